@@ -0,0 +1,305 @@
+#include "pch.h"
+
+#include "Managers/AnimationManager.h"
+
+#include "Core/Animation.h"
+#include "Core/Skeleton.h"
+#include "Core/PoseCache.h"
+
+#include "Core/ECS/Entity.h"
+#include "Core/ECS/TransformComponent.h"
+#include "Core/ECS/AnimationComponent.h"
+
+#include "Utils/ModelImporter.h"
+
+#include <chrono>
+
+// Headless animation benchmark
+// Loads the rigged models, instantiates them and times the animation update without creating a window or a Vulkan device
+//
+// Usage: AnimationBenchmark [--copies N] [--frames N] [--desync] [--no-pose-cache] [model paths...]
+// If no model is given, every model found under assets/ is loaded
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct BenchmarkSettings
+{
+	u32 copies = 64;
+	u32 frames = 1000;
+	f64 deltaTime = 1.0 / 60.0;
+	// Start every copy at a different time instead of playing in sync
+	bool desync = false;
+	bool enablePoseCache = true;
+	std::vector<std::string> modelPaths;
+};
+
+struct BenchmarkInstance
+{
+	Entity* rootEntity;
+	Skeleton* skeleton;
+	AnimationComponent* animationComp;
+};
+
+struct FrameTimings
+{
+	std::vector<f64> animationUpdate;
+	std::vector<f64> transformPropagation;
+	std::vector<f64> boneUniformUpdate;
+	std::vector<f64> total;
+};
+
+static f64 elapsedMicroseconds(Clock::time_point start, Clock::time_point end)
+{
+	return std::chrono::duration<f64, std::micro>(end - start).count();
+}
+
+static f64 percentile(std::vector<f64> samples, f64 p)
+{
+	if (samples.empty())
+		return 0;
+
+	std::sort(samples.begin(), samples.end());
+
+	u64 index = static_cast<u64>(p * (samples.size() - 1) + 0.5);
+
+	return samples[index];
+}
+
+static void printTimings(const char* name, const std::vector<f64>& samples)
+{
+	printf("%-24s p50 %10.2f us    p99 %10.2f us\n", name, percentile(samples, 0.5), percentile(samples, 0.99));
+}
+
+static u64 getAnimationBytes(const Animation* animation)
+{
+	u64 bytes = sizeof(Animation);
+
+	for (auto& it : animation->animationNodes)
+	{
+		const AnimationNode& animationNode = it.second;
+
+		bytes += sizeof(AnimationNode) + animationNode.name.capacity();
+		bytes += sizeof(KeyData) * animationNode.positions.capacity();
+		bytes += sizeof(QuatData) * animationNode.rotations.capacity();
+		bytes += sizeof(KeyData) * animationNode.scales.capacity();
+	}
+
+	return bytes;
+}
+
+static u64 getSkeletonBytes(const Skeleton* skeleton)
+{
+	u64 bytes = sizeof(Skeleton);
+
+	bytes += sizeof(Entity*) * skeleton->hierarchy.capacity();
+	bytes += sizeof(i32) * skeleton->parentIndices.capacity();
+	bytes += sizeof(u32) * skeleton->subtreeEnds.capacity();
+	bytes += skeleton->necessityMask.capacity() / 8;
+	bytes += sizeof(mat4) * skeleton->localPose.capacity();
+	bytes += sizeof(mat4) * skeleton->modelPose.capacity();
+	bytes += sizeof(u32) * skeleton->boneNodeIndices.capacity();
+	bytes += sizeof(i32) * skeleton->boneIds.capacity();
+	bytes += sizeof(mat4) * skeleton->inverseBindMatrices.capacity();
+	bytes += sizeof(u32) * skeleton->attachmentIndices.capacity();
+
+	return bytes;
+}
+
+static BenchmarkSettings parseArguments(int argc, char** argv)
+{
+	BenchmarkSettings settings;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+
+		if (argument == "--copies" && i + 1 < argc)
+			settings.copies = static_cast<u32>(std::stoul(argv[++i]));
+		else if (argument == "--frames" && i + 1 < argc)
+			settings.frames = static_cast<u32>(std::stoul(argv[++i]));
+		else if (argument == "--desync")
+			settings.desync = true;
+		else if (argument == "--no-pose-cache")
+			settings.enablePoseCache = false;
+		else
+			settings.modelPaths.push_back(argument);
+	}
+
+	if (settings.modelPaths.empty())
+	{
+		const std::set<std::string> extensions = { ".gltf", ".glb", ".fbx", ".dae" };
+
+		for (auto& entry : std::filesystem::recursive_directory_iterator("assets"))
+		{
+			std::string extension = entry.path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+			if (entry.is_regular_file() && extensions.contains(extension))
+				settings.modelPaths.push_back(entry.path().string());
+		}
+	}
+
+	return settings;
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkSettings settings = parseArguments(argc, argv);
+
+	std::unordered_map<u32, Animation*> animations;
+	std::vector<Skeleton*> skeletons;
+	std::vector<BenchmarkInstance> instances;
+	// Order: Root Entity Id->Instance Index
+	std::unordered_map<u32, u32> instanceIndices;
+
+	AnimationManager animationManager;
+	animationManager.init(animations);
+
+	PoseCache poseCache;
+
+	// Load models
+	// There is no entity cloning, so every copy is loaded from the file again
+	Clock::time_point loadStart = Clock::now();
+
+	for (const std::string& modelPath : settings.modelPaths)
+	{
+		for (u32 copy = 0; copy < settings.copies; copy++)
+		{
+			std::vector<Mesh*> loadedMeshes;
+			std::map<u32, Material*> loadedMaterials;
+			Skeleton* loadedSkeleton = nullptr;
+			std::vector<Entity*> entities;
+			std::vector<Animation*> loadedAnimations;
+			std::tie(loadedMeshes, loadedMaterials, loadedSkeleton, loadedAnimations) = WillEngine::Utils::readModel(modelPath.c_str(), &entities);
+
+			if (!loadedSkeleton || loadedAnimations.empty())
+			{
+				if (copy == 0)
+					printf("Skipping %s: no skeleton or animation\n", modelPath.c_str());
+
+				break;
+			}
+
+			if (copy == 0)
+				printf("Loaded %s: %u entities, %u bones, %u animations\n", modelPath.c_str(), static_cast<u32>(entities.size()),
+					loadedSkeleton->getNumBones(), static_cast<u32>(loadedAnimations.size()));
+
+			loadedSkeleton->generateHierarchy(entities[0]);
+			skeletons.push_back(loadedSkeleton);
+
+			for (Animation* animation : loadedAnimations)
+			{
+				animations[animation->id] = animation;
+			}
+
+			Entity* rootEntity = entities[0];
+			rootEntity->addComponent<AnimationComponent>();
+
+			AnimationComponent* animationComp = rootEntity->GetComponent<AnimationComponent>();
+			for (Animation* animation : loadedAnimations)
+			{
+				animationComp->addAnimation(animation);
+			}
+
+			if (settings.desync)
+				animationComp->setTime(loadedAnimations[0]->getDuration() * copy / settings.copies);
+
+			instanceIndices[rootEntity->id] = static_cast<u32>(instances.size());
+			instances.push_back({ rootEntity, loadedSkeleton, animationComp });
+		}
+	}
+
+	printf("Load time: %.2f ms\n", elapsedMicroseconds(loadStart, Clock::now()) / 1000.0);
+
+	if (instances.empty())
+	{
+		printf("No animated model loaded\n");
+		return 1;
+	}
+
+	// Place every skeleton in its bind pose before the first frame
+	for (BenchmarkInstance& instance : instances)
+	{
+		instance.skeleton->updatePose(nullptr, nullptr);
+		instance.skeleton->syncEntities();
+	}
+
+	// Frames
+	FrameTimings timings;
+
+	for (u32 frame = 0; frame < settings.frames; frame++)
+	{
+		Clock::time_point frameStart = Clock::now();
+
+		for (BenchmarkInstance& instance : instances)
+		{
+			animationManager.addToQueue(instance.animationComp);
+		}
+
+		animationManager.update(static_cast<f32>(settings.deltaTime));
+
+		Clock::time_point animationEnd = Clock::now();
+
+		// The same work as SystemManager::processTransformationCalculations for skeletal models
+		poseCache.beginFrame();
+
+		std::vector<Skeleton*> updatedSkeletons;
+
+		while (!animationManager.transformToUpdate.empty())
+		{
+			Entity* rootEntity = animationManager.transformToUpdate.front()->getRoot();
+
+			BenchmarkInstance& instance = instances[instanceIndices.at(rootEntity->id)];
+
+			AnimationComponent* animationComp = instance.animationComp;
+			Animation* animation = animations.at(animationComp->getCurrentAnimationId());
+
+			instance.skeleton->readLocalPose(rootEntity, false);
+			instance.skeleton->updatePose(animation, animationComp, settings.enablePoseCache ? &poseCache : nullptr);
+			instance.skeleton->syncEntities();
+
+			updatedSkeletons.push_back(instance.skeleton);
+
+			animationManager.transformToUpdate.pop();
+		}
+
+		Clock::time_point transformEnd = Clock::now();
+
+		for (Skeleton* skeleton : updatedSkeletons)
+		{
+			skeleton->updateBoneUniform();
+		}
+
+		Clock::time_point frameEnd = Clock::now();
+
+		timings.animationUpdate.push_back(elapsedMicroseconds(frameStart, animationEnd));
+		timings.transformPropagation.push_back(elapsedMicroseconds(animationEnd, transformEnd));
+		timings.boneUniformUpdate.push_back(elapsedMicroseconds(transformEnd, frameEnd));
+		timings.total.push_back(elapsedMicroseconds(frameStart, frameEnd));
+	}
+
+	// Resident animation data
+	u64 animationBytes = 0;
+	for (auto& it : animations)
+	{
+		animationBytes += getAnimationBytes(it.second);
+	}
+
+	u64 skeletonBytes = 0;
+	for (Skeleton* skeleton : skeletons)
+	{
+		skeletonBytes += getSkeletonBytes(skeleton);
+	}
+
+	printf("\n");
+	printf("Instances: %u, Frames: %u, %s\n", static_cast<u32>(instances.size()), settings.frames, settings.desync ? "desynced" : "in sync");
+	printTimings("Animation update", timings.animationUpdate);
+	printTimings("Transform propagation", timings.transformPropagation);
+	printTimings("Bone uniform update", timings.boneUniformUpdate);
+	printTimings("Frame", timings.total);
+	printf("Pose cache total hit rate: %.2f%%\n", poseCache.getTotalHitRate() * 100.0f);
+	printf("Animation clip data: %llu bytes\n", static_cast<unsigned long long>(animationBytes));
+	printf("Skeleton pose data: %llu bytes\n", static_cast<unsigned long long>(skeletonBytes));
+
+	return 0;
+}
@@ -47,4 +47,9 @@ public:
 	void addScale(const vec3 scale, f64 time) { scales.push_back({ scale, time }); };
 	const KeyData& getScale(u32 i) const { return scales[i]; };
 	u32 getNumScale() const { return scales.size(); }
+
+	// Find the key in use at a given tick, i.e. the first key after the tick or the last key if we have reached the end
+	u32 findPositionIndex(f64 tick) const;
+	u32 findRotationIndex(f64 tick) const;
+	u32 findScaleIndex(f64 tick) const;
 };
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+#include "Core/UniformClass.h"
+#include "Core/Animation.h"
+#include "Core/Skeleton.h"
+
+#include "Core/Vulkan/VulkanDefines.h"
+
+#include "Utils/VulkanUtil.h"
+
+struct BakedAnimationClip
+{
+	u32 animationId;
+	// Offset of the first matrix of this clip in the baked bone matrices
+	u32 firstMatrix;
+	u32 numFrames;
+	f32 duration;
+};
+
+// Animation clips of a skeleton baked into per-frame bone matrices
+// Instances look up their palette by (clip, frame) in the skinning shader, so they cost nothing on the CPU every frame
+class BakedAnimation
+{
+public:
+
+	static constexpr f32 DEFAULT_FRAME_RATE = 30.0f;
+	static const u32 MAX_INSTANCES = 4096;
+
+public:
+
+	const u32 skeletonId;
+	const u32 numBones;
+	const f32 frameRate;
+
+	std::vector<BakedAnimationClip> clips;
+
+	// Order: Clip->Frame->Bone Id
+	std::vector<mat4> boneMatrices;
+
+	// The skinned meshes drawn for every instance
+	std::vector<u32> meshIndicies;
+	std::vector<u32> materialIndicies;
+
+	std::vector<BakedAnimationInstance> instances;
+
+public:
+
+	// For Vulkan
+	VulkanAllocatedMemory boneMatrixBuffer;
+	// Order: Frame In Flight->Instance Buffer
+	// Every frame in flight has its own copy so an update never overwrites instances a previous frame is still drawing
+	std::vector<VulkanAllocatedMemory> instanceBuffers;
+	VkDescriptorSet boneMatrixDescriptorSet;
+
+private:
+
+	// Order: Frame In Flight->Instances changed since its instance buffer was last updated
+	std::vector<bool> instancesChanged;
+	bool readyToDraw;
+
+public:
+
+	BakedAnimation(const Skeleton* skeleton, f32 frameRate = DEFAULT_FRAME_RATE);
+	~BakedAnimation();
+
+	// Bake the animation into the bone matrices and return its clip index
+	u32 addClip(const Skeleton* skeleton, const Animation* animation);
+
+	void addMesh(u32 meshId, u32 materialId);
+
+	void addInstance(const mat4& modelTransform, u32 clipIndex, f32 timeOffset);
+	void clearInstances();
+
+	void uploadDataToPhysicalDevice(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkSurfaceKHR& surface, VkQueue& queue,
+		VkDescriptorPool& descriptorPool, VkDescriptorSetLayout& descriptorSetLayout, u32 numFramesInFlight);
+
+	// Record an update of the frame's instance buffer if any instance has changed since its last update
+	void updateInstanceBuffer(VkCommandBuffer& commandBuffer, u32 frameIndex);
+
+	// Split a playback time (in seconds) into whole baked frames and the fraction of the current one
+	void getPlaybackFrame(f64 time, u32& frame, f32& frameFraction) const;
+
+	void cleanup(VkDevice& logicalDevice, VmaAllocator& vmaAllocator, VkDescriptorPool& descriptorPool);
+
+	u32 getNumInstances() const { return static_cast<u32>(instances.size()); };
+	u64 getBakedSize() const { return sizeof(mat4) * boneMatrices.size(); };
+	bool isReadyToDraw() const { return readyToDraw; };
+
+	// Sample an animation at a fixed frame rate into numFrames * numBones matrices, ordered by frame and then bone id
+	static std::vector<mat4> bake(const Skeleton* skeleton, const Animation* animation, f32 frameRate, u32& numFrames);
+};
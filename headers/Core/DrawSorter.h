@@ -0,0 +1,44 @@
+#pragma once
+
+// Sorts draw packets by a 64 bit key with a least significant digit radix sort
+// Every thread counts the digits of its own chunk of keys, then scatters the chunk once the counts have been turned into offsets,
+// so the sort is stable and packets with equal keys keep their original order
+class DrawSorter
+{
+public:
+
+	// Below this many keys per thread it is cheaper to sort on fewer threads
+	static const u32 MIN_KEYS_PER_THREAD = 4096;
+
+	// The keys are sorted one byte at a time
+	static const u32 RADIX = 256;
+
+private:
+
+	// Keys and packet indices being read and written by the current pass, swapped after every pass
+	std::vector<u64> keys;
+	std::vector<u64> scratchKeys;
+	std::vector<u32> order;
+	std::vector<u32> scratchOrder;
+
+	// Digit counts of every thread, then the offset the thread writes the next key with that digit to
+	std::vector<u32> histograms;
+
+public:
+
+	DrawSorter();
+	~DrawSorter();
+
+	// Sort the keys on up to maxThreads threads
+	void sort(const std::vector<u64>& sortKeys, u32 maxThreads);
+
+	// Index of the packet at every position of the sorted order
+	const std::vector<u32>& getOrder() const { return order; };
+
+private:
+
+	// Count the digits of the keys [begin, end) at the given byte
+	void countDigits(u32* histogram, u32 shift, u32 begin, u32 end);
+	// Move the keys [begin, end) to their sorted position for the given byte
+	void scatterDigits(u32* histogram, u32 shift, u32 begin, u32 end);
+};
\ No newline at end of file
@@ -21,6 +21,9 @@ namespace WillEngine
 		// A copy of world transformation
 		mat4 worldTransformation;
 
+		// Incremented whenever the world transformation changes, so data derived from it knows when it is stale
+		u32 worldVersion;
+
 	public:
 
 		TransformComponent();
@@ -53,11 +56,14 @@ namespace WillEngine
 		mat4 getLocalTransformation(const Animation* animation, const AnimationComponent* animationComp) const;
 		mat4 getGlobalTransformation(const Animation* animation, const AnimationComponent* animationComp) const;
 
-		void updateWorldTransformation() { worldTransformation = getGlobalTransformation(); };
-		void updateWorldTransformation(const Animation* animation, const AnimationComponent* animationComp) { worldTransformation = getGlobalTransformation(animation, animationComp); };
+		u32 getWorldVersion() const { return worldVersion; };
+
+		void setWorldTransformation(const mat4& transformation) { worldTransformation = transformation; worldVersion++; };
+		void updateWorldTransformation() { setWorldTransformation(getGlobalTransformation()); };
+		void updateWorldTransformation(const Animation* animation, const AnimationComponent* animationComp) { setWorldTransformation(getGlobalTransformation(animation, animationComp)); };
 
 		void updateAllChildWorldTransformation();
-		void updateAllChildWorldTransformation(const Animation* animation, const AnimationComponent* animationComp, const std::unordered_map<std::string, bool>* necessityMap = nullptr);
+		void updateAllChildWorldTransformation(const Animation* animation, const AnimationComponent* animationComp);
 
 	private:
 
@@ -0,0 +1,53 @@
+#pragma once
+
+// Tests world space bounding spheres against the six planes of the camera frustum
+// The spheres are stored as a structure of arrays so the planes are tested against several objects at once with SSE, or AVX if it is enabled
+class FrustumCuller
+{
+public:
+
+	// Counters of the last cull
+	u32 numTested;
+	u32 numCulled;
+
+	// Below this many objects per thread it is cheaper to test on fewer threads
+	static const u32 MIN_OBJECTS_PER_THREAD = 4096;
+
+private:
+
+	// World space bounding spheres, padded to a multiple of the SIMD width
+	std::vector<f32> centreX;
+	std::vector<f32> centreY;
+	std::vector<f32> centreZ;
+	std::vector<f32> radius;
+
+	// 1 if the object at the same index intersects the frustum
+	std::vector<u8> visibility;
+
+	u32 numObjects;
+
+public:
+
+	FrustumCuller();
+	~FrustumCuller();
+
+	// Remove every object of the previous cull
+	void clear();
+
+	// Add a world space bounding sphere (xyz: centre, w: radius), returns the index of the object
+	u32 addObject(const vec4& worldBoundingSphere);
+
+	// Test every object, the objects are split into chunks tested on up to maxThreads threads
+	void cull(const mat4& viewProjection, u32 maxThreads);
+
+	bool isVisible(u32 object) const { return visibility[object] != 0; };
+	u32 getNumObjects() const { return numObjects; };
+
+	// Normalised planes pointing inwards (left, right, bottom, top, near, far), extracted from the view projection matrix
+	static void getFrustumPlanes(const mat4& viewProjection, vec4* planes);
+
+private:
+
+	// Test the objects [begin, end), begin is a multiple of the SIMD width. Returns the number of culled objects
+	u32 cullRange(const vec4* planes, u32 begin, u32 end);
+};
@@ -4,6 +4,8 @@
 #include "Core/Material.h"
 #include "Core/Light.h"
 #include "Core/Skeleton.h"
+#include "Core/BakedAnimation.h"
+#include "Core/PoseCache.h"
 #include "Core/LightComponent.h"
 #include "Animation.h"
 
@@ -31,6 +33,45 @@ struct GameState
 		std::array<VkDescriptorSet, 7> upSampledImage_ImGui;
 
 		VulkanFramebuffer GBuffers;
+
+		// The render graph only allocates the images a pass reads
+		// The bloom and G-Buffer viewers can only show images that exist
+		bool bloomImagesAvailable;
+		bool renderTargetsViewable;
+
+		// Render graph statistics
+		u64 renderGraphMemory;
+		u64 renderGraphUnaliasedMemory;
+		u32 renderGraphCulledPasses;
+
+		// GPU driven rendering statistics
+		u32 indirectObjects;
+		u32 indirectBatches;
+		u32 indirectClusters;
+
+		// Instancing statistics of the mesh draws recorded on the CPU
+		u32 instancedMeshes;
+		u32 instancedDraws;
+
+		// Vertex buffer binds of the previous frame, and the ones skipped because the draw before had bound the same
+		u32 recordedBinds;
+		u32 skippedBinds;
+
+		// CPU frustum culling statistics
+		u32 frustumTestedObjects;
+		u32 frustumCulledObjects;
+
+		// Occlusion culling statistics of the GPU driven draws, read back from a previous frame
+		u32 occlusionCulledObjects;
+		u32 occlusionLateObjects;
+
+		// Clusters of the visible GPU driven objects tested against the camera and the ones outside the frustum or facing away
+		u32 testedClusters;
+		u32 culledClusters;
+
+		// Draws of every level of detail picked for the camera and for the shadow
+		u32 cameraLodDraws[MAX_MESH_LODS];
+		u32 shadowLodDraws[MAX_MESH_LODS];
 	} graphicsState;
 	
 	struct GraphicsResources
@@ -51,9 +92,18 @@ struct GameState
 
 		std::unordered_map<u32, Skeleton*> skeletons;
 
+		// Order: Root Entity Id->Skeleton Id
+		std::unordered_map<u32, u32> rootEntitySkeletons;
+
 		std::unordered_map<u32, Animation*> animations;
+
+		// Order: Skeleton Id->Baked Animation
+		std::unordered_map<u32, BakedAnimation*> bakedAnimations;
 	} gameResources;
 
+	// Poses evaluated in the current frame, shared between skeletons playing the same clip in sync
+	PoseCache poseCache;
+
 	struct UIParams
 	{
 		u32 selectedEntityId;
@@ -78,5 +128,24 @@ struct GameState
 	struct GameSettings
 	{
 		bool enableBloom;
+		bool bakeAnimations;
+		bool enablePoseCache;
+		// Keep the G-Buffers and bloom images alive until the UI pass to display them in the debugger
+		bool viewRenderTargets;
+		// Cull static meshes in a compute shader and draw them with indirect draws
+		bool gpuDrivenRendering;
+		// Skip the meshes drawn on the CPU that are outside of the camera frustum
+		bool enableFrustumCulling;
+		// Skip the GPU driven draws hidden behind the depth pre-pass
+		bool enableOcclusionCulling;
+		// Skip the clusters of the GPU driven draws outside the camera frustum or facing away from the camera
+		bool enableClusterCulling;
+		// Draw the levels of detail of the meshes, the shadow accepts the projected error times its bias
+		bool enableLods;
+		f32 shadowLodBias;
+		// Draw every mesh with this level of detail if it is not negative
+		i32 forcedLod;
+		// Tint the meshes of the geometry pass by their level of detail
+		bool showLodColors;
 	} gameSettings;
 };
\ No newline at end of file
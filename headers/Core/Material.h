@@ -25,6 +25,9 @@ struct TextureDescriptorSet
 	// Texture Descriptor Set for imgui UI
 	VkDescriptorSet imguiTextureDescriptorSet;
 
+	// Element of the texture in the bindless texture array, written once the material is added to the engine
+	u32 bindlessIndex;
+
 	// Constructor
 	TextureDescriptorSet();
 };
@@ -53,10 +56,6 @@ public:
 	// Others: 5. Normal Map
 	TextureDescriptorSet textures[TEXTURE_SIZE];
 
-	// Descriptor Set / Uniform Buffer for vulkan
-	VkDescriptorSetLayout textureDescriptorSetLayout;
-	VkDescriptorSet textureDescriptorSet;
-
 private:
 
 	// Used for generating an id for a material
@@ -67,7 +66,7 @@ public:
 	Material(const Material* material);
 	~Material();
 
-	void cleanUp(VkDevice& logicalDevice, VmaAllocator& vmaAllocator, VkDescriptorPool& descriptorPool);
+	void cleanUp(VkDevice& logicalDevice, VmaAllocator& vmaAllocator);
 
 	// Setters
 	void setTextureImage(u32 index, Image* image, TextureDescriptorSet* textures);
@@ -78,12 +77,14 @@ public:
 	void initTexture(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkCommandPool& commandPool, VkQueue& graphicsQueue, 
 		TextureDescriptorSet* textures, u32 index);
 
-	void initDescriptorSet(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkCommandPool& commandPool,
-		VkDescriptorPool& descriptorPool, VkQueue& graphicsQueue);
+	// The textures are sampled through the bindless texture array of the engine, see VulkanEngine::addMaterial
+	void initTextures(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkCommandPool& commandPool,
+		VkQueue& graphicsQueue);
 
 	// Update
-	void updateDescriptorSet(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkCommandPool& commandPool,
-		VkDescriptorPool& descriptorPool, VkQueue& graphicsQueue, u32 index);
+	// The texture keeps its element of the bindless texture array, the engine rewrites it with the new image
+	void updateTexture(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkCommandPool& commandPool,
+		VkQueue& graphicsQueue, u32 index);
 
 	// Getters
 	const bool hasTexture(u32 index, TextureDescriptorSet* textures);
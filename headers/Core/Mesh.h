@@ -1,8 +1,12 @@
 #pragma once
 #include "Core/BoneWeight.h"
+#include "Core/Meshlet.h"
+#include "Core/MeshLod.h"
 
 #include "Utils/VulkanUtil.h"
 
+#include "Core/Vulkan/VulkanGeometryArena.h"
+
 #include "Managers/FileManager.h"
 
 class Mesh
@@ -16,7 +20,8 @@ public:
 
 	std::vector<vec3> positions;
 	std::vector<vec3> normals;
-	std::vector<vec3> tangents;
+	// w: sign of the bitangent
+	std::vector<vec4> tangents;
 	std::vector<vec2> uvs;
 	std::vector<u32> indicies;
 
@@ -24,15 +29,31 @@ public:
 
 	u32 indiciesSize;
 
-	// Vertex Buffer
-	VulkanAllocatedMemory positionBuffer;
-	VulkanAllocatedMemory normalBuffer;
-	VulkanAllocatedMemory tangentBuffer;
-	VulkanAllocatedMemory uvBuffer;
-	VulkanAllocatedMemory indexBuffer;
+	// Bounds of the positions in mesh space, computed when the mesh is imported and kept after the positions are freed
+	vec3 aabbMin;
+	vec3 aabbMax;
+	// xyz: centre, w: radius
+	vec4 boundingSphere;
+
+	// Clusters of the triangles culled on their own by the GPU driven draws, built when the mesh is imported and kept with the bounds
+	std::vector<Meshlet> meshlets;
+	// Simplified levels follow the full mesh in the indices, generated when the mesh is imported
+	std::vector<MeshLod> lods;
+
+	// Vertices and indices in the geometry arena of the mesh's vertex layout
+	VulkanGeometryArena* geometryArena;
+	VulkanGeometryRange geometryRange;
+
+	// Compressed positions are quantised inside the bounding box, position = positionOffset + positionScale * quantised position
+	// The offset is 0 and the scale 1 if the vertices are not compressed
+	vec3 positionOffset;
+	vec3 positionScale;
 
 	VkPrimitiveTopology primitive;
 
+	// Marks a vertex that is dropped when the vertices are remapped
+	static const u32 REMOVED_VERTEX = UINT32_MAX;
+
 private:
 
 	// Used for generating an id for a mesh
@@ -42,19 +63,53 @@ protected:
 
 	bool readyToDraw;
 
+	// Quantise the positions inside the bounding box and pack the other attributes, sets the dequantisation transform
+	void compressVertices(std::vector<u64>& compressedPositions, std::vector<VulkanCompressedAttributes>& compressedAttributes);
+
+	// Free the vertex data once it is in the geometry arena
+	void releaseVertexData();
+
+	// Attributes the mesh does not have are left empty
+	template<typename T>
+	static void remapAttribute(std::vector<T>& attribute, const std::vector<u32>& remap, u32 numVertices)
+	{
+		if (attribute.empty())
+			return;
+
+		std::vector<T> remapped(numVertices);
+		for (u32 i = 0; i < attribute.size(); i++)
+		{
+			if (remap[i] != REMOVED_VERTEX)
+				remapped[remap[i]] = attribute[i];
+		}
+
+		attribute.swap(remapped);
+	}
+
 public:
 
 	Mesh();
 	Mesh(const Mesh* mesh);
 	virtual ~Mesh();
 
-	virtual void uploadDataToPhysicalDevice(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkSurfaceKHR& surface, VkQueue& queue);
+	// The arena has to match the mesh's geometry type
+	virtual void uploadDataToPhysicalDevice(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkSurfaceKHR& surface, VkQueue& queue,
+		VulkanGeometryArena& geometryArena);
 
-	virtual std::vector<VkBuffer> getVulkanBuffers() const;
-	virtual u32 getVulkanBufferSize() const { return 4; };
-	virtual std::vector<VkDeviceSize> getVulkanOffset() const;
+	virtual VulkanGeometryType getGeometryType() const { return VulkanGeometryType::Static; };
 
+	// Free the mesh's range of the geometry arena
 	virtual void cleanup(VkDevice& logicalDevice, VmaAllocator vmaAllocator);
 
+	// Compute the bounding box and sphere from the positions
+	void computeBounds();
+
+	// The full mesh is the only level if no levels were generated
+	u32 getNumLods() const { return std::max(1u, static_cast<u32>(lods.size())); };
+	MeshLod getLod(u32 lod) const;
+
+	// Move every vertex to its index in remap, or drop it. The indices have to be remapped already
+	virtual void remapVertices(const std::vector<u32>& remap, u32 numVertices);
+
 	virtual bool isReadyToDraw() const { return readyToDraw; };
 };
\ No newline at end of file
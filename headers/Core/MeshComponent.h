@@ -2,6 +2,7 @@
 #include "Utils/VulkanUtil.h"
 
 #include "Core/ECS/Component.h"
+#include "Core/ECS/TransformComponent.h"
 #include "Core/Mesh.h"
 #include "Core/Material.h"
 #include "Core/UniformClass.h"
@@ -22,6 +23,27 @@ namespace WillEngine
 		std::vector<u32> meshIndicies;
 		std::vector<u32> materialIndicies;
 
+		// World space bounds of every mesh, at the same index as meshIndicies
+		std::vector<vec3> worldAabbMin;
+		std::vector<vec3> worldAabbMax;
+		std::vector<vec4> worldBoundingSpheres;
+
+		// World transformation the meshes are drawn with in the current and the previous frame
+		mat4 worldTransformation;
+		mat4 previousWorldTransformation;
+
+		// Slot of every mesh in the GPU driven object buffers, at the same index as meshIndicies
+		std::vector<u32> indirectObjectSlots;
+
+	private:
+
+		// World version of the transformation the bounds were computed with
+		u32 worldBoundsVersion;
+		bool worldBoundsValid;
+
+		// False until the meshes have been drawn once
+		bool transformationHistoryValid;
+
 	public:
 
 		MeshComponent();
@@ -36,6 +58,13 @@ namespace WillEngine
 
 		virtual u32 getNumMesh() const { return meshIndicies.size(); };
 
+		// Recompute the world bounds if the world transformation has changed since they were last computed
+		void updateWorldBounds(TransformComponent* transformComp, const std::unordered_map<u32, Mesh*>& meshes);
+
+		// Move the transformation of the current frame to the previous one, called once per frame before drawing
+		// The first frame has no previous transformation, so it uses the current one
+		void updateTransformationHistory(const mat4& transformation);
+
 		virtual ComponentType getType() { return id; };
 	};
 }
@@ -0,0 +1,19 @@
+#pragma once
+
+// Levels of detail of a mesh, including the full mesh
+static const u32 MAX_MESH_LODS = 4;
+
+// Level of detail of a mesh, every level shares the mesh's vertices and has its own range of the mesh's indices
+struct MeshLod
+{
+	// Relative to the first index of the mesh
+	u32 firstIndex;
+	u32 numIndices;
+
+	// Meshlets of the level in the mesh's meshlets
+	u32 firstMeshlet;
+	u32 numMeshlets;
+
+	// Largest distance the surface moved from the full mesh in mesh space, 0 for the full mesh
+	f32 error;
+};
\ No newline at end of file
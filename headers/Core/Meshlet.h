@@ -0,0 +1,22 @@
+#pragma once
+
+// Cone cutoff of a meshlet whose triangles face too many directions to be back-face culled together
+const f32 MESHLET_NO_CONE = 2.0f;
+
+// Cluster of neighbouring triangles of a mesh, culled on its own by the GPU driven draws
+// The triangles are a range of the mesh's indices, so a meshlet is drawn from the mesh's index buffer
+struct Meshlet
+{
+	// Relative to the first index of the mesh
+	u32 firstIndex;
+	u32 numIndices;
+	u32 numVertices;
+
+	// xyz: centre in mesh space, w: radius
+	vec4 boundingSphere;
+
+	// Every triangle faces away from a camera with dot(normalize(coneApex - camera), coneAxis) >= coneCutoff
+	vec3 coneApex;
+	vec3 coneAxis;
+	f32 coneCutoff;
+};
\ No newline at end of file
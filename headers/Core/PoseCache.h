@@ -0,0 +1,57 @@
+#pragma once
+
+struct PoseCacheKey
+{
+	// Skeletons with the same hierarchy, bones and bind pose share a layout
+	u64 layoutHash;
+	u32 animationId;
+	// Sample time quantized to the animation's ticks
+	u64 tick;
+
+	bool operator==(const PoseCacheKey& other) const = default;
+};
+
+struct PoseCacheKeyHash
+{
+	size_t operator()(const PoseCacheKey& key) const;
+};
+
+// Poses evaluated in the current frame, shared by every skeleton playing the same clip at the same tick
+class PoseCache
+{
+public:
+
+	// Counters of the current frame
+	u32 hits;
+	u32 misses;
+
+	// Counters since the cache was created
+	u64 totalHits;
+	u64 totalMisses;
+
+private:
+
+	// Order: Key->Pose Index
+	std::unordered_map<PoseCacheKey, u32, PoseCacheKeyHash> poseIndices;
+
+	// The pose buffers are kept between frames so they do not have to be allocated again
+	std::vector<std::vector<mat4>> poses;
+	u32 numPosesUsed;
+
+public:
+
+	PoseCache();
+	~PoseCache();
+
+	// Drop every pose of the previous frame
+	void beginFrame();
+
+	// Return the cached pose or nullptr if it has not been evaluated in this frame
+	const std::vector<mat4>* find(const PoseCacheKey& key);
+
+	// Return a pose buffer to evaluate the pose of the key into
+	std::vector<mat4>& insert(const PoseCacheKey& key);
+
+	f32 getHitRate() const { return hits + misses ? static_cast<f32>(hits) / (hits + misses) : 0; };
+	f32 getTotalHitRate() const { return totalHits + totalMisses ? static_cast<f32>(totalHits) / (totalHits + totalMisses) : 0; };
+};
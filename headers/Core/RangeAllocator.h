@@ -0,0 +1,46 @@
+#pragma once
+#include <map>
+
+// Hands out ranges of a linear resource, e.g. the vertices of a buffer shared by many meshes
+// Free ranges are found best fit by size and merged with their neighbours when freed, so freeing in any order never leaves
+// two adjacent free ranges behind
+class RangeAllocator
+{
+private:
+
+	// Free ranges by offset, used to merge neighbours
+	std::map<u32, u32> freeByOffset;
+	// Free ranges by size, used to find the smallest range that fits
+	std::multimap<u32, u32> freeBySize;
+
+	u32 capacity;
+	u32 allocated;
+
+public:
+
+	RangeAllocator();
+	~RangeAllocator();
+
+	// Free every range, the whole capacity is one free range
+	void reset(u32 capacity);
+	// Extend the capacity, the added space is merged with a free range at the end
+	void grow(u32 newCapacity);
+
+	// Returns false if no free range is large enough
+	bool allocate(u32 count, u32& offset);
+	void free(u32 offset, u32 count);
+
+	u32 getCapacity() const { return capacity; };
+	u32 getAllocated() const { return allocated; };
+	u32 getLargestFreeRange() const { return freeBySize.empty() ? 0 : freeBySize.rbegin()->first; };
+
+	// 0 if every free element is in one range, close to 1 if the free space is split into many small ranges
+	f32 getFragmentation() const;
+
+private:
+
+	// Add a free range, merged with the free ranges right before and after it
+	void mergeFreeRange(u32 offset, u32 count);
+	void addFreeRange(u32 offset, u32 count);
+	void removeFreeRange(std::map<u32, u32>::iterator range);
+};
\ No newline at end of file
@@ -2,10 +2,12 @@
 #include "UniformClass.h"
 
 #include "Core/Animation.h"
+#include "Core/PoseCache.h"
 
 #include "Core/Vulkan/VulkanDefines.h"
 
 #include "Core/ECS/Entity.h"
+#include "Core/ECS/AnimationComponent.h"
 
 using namespace WillEngine;
 
@@ -42,21 +44,60 @@ public:
 	std::unordered_map<std::string, BoneInfo> boneInfos;
 	BoneUniform boneUniform;
 
-	// Order: Entity(By Name)->Update Transform
-	// A map to record whether which entity should recalculate its global world transformation
+	// The entity hierarchy this skeleton belongs to, flattened in depth first order
+	// A parent is always stored before its children and every subtree is stored contiguously
+	// The entities are only read when the hierarchy is generated or edited, the pose buffers below are the runtime data
+	std::vector<Entity*> hierarchy;
+	// Order: Hierarchy Index->Parent Hierarchy Index (-1 for the root)
+	std::vector<i32> parentIndices;
+	// Order: Hierarchy Index->One past the last hierarchy index of its subtree
+	std::vector<u32> subtreeEnds;
+
+	// Order: Hierarchy Index->Update Transform
+	// A bitset to record whether which entity should recalculate its global world transformation
+	// It is generated once when the model is loaded
 	// For more details see (Bones section): https://assimp.sourceforge.net/lib_html/data.html
-	std::unordered_map<std::string, bool> necessityMap;
+	std::vector<bool> necessityMask;
+
+	// Pose buffers
+	// Order: Hierarchy Index->Transformation
+	// The bind pose holds the entities' own local transformation, the nodes a clip doesn't animate are reset to it
+	std::vector<mat4> bindPose;
+	std::vector<mat4> localPose;
+	std::vector<mat4> modelPose;
+
+	// Order: Bone->Hierarchy Index / Bone Id / Inverse Bind (Offset) Matrix
+	std::vector<u32> boneNodeIndices;
+	std::vector<i32> boneIds;
+	std::vector<mat4> inverseBindMatrices;
+
+	// Hierarchy indices of the entities with a mesh attached, they are synced from the pose buffer after every update
+	std::vector<u32> attachmentIndices;
+
+	// Hash of the hierarchy, bones and bind pose, skeletons with the same layout can share their evaluated poses
+	u64 layoutHash;
+
+	// Sync every necessary entity from the pose buffer instead of only the attachments
+	// Enable this if the bone entities' world transformation is needed, e.g. for attaching objects to a bone
+	bool syncAllEntities;
 
 public:
 
 	// For Vulkan Uniform Buffer
-	VulkanDescriptorSet boneDescriptorSet;
-	VulkanAllocatedMemory boneUniformBuffer;
+	// Order: Frame In Flight->Descriptor Set / Uniform Buffer
+	std::vector<VulkanDescriptorSet> boneDescriptorSets;
+	std::vector<VulkanAllocatedMemory> boneUniformBuffers;
 
 private:
 
 	static u32 idCounter;
 
+	// Order: Entity Id->Hierarchy Index
+	std::unordered_map<u32, u32> hierarchyIndices;
+
+	// Order: Animation Id->Hierarchy Index->Animation Node (nullptr if the node is not animated)
+	std::unordered_map<u32, std::vector<const AnimationNode*>> animationChannels;
+
 public:
 
 	Skeleton();
@@ -66,21 +107,52 @@ public:
 
 	void generateBoneUniform();
 
-	void updateBoneUniform(Entity* rootEntity);
-	void calculateBoneTransform(Entity* entity);
+	void updateBoneUniform();
+
+	// Read the local transformation of an entity (and its subtree) back into the pose buffer
+	void readLocalPose(const Entity* entity, bool includeSubtree);
+	// Sample the animation into the local pose if there is one and rebuild the model pose
+	// With a pose cache, the pose is evaluated once per layout, clip and tick in a frame and shared with every other skeleton
+	void updatePose(const Animation* animation, const AnimationComponent* animationComp, PoseCache* poseCache = nullptr);
+	// Write the model pose back to the entities' world transformation
+	void syncEntities();
+
+	// Evaluate the bone palette of an animation at a given time (in seconds) without touching the runtime pose buffers
+	// The palette has to be large enough to hold getNumBones() matrices
+	void evaluateBonePalette(const Animation* animation, f64 time, mat4* palette) const;
 
 	bool hasBones() const { return boneInfos.size(); };
+	u32 getNumBones() const { return static_cast<u32>(boneInfos.size()); };
 	bool hasBone(std::string name) const { return boneInfos.contains(name); };
 
-	void generateNecessityMap(Entity* rootEntity);
-	void resetNecessityMap();
-	void addToNecessityMap(Entity* entity);
-	void buildNecessityMap(Entity* entity);
-	const std::unordered_map<std::string, bool>& getNecessityMap() const { return necessityMap; }
+	void generateHierarchy(Entity* rootEntity);
+	bool isNecessary(u32 index) const { return necessityMask[index]; };
+
+	Entity* getRootEntity() const { return hierarchy.empty() ? nullptr : hierarchy[0]; };
+	std::optional<u32> getHierarchyIndex(const Entity* entity) const;
+	u32 getSubtreeEnd(u32 index) const { return subtreeEnds[index]; };
 
 private:
+
+	void flattenHierarchy(Entity* entity, i32 parentIndex);
+	void generateNecessityMask();
+	void generatePoseBuffers();
+	void generateLayoutHash();
+
+	void samplePose(const Animation* animation, const AnimationComponent* animationComp);
+	// The cached and the uncached pose are both sampled at the whole tick the animation time is in,
+	// so a skeleton looks the same whether or not its pose is shared
+	static f64 getSampleTick(const Animation* animation, const AnimationComponent* animationComp);
+	static mat4 sampleLocalTransformation(const AnimationNode* animationNode, f64 tick);
+	const std::vector<const AnimationNode*>& getAnimationChannels(const Animation* animation);
+	std::vector<const AnimationNode*> bindAnimationChannels(const Animation* animation) const;
+
+	// Sample the channels at a tick and build the model pose into pose
+	// If rootRelative is set, the root is placed at the origin unless it is animated
+	void evaluateModelPose(const std::vector<const AnimationNode*>& channels, f64 tick, bool rootRelative, std::vector<mat4>& pose) const;
+
 	// This traverse all the way back to the root node
-	void traverseRootNecessityMapUpdate(Entity* entity);
-	// This traverse all child node
-	void traverseChildNecessityMapUpdate(Entity* entity);
+	void traverseRootNecessityMaskUpdate(u32 index);
+	// This marks the whole subtree of a node
+	void traverseChildNecessityMaskUpdate(u32 index);
 };
\ No newline at end of file
@@ -7,19 +7,20 @@ public:
 
 	std::vector<BoneWeight> boneWeights;
 
-public:
-
-	VulkanAllocatedMemory boneIdsBuffer;
-	VulkanAllocatedMemory weightsBuffer;
-
 public:
 	
 	SkinnedMesh();
 	virtual ~SkinnedMesh();
 
-	virtual void uploadDataToPhysicalDevice(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkSurfaceKHR& surface, VkQueue& queue);
+	virtual void uploadDataToPhysicalDevice(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkSurfaceKHR& surface, VkQueue& queue,
+		VulkanGeometryArena& geometryArena);
+
+	virtual VulkanGeometryType getGeometryType() const { return VulkanGeometryType::Skinned; };
+
+	virtual void remapVertices(const std::vector<u32>& remap, u32 numVertices);
+
+private:
 
-	virtual std::vector<VkBuffer> getVulkanBuffers() const;
-	virtual u32 getVulkanBufferSize() const { return 6; };
-	virtual std::vector<VkDeviceSize> getVulkanOffset() const;
+	// Scaled to add up to 1 so they survive quantisation, vertices without a bone keep a weight of 0
+	static vec4 normalisedWeights(const BoneWeight& boneWeight);
 };
\ No newline at end of file
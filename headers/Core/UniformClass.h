@@ -7,6 +7,13 @@ struct CameraMatrix
 	mat4 projectionMatrix;
 };
 
+// Camera of the shading pass, the world position of a pixel is reconstructed from its depth
+struct CameraUniform
+{
+	vec4 position;
+	mat4 inverseViewProjection;
+};
+
 struct BoneUniform
 {
 	mat4 boneMatrices[MAX_BONES];
@@ -55,4 +62,37 @@ struct PushConstantModelInfo
 {
 	mat4 modelTransform;
 	//u32 materialIndex;
-};
\ No newline at end of file
+};
+
+// Per-instance vertex data for skinned meshes sampling a baked animation
+struct BakedAnimationInstance
+{
+	mat4 modelTransform;
+	// Offset of the first matrix of the clip in the baked bone matrices
+	u32 firstMatrix;
+	u32 numFrames;
+	f32 frameRate;
+	f32 timeOffset;
+};
+
+struct PushConstantBakedAnimation
+{
+	// Dequantisation of the mesh's positions
+	vec4 positionOffset;
+	vec4 positionScale;
+	// Playback time split into whole baked frames and the fraction of the current one, a float time loses its precision after a few hours
+	u32 frame;
+	f32 frameFraction;
+	u32 numBones;
+	// Entry of the mesh's material in the bindless material buffer
+	u32 materialIndex;
+};
+
+// Mesh of a skinned mesh draw, the other mesh draws read it from their object data
+struct PushConstantSkinnedMesh
+{
+	// Dequantisation of the mesh's positions
+	vec4 positionOffset;
+	vec4 positionScale;
+	u32 materialIndex;
+};
@@ -36,13 +36,19 @@ enum class VulkanDescriptorSetType : u8
 {
 	DepthSkeletal,
 	Skeletal,
+	BakedAnimation,
 	Scene, 
 	Light,
 	LightMatrix,
 	Camera,
-	Texture,
 	Attachment,
-	ShadowMap
+	ShadowMap,
+	Indirect,
+	Cull,
+	HiZ,
+	HiZInput,
+	HiZOutput,
+	Instance
 };
 
 enum class VulkanPipelineType : u8
@@ -53,11 +59,58 @@ enum class VulkanPipelineType : u8
 	Shadow,
 	DepthSkeletal,
 	Skeletal,
+	DepthBakedSkeletal,
+	BakedSkeletal,
 
 	FilterBright,
 	Downscale,
 	Upscale,
-	BlendColor
+	BlendColor,
+
+	Cull,
+	DepthIndirect,
+	GeometryIndirect,
+	ShadowIndirect,
+	HiZ
+};
+
+// Vertex layout of a mesh, meshes with the same layout share a geometry arena
+enum class VulkanGeometryType : u8
+{
+	Static,
+	Skinned
+};
+
+// Vertex input of the pipelines drawing one geometry type
+struct VulkanVertexInput
+{
+	std::vector<VkVertexInputBindingDescription> bindings;
+	std::vector<VkVertexInputAttributeDescription> attributes;
+
+	// Streams of the geometry arena, the baked animation instance binding comes after them
+	u32 numStreams;
+
+	// Read by the vertex shaders as a specialisation constant
+	VkBool32 compressed;
+};
+
+// Normal, tangent and uv of a compressed vertex, interleaved in the stream after the positions
+struct VulkanCompressedAttributes
+{
+	// Octahedral encoding, snorm16x2
+	u32 normal;
+	// Octahedral encoding in xy and the bitangent sign in w, snorm8x4
+	u32 tangent;
+	// Half precision
+	u32 uv;
+};
+
+// Bone influences of a compressed skinned vertex
+struct VulkanCompressedSkin
+{
+	u8 boneIds[4];
+	// unorm16x4
+	u16 weights[4];
 };
 
 enum class VulkanCommandBufferType : u8
@@ -76,6 +129,10 @@ enum class VulkanCommandBufferType : u8
 
 	Upload,
 	UniformUpdate,
+	Cull,
+	HiZ,
+	LateCull,
+	DepthLate,
 	Present
 };
 
@@ -108,30 +165,282 @@ enum class VulkanSamplerType : u8
 enum class VulkanRenderPassType : u8
 {
 	Depth,
+	// Same attachment as Depth, loads the depth of the early draws instead of clearing it
+	DepthLate,
 	Geometry,
 	Shadow,
 	Shading,
 	Present
 };
 
+// The passes of a frame are submitted in one batch and ordered with pipeline barriers
+// Semaphores are only used to sync with the swapchain
 enum class VulkanSemaphoreType : u8
 {
 	ImageAvailable,
-	UniformUpdate,
-	RenderFinished,
 
-	PreDepthFinished,
-	ShadowFinished,
-	GeometryFinished,
+	ReadyToPresent,
 
-	DownscaleFinished,
-	UpscaleFinished,
+	End
+};
 
-	ColorBlendFinished,
+// Secondary command buffers recorded by one worker thread
+// Command pools can't be used by several threads at once, so every worker has its own pool per frame in flight
+struct VulkanWorkerCommandBuffers
+{
+	VkCommandPool commandPool;
 
-	ReadyToPresent,
+	VkCommandBuffer depthBuffer;
+	VkCommandBuffer shadowBuffer;
+	VkCommandBuffer geometryBuffer;
+};
 
-	End
+// Per object data of the GPU driven draws, matches ObjectData in the culling and indirect shaders
+// An object keeps its slot between frames and is only written again when it moves
+struct VulkanIndirectObject
+{
+	mat4 transformation;
+	// xyz: centre in mesh space, w: radius
+	vec4 boundingSphere;
+	u32 flags;
+	// Entry of the material in the bindless material buffer
+	u32 materialIndex;
+	u32 padding[2];
+	// Dequantisation of the mesh's positions
+	vec4 positionOffset;
+	vec4 positionScale;
+};
+
+// Indirect draws of an object slot in the current frame, matches ObjectBatches in the culling shader
+// The levels of detail are picked every frame, so only these are written for every object
+struct VulkanIndirectObjectBatches
+{
+	// Indirect draw the object is an instance of
+	u32 batch;
+	// Indirect draw of the object's shadow, the batch of the level of detail picked for the light
+	u32 shadowBatch;
+};
+
+// Batch of an object slot that is not drawn in the current frame
+const u32 OBJECT_NO_BATCH = 0xFFFFFFFF;
+
+// Flags of VulkanIndirectObject and VulkanObjectData
+const u32 OBJECT_CAST_SHADOW = 1 << 0;
+
+// Meshlet of a batch, matches ClusterData in the culling shader
+struct VulkanIndirectCluster
+{
+	// xyz: centre in mesh space, w: radius
+	vec4 boundingSphere;
+	// xyz: apex of the normal cone in mesh space, w: cutoff
+	vec4 coneApex;
+	vec4 coneAxis;
+};
+
+// Clusters of a batch, matches BatchData in the culling shader
+struct VulkanIndirectBatchClusters
+{
+	u32 firstCluster;
+	u32 numClusters;
+	// See VulkanObjectData::lodTint, the geometry pass reads it through the object's batch
+	u32 lodTint;
+	u32 padding;
+};
+
+// Uniform buffer of the culling shader, updated once per frame
+struct VulkanCullData
+{
+	// Normalised planes pointing inwards
+	vec4 frustumPlanes[6];
+	mat4 viewProjection;
+	// View projection the Hi-Z pyramid of the previous frame was rendered with
+	mat4 previousViewProjection;
+	// xy: size of the pyramid's first mip, z: number of mips, w: 1 if the previous frame built the pyramid
+	vec4 hiZSize;
+	// Clusters facing away from the camera are culled
+	vec4 cameraPosition;
+};
+
+// Push constants of the culling shader
+struct VulkanCullPhase
+{
+	u32 numObjects;
+	u32 numBatches;
+	u32 numClusters;
+	// 0: frustum cull every object and test it against the previous frame's pyramid
+	// 1: test the objects rejected by the first phase against the pyramid of this frame
+	u32 phase;
+	// 1 if the objects are tested against the pyramid
+	u32 occlusionCulling;
+	// 1 if the clusters of the visible objects are frustum and back-face culled
+	u32 clusterCulling;
+};
+
+// Objects tested in the second culling phase and clusters of the visible objects
+struct VulkanCullStatistics
+{
+	u32 occludedObjects;
+	u32 lateObjects;
+	u32 testedClusters;
+	u32 culledClusters;
+};
+
+// Buffers of the GPU driven draws
+// The CPU rewrites the objects and draw commands every frame, so every frame in flight has its own
+struct VulkanIndirectBuffers
+{
+	VulkanAllocatedMemory objectBuffer;
+	// VulkanIndirectCluster of every cluster of every batch, and the VulkanIndirectBatchClusters of every batch
+	VulkanAllocatedMemory clusterBuffer;
+	VulkanAllocatedMemory batchBuffer;
+	// One VkDrawIndexedIndirectCommand per cluster for the camera, one per cluster for the shadow
+	// and one per cluster for the camera draws found visible by the second culling phase
+	VulkanAllocatedMemory drawCommandBuffer;
+	// Number of draws of every batch up to its last cluster with a visible instance, in the same three parts
+	VulkanAllocatedMemory drawCountBuffer;
+	// Indices of the visible objects, grouped by draw command
+	VulkanAllocatedMemory visibleObjectBuffer;
+	// 1 if the first culling phase rejected the object only because it was occluded
+	VulkanAllocatedMemory objectStateBuffer;
+	// VulkanCullStatistics, read back once the frame has finished on the GPU
+	VulkanAllocatedMemory statisticsBuffer;
+	// VulkanIndirectObjectBatches of every object slot
+	VulkanAllocatedMemory objectBatchBuffer;
+
+	// Number of objects, batches and clusters the buffers have room for
+	// Every cluster draw has room for every object of its batch, the instance capacity is the sum over the clusters
+	u32 objectCapacity;
+	u32 batchCapacity;
+	u32 clusterCapacity;
+	u32 instanceCapacity;
+
+	VkDescriptorSet descriptorSet;
+};
+
+// Per instance data of the mesh draws recorded on the CPU, matches ObjectData in the depth, geometry and shadow vertex shaders
+struct VulkanObjectData
+{
+	mat4 transformation;
+	// World transformation of the previous frame
+	mat4 previousTransformation;
+	u32 materialIndex;
+	u32 flags;
+	// Level of detail plus one if the geometry pass tints the meshes by their level, 0 otherwise
+	u32 lodTint;
+	u32 padding;
+	// Dequantisation of the mesh's positions
+	vec4 positionOffset;
+	vec4 positionScale;
+};
+
+// Object data of the instanced mesh draws, read with gl_InstanceIndex in the vertex shaders
+struct VulkanInstanceBuffer
+{
+	VulkanAllocatedMemory buffer;
+	// Mapped for as long as the buffer exists
+	VulkanObjectData* objects;
+
+	// Number of objects the buffer has room for
+	u32 capacity;
+
+	VkDescriptorSet descriptorSet;
+};
+
+// Material of the geometry pass, matches MaterialData in the deferred fragment shader
+// The colours of a material without a texture are baked into a 1x1 texture, so the textures are all it needs
+struct VulkanMaterialData
+{
+	// Element of every texture of the material in the bindless texture array
+	// BRDF: 0. Emissive, 1. Albedo (Diffuse), 2. Metallic, 3. Roughness, Others: 4. Normal Map
+	u32 textures[5];
+	u32 flags;
+	u32 padding[2];
+};
+
+// Flags of VulkanMaterialData
+// Materials without it write no emission and skip sampling the emissive texture
+const u32 MATERIAL_EMISSIVE = 1 << 0;
+
+// Every material texture in one descriptor array, the materials index it through the material buffer
+// The set is bound once per pass, so changing material between draws binds nothing
+// Update after bind lets new textures be written to elements no pending frame reads
+struct VulkanBindlessTextures
+{
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSetLayout layout;
+	VkDescriptorSet descriptorSet;
+
+	// VulkanMaterialData indexed by material id, mapped for as long as the buffer exists
+	VulkanAllocatedMemory materialBuffer;
+	VulkanMaterialData* materials;
+	u32 materialCapacity;
+
+	// Number of elements of the texture array, limited by the device
+	u32 maxTextures;
+	// Elements written so far, textures are never removed while the engine runs
+	u32 numTextures;
+};
+
+// Max depth pyramid of the depth pre-pass, used to reject objects hidden behind closer ones
+// Every mip holds the farthest depth of the texels it covers in the mip before, the first mip is half the size of the depth buffer
+struct VulkanHiZPyramid
+{
+	// View of every mip, sampled by the culling shader
+	VulkanAllocatedImage image;
+	// View of a single mip, written when the pyramid is built
+	std::vector<VkImageView> mipViews;
+
+	VkExtent2D extent;
+	u32 numMips;
+
+	// Mip i is built from input i, the depth buffer or the mip before, and written through output i
+	std::vector<VkDescriptorSet> inputDescriptorSets;
+	std::vector<VkDescriptorSet> outputDescriptorSets;
+	// The whole pyramid for the culling shader
+	VkDescriptorSet descriptorSet;
+
+	// The image is created in an undefined layout, the first build moves it to GENERAL
+	bool initialised;
+	// True once a frame has built the pyramid, the first culling phase ignores it before that
+	bool valid;
+	mat4 viewProjection;
+};
+
+// Resources owned by one frame in flight
+// They are only reused after the frame's fence is signaled, i.e. the GPU has finished with them
+struct VulkanFrame
+{
+	// Every command buffer below is allocated from this pool, the whole pool is reset at the start of the frame
+	VkCommandPool commandPool;
+
+	// Primary Command Buffers
+	std::unordered_map<VulkanCommandBufferType, VkCommandBuffer> commandBuffers;
+
+	// Command buffers of the passes submitted to the compute queue, VK_NULL_HANDLE if bloom runs on the graphics queue
+	// Allocated from the compute queue family, which may be different from the graphics queue family
+	VkCommandPool computeCommandPool;
+	std::unordered_map<VulkanCommandBufferType, VkCommandBuffer> computeCommandBuffers;
+
+	// Secondary Command Buffers, one set per worker thread
+	std::vector<VulkanWorkerCommandBuffers> workers;
+
+	// Used for GPU - GPU sync
+	std::unordered_map<VulkanSemaphoreType, VkSemaphore> semaphores;
+
+	// Used for CPU - GPU sync
+	VkFence fence;
+
+	// Uniform buffers updated every frame, the layouts are shared and stored in VulkanEngine::descriptorSets
+	std::unordered_map<VulkanDescriptorSetType, VulkanDescriptorSet> uniformDescriptorSets;
+
+	// Objects culled and drawn on the GPU
+	VulkanIndirectBuffers indirectBuffers;
+
+	// Object data of the mesh draws recorded on the CPU
+	VulkanInstanceBuffer instanceBuffer;
+
+	// Resources that were still in use when they are released, destroyed once this frame comes round again
+	std::vector<std::function<void()>> deletionQueue;
 };
 
 enum VulkanFramebufferType : u8
@@ -160,7 +469,8 @@ struct VulkanFramebufferAttachment
 
 struct VulkanFramebuffer
 {
-	static const u32 ATTACHMENT_SIZE = 4;
+	// G-Buffers of the geometry pass, the depth buffer is not one of them
+	static const u32 ATTACHMENT_SIZE = 3;
 
 	VkFramebuffer framebuffer;
 	std::vector<VulkanFramebufferAttachment> attachments;
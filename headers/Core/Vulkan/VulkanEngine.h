@@ -5,12 +5,18 @@
 #include "Core/ECS/SkeletalComponent.h"
 #include "Core/Material.h"
 #include "Core/SkinnedMesh.h"
+#include "Core/BakedAnimation.h"
 #include "Core/LightComponent.h"
 #include "Core/Camera.h"
 #include "Core/UniformClass.h"
+#include "Core/FrustumCuller.h"
+#include "Core/DrawSorter.h"
+#include "Core/WorkerPool.h"
 
 #include "Core/Vulkan/VulkanDefines.h"
 #include "Core/Vulkan/VulkanGui.h"
+#include "Core/Vulkan/VulkanRenderGraph.h"
+#include "Core/Vulkan/VulkanGeometryArena.h"
 
 #include "Core/ECS/TransformComponent.h"
 
@@ -18,6 +24,112 @@
 
 #include "Core/GameState.h"
 
+#include <atomic>
+
+// A draw gathered from the scene before recording
+// Everything the worker threads need is resolved here, so they never touch the game state's containers
+struct VulkanDrawItem
+{
+	Mesh* mesh;
+	// VK_NULL_HANDLE if the mesh is not skinned
+	VkDescriptorSet boneDescriptorSet;
+	const mat4* transformation;
+	const mat4* previousTransformation;
+	vec4 worldBoundingSphere;
+	// See OBJECT_CAST_SHADOW
+	u32 flags;
+
+	// Entry of the material in the bindless material buffer, 0 if the mesh has no material
+	u32 materialIndex;
+
+	// Packed into the sort key of every pass the mesh is drawn in
+	u32 meshIndex;
+	// Distance from the camera quantised to SORT_DEPTH_BITS
+	u32 depthBucket;
+
+	// Level of detail of the mesh, shadow draws have their own
+	u32 lod;
+};
+
+// Every static object sharing a mesh and level of detail, drawn with one indirect draw
+// The culling shader fills in how many of its objects are visible, every object reads its own material
+struct VulkanIndirectBatch
+{
+	Mesh* mesh;
+	// Packed into the sort key of the batch
+	u32 meshIndex;
+	u32 lod;
+	// First slot of the batch in the visible object buffer, every cluster of the batch has a slot for every object
+	u32 firstInstance;
+	u32 numObjects;
+	// Clusters of the batch in the cluster buffer, one draw each
+	u32 firstCluster;
+	u32 numClusters;
+};
+
+// Slot of a GPU driven object in the object buffers, kept between frames for as long as the object is drawn
+struct VulkanIndirectObjectSlot
+{
+	// nullptr if the slot is free
+	const MeshComponent* meshComponent;
+	// Index of the mesh in the mesh component
+	u32 meshSlot;
+	// World version of the transformation the object data was written with
+	u32 worldVersion;
+	// One bit for every frame in flight whose object buffer has not been written since the object data changed
+	u32 dirtyFrames;
+	bool drawn;
+};
+
+// Mesh draws sharing a mesh and level of detail, drawn with one instanced draw
+// The object data of its instances is next to each other in the frame's instance buffer, the material is part of it
+struct VulkanInstancedDraw
+{
+	Mesh* mesh;
+	u32 lod;
+	// First object of the draw in the instance buffer
+	u32 firstInstance;
+	u32 numInstances;
+};
+
+// Mesh bound by the draws recorded so far in a pass, the next draw only binds it if it is different
+// Materials are read from the bindless texture array, so they are never bound between draws
+struct VulkanBindState
+{
+	const VulkanGeometryArena* geometryArena;
+	// Meshes of an arena use its 16 or 32 bit index buffer
+	VkIndexType indexType;
+
+	u32 binds;
+	u32 skippedBinds;
+};
+
+struct VulkanDrawLists
+{
+	// Meshes without a skeleton, drawn in the depth and geometry passes
+	std::vector<VulkanDrawItem> meshDraws;
+	// Skinned meshes sorted by skeleton, drawn in the depth and geometry passes
+	std::vector<VulkanDrawItem> skeletalDraws;
+	// Every mesh casting a shadow
+	std::vector<VulkanDrawItem> shadowDraws;
+
+	// The mesh draws and shadow draws in sort key order, grouped by mesh, these are the draws actually recorded
+	// The depth and geometry passes draw the same instanced draws
+	std::vector<VulkanInstancedDraw> meshInstances;
+	std::vector<VulkanInstancedDraw> shadowInstances;
+	// Draw of every instance, its object data is written to the frame's instance buffer
+	std::vector<const VulkanDrawItem*> instanceDraws;
+
+	// Static meshes culled on the GPU, only filled with GPU driven rendering
+	// Batches of every object slot, OBJECT_NO_BATCH for the slots not drawn in this frame
+	std::vector<VulkanIndirectObjectBatches> indirectObjectBatches;
+	std::vector<VulkanIndirectBatch> indirectBatches;
+	u32 numIndirectObjects;
+	// Clusters and visible object slots of every batch
+	u32 numIndirectClusters;
+	u32 numIndirectInstances;
+};
+
 class VulkanEngine
 {
 private:
@@ -36,10 +148,14 @@ public:
 
 	// Triple buffering
 	static const u32 NUM_SWAPCHAIN = 3;
+	// Number of frames the CPU can record ahead of the GPU, independent of the number of swapchain images
+	static const u32 FRAMES_IN_FLIGHT = 2;
 	const VkFormat desiredSwapchainFormat = VK_FORMAT_R8G8B8A8_UNORM;
 
 	const VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
 
+	const VkFormat hiZFormat = VK_FORMAT_R32_SFLOAT;
+
 	const VkFormat shadowDepthFormat = VK_FORMAT_D32_SFLOAT;
 
 	const u32 numDownSampleImage = 6;
@@ -47,9 +163,48 @@ public:
 
 	const VkFormat generalImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
 
+	// 12 bytes per pixel, the position is reconstructed from the depth buffer
+	// 0: albedo and metallic, 1: octahedral encoded normal, 2: emissive and roughness
+	// The octahedral normal is in [-1, 1], which a signed normalised format covers with even precision
+	// Devices that can't render to it fall back to half floats when the engine is initialised
+	VkFormat gBufferFormats[VulkanFramebuffer::ATTACHMENT_SIZE] = { VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R16G16_SNORM, VK_FORMAT_R8G8B8A8_UNORM };
+
+	// Below this many draws per thread it is cheaper to record on fewer threads
+	const u32 MIN_DRAWS_PER_WORKER = 256;
+
+	// Below this many instances per thread it is cheaper to write the object data on fewer threads
+	const u32 MIN_INSTANCES_PER_THREAD = 4096;
+
+	// Sort key of a draw, from the most significant bits: pass, pipeline, mesh, level of detail, depth
+	// Draws sharing a pipeline, then a mesh and level end up next to each other and are drawn front to back
+	// Materials are not part of the key, changing material between draws costs nothing
+	static const u32 SORT_DEPTH_BITS = 14;
+	static const u32 SORT_LOD_BITS = 2;
+	static const u32 SORT_MESH_BITS = 20;
+	static const u32 SORT_PIPELINE_BITS = 6;
+	// Distance mapped to the last depth bucket, the far plane of the camera
+	const f32 SORT_MAX_DEPTH = 2000.0f;
+
+	// Projected error of the level of detail a draw uses, the shadow draws multiply it by their bias
+	const f32 LOD_ERROR_PIXELS = 1.0f;
+	// Keeps the projected error finite for a camera inside the bounding sphere
+	const f32 LOD_MIN_DISTANCE = 0.01f;
+
+	// Width and height of every face of the point light's shadow cube map
+	static const u32 SHADOW_MAP_SIZE = 1024;
+
+	// Size of the bindless texture array if the device allows it, 5 textures per material
+	const u32 MAX_BINDLESS_TEXTURES = 16384;
+	// Materials the material buffer has room for before it first grows
+	const u32 INITIAL_MATERIAL_CAPACITY = 256;
+
+	// A geometry arena is compacted once less than half of its free space is in its largest free range
+	const f32 GEOMETRY_DEFRAGMENT_THRESHOLD = 0.5f;
+
 public:
 
 	std::queue<Skeleton*> skeletonToInitialise;
+	std::queue<BakedAnimation*> bakedAnimationToInitialise;
 
 public:
 
@@ -79,37 +234,89 @@ public:
 
 	std::vector<VkFramebuffer> presentFramebuffers;
 
+	// Passes of a frame, owns the depth buffer, G-Buffers, shading image and bloom images
+	VulkanRenderGraph renderGraph;
+	// Settings the render graph was built with, the graph is rebuilt when they change
+	bool renderGraphBloom;
+	bool renderGraphViewRenderTargets;
+
+	// Swapchain image the UI pass renders to in the current frame
+	u32 currentImageIndex;
+
+	// Bloom is submitted to the compute queue when the device has one besides the graphics queue
+	VkQueue computeQueue;
+	u32 graphicsQueueFamily;
+	u32 computeQueueFamily;
+	bool asyncCompute;
+
+	// Orders the batches of the render graph across the graphics and compute queues, incremented by every batch
+	VkSemaphore timelineSemaphore;
+	u64 timelineValue;
+	// Value signaled by the last compute batch, the next frame has to wait for it before writing the shading image again
+	u64 computeTimelineValue;
+
 	// Sampler to sample framebuffer's color attachment
 	std::unordered_map<VulkanSamplerType, VkSampler> samplers;
 
-	// Command pool and buffer
-	// The first command pools are used for allocation/initialisation, the rests is used for recording command buffers for rendering commands
+	// Command pool used for allocation/initialisation
+	// Rendering commands are recorded into the command pools of the frames in flight
 	VkCommandPool commandPool;
 
-	// Secondary Command buffers that store the rendering command that will be used several times in a rendering loop
-	std::vector<VkCommandBuffer> depthMeshBuffers;
-	std::vector<VkCommandBuffer> depthSkeletalBuffers;
+	// Per frame resources, indexed by currentFrame
+	std::array<VulkanFrame, FRAMES_IN_FLIGHT> frames;
+	u32 currentFrame;
+
+	// Draws of the current frame, split into chunks between the worker threads
+	VulkanDrawLists drawLists;
+	// Number of workers recording secondary command buffers in the current frame
+	u32 numActiveWorkers;
+	// Runs the per frame work split between the threads, its threads are kept between frames
+	WorkerPool workerPool;
 
-	std::vector<VkCommandBuffer> shadowMeshBuffers;
-	std::vector<VkCommandBuffer> shadowSkeletalBuffers;
+	// Culls the meshes drawn on the CPU against the camera
+	FrustumCuller frustumCuller;
 
-	std::vector<VkCommandBuffer> geometryMeshBuffers;
-	std::vector<VkCommandBuffer> geometrySkeletalBuffers;
+	// Orders the draws of every pass by their sort key
+	DrawSorter drawSorter;
+	std::vector<u64> sortKeys;
 
+	// Binds recorded and skipped in the passes of the current frame, added up by every worker thread
+	std::atomic<u32> numBinds;
+	std::atomic<u32> numSkippedBinds;
 
-	// Primary Command Buffers
-	std::unordered_map<VulkanCommandBufferType, std::vector<VkCommandBuffer>> pipelineCommandBuffers;
+	// Batch of every mesh and level of detail in the current frame, the mesh index is in the upper 32 bits
+	std::unordered_map<u64, u32> indirectBatchLookup;
 
-	// Semaphore for waiting and signaling
-	// Used for GPU - GPU sync
-	std::unordered_map<VulkanSemaphoreType, VkSemaphore> semaphores;
+	// Object data of the GPU driven draws and the slot it is kept in, only the objects that moved are written to the object buffers
+	std::vector<VulkanIndirectObject> indirectObjects;
+	std::vector<VulkanIndirectObjectSlot> indirectObjectSlots;
+	std::vector<u32> freeIndirectObjectSlots;
 
-	// Fence 
-	// Used for CPU - GPU symc
-	std::vector<VkFence> fences;
+	// Without vkCmdDrawIndexedIndirectCount every batch is drawn, the culled ones with no instances
+	bool drawIndirectCount;
+	// Without multi draw indirect every cluster of a batch is drawn with its own call
+	bool multiDrawIndirect;
+
+	// Depth pyramid the GPU driven draws are occlusion culled against, kept between frames
+	VulkanHiZPyramid hiZPyramid;
+	// True if the GPU driven draws of the current frame are occlusion culled
+	bool occlusionCulling;
+
+	// Playback time of the baked animations in the current frame, kept in double precision
+	f64 bakedAnimationTime;
 
 	VkDescriptorPool descriptorPool;
 
+	// Textures and materials of the geometry passes, bound once per pass
+	VulkanBindlessTextures bindlessTextures;
+
+	// Vertex and index buffers shared by every mesh with the same vertex layout
+	std::unordered_map<VulkanGeometryType, VulkanGeometryArena> geometryArenas;
+	// Quantised positions and packed attributes in the arenas, fixed when the arenas and pipelines are created
+	bool compressedVertices;
+	// Set once a deferred deletion has freed a geometry range, the arenas can only become fragmented then
+	bool geometryFreed;
+
 	// Pipeline and pipeline layout (Blinn Phong Shader)
 	std::vector<VulkanPipeline> pipelines;
 	std::unordered_map<VulkanPipelineType, u32> pipelineIndexLookup;
@@ -135,6 +342,9 @@ public:
 		GameState* gameState);
 	void cleanup(VkDevice& logicalDevice);
 
+	// Called before init, bloom stays on the graphics queue if computeQueue is VK_NULL_HANDLE
+	void setComputeQueue(VkQueue computeQueue, u32 graphicsQueueFamily, u32 computeQueueFamily);
+
 	// Init / setup
 
 	void createVmaAllocator(VkInstance& instance, VkPhysicalDevice& physicalDevice, VkDevice& logicalDevice);
@@ -143,14 +353,19 @@ public:
 	void getSwapchainImages(VkDevice& logicalDevice);
 	void createSwapchainImageViews(VkDevice& logicalDevice);
 
-	void createDepthPrePass(VkDevice& logicalDevice, VkRenderPass& renderPass, const VkFormat& depthFormat);
+	// With loadDepth the depth buffer keeps the depth drawn before instead of being cleared
+	void createDepthPrePass(VkDevice& logicalDevice, VkRenderPass& renderPass, const VkFormat& depthFormat, bool loadDepth = false);
 	void createPresentRenderPass(VkDevice& logicalDevice, VkRenderPass& renderPass, const VkFormat& format);
 	void createShadingRenderPass(VkDevice& logicalDevice, VkRenderPass& renderPass, VkFormat format, const VkFormat& depthFormat);
 	void createShadowRenderPass(VkDevice& logicalDevice, VkRenderPass& renderPass, const VkFormat& depthFormat);
-	void createGeometryRenderPass(VkDevice& logicalDevice, VkRenderPass& renderPass, VkFormat format, const VkFormat& depthFormat);
+	void createGeometryRenderPass(VkDevice& logicalDevice, VkRenderPass& renderPass, const VkFormat* formats, const VkFormat& depthFormat);
 
-	void createDepthBuffer(VkDevice& logicalDevice, VmaAllocator& vmaAllocator, const VkExtent2D& extent);
-	void destroyDepthBuffer(VkDevice& logicalDevice, VmaAllocator& vmaAllocator);
+	// Declare the passes of a frame and the images they use, then compile the graph
+	void buildRenderGraph(VkDevice& logicalDevice);
+	// Recreate everything using the images of the render graph
+	void destroyRenderTargets(VkDevice& logicalDevice);
+	void createRenderTargets(VkDevice& logicalDevice);
+	void recreateRenderGraph(VkDevice& logicalDevice);
 
 	void createGBuffers(VkDevice& logicalDevice, const VkExtent2D& extent);
 
@@ -165,23 +380,29 @@ public:
 
 	void createDepthFramebuffer(VkDevice& logicalDevice, VkFramebuffer& depthFramebuffer, VkRenderPass& depthRenderPass, VkExtent2D extent);
 
-	void createImageBuffersForPostProcessing(VkDevice& logicalDevice, VkQueue& graphicsQueue);
-	void destroyImageBuffersForPostProcessing(VkDevice& logicalDevice, VmaAllocator& vmaAllocator);
-
 	void createCommandPool(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface, VkCommandPool& commandPool);
 
-	void createCommandBuffers(VkDevice& logicalDevice);
-	void createSecondaryCommandBuffers(VkDevice& logicalDevice);
+	void createCommandBuffers(VkDevice& logicalDevice, VulkanFrame& frame);
+	void createSecondaryCommandBuffers(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface, VulkanFrame& frame);
+
+	void createSemaphore(VkDevice& logicalDevice, VulkanFrame& frame);
+
+	void createFence(VkDevice& logicalDevice, VkFence& fence, VkFenceCreateFlagBits flag);
 
-	void createSemaphore(VkDevice& logicalDevice);
+	void createTimelineSemaphore(VkDevice& logicalDevice, VkSemaphore& semaphore);
 
-	void createFence(VkDevice& logicalDevice, std::vector<VkFence>& fences, VkFenceCreateFlagBits flag);
+	void createFrames(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface);
+	void destroyFrames(VkDevice& logicalDevice);
+	void flushDeletionQueue(VulkanFrame& frame);
 
 	void createDescriptionPool(VkDevice& logicalDevice);
 
 	void initUniformBuffer(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool, VulkanAllocatedMemory& uniformBuffer,VkDescriptorSet& descriptorSet, 
 		VkDescriptorSetLayout& descriptorSetLayout, u32 binding, u32 bufferSize, VkShaderStageFlagBits shaderStage);
 	void createUniformBuffer(VkDevice& logicalDevice, VulkanAllocatedMemory& uniformBuffer, u32 bufferSize);
+	// One uniform buffer and descriptor set per frame in flight, sharing one layout
+	void initFrameUniformBuffers(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool, VulkanDescriptorSetType type, u32 binding, u32 bufferSize,
+		VkShaderStageFlagBits shaderStage);
 
 	void initDescriptorSets(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool);
 
@@ -190,15 +411,39 @@ public:
 
 	// Initialise descriptor sets for deferred rendering
 	void initAttachmentDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool, VulkanDescriptorSet& descriptorSet);
+	void freeAttachmentDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool, VulkanDescriptorSet& descriptorSet);
 
 	void initRenderedDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool);
+	void freeRenderedDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool);
 
 	void initComputedImageDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool);
 	void freeComputedImageDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool);
 
+	// Bindless textures
+	// The set has its own pool, update after bind sets can't be allocated from a pool without the flag
+	void initBindlessTextures(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice);
+	void destroyBindlessTextures(VkDevice& logicalDevice);
+	// Write the textures of a loaded material to the texture array and its entry to the material buffer
+	void addMaterial(VkDevice& logicalDevice, Material* material);
+	// Point the texture's element of the array at its current image view and sampler
+	void writeBindlessTexture(VkDevice& logicalDevice, const TextureDescriptorSet& texture);
+	// Flag the material's features in its entry of the material buffer
+	void updateMaterialFlags(Material* material);
+	// Grow the material buffer to hold the given number of materials, keeping the materials written so far
+	void createMaterialBuffer(VkDevice& logicalDevice, u32 capacity);
+
+	// Geometry arenas
+	void initGeometryArenas();
+	void destroyGeometryArenas();
+	// Compact the arenas whose free space is split into too many ranges, waits for the device to be idle if any is compacted
+	// Only called after geometry ranges have been freed, never as a per-frame poll
+	void defragmentGeometry(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface, VkQueue& queue);
+
 	// Pipeline init
 	void initDepthSkeletalPipeline(VkDevice& logicalDevice);
 	void initSkeletalPipeline(VkDevice& logicalDevice);
+	void initDepthBakedSkeletalPipeline(VkDevice& logicalDevice);
+	void initBakedSkeletalPipeline(VkDevice& logicalDevice);
 	void initGeometryPipeline(VkDevice& logicalDevice);
 	void initDepthPipeline(VkDevice& logicalDevice);
 	void initShadowPipeline(VkDevice& logicalDevice);
@@ -209,34 +454,112 @@ public:
 	void initUpscalePipeline(VkDevice& logicalDevice);
 	void initBlendColorPipeline(VkDevice& logicalDevice);
 
+	// GPU driven rendering
+	void initIndirectDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool);
+	void initCullPipeline(VkDevice& logicalDevice);
+	void initDepthIndirectPipeline(VkDevice& logicalDevice);
+	void initGeometryIndirectPipeline(VkDevice& logicalDevice);
+	void initShadowIndirectPipeline(VkDevice& logicalDevice);
+
+	// Occlusion culling
+	void initHiZDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool);
+	void initHiZPipeline(VkDevice& logicalDevice);
+	// The pyramid follows the size of the depth buffer, it is recreated with the render targets
+	void createHiZPyramid(VkDevice& logicalDevice);
+	void destroyHiZPyramid(VkDevice& logicalDevice);
+
 	// GUI
 	void initGui(GLFWwindow* window, VkInstance& instance, VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkQueue& queue, VkSurfaceKHR& surface);
 
 	// Update
 	void update(GLFWwindow* window, VkInstance& instance, VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR surface, VkQueue graphicsQueue, bool renderWithBRDF);
 
+	// Destroy a resource once every frame that could still be using it has finished on the GPU
+	// Called between frames, the deletion runs once the last submitted frame is waited for
+	void deferDeletion(std::function<void()> deletion) { frames[(currentFrame + FRAMES_IN_FLIGHT - 1) % FRAMES_IN_FLIGHT].deletionQueue.push_back(deletion); }
+
+	// Release the GPU resources of an unloaded model, the frames in flight may still be drawing it
+	void releaseMesh(VkDevice& logicalDevice, Mesh* mesh);
+	void releaseSkeleton(VkDevice& logicalDevice, Skeleton* skeleton);
+	void releaseBakedAnimation(VkDevice& logicalDevice, BakedAnimation* bakedAnimation);
+
 	void updateSceneUniform(Camera* camera);
 	void updateSkeletonUniform(VkCommandBuffer& commandBuffer);
 
+	void updateBakedAnimationInstances(VkCommandBuffer& commandBuffer);
+
 	void processTodoSkeleton(VkDevice& logicalDevice);
+	void processTodoBakedAnimation(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface, VkQueue& graphicsQueue);
 
 	void recordUniformUpdate(VkCommandBuffer& commandBuffer);
 
-	// Record rendering commands
-	void recordMeshSecondaryCommandBuffer(VkCommandBuffer& commandBuffer, VkRenderPass& renderPass, VkFramebuffer& framebuffer, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout);
-	void recordSkeletalSecondaryCommandBuffer(VkCommandBuffer& commandBuffer, VkRenderPass& renderPass, VkFramebuffer& framebuffer, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout);
+	// Gather the draws of the depth, shadow and geometry passes
+	void gatherDrawLists();
+	// Slot of a mesh of a mesh component, its object data is written again if the mesh component has moved since
+	u32 getIndirectObjectSlot(MeshComponent* meshComponent, TransformComponent* transformComponent, u32 meshSlot, bool& moved);
+	// Coarsest level of detail of the mesh whose error projects to at most errorPixels, seen from the view position
+	// pixelsPerUnit is the size in pixels of one unit at a distance of one
+	u32 selectLod(const Mesh* mesh, const vec4& worldBoundingSphere, const vec3& viewPosition, f32 pixelsPerUnit, f32 errorPixels) const;
+	// Level of detail plus one if the geometry pass tints the meshes by their level, 0 otherwise
+	u32 getLodTint(u32 lod) const { return gameState->gameSettings.showLodColors ? lod + 1 : 0; };
+	// Drop the mesh draws outside of the camera frustum, the depth and geometry passes only record the visible ones
+	void cullMeshDraws();
+	// Sort the mesh and shadow draws of every pass by key and group the ones sharing a mesh into instanced draws
+	void buildInstancedDraws(bool renderShadow);
+	// Order the GPU driven batches by key, the objects are moved to the new index of their batch
+	void sortIndirectBatches();
+	static u64 getSortKey(VulkanRenderPassType pass, VulkanPipelineType pipeline, u32 mesh, u32 lod, u32 depthBucket);
+	// Write the object data of the instanced draws, growing the frame's buffer if needed
+	void updateInstanceBuffer(VkDevice& logicalDevice, VulkanFrame& frame);
+	// Write the object data of the instances [begin, end) to the mapped buffer
+	void writeObjectData(VulkanObjectData* objects, u32 begin, u32 end);
+	void createInstanceBuffer(VkDevice& logicalDevice, VulkanFrame& frame, u32 capacity);
+	void destroyInstanceBuffer(VulkanFrame& frame);
+
+	// Upload the objects and draw commands of the GPU driven draws, growing the frame's buffers if needed
+	void updateIndirectBuffers(VkDevice& logicalDevice, VulkanFrame& frame);
+	void createIndirectBuffers(VkDevice& logicalDevice, VulkanFrame& frame, u32 objectCapacity, u32 batchCapacity, u32 clusterCapacity,
+		u32 instanceCapacity);
+	void destroyIndirectBuffers(VulkanFrame& frame);
+
+	// Record secondary command buffers
+	// The draw lists are split into chunks and every chunk is recorded on its own thread
+	void recordSecondaryCommandBuffers(VulkanFrame& frame, bool renderShadow);
+	void recordWorkerCommandBuffers(VulkanWorkerCommandBuffers& worker, u32 workerIndex, bool renderShadow);
+	void beginSecondaryCommandBuffer(VkCommandBuffer& commandBuffer, VkRenderPass& renderPass, VkFramebuffer& framebuffer, bool setViewport);
 
-	void recordDepthPrePass(VkCommandBuffer& commandBuffer, VkCommandBuffer& meshBuffer, VkCommandBuffer& skeletalBuffer);
-	void recordShadowPass(VkCommandBuffer& commandBuffer);
-	void recordGeometryPass(VkCommandBuffer& commandBuffer, VkCommandBuffer& meshBuffer, VkCommandBuffer& skeletalBuffer);
+	// Record rendering commands
+	void recordCullPass(VkCommandBuffer& commandBuffer, VulkanFrame& frame);
+	void recordDepthPrePass(VkCommandBuffer& commandBuffer, VulkanFrame& frame);
+	void recordHiZPass(VkCommandBuffer& commandBuffer);
+	// Second culling phase and the depth of the objects it found visible
+	void recordLateCullPass(VkCommandBuffer& commandBuffer, VulkanFrame& frame);
+	void recordDepthLatePass(VkCommandBuffer& commandBuffer, VulkanFrame& frame);
+	// Run one phase of the culling shader, see VulkanCullPhase
+	void dispatchCull(VkCommandBuffer& commandBuffer, VulkanFrame& frame, u32 phase);
+	void recordShadowPass(VkCommandBuffer& commandBuffer, VulkanFrame& frame);
+	void recordGeometryPass(VkCommandBuffer& commandBuffer, VulkanFrame& frame);
 	void recordShadingPass(VkCommandBuffer& commandBuffer);
 
 	// The actual render passes commands
-	void depthSkeletalPrePasses(VkCommandBuffer& commandBuffer);
-	void depthPrePasses(VkCommandBuffer& commandBuffer);
-	void geometrySkeletalPasses(VkCommandBuffer& commandBuffer, VkExtent2D extent);
-	void geometryPasses(VkCommandBuffer& commandBuffer, VkExtent2D extent);
-	void shadowPasses(VkCommandBuffer& commandBuffer);
+	// The ones taking a range record the draws [begin, end) of their draw list
+	void depthSkeletalPrePasses(VkCommandBuffer& commandBuffer, u32 begin, u32 end);
+	void depthBakedSkeletalPrePasses(VkCommandBuffer& commandBuffer);
+	void depthPrePasses(VkCommandBuffer& commandBuffer, u32 begin, u32 end);
+	void geometrySkeletalPasses(VkCommandBuffer& commandBuffer, VkExtent2D extent, u32 begin, u32 end);
+	void geometryBakedSkeletalPasses(VkCommandBuffer& commandBuffer, VkExtent2D extent);
+	void geometryPasses(VkCommandBuffer& commandBuffer, VkExtent2D extent, u32 begin, u32 end);
+	void shadowPasses(VkCommandBuffer& commandBuffer, u32 begin, u32 end);
+	void depthIndirectPrePasses(VkCommandBuffer& commandBuffer, u32 begin, u32 end, u32 part);
+	void geometryIndirectPasses(VkCommandBuffer& commandBuffer, u32 begin, u32 end);
+	void shadowIndirectPasses(VkCommandBuffer& commandBuffer, u32 begin, u32 end);
+	// Bind the geometry arena of a mesh, unless the draw before has bound the same one
+	void bindGeometry(VkCommandBuffer& commandBuffer, const Mesh* mesh, VulkanBindState& bindState);
+	// Add the binds of a pass to the counters of the frame
+	void addBindStatistics(const VulkanBindState& bindState);
+	// Draw the clusters of the batches [begin, end) from one part of the draw commands
+	// 0: camera draws, 1: shadow draws, 2: camera draws found visible by the second culling phase
+	void drawIndirectBatches(VkCommandBuffer& commandBuffer, u32 begin, u32 end, u32 part);
 	void shadingPasses(VkCommandBuffer& commandBuffer, VkRenderPass& renderPass, VkFramebuffer& framebuffer, VkExtent2D extent);
 	void UIPasses(VkCommandBuffer& commandBuffer, VkRenderPass& renderPass, VkFramebuffer& framebuffer, VkExtent2D extent);
 
@@ -250,6 +573,14 @@ public:
 	void submitCommands(u32 commandBufferCount, VkCommandBuffer* commandBuffer, u32 waitSemaphoreCount, VkSemaphore* waitSemaphore, u32 signalSemaphoreCount,
 		VkSemaphore* signalSemaphore, VkQueue& graphicsQueue, VkFence* fence);
 
+	// Submit the batches of the render graph to their queues, every batch waits for the batch before it on the other queue
+	void submitRenderGraphBatches(std::vector<VulkanRenderGraphBatch>& batches, VkSemaphore& imageAvailable, VkSemaphore& readyToPresent,
+		VkQueue& graphicsQueue, VkFence& fence);
+
+	// Make the writes of a pass visible to the passes after it in the same submission
+	void recordPassBarrier(VkCommandBuffer& commandBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage,
+		VkAccessFlags dstAccess);
+
 	void presentImage(VkQueue& graphicsQueue, VkSemaphore& waitSemaphore, VkSwapchainKHR& swapchain, u32& swapchainIndex);
 
 
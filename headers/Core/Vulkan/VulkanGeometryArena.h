@@ -0,0 +1,108 @@
+#pragma once
+#include "Core/Vulkan/VulkanDefines.h"
+#include "Core/RangeAllocator.h"
+
+// Vertices and indices of a mesh in a geometry arena
+// The indices are relative to the first vertex, so the vertices can be moved without rewriting them
+struct VulkanGeometryRange
+{
+	u32 vertexOffset;
+	u32 numVertices;
+	u32 firstIndex;
+	u32 numIndices;
+	// 16 bit if the mesh has few enough vertices, the first index is in the index buffer of this type
+	VkIndexType indexType;
+};
+
+// Index buffer of one index type
+struct VulkanGeometryIndices
+{
+	VkIndexType indexType;
+	u32 indexSize;
+
+	VulkanAllocatedMemory buffer;
+	RangeAllocator allocator;
+};
+
+// Large vertex and index buffers shared by every mesh with the same vertex layout
+// Every stream has one buffer, a mesh owns the same range of vertices in each of them. The buffers are bound once per pass
+// and draws select their mesh with the first index and vertex offset
+// Meshes with up to 65536 vertices use 16 bit indices, so there is one index buffer for each index type
+class VulkanGeometryArena
+{
+public:
+
+	static const u32 INITIAL_VERTEX_CAPACITY = 1 << 18;
+	// Of each index buffer
+	static const u32 INITIAL_INDEX_CAPACITY = 1 << 20;
+
+	static const u32 NUM_INDEX_TYPES = 2;
+	// The indices are relative to the first vertex of the mesh
+	static const u32 MAX_16_BIT_VERTICES = 1 << 16;
+
+private:
+
+	// Size of one vertex in each stream
+	std::vector<u32> strides;
+	// Whether the streams hold the compressed vertex layout
+	bool compressed;
+
+	std::vector<VulkanAllocatedMemory> vertexBuffers;
+	// Handles and offsets passed when binding, the offsets are always 0
+	std::vector<VkBuffer> vertexBufferHandles;
+	std::vector<VkDeviceSize> vertexBufferOffsets;
+
+	RangeAllocator vertexAllocator;
+
+	// 16 and 32 bit
+	std::array<VulkanGeometryIndices, NUM_INDEX_TYPES> indexBuffers;
+
+	// Every range handed out, updated when the arena is defragmented
+	std::vector<VulkanGeometryRange*> ranges;
+
+public:
+
+	VulkanGeometryArena();
+	~VulkanGeometryArena();
+
+	// One stream for each binding of the vertex input
+	void init(VmaAllocator& vmaAllocator, const VulkanVertexInput& vertexInput, u32 vertexCapacity, u32 indexCapacity);
+	void destroy(VmaAllocator& vmaAllocator);
+
+	// Allocate a range and copy the vertices of every stream and the indices into it, the arena grows if it is full
+	// The indices are narrowed to 16 bit if the vertices allow it. Waits for the copy to finish
+	void upload(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkSurfaceKHR& surface, VkQueue& queue,
+		VulkanGeometryRange& range, const std::vector<const void*>& vertexData, u32 numVertices, const u32* indices, u32 numIndices);
+	// The range can be handed out again, draws recorded with it must have finished
+	void free(VulkanGeometryRange& range);
+
+	// Move every range to the start of the buffers so the free space is one range again
+	// Waits for the device to be idle, the ranges are updated so draws recorded afterwards use the new offsets
+	void defragment(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkSurfaceKHR& surface, VkQueue& queue);
+
+	void bindVertices(VkCommandBuffer& commandBuffer) const;
+	void bindIndices(VkCommandBuffer& commandBuffer, VkIndexType indexType) const;
+
+	u32 getNumStreams() const { return static_cast<u32>(strides.size()); };
+	bool isCompressed() const { return compressed; };
+	f32 getFragmentation() const;
+	u64 getMemorySize() const;
+
+private:
+
+	VulkanGeometryIndices& getIndexBuffer(VkIndexType indexType) { return indexBuffers[indexType == VK_INDEX_TYPE_UINT16 ? 0 : 1]; };
+	const VulkanGeometryIndices& getIndexBuffer(VkIndexType indexType) const { return indexBuffers[indexType == VK_INDEX_TYPE_UINT16 ? 0 : 1]; };
+
+	// Replace the buffers with ones of the given capacity and copy ranges of the old ones, the copies are in vertices and indices
+	// Buffers keeping their capacity without copies are left as they are
+	void resize(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkSurfaceKHR& surface, VkQueue& queue,
+		u32 vertexCapacity, const std::array<u32, NUM_INDEX_TYPES>& indexCapacities, const std::vector<VkBufferCopy>& vertexCopies,
+		const std::array<std::vector<VkBufferCopy>, NUM_INDEX_TYPES>& indexCopies);
+
+	void createVertexBuffers(VmaAllocator& vmaAllocator, u32 vertexCapacity);
+	void createIndexBuffer(VmaAllocator& vmaAllocator, VulkanGeometryIndices& indexBuffer, u32 indexCapacity);
+
+	// Record commands with a temporary command buffer and wait for them to finish
+	void submit(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface, VkQueue& queue,
+		const std::function<void(VkCommandBuffer&)>& record);
+};
\ No newline at end of file
@@ -0,0 +1,174 @@
+#pragma once
+#include "Core/Vulkan/VulkanDefines.h"
+
+typedef u32 RenderGraphImageId;
+typedef u32 RenderGraphPassId;
+
+// How a pass uses an image
+struct VulkanRenderGraphAccess
+{
+	RenderGraphImageId image;
+
+	VkPipelineStageFlags stage;
+	VkAccessFlags access;
+
+	// Layout the image has to be in when the pass starts
+	// UNDEFINED if the pass does not care about the previous content, e.g. a render pass clearing the attachment
+	VkImageLayout layout;
+	// Layout the pass leaves the image in
+	VkImageLayout finalLayout;
+
+	bool write;
+};
+
+struct VulkanRenderGraphImage
+{
+	std::string name;
+
+	VkFormat format;
+	VkExtent2D extent;
+	VkImageUsageFlags usage;
+	VkImageAspectFlags aspect;
+
+	// Imported images are created and destroyed outside of the graph, they are never aliased
+	bool imported;
+	VulkanAllocatedImage* importedImage;
+
+	// Transient images are created by the graph when it is compiled
+	VulkanAllocatedImage image;
+	VkMemoryRequirements memoryRequirements;
+
+	// First and last alive pass using the image, -1 if no alive pass uses it
+	i32 firstPass;
+	i32 lastPass;
+
+	// The memory slot the image is bound to, images in the same slot are never alive at the same time
+	i32 memorySlot;
+
+	// Queues of the alive passes using the image, only images used on the same queues share a memory slot
+	u32 queueMask;
+};
+
+struct VulkanRenderGraphPass
+{
+	std::string name;
+
+	// The primary command buffer of the frame this pass is recorded into
+	VulkanCommandBufferType commandBufferType;
+
+	std::vector<VulkanRenderGraphAccess> accesses;
+
+	// Records the commands of the pass, the command buffer is already begun
+	std::function<void(VkCommandBuffer&)> record;
+
+	// Checked every frame, the pass is skipped if it returns false
+	std::function<bool()> shouldExecute;
+
+	// Passes with effects outside of the graph (e.g. presenting) are never culled
+	bool sideEffect;
+
+	// Culled passes do not write anything an alive pass reads
+	bool culled;
+
+	// Submitted to the compute queue instead of the graphics queue
+	bool asyncCompute;
+
+	// Barriers recorded before the pass, computed when the graph is compiled
+	VkPipelineStageFlags srcStage;
+	VkPipelineStageFlags dstStage;
+	VkAccessFlags srcAccess;
+	VkAccessFlags dstAccess;
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	// Image of each image barrier, the handles are patched in when the pass is executed
+	std::vector<RenderGraphImageId> imageBarrierImages;
+
+	// Queue family ownership releases recorded after the pass, for images the next pass using them runs on the other queue
+	VkPipelineStageFlags releaseSrcStage;
+	std::vector<VkImageMemoryBarrier> releaseBarriers;
+	std::vector<RenderGraphImageId> releaseBarrierImages;
+};
+
+// Consecutive passes submitted to the same queue
+struct VulkanRenderGraphBatch
+{
+	bool asyncCompute;
+	std::vector<VkCommandBuffer> commandBuffers;
+};
+
+struct VulkanRenderGraphMemorySlot
+{
+	VkMemoryRequirements memoryRequirements;
+	VmaAllocation allocation;
+
+	std::vector<RenderGraphImageId> images;
+};
+
+// Frame graph of the passes rendering the scene
+// Passes declare the images they read and write. When compiled the graph drops passes whose outputs are never read,
+// aliases the memory of transient images whose lifetimes do not overlap and computes the barriers and layout transitions between passes
+class VulkanRenderGraph
+{
+private:
+
+	std::vector<VulkanRenderGraphImage> images;
+	std::vector<VulkanRenderGraphPass> passes;
+
+	// Alive passes in execution order
+	std::vector<RenderGraphPassId> executionOrder;
+
+	std::vector<VulkanRenderGraphMemorySlot> memorySlots;
+
+	u32 graphicsQueueFamily;
+	u32 computeQueueFamily;
+
+	bool compiled;
+
+public:
+
+	VulkanRenderGraph();
+	~VulkanRenderGraph();
+
+	// Declaration
+	RenderGraphImageId createImage(const std::string& name, VkFormat format, VkExtent2D extent, VkImageUsageFlags usage, VkImageAspectFlags aspect);
+	RenderGraphImageId importImage(const std::string& name, VulkanAllocatedImage* image, VkImageAspectFlags aspect);
+
+	RenderGraphPassId addPass(const std::string& name, VulkanCommandBufferType commandBufferType, std::function<void(VkCommandBuffer&)> record);
+
+	void readImage(RenderGraphPassId pass, RenderGraphImageId image, VkPipelineStageFlags stage, VkAccessFlags access, VkImageLayout layout);
+	void writeImage(RenderGraphPassId pass, RenderGraphImageId image, VkPipelineStageFlags stage, VkAccessFlags access, VkImageLayout layout,
+		VkImageLayout finalLayout);
+
+	void setSideEffect(RenderGraphPassId pass) { passes[pass].sideEffect = true; }
+	void setCondition(RenderGraphPassId pass, std::function<bool()> shouldExecute) { passes[pass].shouldExecute = shouldExecute; }
+	void setAsyncCompute(RenderGraphPassId pass) { passes[pass].asyncCompute = true; }
+
+	// Ownership of images moves between the families when they are used on both queues, nothing moves if they are the same family
+	void setQueueFamilies(u32 graphicsQueueFamily, u32 computeQueueFamily);
+
+	// Cull passes, allocate transient images and compute barriers
+	void compile(VkDevice& logicalDevice, VmaAllocator& vmaAllocator);
+
+	// Record every alive pass into the frame's command buffers and group them into batches per queue in execution order
+	// Every batch has to wait for the batch before it when they are submitted
+	void execute(VulkanFrame& frame, std::vector<VulkanRenderGraphBatch>& batches);
+
+	// Destroy transient images and clear every declaration
+	void destroy(VkDevice& logicalDevice, VmaAllocator& vmaAllocator);
+
+	const VulkanAllocatedImage& getImage(RenderGraphImageId image) const;
+	bool isImageUsed(RenderGraphImageId image) const { return images[image].firstPass >= 0; }
+	bool isPassCulled(RenderGraphPassId pass) const { return passes[pass].culled; }
+
+	u32 getNumCulledPasses() const;
+	// Memory of transient images after aliasing
+	u64 getTransientMemorySize() const;
+	// Memory the transient images would use if every image had its own allocation
+	u64 getUnaliasedMemorySize() const;
+
+private:
+
+	void cullPasses();
+	void computeLifetimes();
+	void allocateTransientImages(VkDevice& logicalDevice, VmaAllocator& vmaAllocator);
+	void computeBarriers();
+};
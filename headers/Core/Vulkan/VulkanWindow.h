@@ -40,10 +40,19 @@ public:
 
 	VkQueue graphicsQueue;
 
+	// VK_NULL_HANDLE if the device has no queue besides the graphics queue that can run compute work
 	VkQueue computeQueue;
 
 	VkQueue presentQueue;
 
+	u32 graphicsQueueFamily;
+	u32 computeQueueFamily;
+
+	// vkCmdDrawIndexedIndirectCount is available
+	bool drawIndirectCount;
+	// Indirect draws can draw more than one command
+	bool multiDrawIndirect;
+
 	VkSurfaceKHR surface;
 
 	// The majority vulkan stuffs run here
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+// Threads started once and kept asleep between frames, so the per frame work doesn't create and join threads
+// The calling thread runs the first task itself, the other tasks run on the workers
+class WorkerPool
+{
+private:
+
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	// Wakes the workers when a new set of tasks is run or the pool is stopped
+	std::condition_variable workCondition;
+	// Wakes the calling thread when the last worker task is done
+	std::condition_variable doneCondition;
+
+	// Tasks of the current run, only valid while run() waits for them
+	const std::function<void(u32)>* task;
+	u32 numTasks;
+	// Worker tasks of the current run that haven't finished yet
+	u32 numPendingTasks;
+	// Incremented by every run, a worker runs its task once per generation
+	u32 generation;
+	bool stopping;
+
+public:
+
+	// Starts numThreads - 1 workers, the calling thread is the remaining one
+	WorkerPool(u32 numThreads);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// Run task(i) for every i in [0, numTasks) and return once all of them are done
+	// numTasks is clamped to the number of threads
+	void run(u32 numTasks, const std::function<void(u32)>& task);
+
+	u32 getNumThreads() const { return static_cast<u32>(threads.size()) + 1; };
+
+private:
+
+	void workerLoop(u32 taskIndex);
+};
\ No newline at end of file
@@ -5,4 +5,12 @@ namespace WillEngine::Utils
 	mat4 AssimpMat4ToGlmMat4(const aiMatrix4x4 aiMatrix);
 
 	void DecomposeMatrix(mat4 in, vec3& position, vec3& rotation, vec3& scale);
+
+	// Bounds enclosing the transformed box, without transforming its eight corners
+	void TransformAabb(const mat4& transformation, const vec3& aabbMin, const vec3& aabbMax, vec3& worldMin, vec3& worldMax);
+	// The radius grows with the largest scale of the transformation
+	vec4 TransformBoundingSphere(const mat4& transformation, const vec4& boundingSphere);
+
+	// Map a direction onto the octahedron unfolded into [-1, 1]^2
+	vec2 EncodeOctahedral(const vec3& direction);
 }
\ No newline at end of file
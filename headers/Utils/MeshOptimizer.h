@@ -0,0 +1,38 @@
+#pragma once
+#include "Core/Mesh.h"
+
+namespace WillEngine::Utils
+{
+	// Post-transform vertex cache efficiency of a triangle list, simulated with a FIFO cache
+	struct VertexCacheStatistics
+	{
+		// Average cache misses per triangle, 3 without any reuse and close to 0.5 for a well ordered regular grid
+		f32 acmr;
+		// Average transforms per referenced vertex, 1 if every vertex is transformed once
+		f32 atvr;
+	};
+
+	// Size of the FIFO cache the statistics are measured with
+	static const u32 VERTEX_CACHE_SIZE = 16;
+
+	// A cluster may be split for overdraw as long as its misses per triangle stay within this factor of the unsplit cluster
+	static const f32 OVERDRAW_THRESHOLD = 1.05f;
+
+	// Reorder the triangles of a triangle list for the vertex cache, then optionally by cluster for overdraw, then the vertices in the
+	// order the triangles first use them. Unused vertices are removed
+	void optimizeMesh(Mesh* mesh, bool overdraw, VertexCacheStatistics& before, VertexCacheStatistics& after);
+	// Optimise every mesh, spread over the hardware threads, and print the statistics of every mesh if printStatistics is set
+	void optimizeMeshes(const std::vector<Mesh*>& meshes, bool overdraw, bool printStatistics);
+
+	VertexCacheStatistics analyzeVertexCache(const std::vector<u32>& indices, u32 numVertices, u32 cacheSize);
+
+	// Tom Forsyth's linear-speed vertex cache optimisation
+	// Reference: https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+	void optimizeVertexCache(std::vector<u32>& indices, u32 numVertices);
+	// Split the cache optimised triangles into clusters and draw the ones facing away from the mesh's centre first, as in Tipsify
+	// Reference: Sander et al. 2007, Fast Triangle Reordering for Vertex Locality and Reduced Overdraw
+	void optimizeOverdraw(std::vector<u32>& indices, const std::vector<vec3>& positions, f32 threshold);
+	// Number the vertices in the order the indices first use them, remap holds the new index of every vertex or Mesh::REMOVED_VERTEX
+	// Returns the number of used vertices
+	u32 optimizeVertexFetch(std::vector<u32>& indices, u32 numVertices, std::vector<u32>& remap);
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+#include "Core/Mesh.h"
+
+namespace WillEngine::Utils
+{
+	// Every level keeps about this fraction of the triangles of the level before
+	static const f32 LOD_TRIANGLE_RATIO = 0.5f;
+	// The chain ends at a level that removes less than this fraction of the triangles of the level before
+	static const f32 LOD_MIN_REDUCTION = 0.1f;
+
+	// Simplify the full mesh into up to MAX_MESH_LODS - 1 coarser levels, their indices are appended to the mesh's
+	// Vertices on UV seams and open borders are kept in place, vertices of skinned meshes only collapse onto vertices with the same main bone
+	void generateLods(Mesh* mesh);
+	// Generate the levels of every mesh, spread over the hardware threads, and print the triangles of every level if printStatistics is set
+	void generateMeshLods(const std::vector<Mesh*>& meshes, bool printStatistics);
+
+	// Quadric error metric edge collapse, vertices collapse onto a neighbour so the simplified triangles use the same vertices
+	// Vertices only collapse onto vertices of the same group and locked vertices never collapse
+	// Returns the simplified triangles, error is set to the largest distance a collapse moved the surface
+	// Reference: Garland and Heckbert 1997, Surface Simplification Using Quadric Error Metrics
+	std::vector<u32> simplifyMesh(const std::vector<u32>& indices, const std::vector<vec3>& positions, const std::vector<u32>& groups,
+		const std::vector<bool>& locked, u32 targetIndexCount, f32& error);
+
+	// Vertices sharing their position with another vertex, i.e. on an attribute seam, and vertices on an edge without exactly one
+	// opposite edge
+	std::vector<bool> findLockedVertices(const std::vector<u32>& indices, const std::vector<vec3>& positions);
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+#include "Core/Mesh.h"
+
+namespace WillEngine::Utils
+{
+	// Limits of a meshlet, the sizes a mesh shader workgroup would output
+	static const u32 MAX_MESHLET_VERTICES = 64;
+	static const u32 MAX_MESHLET_TRIANGLES = 124;
+
+	// Triangles whose normals spread further than this from the cone axis can face the camera from anywhere
+	static const f32 MESHLET_MIN_CONE_DOT = 0.1f;
+
+	// Split the triangles of every level of detail into meshlets in the order they are drawn, a meshlet ends once the next triangle
+	// would exceed a limit
+	// The triangles should be ordered for the vertex cache first, so the triangles next to each other in the index buffer are neighbours
+	void buildMeshlets(Mesh* mesh);
+	// Append the meshlets of the index range to the mesh's
+	void buildMeshlets(Mesh* mesh, u32 firstIndex, u32 numIndices);
+
+	// Bounding sphere and normal cone of the meshlet's triangles
+	void computeMeshletBounds(Meshlet& meshlet, const std::vector<u32>& indices, const std::vector<vec3>& positions);
+}
\ No newline at end of file
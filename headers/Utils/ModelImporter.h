@@ -18,6 +18,11 @@ namespace WillEngine::Utils
 		aiProcess_JoinIdenticalVertices |
 		aiProcess_CalcTangentSpace;
 
+	// Reorder clusters of triangles for overdraw after reordering them for the vertex cache
+	inline constexpr bool OPTIMIZE_OVERDRAW = true;
+	// Print the vertex cache statistics and level of detail triangle counts of every imported mesh
+	inline constexpr bool PRINT_MESH_STATISTICS = false;
+
 	std::tuple<std::vector<Mesh*>, std::map<u32, Material*>, Skeleton*, std::vector<Animation*>> readModel(const char* filepath, std::vector<Entity*>* entities = nullptr);
 	std::vector<Animation*> readAnimation(const char* filepath);
 
@@ -27,6 +32,8 @@ namespace WillEngine::Utils
 	std::vector<Mesh*> extractMesh(const aiScene* scene);
 	Mesh* extractMeshWithoutBones(const aiMesh* currentAiMesh);
 	Mesh* extractMeshWithBones(const aiMesh* mesh);
+	// The w component is the sign of the bitangent, the shaders compute it as the cross product of the tangent and normal
+	vec4 tangentWithSign(const aiVector3D& normal, const aiVector3D& tangent, const aiVector3D& bitangent);
 	// For Skeletal Animation
 	void extractNodes(const char* filename, const aiScene* scene, std::vector<Mesh*> extractedMesh, std::map<u32, Material*> extractedMaterial, 
 		Skeleton* extractedSkeleton, std::vector<Entity*>* entities);
@@ -11,6 +11,8 @@ namespace WillEngine::VulkanUtil
 {
 	// Queue Families
 	std::optional<u32> findQueueFamilies(VkPhysicalDevice& device, VkQueueFlagBits flag, VkSurfaceKHR surface);
+	// A family with compute but without graphics, its queues run alongside the graphics queue
+	std::optional<u32> findDedicatedComputeQueueFamily(VkPhysicalDevice& device);
 
 	// Surfaces
 	void querySupportedSurfaceFormat(VkPhysicalDevice& device, VkSurfaceKHR& surface,
@@ -51,6 +53,10 @@ namespace WillEngine::VulkanUtil
 	void createImageView(VkDevice& logicalDevice, VkImage& image, VkImageView& imageView, u32 mipLevels, VkFormat format, 
 		VkImageAspectFlags aspectMask);
 
+	// View of the mips [baseMipLevel, baseMipLevel + mipLevels)
+	void createMipImageView(VkDevice& logicalDevice, VkImage& image, VkImageView& imageView, u32 baseMipLevel, u32 mipLevels, VkFormat format,
+		VkImageAspectFlags aspectMask);
+
 	void createDepthImageView(VkDevice& logicalDevice, VkImage& image, VkImageView& imageView, u32 mipLevels, VkFormat format,
 		VkImageAspectFlags aspectMask);
 
@@ -71,6 +77,7 @@ namespace WillEngine::VulkanUtil
 
 	// Command Pool / Buffer
 	VkCommandPool createCommandPool(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface);
+	VkCommandPool createCommandPool(VkDevice& logicalDevice, u32 queueFamilyIndex);
 
 	VkCommandBuffer createCommandBuffer(VkDevice& logicalDevice, VkCommandPool& commandPool);
 	VkCommandBuffer createSecondaryCommandBuffer(VkDevice& logicalDevice, VkCommandPool& commandPool);
@@ -78,6 +85,10 @@ namespace WillEngine::VulkanUtil
 	// Fances
 	VkFence createFence(VkDevice& logicalDevice, bool signaled);
 
+	// Global Memory Barrier
+	void memoryBarrier(VkCommandBuffer& commandBuffer, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, VkPipelineStageFlags srcStage,
+		VkPipelineStageFlags dstStage);
+
 	// Memory Buffer Barrier
 	void bufferBarrier(VkCommandBuffer& commandBuffer, VkBuffer& buffer, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask, VkPipelineStageFlags srcStage,
 		VkPipelineStageFlags dstStage, VkDeviceSize size, VkDeviceSize offset, u32 srcFamilyIndex, u32 dstFamilyIndex);
@@ -94,6 +105,8 @@ namespace WillEngine::VulkanUtil
 	void initShadowShaderModule(VkDevice& logicalDevice, VkShaderModule& vertShader, VkShaderModule& geomShader, VkShaderModule& fragShader);
 	void initDepthShaderModule(VkDevice& logicalDevice, VkShaderModule& vertShader, VkShaderModule& fragShader);
 	void initDepthSkeletonShaderModule(VkDevice& logicalDevice, VkShaderModule& vertShader, VkShaderModule& fragShader);
+	void initBakedSkeletalShaderModule(VkDevice& logicalDevice, VkShaderModule& vertShader, VkShaderModule& fragShader);
+	void initDepthBakedSkeletonShaderModule(VkDevice& logicalDevice, VkShaderModule& vertShader, VkShaderModule& fragShader);
 
 	void initFilterBrightShaderModule(VkDevice& logicalDevice, VkShaderModule& compShader);
 	void initClearColorShaderModule(VkDevice& logicalDevice, VkShaderModule& compShader);
@@ -101,36 +114,51 @@ namespace WillEngine::VulkanUtil
 	void initUpscaleShaderModule(VkDevice& logicalDevice, VkShaderModule& compShader);
 	void initBlendColorShaderModule(VkDevice& logicalDevice, VkShaderModule& compShader);
 
+	void initCullShaderModule(VkDevice& logicalDevice, VkShaderModule& compShader);
+	void initHiZShaderModule(VkDevice& logicalDevice, VkShaderModule& compShader);
+	void initDepthIndirectShaderModule(VkDevice& logicalDevice, VkShaderModule& vertShader, VkShaderModule& fragShader);
+	void initGeometryIndirectShaderModule(VkDevice& logicalDevice, VkShaderModule& vertShader, VkShaderModule& fragShader);
+	void initShadowIndirectShaderModule(VkDevice& logicalDevice, VkShaderModule& vertShader, VkShaderModule& geomShader, VkShaderModule& fragShader);
+
 	// Descriptors related
 	void createDescriptorSetLayout(VkDevice& logicalDevice, VkDescriptorSetLayout& descriptorSetLayout,VkDescriptorType descriptorType, 
 		VkShaderStageFlags shaderStage, u32 binding, u32 descriptorCount);
+	// Bindings 0 to bindingCount - 1, all of the same type
+	void createDescriptorSetLayoutBindings(VkDevice& logicalDevice, VkDescriptorSetLayout& descriptorSetLayout, VkDescriptorType descriptorType,
+		VkShaderStageFlags shaderStage, u32 bindingCount);
 
 	void allocDescriptorSet(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool, VkDescriptorSetLayout& descriptorSetInfo,
 		VkDescriptorSet& descriptorSet);
 
-	void writeDescriptorSetBuffer(VkDevice& logicalDevice, VkDescriptorSet& descriptorSet, VkBuffer& descriptorBuffer, u32 binding);
+	void writeDescriptorSetBuffer(VkDevice& logicalDevice, VkDescriptorSet& descriptorSet, VkBuffer& descriptorBuffer, u32 binding,
+		VkDescriptorType descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
 
 	void writeDescriptorSetImage(VkDevice& logicalDevice, VkDescriptorSet& descriptorSet, VkSampler* sampler,
 		VkImageView* imageView, VkImageLayout imageLayout, VkDescriptorType descriptorType, u32 binding, u32 descriptorCount);
 
 	// Pipeline
+	// Vertex input of a geometry arena's layout, positionOnly leaves out every attribute but the position and skinning for the depth
+	// and shadow passes. The baked animation instance binding follows the streams
+	VulkanVertexInput createVertexInput(VulkanGeometryType geometryType, bool compressed, bool positionOnly, bool bakedAnimation = false);
+
 	void createPipelineLayout(VkDevice& logicalDevice, VkPipelineLayout& pipelineLayout, u32 size,
 		VkDescriptorSetLayout* descriptorSetLayout, u32 pushConstantCount, VkPushConstantRange* pushConstant);
 
 	void createPipeline(VkDevice& logicalDevice, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout, VkRenderPass& renderpass, 
 		VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent);
 	void createSkeletalPipeline(VkDevice& logicalDevice, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout, VkRenderPass& renderpass,
-		VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent);
+		VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent, const VulkanVertexInput& vertexInput);
 	void createGeometryPipeline(VkDevice& logicalDevice, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout, VkRenderPass& renderpass,
-		VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent);
+		VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent, const VulkanVertexInput& vertexInput);
 	void createShadingPipeline(VkDevice& logicalDevice, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout, VkRenderPass& renderpass,
 		VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent);
 	void createShadowPipeline(VkDevice& logicalDevice, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout, VkRenderPass& renderpass,
-		VkShaderModule& vertShader, VkShaderModule& geomShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, u32 width, u32 height);
+		VkShaderModule& vertShader, VkShaderModule& geomShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, u32 width, u32 height,
+		const VulkanVertexInput& vertexInput);
 	void createDepthPipeline(VkDevice& logicalDevice, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout, VkRenderPass& renderpass,
-		VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent);
+		VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent, const VulkanVertexInput& vertexInput);
 	void createDepthSkeletalPipeline(VkDevice& logicalDevice, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout, VkRenderPass& renderpass,
-		VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent);
+		VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent, const VulkanVertexInput& vertexInput);
 
 	void createComputePipeline(VkDevice& logicalDevice, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout, VkShaderModule& compShader);
 
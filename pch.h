@@ -17,12 +17,15 @@
 #include <set>
 #include <queue>
 #include <array>
+#include <functional>
 
 // Windows
+#ifdef _WIN32
 #include <Windows.h>
 
 // Vulkan
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 
 // Volk
 #include <volk.h>
@@ -33,8 +36,10 @@
 // GLFW
 #define GLFW_INCLUDE_VULKAN
 #include <glfw/glfw3.h>
+#ifdef _WIN32
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <glfw/glfw3native.h>
+#endif
 
 // GLM
 #include <glm/glm.hpp>
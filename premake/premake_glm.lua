@@ -14,10 +14,11 @@ project "glm"
 		"../libs/glm/glm/**.inl"
 	}
 
-	defines {
-		"WIN32",
-		"_WINDOWS"
-	}
+	filter "system:windows"
+		defines {
+			"WIN32",
+			"_WINDOWS"
+		}
 
 	filter "configurations:Debug"
 		runtime "Debug"
@@ -57,10 +57,11 @@ project "imgui"
 		"../libs/imgui/backends/imgui_impl_vulkan.cpp"
 	}
 
-	defines {
-		"WIN32",
-		"_WINDOWS"
-	}
+	filter "system:windows"
+		defines {
+			"WIN32",
+			"_WINDOWS"
+		}
 	filter "configurations:Debug"
 		runtime "Debug"
 		symbols "on"
@@ -20,10 +20,11 @@ project "volk"
 	files( "../libs/volk/*.c" )
 	files( "../libs/volk/*.h" )
 
-	defines {
-		"WIN32",
-		"_WINDOWS"
-	}
+	filter "system:windows"
+		defines {
+			"WIN32",
+			"_WINDOWS"
+		}
 
 	filter "configurations:Debug"
 		runtime "Debug"
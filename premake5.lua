@@ -18,8 +18,11 @@ workspace "WillEngine"
 	architecture "x64"
 	startproject "WillEngine"
 
-include "premake/premake_glfw.lua"
-include "premake/premake_assimp.lua"
+-- The glfw and assimp projects only build the Windows sources, other platforms link the system libraries
+if os.target() == "windows" then
+	include "premake/premake_glfw.lua"
+	include "premake/premake_assimp.lua"
+end
 include "premake/premake_glm.lua"
 
 include "premake/premake_volk.lua"
@@ -120,4 +123,151 @@ project "WillEngine"
 	pchheader "pch.h"
 	pchsource "pch.cpp"
 
-	postbuildcommands { '{COPYFILE} "%{wks.location}/libs/compiled_libs/assimp/Debug/assimp-vc143-mtd.dll" %{cfg.targetdir}'  }
\ No newline at end of file
+	postbuildcommands { '{COPYFILE} "%{wks.location}/libs/compiled_libs/assimp/Debug/assimp-vc143-mtd.dll" %{cfg.targetdir}'  }
+
+-- Engine sources of the headless projects
+-- Nothing is rendered, but the meshes and materials pull in the Vulkan and ImGui code
+local headlessSources =
+{
+	"pch.h",
+	"pch.cpp",
+	"src/Core/*.cpp",
+	"src/Core/ECS/*.cpp",
+	"src/Core/Vulkan/VulkanGeometryArena.cpp",
+	"src/Managers/AnimationManager.cpp",
+	"src/Managers/FileManager.cpp",
+	"src/Utils/Image.cpp",
+	"src/Utils/MathUtil.cpp",
+	"src/Utils/MeshOptimizer.cpp",
+	"src/Utils/MeshletBuilder.cpp",
+	"src/Utils/MeshSimplifier.cpp",
+	"src/Utils/ModelImporter.cpp",
+	"src/Utils/VulkanUtil.cpp",
+}
+
+-- Headless animation benchmark
+-- Loads the rigged models and times the animation update without creating a window or a Vulkan device
+-- Run from the repository root so the default assets/ folder can be found
+project "AnimationBenchmark"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++20"
+	targetdir "bin/%{cfg.buildcfg}"
+
+	defines {"NOMINMAX"}
+
+	filter "configurations:Debug"
+		defines {"DEBUG"}
+		symbols "on"
+
+	filter "configurations:Release"
+		optimize "Speed"
+
+	filter "system:windows"
+		disablewarnings {"4005"}
+		links {"user32"}
+
+	filter "system:linux"
+		links {"dl", "pthread"}
+
+	filter {}
+
+	includedirs
+	{
+		"",
+		"headers",
+		"libs/glfw/include/",
+		"libs/assimp/include/",
+		"libs/glm/",
+		"libs/stb/",
+		"libs/imgui/",
+		"libs/volk/",
+		"libs/vulkan/include/",
+		"libs/vma/include/",
+	}
+
+	dependson
+	{
+		"imgui",
+		"volk",
+		"vulkan",
+		"vma",
+	}
+
+	links
+	{
+		"assimp",
+		"imgui",
+		"volk",
+		"vma",
+		"glfw",
+	}
+
+	files {"benchmark/*.cpp"}
+	files(headlessSources)
+
+	pchheader "pch.h"
+	pchsource "pch.cpp"
+
+-- Headless behaviour checks
+-- Checks the engine utilities on generated data without creating a window or a Vulkan device
+project "BehaviourTests"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++20"
+	targetdir "bin/%{cfg.buildcfg}"
+
+	defines {"NOMINMAX"}
+
+	filter "configurations:Debug"
+		defines {"DEBUG"}
+		symbols "on"
+
+	filter "configurations:Release"
+		optimize "Speed"
+
+	filter "system:windows"
+		disablewarnings {"4005"}
+		links {"user32"}
+
+	filter "system:linux"
+		links {"dl", "pthread"}
+
+	filter {}
+
+	includedirs
+	{
+		"",
+		"headers",
+		"libs/glfw/include/",
+		"libs/assimp/include/",
+		"libs/glm/",
+		"libs/stb/",
+		"libs/imgui/",
+		"libs/volk/",
+		"libs/vulkan/include/",
+		"libs/vma/include/",
+	}
+
+	dependson
+	{
+		"imgui",
+		"volk",
+		"vulkan",
+		"vma",
+	}
+
+	links
+	{
+		"assimp",
+		"imgui",
+		"volk",
+		"vma",
+		"glfw",
+	}
+
+	files {"tests/*.cpp"}
+	files(headlessSources)
+
+	pchheader "pch.h"
+	pchsource "pch.cpp"
@@ -0,0 +1,129 @@
+#version 450 core
+
+// Normal and tangent are octahedral encoded if the vertices are compressed
+layout(constant_id = 0) const bool COMPRESSED_VERTICES = false;
+
+// Quantised inside the mesh's bounding box if the vertices are compressed
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+// w: sign of the bitangent
+layout(location = 2) in vec4 tangent;
+layout(location = 3) in vec2 texCoord;
+layout(location = 4) in uvec4 boneIds;
+layout(location = 5) in vec4 weights;
+
+// Per instance
+layout(location = 6) in mat4 modelTransform;
+layout(location = 10) in uvec2 clipInfo;
+layout(location = 11) in vec2 playbackInfo;
+
+layout(set = 0, binding = 0) uniform sceneMatrix
+{
+	mat4 cameraMatrix;
+	mat4 projectMatrix;
+};
+
+const uint MAX_BONES = 256;
+const uint MAX_BONE_INFLUENCE = 4;
+// Order: Clip->Frame->Bone Id
+layout(set = 2, binding = 2) readonly buffer bakedBoneMatricesInfo
+{
+	mat4 bakedBoneMatrices[];
+};
+
+layout(push_constant) uniform bakedAnimationInfo
+{
+	// Dequantisation of the mesh's positions
+	vec4 positionOffset;
+	vec4 positionScale;
+	// Playback time split into whole baked frames and the fraction of the current one
+	uint frame;
+	float frameFraction;
+	uint numBones;
+	uint materialIndex;
+};
+
+layout(location = 0) out vec4 oPosition;
+layout(location = 1) out vec4 oNormal;
+layout(location = 2) out vec4 oTangent;
+layout(location = 3) out vec4 oBitangent;
+layout(location = 4) out vec2 oTexCoord;
+layout(location = 5) flat out uint oMaterialIndex;
+layout(location = 6) flat out uint oLodTint;
+
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+
+void main()
+{
+	uint firstMatrix = clipInfo.x;
+	uint numFrames = clipInfo.y;
+	float frameRate = playbackInfo.x;
+	float timeOffset = playbackInfo.y;
+
+	uint clipFrame = (frame + uint(frameFraction + timeOffset * frameRate)) % numFrames;
+	uint frameMatrix = firstMatrix + clipFrame * numBones;
+
+	vec3 meshPosition = positionOffset.xyz + positionScale.xyz * position;
+	vec3 meshNormal = COMPRESSED_VERTICES ? decodeOctahedral(normal.xy) : normal;
+	vec3 meshTangent = COMPRESSED_VERTICES ? decodeOctahedral(tangent.xy) : tangent.xyz;
+
+	vec4 finalPosition = vec4(0);
+	vec4 finalNormal = vec4(0);
+	vec4 finalTangent = vec4(0);
+	vec4 finalBitangent = vec4(0);
+	for(int i = 0; i < MAX_BONE_INFLUENCE; i++)
+	{
+		// Unused influences have a weight of 0
+		if(weights[i] == 0.0)
+			continue;
+		if(boneIds[i] >= MAX_BONES)
+		{
+			finalPosition = vec4(meshPosition, 1);
+			break;
+		}
+
+		mat4 boneMatrix = bakedBoneMatrices[frameMatrix + boneIds[i]];
+
+		vec4 localPosition = boneMatrix * vec4(meshPosition, 1);
+
+		// A optimised way to calculate a transformed normal without using inverse transpose
+		// Reference: https://lxjk.github.io/2017/10/01/Stop-Using-Normal-Matrix.html
+		mat3 upperMatrix = mat3(boneMatrix);
+		float scaleX = length(upperMatrix[0]);
+		float scaleY = length(upperMatrix[1]);
+		float scaleZ = length(upperMatrix[2]);
+		vec3 scale = vec3(scaleX, scaleY, scaleZ);
+
+		vec4 localNormal = normalize(vec4(upperMatrix * (meshNormal / scale), 0));
+		vec4 localTangent = normalize(boneMatrix * vec4(meshTangent, 0));
+		// Flipped where the uvs are mirrored
+		vec4 localBitangent = normalize(vec4(cross(localTangent.rgb, localNormal.rgb) * tangent.w, 0));
+
+		finalPosition += localPosition * weights[i];
+		finalNormal += localNormal * weights[i];
+		finalTangent += localTangent * weights[i];
+		finalBitangent += localBitangent * weights[i];
+	}
+
+	finalPosition = modelTransform * finalPosition;
+	finalNormal = vec4(mat3(modelTransform) * finalNormal.xyz, 0);
+	finalTangent = vec4(mat3(modelTransform) * finalTangent.xyz, 0);
+	finalBitangent = vec4(mat3(modelTransform) * finalBitangent.xyz, 0);
+
+	oPosition = finalPosition;
+	oNormal = normalize(finalNormal);
+	oTangent = normalize(finalTangent);
+	oBitangent = normalize(finalBitangent);
+	oTexCoord = texCoord;
+	oMaterialIndex = materialIndex;
+	// Skinned meshes always draw their full mesh and are not tinted
+	oLodTint = 0;
+
+	gl_Position = projectMatrix * cameraMatrix * finalPosition;
+}
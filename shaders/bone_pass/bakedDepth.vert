@@ -0,0 +1,67 @@
+#version 450 core
+
+// Only the positions and skinning are fetched, the positions are quantised inside the mesh's bounding box if the vertices are compressed
+layout(location = 0) in vec3 position;
+layout(location = 4) in uvec4 boneIds;
+layout(location = 5) in vec4 weights;
+
+// Per instance
+layout(location = 6) in mat4 modelTransform;
+layout(location = 10) in uvec2 clipInfo;
+layout(location = 11) in vec2 playbackInfo;
+
+layout(set = 0, binding = 0) uniform sceneMatrix
+{
+	mat4 cameraMatrix;
+	mat4 projectMatrix;
+};
+
+const uint MAX_BONES = 256;
+const uint MAX_BONE_INFLUENCE = 4;
+// Order: Clip->Frame->Bone Id
+layout(set = 1, binding = 2) readonly buffer bakedBoneMatricesInfo
+{
+	mat4 bakedBoneMatrices[];
+};
+
+layout(push_constant) uniform bakedAnimationInfo
+{
+	// Dequantisation of the mesh's positions
+	vec4 positionOffset;
+	vec4 positionScale;
+	// Playback time split into whole baked frames and the fraction of the current one
+	uint frame;
+	float frameFraction;
+	uint numBones;
+};
+
+void main()
+{
+	uint firstMatrix = clipInfo.x;
+	uint numFrames = clipInfo.y;
+	float frameRate = playbackInfo.x;
+	float timeOffset = playbackInfo.y;
+
+	uint clipFrame = (frame + uint(frameFraction + timeOffset * frameRate)) % numFrames;
+	uint frameMatrix = firstMatrix + clipFrame * numBones;
+
+	vec3 meshPosition = positionOffset.xyz + positionScale.xyz * position;
+
+	vec4 finalPosition = vec4(0);
+	for(int i = 0; i < MAX_BONE_INFLUENCE; i++)
+	{
+		// Unused influences have a weight of 0
+		if(weights[i] == 0.0)
+			continue;
+		if(boneIds[i] >= MAX_BONES)
+		{
+			finalPosition = vec4(meshPosition, 1);
+			break;
+		}
+
+		vec4 localPosition = bakedBoneMatrices[frameMatrix + boneIds[i]] * vec4(meshPosition, 1);
+		finalPosition += localPosition * weights[i];
+	}
+
+	gl_Position = projectMatrix * cameraMatrix * modelTransform * finalPosition;
+}
@@ -1,10 +1,8 @@
 #version 450 core
 
+// Only the positions and skinning are fetched, the positions are quantised inside the mesh's bounding box if the vertices are compressed
 layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 normal;
-layout(location = 2) in vec3 tangent;
-layout(location = 3) in vec2 texCoord;
-layout(location = 4) in ivec4 boneIds;
+layout(location = 4) in uvec4 boneIds;
 layout(location = 5) in vec4 weights;
 
 layout(set = 0, binding = 0) uniform sceneMatrix
@@ -20,22 +18,30 @@ layout(set = 1, binding = 2) uniform boneMatricesInfo
 	mat4 boneMatrices[MAX_BONES];
 };
 
+layout(push_constant) uniform meshInfo
+{
+	// Dequantisation of the mesh's positions
+	vec4 positionOffset;
+	vec4 positionScale;
+};
+
 void main()
 {
+	vec3 meshPosition = positionOffset.xyz + positionScale.xyz * position;
+
 	vec4 finalPosition = vec4(0);
 	for(int i = 0; i < MAX_BONE_INFLUENCE; i++)
 	{
-		// Ignore bone with id 0 as according to https://github.com/assimp/assimp/issues/3285
-		// bone id 0 has no meaning
-		if(boneIds[i] < 0)
+		// Unused influences have a weight of 0
+		if(weights[i] == 0.0)
 			continue;
 		if(boneIds[i] >= MAX_BONES)
 		{
-			finalPosition = vec4(position, 1);
+			finalPosition = vec4(meshPosition, 1);
 			break;
 		}
 
-		vec4 localPosition = boneMatrices[boneIds[i]] * vec4(position, 1);
+		vec4 localPosition = boneMatrices[boneIds[i]] * vec4(meshPosition, 1);
 		finalPosition += localPosition * weights[i];
 	}
 
@@ -1,10 +1,15 @@
 #version 450 core
 
+// Normal and tangent are octahedral encoded if the vertices are compressed
+layout(constant_id = 0) const bool COMPRESSED_VERTICES = false;
+
+// Quantised inside the mesh's bounding box if the vertices are compressed
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
-layout(location = 2) in vec3 tangent;
+// w: sign of the bitangent
+layout(location = 2) in vec4 tangent;
 layout(location = 3) in vec2 texCoord;
-layout(location = 4) in ivec4 boneIds;
+layout(location = 4) in uvec4 boneIds;
 layout(location = 5) in vec4 weights;
 
 layout(set = 0, binding = 0) uniform sceneMatrix
@@ -20,29 +25,52 @@ layout(set = 2, binding = 2) uniform boneMatricesInfo
 	mat4 boneMatrices[MAX_BONES];
 };
 
+layout(push_constant) uniform meshInfo
+{
+	// Dequantisation of the mesh's positions
+	vec4 positionOffset;
+	vec4 positionScale;
+	uint materialIndex;
+};
+
 layout(location = 0) out vec4 oPosition;
 layout(location = 1) out vec4 oNormal;
 layout(location = 2) out vec4 oTangent;
 layout(location = 3) out vec4 oBitangent;
 layout(location = 4) out vec2 oTexCoord;
+layout(location = 5) flat out uint oMaterialIndex;
+layout(location = 6) flat out uint oLodTint;
+
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
 
 void main()
 {
+	vec3 meshPosition = positionOffset.xyz + positionScale.xyz * position;
+	vec3 meshNormal = COMPRESSED_VERTICES ? decodeOctahedral(normal.xy) : normal;
+	vec3 meshTangent = COMPRESSED_VERTICES ? decodeOctahedral(tangent.xy) : tangent.xyz;
+
 	vec4 finalPosition = vec4(0);
 	vec4 finalNormal = vec4(0);
 	vec4 finalTangent = vec4(0);
 	vec4 finalBitangent = vec4(0);
 	for(int i = 0; i < MAX_BONE_INFLUENCE; i++)
 	{
-		if(boneIds[i] < 0)
+		// Unused influences have a weight of 0
+		if(weights[i] == 0.0)
 			continue;
 		if(boneIds[i] >= MAX_BONES)
 		{
-			finalPosition = vec4(position, 1);
+			finalPosition = vec4(meshPosition, 1);
 			break;
 		}
 
-		vec4 localPosition = boneMatrices[boneIds[i]] * vec4(position, 1);
+		vec4 localPosition = boneMatrices[boneIds[i]] * vec4(meshPosition, 1);
 
 		// A optimised way to calculate a transformed normal without using inverse transpose
 		// Reference: https://lxjk.github.io/2017/10/01/Stop-Using-Normal-Matrix.html
@@ -52,9 +80,10 @@ void main()
 		float scaleZ = length(upperMatrix[2]);
 		vec3 scale = vec3(scaleX, scaleY, scaleZ);
 
-		vec4 localNormal = normalize(vec4(upperMatrix * (normal / scale), 0));
-		vec4 localTangent = normalize(boneMatrices[boneIds[i]] * vec4(tangent, 1));
-		vec4 localBitangent = normalize(vec4(cross(localTangent.rgb, localNormal.rgb), 0));
+		vec4 localNormal = normalize(vec4(upperMatrix * (meshNormal / scale), 0));
+		vec4 localTangent = normalize(boneMatrices[boneIds[i]] * vec4(meshTangent, 0));
+		// Flipped where the uvs are mirrored
+		vec4 localBitangent = normalize(vec4(cross(localTangent.rgb, localNormal.rgb) * tangent.w, 0));
 
 		finalPosition += localPosition * weights[i];
 		finalNormal += localNormal * weights[i];
@@ -67,6 +96,9 @@ void main()
 	oTangent = normalize(finalTangent);
 	oBitangent = normalize(finalBitangent);
 	oTexCoord = texCoord;
+	oMaterialIndex = materialIndex;
+	// Skinned meshes always draw their full mesh and are not tinted
+	oLodTint = 0;
 
 	gl_Position = projectMatrix * cameraMatrix * finalPosition;
 }
\ No newline at end of file
@@ -0,0 +1,42 @@
+#version 450 core
+
+// Only the positions are fetched, quantised inside the mesh's bounding box if the vertices are compressed
+layout(location = 0) in vec3 position;
+
+struct ObjectData
+{
+	mat4 transformation;
+	vec4 boundingSphere;
+	uint flags;
+	uint materialIndex;
+	uint padding0;
+	uint padding1;
+	// Dequantisation of the mesh's positions
+	vec4 positionOffset;
+	vec4 positionScale;
+};
+
+layout(set = 0, binding = 0) uniform sceneMatrix
+{
+	mat4 cameraMatrix;
+	mat4 projectMatrix;
+};
+
+layout(set = 1, binding = 0) readonly buffer Objects
+{
+	ObjectData objects[];
+};
+
+// Written by the culling shader, the instance index of the indirect draw points into it
+layout(set = 1, binding = 3) readonly buffer VisibleObjects
+{
+	uint visibleObjects[];
+};
+
+void main()
+{
+	ObjectData object = objects[visibleObjects[gl_InstanceIndex]];
+	vec3 meshPosition = object.positionOffset.xyz + object.positionScale.xyz * position;
+
+	gl_Position = projectMatrix * cameraMatrix * object.transformation * vec4(meshPosition, 1);
+}
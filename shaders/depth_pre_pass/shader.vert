@@ -1,9 +1,21 @@
 #version 450 core
 
+// Only the positions are fetched, quantised inside the mesh's bounding box if the vertices are compressed
 layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 normal;
-layout(location = 2) in vec3 tangent;
-layout(location = 3) in vec2 texCoord;
+
+struct ObjectData
+{
+	mat4 transformation;
+	// World transformation of the previous frame
+	mat4 previousTransformation;
+	uint materialIndex;
+	uint flags;
+	uint padding0;
+	uint padding1;
+	// Dequantisation of the mesh's positions
+	vec4 positionOffset;
+	vec4 positionScale;
+};
 
 layout(set = 0, binding = 0) uniform sceneMatrix
 {
@@ -11,12 +23,16 @@ layout(set = 0, binding = 0) uniform sceneMatrix
 	mat4 projectMatrix;
 };
 
-layout(push_constant) uniform modelMatrices
+// Object data of the instanced draws, the instance index starts at the draw's first object
+layout(set = 1, binding = 0) readonly buffer Objects
 {
-	mat4 modelTransformation;
+	ObjectData objects[];
 };
 
 void main()
 {
-	gl_Position = projectMatrix * cameraMatrix * modelTransformation * vec4(position, 1);
+	ObjectData object = objects[gl_InstanceIndex];
+	vec3 meshPosition = object.positionOffset.xyz + object.positionScale.xyz * position;
+
+	gl_Position = projectMatrix * cameraMatrix * object.transformation * vec4(meshPosition, 1);
 }
\ No newline at end of file
@@ -1,27 +1,68 @@
 #version 450 core
 #extension GL_KHR_vulkan_glsl : enable
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec4 position;
 layout(location = 1) in vec4 normal;
 layout(location = 2) in vec4 tangent;
 layout(location = 3) in vec4 bitangent;
 layout(location = 4) in vec2 texCoord;
+layout(location = 5) flat in uint materialIndex;
+// Level of detail plus one if the meshes are tinted by their level, 0 otherwise
+layout(location = 6) flat in uint lodTint;
 
-// BRDF: 0. Emissive, 1. Albedo (Diffuse), 2. Metallic, 3. Roughness
-// Others: 4. Normal Map
-layout(set = 1, binding = 1) uniform sampler2D texColor[5];
+struct MaterialData
+{
+	// Element of every texture in the texture array
+	// BRDF: 0. Emissive, 1. Albedo (Diffuse), 2. Metallic, 3. Roughness
+	// Others: 4. Normal Map
+	uint textures[5];
+	uint flags;
+	uint padding0;
+	uint padding1;
+};
+
+// Materials without it write no emission and skip sampling the emissive texture
+const uint MATERIAL_EMISSIVE = 1;
+
+// Debug tint of every level of detail, from the full mesh to the coarsest level
+const vec3 LOD_COLORS[4] = vec3[](vec3(0.1, 0.8, 0.1), vec3(0.1, 0.4, 0.9), vec3(0.9, 0.8, 0.1), vec3(0.9, 0.1, 0.1));
+
+// Indexed by material id
+layout(set = 1, binding = 0) readonly buffer Materials
+{
+	MaterialData materials[];
+};
+
+// Every texture of every material, the instances of a draw can have different materials
+layout(set = 1, binding = 1) uniform sampler2D textures[];
 
+// 0: albedo and metallic, 1: octahedral encoded normal, 2: emissive and roughness
+// The position is reconstructed from the depth buffer by the shading pass
 layout(location = 0) out vec4 GBuffer0;
-layout(location = 1) out vec4 GBuffer1;
+layout(location = 1) out vec2 GBuffer1;
 layout(location = 2) out vec4 GBuffer2;
-layout(location = 3) out vec4 GBuffer3;
+
+// Octahedral normal encoding, folds the lower hemisphere over the upper one
+// Reference: Cigolle et al. 2014, A Survey of Efficient Representations for Independent Unit Vectors
+vec2 encodeNormal(vec3 normal)
+{
+	normal /= abs(normal.x) + abs(normal.y) + abs(normal.z);
+
+	if(normal.z >= 0)
+		return normal.xy;
+
+	vec2 signs = vec2(normal.x >= 0 ? 1.0 : -1.0, normal.y >= 0 ? 1.0 : -1.0);
+
+	return (1.0 - abs(normal.yx)) * signs;
+}
 
 void main()
 {
-	vec4 oPosition = position;
+	MaterialData material = materials[materialIndex];
 
 	vec3 oNormal = normalize(normal.rgb);
-	vec3 tNormal = vec3(texture(texColor[4], texCoord));
+	vec3 tNormal = vec3(texture(textures[nonuniformEXT(material.textures[4])], texCoord));
 	// The B channel of a normal map must always be in between 128 and 255. Any value below 128 is an unvalid normal map
 	if(tNormal.b * 255 >= 128 && tNormal.b * 255 <= 255)
 	{
@@ -41,20 +82,23 @@ void main()
 	}
 	
 
-	float lod = textureQueryLod(texColor[0], texCoord).x;
-	vec4 tEmissive = texture(texColor[0], texCoord);
+	vec4 tEmissive = vec4(0);
+	if((material.flags & MATERIAL_EMISSIVE) != 0)
+		tEmissive = texture(textures[nonuniformEXT(material.textures[0])], texCoord);
 
-	lod = textureQueryLod(texColor[1], texCoord).x;
-	vec4 tAlbedo = texture(texColor[1], texCoord);
+	float lod = textureQueryLod(textures[nonuniformEXT(material.textures[1])], texCoord).x;
+	vec4 tAlbedo = texture(textures[nonuniformEXT(material.textures[1])], texCoord);
 
 	lod = 30;
-	float tMetallic = texture(texColor[2], texCoord).r;
+	float tMetallic = texture(textures[nonuniformEXT(material.textures[2])], texCoord).r;
 
 	lod = 30;
-	float tRoughness = texture(texColor[3], texCoord).r;
+	float tRoughness = texture(textures[nonuniformEXT(material.textures[3])], texCoord).r;
+
+	if(lodTint != 0)
+		tAlbedo.rgb = mix(tAlbedo.rgb, LOD_COLORS[min(lodTint - 1, 3u)], 0.7);
 
-	GBuffer0 = vec4(vec3(oPosition), tMetallic);
-	GBuffer1 = vec4(vec3(oNormal), tRoughness);
-	GBuffer2 = vec4(vec3(tEmissive), 1);
-	GBuffer3 = vec4(vec3(tAlbedo), 1);
+	GBuffer0 = vec4(vec3(tAlbedo), tMetallic);
+	GBuffer1 = encodeNormal(oNormal);
+	GBuffer2 = vec4(vec3(tEmissive), tRoughness);
 }
\ No newline at end of file
@@ -1,19 +1,40 @@
 #version 450 core
 
+// Normal and tangent are octahedral encoded if the vertices are compressed
+layout(constant_id = 0) const bool COMPRESSED_VERTICES = false;
+
+// Quantised inside the mesh's bounding box if the vertices are compressed
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
-layout(location = 2) in vec3 tangent;
+// w: sign of the bitangent
+layout(location = 2) in vec4 tangent;
 layout(location = 3) in vec2 texCoord;
 
+struct ObjectData
+{
+	mat4 transformation;
+	// World transformation of the previous frame
+	mat4 previousTransformation;
+	uint materialIndex;
+	uint flags;
+	// Level of detail plus one if the meshes are tinted by their level, 0 otherwise
+	uint lodTint;
+	uint padding;
+	// Dequantisation of the mesh's positions
+	vec4 positionOffset;
+	vec4 positionScale;
+};
+
 layout(set = 0, binding = 0) uniform sceneMatrix
 {
 	mat4 cameraMatrix;
 	mat4 projectMatrix;
 };
 
-layout(push_constant) uniform modelMatrix
+// Object data of the instanced draws, the instance index starts at the draw's first object
+layout(set = 2, binding = 0) readonly buffer Objects
 {
-	mat4 modelTransformation;
+	ObjectData objects[];
 };
 
 layout(location = 0) out vec4 oPosition;
@@ -21,10 +42,27 @@ layout(location = 1) out vec4 oNormal;
 layout(location = 2) out vec4 oTangent;
 layout(location = 3) out vec4 oBitangent;
 layout(location = 4) out vec2 oTexCoord;
+layout(location = 5) flat out uint oMaterialIndex;
+layout(location = 6) flat out uint oLodTint;
+
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
 
 void main()
 {
-	oPosition = modelTransformation * vec4(position, 1);
+	ObjectData object = objects[gl_InstanceIndex];
+	mat4 modelTransformation = object.transformation;
+
+	vec3 meshPosition = object.positionOffset.xyz + object.positionScale.xyz * position;
+	vec3 meshNormal = COMPRESSED_VERTICES ? decodeOctahedral(normal.xy) : normal;
+	vec3 meshTangent = COMPRESSED_VERTICES ? decodeOctahedral(tangent.xy) : tangent.xyz;
+
+	oPosition = modelTransformation * vec4(meshPosition, 1);
 
 	// A optimised way to calculate a transformed normal without using inverse transpose
 	// Reference: https://lxjk.github.io/2017/10/01/Stop-Using-Normal-Matrix.html
@@ -34,10 +72,13 @@ void main()
 	float scaleZ = length(upperMatrix[2]);
 	vec3 scale = vec3(scaleX, scaleY, scaleZ);
 
-	oNormal = normalize(vec4(upperMatrix * (normal / scale), 0));
-	oTangent = normalize(modelTransformation * vec4(tangent, 1));
-	oBitangent = normalize(vec4(cross(oTangent.rgb, oNormal.rgb), 0));
+	oNormal = normalize(vec4(upperMatrix * (meshNormal / scale), 0));
+	oTangent = normalize(modelTransformation * vec4(meshTangent, 0));
+	// Flipped where the uvs are mirrored
+	oBitangent = normalize(vec4(cross(oTangent.rgb, oNormal.rgb) * tangent.w, 0));
 	oTexCoord = texCoord;
+	oMaterialIndex = object.materialIndex;
+	oLodTint = object.lodTint;
 
-	gl_Position = projectMatrix * cameraMatrix * modelTransformation * vec4(position, 1);
+	gl_Position = projectMatrix * cameraMatrix * oPosition;
 }
\ No newline at end of file
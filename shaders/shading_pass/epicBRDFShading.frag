@@ -14,14 +14,37 @@ layout(set = 0, binding = 1) uniform light
 layout(set = 1, binding = 1) uniform camera
 {
 	vec4 cameraPosition;
+	mat4 inverseViewProjection;
 };
 
+// 0: albedo and metallic, 1: octahedral encoded normal, 2: emissive and roughness, 3: depth
 layout(set = 2, binding = 2) uniform sampler2D texColor[4];
 
 layout(set = 3, binding = 3) uniform samplerCube depthMap;
 
 layout (location = 0) out vec4 oColor;
 
+// Octahedral normal decoding, unfolds the lower hemisphere
+// Reference: Cigolle et al. 2014, A Survey of Efficient Representations for Independent Unit Vectors
+vec3 decodeNormal(vec2 encoded)
+{
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+
+	float t = max(-normal.z, 0);
+	normal.x += normal.x >= 0 ? -t : t;
+	normal.y += normal.y >= 0 ? -t : t;
+
+	return normalize(normal);
+}
+
+// World position of the pixel, the depth is in the [0, 1] range Vulkan writes
+vec3 reconstructPosition(vec2 uv, float depth)
+{
+	vec4 position = inverseViewProjection * vec4(uv * 2.0 - 1.0, depth, 1);
+
+	return position.xyz / position.w;
+}
+
 // Taking inspiration from GPU Gems: Shadow Map Antialiasing
 vec4 offset_lookup(vec3 texCoord, vec3 offset, float texmapscale)
 {
@@ -121,12 +144,16 @@ vec4 brdfCookTorrance(float D, float G, vec4 F, float NdotL, float NdotV)
 
 void main()
 {
-	const vec3 position = vec3(vec4(texture(texColor[0], texCoord).rgb, 1));
-	const vec3 normal = vec3(vec4(normalize(texture(texColor[1], texCoord)).rgb, 1));
-	const vec4 emissive = texture(texColor[2], texCoord);
-	const vec4 albedo = texture(texColor[3], texCoord);
-	const float metallic = texture(texColor[0], texCoord).a;
-	const float roughness = texture(texColor[1], texCoord).a;
+	const vec4 gBuffer0 = texture(texColor[0], texCoord);
+	const vec4 gBuffer2 = texture(texColor[2], texCoord);
+	const float depth = texelFetch(texColor[3], ivec2(gl_FragCoord.xy), 0).r;
+
+	const vec3 position = reconstructPosition(texCoord, depth);
+	const vec3 normal = decodeNormal(texture(texColor[1], texCoord).rg);
+	const vec4 emissive = vec4(gBuffer2.rgb, 1);
+	const vec4 albedo = vec4(gBuffer0.rgb, 1);
+	const float metallic = gBuffer0.a;
+	const float roughness = gBuffer2.a;
 
 	// Values we are going to use later
 	const vec3 lightDirection = normalize(vec3(lightPosition) - position);
@@ -31,4 +31,30 @@ AnimationNode::AnimationNode(std::string name, std::vector<KeyData> position, st
 AnimationNode::~AnimationNode()
 {
 
+}
+
+template<typename T>
+static u32 findKeyIndex(const std::vector<T>& keys, f64 tick)
+{
+	auto it = std::upper_bound(keys.begin(), keys.end(), tick, [](f64 value, const T& key) { return value < key.time; });
+
+	if (it == keys.end())
+		return static_cast<u32>(keys.size()) - 1;
+
+	return static_cast<u32>(it - keys.begin());
+}
+
+u32 AnimationNode::findPositionIndex(f64 tick) const
+{
+	return findKeyIndex(positions, tick);
+}
+
+u32 AnimationNode::findRotationIndex(f64 tick) const
+{
+	return findKeyIndex(rotations, tick);
+}
+
+u32 AnimationNode::findScaleIndex(f64 tick) const
+{
+	return findKeyIndex(scales, tick);
 }
\ No newline at end of file
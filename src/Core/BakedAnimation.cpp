@@ -0,0 +1,222 @@
+#include "pch.h"
+#include "Core/BakedAnimation.h"
+
+BakedAnimation::BakedAnimation(const Skeleton* skeleton, f32 frameRate) :
+	skeletonId(skeleton->id),
+	numBones(skeleton->getNumBones()),
+	frameRate(frameRate),
+	clips(),
+	boneMatrices(),
+	meshIndicies(),
+	materialIndicies(),
+	instances(),
+	boneMatrixBuffer({ VK_NULL_HANDLE, VK_NULL_HANDLE }),
+	instanceBuffers(),
+	boneMatrixDescriptorSet(VK_NULL_HANDLE),
+	instancesChanged(),
+	readyToDraw(false)
+{
+
+}
+
+BakedAnimation::~BakedAnimation()
+{
+
+}
+
+u32 BakedAnimation::addClip(const Skeleton* skeleton, const Animation* animation)
+{
+	BakedAnimationClip clip{};
+	clip.animationId = animation->id;
+	clip.firstMatrix = static_cast<u32>(boneMatrices.size());
+	clip.duration = static_cast<f32>(animation->getDuration());
+
+	std::vector<mat4> bakedMatrices = bake(skeleton, animation, frameRate, clip.numFrames);
+	boneMatrices.insert(boneMatrices.end(), bakedMatrices.begin(), bakedMatrices.end());
+
+	clips.push_back(clip);
+
+	return static_cast<u32>(clips.size()) - 1;
+}
+
+void BakedAnimation::addMesh(u32 meshId, u32 materialId)
+{
+	meshIndicies.push_back(meshId);
+	materialIndicies.push_back(materialId);
+}
+
+void BakedAnimation::addInstance(const mat4& modelTransform, u32 clipIndex, f32 timeOffset)
+{
+	if (instances.size() >= MAX_INSTANCES)
+		return;
+
+	const BakedAnimationClip& clip = clips.at(clipIndex);
+
+	BakedAnimationInstance instance{};
+	instance.modelTransform = modelTransform;
+	instance.firstMatrix = clip.firstMatrix;
+	instance.numFrames = clip.numFrames;
+	instance.frameRate = frameRate;
+	instance.timeOffset = timeOffset;
+
+	instances.push_back(instance);
+
+	std::fill(instancesChanged.begin(), instancesChanged.end(), true);
+}
+
+void BakedAnimation::clearInstances()
+{
+	instances.clear();
+
+	std::fill(instancesChanged.begin(), instancesChanged.end(), true);
+}
+
+void BakedAnimation::uploadDataToPhysicalDevice(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkSurfaceKHR& surface,
+	VkQueue& queue, VkDescriptorPool& descriptorPool, VkDescriptorSetLayout& descriptorSetLayout, u32 numFramesInFlight)
+{
+	const u64 bakedSize = getBakedSize();
+
+	// Buffer that is going to send to the GPU
+	boneMatrixBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, bakedSize,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+	instanceBuffers.resize(numFramesInFlight);
+	for (VulkanAllocatedMemory& instanceBuffer : instanceBuffers)
+	{
+		instanceBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(BakedAnimationInstance) * MAX_INSTANCES,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	}
+
+	// Staging buffer
+	VulkanAllocatedMemory stagingBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, bakedSize,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	void* bakedPtr = nullptr;
+	if (vmaMapMemory(vmaAllocator, stagingBuffer.allocation, &bakedPtr) != VK_SUCCESS)
+		throw std::runtime_error("Failed to map memory");
+	std::memcpy(bakedPtr, boneMatrices.data(), bakedSize);
+	vmaUnmapMemory(vmaAllocator, stagingBuffer.allocation);
+
+	VkFence uploadComplete = WillEngine::VulkanUtil::createFence(logicalDevice, false);
+
+	VkCommandPool commandPool = WillEngine::VulkanUtil::createCommandPool(logicalDevice, physicalDevice, surface);
+	VkCommandBuffer commandBuffer = WillEngine::VulkanUtil::createCommandBuffer(logicalDevice, commandPool);
+
+	VkCommandBufferBeginInfo commandInfo{};
+	commandInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	commandInfo.flags = 0;
+
+	if (vkBeginCommandBuffer(commandBuffer, &commandInfo) != VK_SUCCESS)
+		throw std::runtime_error("Failed to begin command buffer");
+
+	// Copy buffer from staging to the actual one
+	VkBufferCopy bakedCopy{};
+	bakedCopy.size = bakedSize;
+	vkCmdCopyBuffer(commandBuffer, stagingBuffer.buffer, boneMatrixBuffer.buffer, 1, &bakedCopy);
+
+	WillEngine::VulkanUtil::bufferBarrier(commandBuffer, boneMatrixBuffer.buffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_WHOLE_SIZE, 0, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
+
+	// End Command buffer
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("Failed to end command buffer");
+
+	// Submit the recorded commands
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	if (vkQueueSubmit(queue, 1, &submitInfo, uploadComplete) != VK_SUCCESS)
+		throw std::runtime_error("Failed to submit commands");
+
+	if (vkWaitForFences(logicalDevice, 1, &uploadComplete, VK_TRUE, std::numeric_limits<u64>::max()) != VK_SUCCESS)
+		throw std::runtime_error("Failed to wait for fence");
+
+	// Clean up staging buffer
+	vmaDestroyBuffer(vmaAllocator, stagingBuffer.buffer, stagingBuffer.allocation);
+
+	// Clean up command pool, command buffer, and fence
+	vkDestroyFence(logicalDevice, uploadComplete, nullptr);
+	vkFreeCommandBuffers(logicalDevice, commandPool, 1, &commandBuffer);
+	vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+
+	// Descriptor set for the baked bone matrices
+	WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, descriptorPool, descriptorSetLayout, boneMatrixDescriptorSet);
+	WillEngine::VulkanUtil::writeDescriptorSetBuffer(logicalDevice, boneMatrixDescriptorSet, boneMatrixBuffer.buffer, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+
+	// The baked matrices only live on the GPU from now on
+	boneMatrices.clear();
+	boneMatrices.shrink_to_fit();
+
+	instancesChanged.assign(numFramesInFlight, true);
+	readyToDraw = true;
+}
+
+void BakedAnimation::updateInstanceBuffer(VkCommandBuffer& commandBuffer, u32 frameIndex)
+{
+	if (!readyToDraw || !instancesChanged[frameIndex])
+		return;
+
+	// vkCmdUpdateBuffer is limited to 65536 bytes per call
+	const u64 maxUpdateSize = 65536;
+	const u64 instanceDataSize = sizeof(BakedAnimationInstance) * instances.size();
+	const u8* instanceData = reinterpret_cast<const u8*>(instances.data());
+
+	for (u64 offset = 0; offset < instanceDataSize; offset += maxUpdateSize)
+	{
+		const u64 updateSize = std::min(maxUpdateSize, instanceDataSize - offset);
+
+		vkCmdUpdateBuffer(commandBuffer, instanceBuffers[frameIndex].buffer, offset, updateSize, instanceData + offset);
+	}
+
+	instancesChanged[frameIndex] = false;
+}
+
+void BakedAnimation::getPlaybackFrame(f64 time, u32& frame, f32& frameFraction) const
+{
+	const f64 frames = time * frameRate;
+	const f64 wholeFrames = std::floor(frames);
+
+	// The shader adds the instance's offset and wraps the frame into its clip
+	frame = static_cast<u32>(std::fmod(wholeFrames, 4294967296.0));
+	frameFraction = static_cast<f32>(frames - wholeFrames);
+}
+
+void BakedAnimation::cleanup(VkDevice& logicalDevice, VmaAllocator& vmaAllocator, VkDescriptorPool& descriptorPool)
+{
+	if (!readyToDraw)
+		return;
+
+	vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &boneMatrixDescriptorSet);
+
+	vmaDestroyBuffer(vmaAllocator, boneMatrixBuffer.buffer, boneMatrixBuffer.allocation);
+	for (VulkanAllocatedMemory& instanceBuffer : instanceBuffers)
+	{
+		vmaDestroyBuffer(vmaAllocator, instanceBuffer.buffer, instanceBuffer.allocation);
+	}
+
+	readyToDraw = false;
+}
+
+std::vector<mat4> BakedAnimation::bake(const Skeleton* skeleton, const Animation* animation, f32 frameRate, u32& numFrames)
+{
+	const u32 numBones = skeleton->getNumBones();
+
+	// Always bake at least one frame
+	numFrames = std::max(1u, static_cast<u32>(std::ceil(animation->getDuration() * frameRate)));
+
+	std::vector<mat4> matrices(static_cast<u64>(numFrames) * numBones, mat4(1));
+
+	if (numBones == 0)
+		return matrices;
+
+	for (u32 frame = 0; frame < numFrames; frame++)
+	{
+		const f64 time = static_cast<f64>(frame) / frameRate;
+
+		skeleton->evaluateBonePalette(animation, time, &matrices[static_cast<u64>(frame) * numBones]);
+	}
+
+	return matrices;
+}
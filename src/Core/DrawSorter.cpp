@@ -0,0 +1,140 @@
+#include "pch.h"
+#include "Core/DrawSorter.h"
+
+#include <barrier>
+#include <numeric>
+
+DrawSorter::DrawSorter() :
+	keys(),
+	scratchKeys(),
+	order(),
+	scratchOrder(),
+	histograms()
+{
+
+}
+
+DrawSorter::~DrawSorter()
+{
+
+}
+
+void DrawSorter::sort(const std::vector<u64>& sortKeys, u32 maxThreads)
+{
+	const u32 numKeys = static_cast<u32>(sortKeys.size());
+
+	// The capacity is kept between frames
+	keys.assign(sortKeys.begin(), sortKeys.end());
+	scratchKeys.resize(numKeys);
+	order.resize(numKeys);
+	scratchOrder.resize(numKeys);
+	std::iota(order.begin(), order.end(), 0);
+
+	if (numKeys < 2)
+		return;
+
+	// Bytes every key has in common can't change the order, so they are not sorted
+	u64 differentBits = 0;
+	for (u64 key : keys)
+	{
+		differentBits |= key ^ keys[0];
+	}
+
+	std::vector<u32> shifts;
+	for (u32 shift = 0; shift < 64; shift += 8)
+	{
+		if ((differentBits >> shift) & (RADIX - 1))
+			shifts.push_back(shift);
+	}
+
+	if (shifts.empty())
+		return;
+
+	// Only use as many threads as there is enough work for
+	const u32 numThreads = std::clamp((numKeys + MIN_KEYS_PER_THREAD - 1) / MIN_KEYS_PER_THREAD, 1u, std::max(maxThreads, 1u));
+
+	histograms.assign(numThreads * RADIX, 0);
+
+	// Run by one thread once every thread has reached the barrier
+	// After counting, the counts become offsets: the keys are ordered by digit, then by thread, so every thread keeps its keys in order
+	// After scattering, the written buffers become the ones read by the next pass
+	bool counted = false;
+	auto completion = [&]() noexcept
+		{
+			counted = !counted;
+
+			if (!counted)
+			{
+				std::swap(keys, scratchKeys);
+				std::swap(order, scratchOrder);
+
+				return;
+			}
+
+			u32 offset = 0;
+			for (u32 digit = 0; digit < RADIX; digit++)
+			{
+				for (u32 thread = 0; thread < numThreads; thread++)
+				{
+					const u32 count = histograms[thread * RADIX + digit];
+					histograms[thread * RADIX + digit] = offset;
+					offset += count;
+				}
+			}
+		};
+
+	std::barrier sync(numThreads, completion);
+
+	auto sortChunk = [&](u32 thread)
+		{
+			const u32 begin = static_cast<u32>(static_cast<u64>(numKeys) * thread / numThreads);
+			const u32 end = static_cast<u32>(static_cast<u64>(numKeys) * (thread + 1) / numThreads);
+			u32* histogram = &histograms[thread * RADIX];
+
+			for (u32 shift : shifts)
+			{
+				countDigits(histogram, shift, begin, end);
+				sync.arrive_and_wait();
+
+				scatterDigits(histogram, shift, begin, end);
+				sync.arrive_and_wait();
+			}
+		};
+
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads - 1);
+
+	for (u32 i = 1; i < numThreads; i++)
+	{
+		threads.emplace_back(sortChunk, i);
+	}
+
+	// The calling thread sorts the first chunk
+	sortChunk(0);
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+void DrawSorter::countDigits(u32* histogram, u32 shift, u32 begin, u32 end)
+{
+	std::fill(histogram, histogram + RADIX, 0);
+
+	for (u32 i = begin; i < end; i++)
+	{
+		histogram[(keys[i] >> shift) & (RADIX - 1)]++;
+	}
+}
+
+void DrawSorter::scatterDigits(u32* histogram, u32 shift, u32 begin, u32 end)
+{
+	for (u32 i = begin; i < end; i++)
+	{
+		const u32 destination = histogram[(keys[i] >> shift) & (RADIX - 1)]++;
+
+		scratchKeys[destination] = keys[i];
+		scratchOrder[destination] = order[i];
+	}
+}
\ No newline at end of file
@@ -8,7 +8,8 @@ TransformComponent::TransformComponent():
 	position(0),
 	rotation(0),
 	scale(1),
-	worldTransformation(1)
+	worldTransformation(1),
+	worldVersion(0)
 {
 	
 }
@@ -18,7 +19,8 @@ TransformComponent::TransformComponent(const vec3 position, const vec3 rotation,
 	position(position),
 	rotation(rotation),
 	scale(scale),
-	worldTransformation(1)
+	worldTransformation(1),
+	worldVersion(0)
 {
 	
 }
@@ -27,7 +29,8 @@ TransformComponent::TransformComponent(Entity* entity) :
 	Component(entity),
 	position(0),
 	rotation(0),
-	scale(1)
+	scale(1),
+	worldVersion(0)
 {
 	worldTransformation = getGlobalTransformation();
 }
@@ -36,7 +39,8 @@ TransformComponent::TransformComponent(Entity* entity, const vec3 position, cons
 	Component(entity),
 	position(position),
 	rotation(rotation),
-	scale(scale)
+	scale(scale),
+	worldVersion(0)
 {
 	worldTransformation = getGlobalTransformation();
 }
@@ -136,20 +140,13 @@ void TransformComponent::updateAllChildWorldTransformation()
 	}
 }
 
-void TransformComponent::updateAllChildWorldTransformation(const Animation* animation, const AnimationComponent* animationComp, const std::unordered_map<std::string, bool>* necessityMap)
+void TransformComponent::updateAllChildWorldTransformation(const Animation* animation, const AnimationComponent* animationComp)
 {
-	// Don't update transformation if all of the following is met:
-	// 1. We have a necessity map included
-	// 2. It does not appear in the necessity map / The node appears in the necessity map but has not been visited before
-	// More details (Bone Section): https://assimp.sourceforge.net/lib_html/data.html
-	if (necessityMap && (!necessityMap->contains(parent->name) || necessityMap->at(parent->name) == false))
-		return;
-
 	updateWorldTransformation(animation, animationComp);
 
 	for (auto* child : getParent()->children)
 	{
 		TransformComponent* childTransform = child->GetComponent<TransformComponent>();
-		childTransform->updateAllChildWorldTransformation(animation, animationComp, necessityMap);
+		childTransform->updateAllChildWorldTransformation(animation, animationComp);
 	}
 }
\ No newline at end of file
@@ -7,7 +7,88 @@ void WillEngine::EngineGui::DebuggingPanel::update(GameState* gameState, VulkanF
 
 	ImGui::Checkbox("Enable Bloom", &gameState->gameSettings.enableBloom);
 
-	if (ImGui::TreeNode("Bloom Viewer"))
+	ImGui::Checkbox("Bake Animations On Load", &gameState->gameSettings.bakeAnimations);
+
+	ImGui::Checkbox("Enable Pose Cache", &gameState->gameSettings.enablePoseCache);
+
+	ImGui::Checkbox("View Render Targets", &gameState->gameSettings.viewRenderTargets);
+
+	ImGui::Checkbox("GPU Driven Rendering", &gameState->gameSettings.gpuDrivenRendering);
+
+	ImGui::Checkbox("Frustum Culling", &gameState->gameSettings.enableFrustumCulling);
+
+	ImGui::Checkbox("Occlusion Culling", &gameState->gameSettings.enableOcclusionCulling);
+
+	ImGui::Checkbox("Cluster Culling", &gameState->gameSettings.enableClusterCulling);
+
+	ImGui::Checkbox("Levels Of Detail", &gameState->gameSettings.enableLods);
+
+	if (ImGui::TreeNode("Pose Cache"))
+	{
+		const PoseCache& poseCache = gameState->poseCache;
+
+		ImGui::Text("Hits: %u Misses: %u", poseCache.hits, poseCache.misses);
+		ImGui::Text("Hit Rate: %.2f%%", poseCache.getHitRate() * 100.0f);
+		ImGui::Text("Total Hit Rate: %.2f%%", poseCache.getTotalHitRate() * 100.0f);
+
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Render Graph"))
+	{
+		ImGui::Text("Transient Memory: %.2f MB", gameState->graphicsState.renderGraphMemory / (1024.0f * 1024.0f));
+		ImGui::Text("Without Aliasing: %.2f MB", gameState->graphicsState.renderGraphUnaliasedMemory / (1024.0f * 1024.0f));
+		ImGui::Text("Culled Passes: %u", gameState->graphicsState.renderGraphCulledPasses);
+
+		ImGui::TreePop();
+	}
+
+	if (gameState->gameSettings.enableFrustumCulling && ImGui::TreeNode("Frustum Culling"))
+	{
+		ImGui::Text("Tested: %u Culled: %u", gameState->graphicsState.frustumTestedObjects, gameState->graphicsState.frustumCulledObjects);
+
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Draw Submission"))
+	{
+		ImGui::Text("Meshes: %u Draws: %u", gameState->graphicsState.instancedMeshes, gameState->graphicsState.instancedDraws);
+		ImGui::Text("Binds: %u Skipped: %u", gameState->graphicsState.recordedBinds, gameState->graphicsState.skippedBinds);
+
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Levels Of Detail"))
+	{
+		ImGui::SliderFloat("Shadow Bias", &gameState->gameSettings.shadowLodBias, 1.0f, 8.0f);
+		// -1 picks the level by its projected error
+		ImGui::SliderInt("Force Level", &gameState->gameSettings.forcedLod, -1, MAX_MESH_LODS - 1);
+		ImGui::Checkbox("Tint Levels", &gameState->gameSettings.showLodColors);
+
+		for (u32 i = 0; i < MAX_MESH_LODS; i++)
+			ImGui::Text("LOD%u Camera: %u Shadow: %u", i, gameState->graphicsState.cameraLodDraws[i], gameState->graphicsState.shadowLodDraws[i]);
+
+		ImGui::TreePop();
+	}
+
+	if (gameState->gameSettings.gpuDrivenRendering && ImGui::TreeNode("GPU Driven"))
+	{
+		ImGui::Text("Objects: %u", gameState->graphicsState.indirectObjects);
+		ImGui::Text("Indirect Draws: %u", gameState->graphicsState.indirectBatches);
+		ImGui::Text("Clusters: %u", gameState->graphicsState.indirectClusters);
+
+		if (gameState->gameSettings.enableOcclusionCulling)
+			ImGui::Text("Occluded: %u Visible Late: %u", gameState->graphicsState.occlusionCulledObjects, gameState->graphicsState.occlusionLateObjects);
+
+		if (gameState->gameSettings.enableClusterCulling)
+			ImGui::Text("Clusters Tested: %u Culled: %u", gameState->graphicsState.testedClusters, gameState->graphicsState.culledClusters);
+
+		ImGui::TreePop();
+	}
+
+	// The images are only kept alive for the viewers when viewing render targets
+	if (gameState->gameSettings.viewRenderTargets && gameState->graphicsState.bloomImagesAvailable && gameState->graphicsState.renderTargetsViewable
+		&& ImGui::TreeNode("Bloom Viewer"))
 	{
 		static i32 mipLevel = 0;
 		ImGui::SliderInt("Mip Level", &mipLevel, 0, gameState->graphicsState.upSampledImageDescriptorSetOutput.size() - 1);
@@ -26,19 +107,14 @@ void WillEngine::EngineGui::DebuggingPanel::update(GameState* gameState, VulkanF
 		ImGui::TreePop();
 	}
 
-	if (ImGui::TreeNode("GBuffer Viewer"))
+	if (gameState->gameSettings.viewRenderTargets && gameState->graphicsState.renderTargetsViewable && ImGui::TreeNode("GBuffer Viewer"))
 	{
-		ImGui::Text("GBuffer0");
-		ImGui::Image((ImTextureID)attachments.attachments[0].imguiTextureDescriptorSet, ImVec2(352, 240));
-
-		ImGui::Text("GBuffer1");
-		ImGui::Image((ImTextureID)attachments.attachments[1].imguiTextureDescriptorSet, ImVec2(352, 240));
-
-		ImGui::Text("GBuffer2");
-		ImGui::Image((ImTextureID)attachments.attachments[2].imguiTextureDescriptorSet, ImVec2(352, 240));
-
-		ImGui::Text("GBuffer3");
-		ImGui::Image((ImTextureID)attachments.attachments[3].imguiTextureDescriptorSet, ImVec2(352, 240));
+		// 0: albedo and metallic, 1: octahedral encoded normal, 2: emissive and roughness
+		for (u32 i = 0; i < VulkanFramebuffer::ATTACHMENT_SIZE; i++)
+		{
+			ImGui::Text("GBuffer%u", i);
+			ImGui::Image((ImTextureID)attachments.attachments[i].imguiTextureDescriptorSet, ImVec2(352, 240));
+		}
 
 		ImGui::TreePop();
 	}
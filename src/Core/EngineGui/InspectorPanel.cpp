@@ -83,6 +83,49 @@ void WillEngine::EngineGui::InspectorPanel::update(GameState* gameState)
 			{
 				ImGui::Text("Hello I have Skeleton");
 
+				// Crowd of instances sampling the baked animation of this skeleton
+				auto bakedIt = gameState->gameResources.bakedAnimations.find(skeletalComp->skeletalId);
+				if (bakedIt != gameState->gameResources.bakedAnimations.end())
+				{
+					BakedAnimation* bakedAnimation = bakedIt->second;
+
+					ImGui::NewLine();
+
+					ImGui::Text("Baked clips: %u", static_cast<u32>(bakedAnimation->clips.size()));
+					ImGui::Text("Crowd instances: %u", bakedAnimation->getNumInstances());
+
+					static i32 crowdWidth = 10;
+					static f32 crowdSpacing = 2.0f;
+					ImGui::SliderInt("Crowd Width", &crowdWidth, 1, 64);
+					ImGui::DragFloat("Crowd Spacing", &crowdSpacing, 0.1f, 0, 100);
+
+					if (ImGui::Button("Spawn Crowd"))
+					{
+						bakedAnimation->clearInstances();
+
+						for (i32 x = 0; x < crowdWidth; x++)
+						{
+							for (i32 z = 0; z < crowdWidth; z++)
+							{
+								u32 index = static_cast<u32>(x * crowdWidth + z);
+
+								// Stagger clips and playback so the crowd does not move in lockstep
+								u32 clipIndex = index % bakedAnimation->clips.size();
+								f32 timeOffset = bakedAnimation->clips[clipIndex].duration * (index % 7) / 7.0f;
+
+								mat4 modelTransform = glm::translate(mat4(1), vec3(x * crowdSpacing, 0, z * crowdSpacing));
+
+								bakedAnimation->addInstance(modelTransform, clipIndex, timeOffset);
+							}
+						}
+					}
+
+					ImGui::SameLine();
+
+					if (ImGui::Button("Clear Crowd"))
+						bakedAnimation->clearInstances();
+				}
+
 				ImGui::TreePop();
 			}
 		}
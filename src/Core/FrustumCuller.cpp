@@ -0,0 +1,188 @@
+#include "pch.h"
+#include "Core/FrustumCuller.h"
+
+#include <immintrin.h>
+
+#ifdef __AVX__
+static const u32 SIMD_WIDTH = 8;
+#else
+static const u32 SIMD_WIDTH = 4;
+#endif
+
+FrustumCuller::FrustumCuller() :
+	numTested(0),
+	numCulled(0),
+	centreX(),
+	centreY(),
+	centreZ(),
+	radius(),
+	visibility(),
+	numObjects(0)
+{
+
+}
+
+FrustumCuller::~FrustumCuller()
+{
+
+}
+
+void FrustumCuller::clear()
+{
+	// The capacity is kept between frames
+	centreX.clear();
+	centreY.clear();
+	centreZ.clear();
+	radius.clear();
+
+	numObjects = 0;
+}
+
+u32 FrustumCuller::addObject(const vec4& worldBoundingSphere)
+{
+	centreX.push_back(worldBoundingSphere.x);
+	centreY.push_back(worldBoundingSphere.y);
+	centreZ.push_back(worldBoundingSphere.z);
+	radius.push_back(worldBoundingSphere.w);
+
+	return numObjects++;
+}
+
+void FrustumCuller::cull(const mat4& viewProjection, u32 maxThreads)
+{
+	// Pad the arrays so the last chunk can be loaded as a whole, padded objects are never read back
+	const u32 paddedSize = (numObjects + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+	centreX.resize(paddedSize, 0.0f);
+	centreY.resize(paddedSize, 0.0f);
+	centreZ.resize(paddedSize, 0.0f);
+	radius.resize(paddedSize, 0.0f);
+	visibility.resize(paddedSize);
+
+	numTested = numObjects;
+	numCulled = 0;
+
+	if (numObjects == 0)
+		return;
+
+	vec4 planes[6];
+	getFrustumPlanes(viewProjection, planes);
+
+	// Only use as many threads as there is enough work for
+	const u32 numChunks = paddedSize / SIMD_WIDTH;
+	const u32 numThreads = std::clamp((numObjects + MIN_OBJECTS_PER_THREAD - 1) / MIN_OBJECTS_PER_THREAD, 1u, std::max(maxThreads, 1u));
+
+	// Every thread tests a range of whole SIMD chunks
+	auto getRange = [&](u32 thread, u32& begin, u32& end)
+		{
+			begin = numChunks * thread / numThreads * SIMD_WIDTH;
+			end = numChunks * (thread + 1) / numThreads * SIMD_WIDTH;
+		};
+
+	std::vector<u32> culled(numThreads, 0);
+
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads - 1);
+
+	for (u32 i = 1; i < numThreads; i++)
+	{
+		threads.emplace_back([&, i]()
+			{
+				u32 begin = 0;
+				u32 end = 0;
+				getRange(i, begin, end);
+				culled[i] = cullRange(planes, begin, end);
+			});
+	}
+
+	// The calling thread tests the first range
+	u32 begin = 0;
+	u32 end = 0;
+	getRange(0, begin, end);
+	culled[0] = cullRange(planes, begin, end);
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	for (u32 count : culled)
+	{
+		numCulled += count;
+	}
+}
+
+u32 FrustumCuller::cullRange(const vec4* planes, u32 begin, u32 end)
+{
+	u32 culled = 0;
+
+	for (u32 i = begin; i < end; i += SIMD_WIDTH)
+	{
+		// A sphere is outside if it is further than its radius behind any plane
+#ifdef __AVX__
+		const __m256 x = _mm256_loadu_ps(&centreX[i]);
+		const __m256 y = _mm256_loadu_ps(&centreY[i]);
+		const __m256 z = _mm256_loadu_ps(&centreZ[i]);
+		const __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&radius[i]));
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (u32 p = 0; p < 6; p++)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(planes[p].x)), _mm256_set1_ps(planes[p].w));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(y, _mm256_set1_ps(planes[p].y)));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(z, _mm256_set1_ps(planes[p].z)));
+
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GT_OQ));
+		}
+
+		const i32 mask = _mm256_movemask_ps(inside);
+#else
+		const __m128 x = _mm_loadu_ps(&centreX[i]);
+		const __m128 y = _mm_loadu_ps(&centreY[i]);
+		const __m128 z = _mm_loadu_ps(&centreZ[i]);
+		const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&radius[i]));
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (u32 p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(planes[p].x)), _mm_set1_ps(planes[p].w));
+			distance = _mm_add_ps(distance, _mm_mul_ps(y, _mm_set1_ps(planes[p].y)));
+			distance = _mm_add_ps(distance, _mm_mul_ps(z, _mm_set1_ps(planes[p].z)));
+
+			inside = _mm_and_ps(inside, _mm_cmpgt_ps(distance, negativeRadius));
+		}
+
+		const i32 mask = _mm_movemask_ps(inside);
+#endif
+
+		const u32 numLanes = std::min(SIMD_WIDTH, numObjects - std::min(numObjects, i));
+		for (u32 lane = 0; lane < SIMD_WIDTH; lane++)
+		{
+			const u8 visible = (mask >> lane) & 1;
+			visibility[i + lane] = visible;
+
+			if (lane < numLanes && !visible)
+				culled++;
+		}
+	}
+
+	return culled;
+}
+
+void FrustumCuller::getFrustumPlanes(const mat4& viewProjection, vec4* planes)
+{
+	// Rows of the matrix, glm is column major
+	const mat4 m = glm::transpose(viewProjection);
+
+	planes[0] = m[3] + m[0];
+	planes[1] = m[3] - m[0];
+	planes[2] = m[3] + m[1];
+	planes[3] = m[3] - m[1];
+	planes[4] = m[3] + m[2];
+	planes[5] = m[3] - m[2];
+
+	// Normalise so the distance to a plane can be compared against a radius
+	for (u32 i = 0; i < 6; i++)
+	{
+		planes[i] /= glm::length(vec3(planes[i]));
+	}
+}
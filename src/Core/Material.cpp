@@ -15,7 +15,8 @@ TextureDescriptorSet::TextureDescriptorSet():
 	vulkanImage({ VK_NULL_HANDLE,VK_NULL_HANDLE }),
 	imageView(VK_NULL_HANDLE),
 	textureSampler(VK_NULL_HANDLE),
-	imguiTextureDescriptorSet(VK_NULL_HANDLE)
+	imguiTextureDescriptorSet(VK_NULL_HANDLE),
+	bindlessIndex(0)
 {
 
 }
@@ -27,9 +28,7 @@ Material::Material() :
 	materialUniform({}),
 	name(""),
 	id(++idCounter),
-	textures(),
-	textureDescriptorSetLayout(VK_NULL_HANDLE),
-	textureDescriptorSet(VK_NULL_HANDLE)
+	textures()
 {
 
 }
@@ -38,9 +37,7 @@ Material::Material(const Material* material) :
 	materialUniform({}),
 	name(material->name.c_str()),
 	id(material->id),
-	textures(),
-	textureDescriptorSetLayout(material->textureDescriptorSetLayout),
-	textureDescriptorSet(material->textureDescriptorSet)
+	textures()
 {
 	std::copy(std::begin(material->textures), std::end(material->textures), std::begin(textures));
 }
@@ -50,7 +47,7 @@ Material::~Material()
 
 }
 
-void Material::cleanUp(VkDevice& logicalDevice, VmaAllocator& vmaAllocator, VkDescriptorPool& descriptorPool)
+void Material::cleanUp(VkDevice& logicalDevice, VmaAllocator& vmaAllocator)
 {
 	for (auto& texture : textures)
 	{
@@ -60,10 +57,6 @@ void Material::cleanUp(VkDevice& logicalDevice, VmaAllocator& vmaAllocator, VkDe
 
 		vkDestroySampler(logicalDevice, texture.textureSampler, nullptr);
 	}
-
-	vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &textureDescriptorSet);
-
-	vkDestroyDescriptorSetLayout(logicalDevice, textureDescriptorSetLayout, nullptr);
 }
 
 void Material::setTextureImage(u32 index, Image* image, TextureDescriptorSet* textures)
@@ -112,38 +105,18 @@ void Material::initTexture(VkDevice& logicalDevice, VkPhysicalDevice& physicalDe
 		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
-void Material::initDescriptorSet(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkCommandPool& commandPool,
-	VkDescriptorPool& descriptorPool, VkQueue& graphicsQueue)
+void Material::initTextures(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkCommandPool& commandPool,
+	VkQueue& graphicsQueue)
 {
 	// Initiase Texture
 	for (u32 i = 0; i < TEXTURE_SIZE; i++)
 	{
 		initTexture(logicalDevice, physicalDevice, vmaAllocator, commandPool, graphicsQueue, textures, i);
 	}
-
-	// Initialise Descriptor set layout first
-	// Binding set to 1 with n number of descriptor sets
-	WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, textureDescriptorSetLayout, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-		VK_SHADER_STAGE_FRAGMENT_BIT, 1, TEXTURE_SIZE);
-
-	// Allocate memory for descriptor set
-	WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, descriptorPool, textureDescriptorSetLayout, textureDescriptorSet);
-
-	// Write Descriptor Set
-	std::vector<VkSampler> textureSamplers(TEXTURE_SIZE);
-	std::vector<VkImageView> imageViews(TEXTURE_SIZE);
-	for (u32 i = 0; i < TEXTURE_SIZE; i++)
-	{
-		textureSamplers[i] = textures[i].textureSampler;
-		imageViews[i] = textures[i].imageView;
-	}
-
-	WillEngine::VulkanUtil::writeDescriptorSetImage(logicalDevice, textureDescriptorSet, textureSamplers.data(), imageViews.data(),
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, TEXTURE_SIZE);
 }
 
-void Material::updateDescriptorSet(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkCommandPool& commandPool,
-	VkDescriptorPool& descriptorPool, VkQueue& graphicsQueue, u32 index)
+void Material::updateTexture(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkCommandPool& commandPool,
+	VkQueue& graphicsQueue, u32 index)
 {
 	// Free previous memory
 	vmaDestroyImage(vmaAllocator, textures[index].vulkanImage.image, textures[index].vulkanImage.allocation);
@@ -154,18 +127,6 @@ void Material::updateDescriptorSet(VkDevice& logicalDevice, VkPhysicalDevice& ph
 
 	// Update the image and imageview associated to it
 	initTexture(logicalDevice, physicalDevice, vmaAllocator, commandPool, graphicsQueue, textures, index);
-
-	// Write Descriptor Set
-	std::vector<VkSampler> textureSamplers(TEXTURE_SIZE);
-	std::vector<VkImageView> imageViews(TEXTURE_SIZE);
-	for (u32 i = 0; i < TEXTURE_SIZE; i++)
-	{
-		textureSamplers[i] = textures[i].textureSampler;
-		imageViews[i] = textures[i].imageView;
-	}
-
-	WillEngine::VulkanUtil::writeDescriptorSetImage(logicalDevice, textureDescriptorSet, textureSamplers.data(), imageViews.data(),
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, TEXTURE_SIZE);
 }
 
 const bool Material::hasTexture(u32 index, TextureDescriptorSet* textures)
@@ -1,6 +1,10 @@
 #include "pch.h"
 #include "Core/Mesh.h"
 
+#include <glm/gtc/packing.hpp>
+
+#include "Utils/MathUtil.h"
+
 u32 Mesh::idCounter = 0;
 
 Mesh::Mesh() :
@@ -13,11 +17,15 @@ Mesh::Mesh() :
 	uvs(),
 	indicies(),
 	indiciesSize(0),
-	positionBuffer({ VK_NULL_HANDLE , VK_NULL_HANDLE }),
-	normalBuffer({ VK_NULL_HANDLE , VK_NULL_HANDLE }),
-	tangentBuffer({ VK_NULL_HANDLE, VK_NULL_HANDLE }),
-	uvBuffer({ VK_NULL_HANDLE , VK_NULL_HANDLE }),
-	indexBuffer({ VK_NULL_HANDLE , VK_NULL_HANDLE }),
+	aabbMin(0),
+	aabbMax(0),
+	boundingSphere(0),
+	meshlets(),
+	lods(),
+	geometryArena(nullptr),
+	geometryRange(),
+	positionOffset(0),
+	positionScale(1),
 	primitive(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST),
 	readyToDraw(false)
 {
@@ -34,11 +42,15 @@ Mesh::Mesh(const Mesh* mesh) :
 	uvs(mesh->uvs),
 	indicies(mesh->indicies),
 	indiciesSize(mesh->indiciesSize),
-	positionBuffer({ VK_NULL_HANDLE , VK_NULL_HANDLE }),
-	normalBuffer({ VK_NULL_HANDLE , VK_NULL_HANDLE }),
-	tangentBuffer({ VK_NULL_HANDLE, VK_NULL_HANDLE }),
-	uvBuffer({ VK_NULL_HANDLE , VK_NULL_HANDLE }),
-	indexBuffer({ VK_NULL_HANDLE , VK_NULL_HANDLE }),
+	aabbMin(mesh->aabbMin),
+	aabbMax(mesh->aabbMax),
+	boundingSphere(mesh->boundingSphere),
+	meshlets(mesh->meshlets),
+	lods(mesh->lods),
+	geometryArena(nullptr),
+	geometryRange(),
+	positionOffset(mesh->positionOffset),
+	positionScale(mesh->positionScale),
 	primitive(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST),
 	readyToDraw(false)
 {
@@ -50,156 +62,127 @@ Mesh::~Mesh()
 
 }
 
-void Mesh::uploadDataToPhysicalDevice(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkSurfaceKHR& surface, VkQueue& queue)
+void Mesh::uploadDataToPhysicalDevice(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkSurfaceKHR& surface, VkQueue& queue,
+	VulkanGeometryArena& geometryArena)
 {
-	// Buffer that is going to send to the GPU
-	positionBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(vec3) * positions.size(),
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
-
-	normalBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(vec3) * normals.size(),
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
-
-	tangentBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(vec3) * tangents.size(),
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
-
-	uvBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(vec2) * uvs.size(),
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
-
-	indexBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(u32) * indicies.size(),
-		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
-
-
-	// Staging buffers
-	VulkanAllocatedMemory positionStagingBuffer{};
-	positionStagingBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(vec3) * positions.size(),
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-
-	VulkanAllocatedMemory normalStagingBuffer{};
-	normalStagingBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(vec3) * normals.size(),
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-
-	VulkanAllocatedMemory tangentStagingBuffer{};
-	tangentStagingBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(vec3) * tangents.size(),
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-
-	VulkanAllocatedMemory uvStagingBuffer{};
-	uvStagingBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(vec2) * uvs.size(),
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-
-	VulkanAllocatedMemory indexStagingBuffer;
-	indexStagingBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(u32) * indicies.size(),
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-
-	// Copy data to the staging buffer first
-	void* positionPtr = nullptr;
-	if (vmaMapMemory(vmaAllocator, positionStagingBuffer.allocation, &positionPtr) != VK_SUCCESS)
-		throw std::runtime_error("Failed to map memory");
-	std::memcpy(positionPtr, positions.data(), sizeof(vec3) * positions.size());
-	vmaUnmapMemory(vmaAllocator, positionStagingBuffer.allocation);
-
-	void* normalPtr = nullptr;
-	if (vmaMapMemory(vmaAllocator, normalStagingBuffer.allocation, &normalPtr) != VK_SUCCESS)
-		throw std::runtime_error("Failed to map memory");
-	std::memcpy(normalPtr, normals.data(), sizeof(vec3) * normals.size());
-	vmaUnmapMemory(vmaAllocator, normalStagingBuffer.allocation);
+	const u32 numVertices = static_cast<u32>(positions.size());
 
-	void* tangentPtr = nullptr;
-	if (vmaMapMemory(vmaAllocator, tangentStagingBuffer.allocation, &tangentPtr) != VK_SUCCESS)
-		throw std::runtime_error("Failed to map memory");
-	std::memcpy(tangentPtr, tangents.data(), sizeof(vec3) * tangents.size());
-	vmaUnmapMemory(vmaAllocator, tangentStagingBuffer.allocation);
+	if (geometryArena.isCompressed())
+	{
+		std::vector<u64> compressedPositions;
+		std::vector<VulkanCompressedAttributes> compressedAttributes;
+		compressVertices(compressedPositions, compressedAttributes);
 
-	void* uvPtr = nullptr;
-	if (vmaMapMemory(vmaAllocator, uvStagingBuffer.allocation, &uvPtr) != VK_SUCCESS)
-		throw std::runtime_error("Failed to map memory");
-	std::memcpy(uvPtr, uvs.data(), sizeof(vec2) * uvs.size());
-	vmaUnmapMemory(vmaAllocator, uvStagingBuffer.allocation);
+		// Streams in the order of the vertex input bindings
+		std::vector<const void*> vertexData = { compressedPositions.data(), compressedAttributes.data() };
 
-	void* indexPtr = nullptr;
-	if (vmaMapMemory(vmaAllocator, indexStagingBuffer.allocation, &indexPtr) != VK_SUCCESS)
-		throw std::runtime_error("Failed to map memory");
-	std::memcpy(indexPtr, indicies.data(), sizeof(u32) * indicies.size());
-	vmaUnmapMemory(vmaAllocator, indexStagingBuffer.allocation);
+		geometryArena.upload(logicalDevice, physicalDevice, vmaAllocator, surface, queue, geometryRange, vertexData, numVertices,
+			indicies.data(), static_cast<u32>(indicies.size()));
+	}
+	else
+	{
+		positionOffset = vec3(0);
+		positionScale = vec3(1);
 
-	VkFence uploadComplete = WillEngine::VulkanUtil::createFence(logicalDevice, false);
+		// Streams in the order of the vertex input bindings
+		std::vector<const void*> vertexData = { positions.data(), normals.data(), tangents.data(), uvs.data() };
 
-	VkCommandPool commandPool = WillEngine::VulkanUtil::createCommandPool(logicalDevice, physicalDevice, surface);
-	VkCommandBuffer commandBuffer = WillEngine::VulkanUtil::createCommandBuffer(logicalDevice, commandPool);
+		geometryArena.upload(logicalDevice, physicalDevice, vmaAllocator, surface, queue, geometryRange, vertexData, numVertices,
+			indicies.data(), static_cast<u32>(indicies.size()));
+	}
 
-	VkCommandBufferBeginInfo commandInfo{};
-	commandInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	commandInfo.flags = 0;
+	this->geometryArena = &geometryArena;
 
-	if (vkBeginCommandBuffer(commandBuffer, &commandInfo) != VK_SUCCESS)
-		throw std::runtime_error("Failed to begin command buffer");
-
-	// Copy buffer from staging to the actual one
-	VkBufferCopy positionCopy{};
-	positionCopy.size = sizeof(vec3) * positions.size();
-	vkCmdCopyBuffer(commandBuffer, positionStagingBuffer.buffer, positionBuffer.buffer, 1, &positionCopy);
-
-	WillEngine::VulkanUtil::bufferBarrier(commandBuffer, positionBuffer.buffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_WHOLE_SIZE, 0, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
-
-	VkBufferCopy normalCopy{};
-	normalCopy.size = sizeof(vec3) * normals.size();
-	vkCmdCopyBuffer(commandBuffer, normalStagingBuffer.buffer, normalBuffer.buffer, 1, &normalCopy);
-
-	WillEngine::VulkanUtil::bufferBarrier(commandBuffer, normalBuffer.buffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_WHOLE_SIZE, 0, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
-
-	VkBufferCopy tangentCopy{};
-	tangentCopy.size = sizeof(vec3) * tangents.size();
-	vkCmdCopyBuffer(commandBuffer, tangentStagingBuffer.buffer, tangentBuffer.buffer, 1, &tangentCopy);
-
-	WillEngine::VulkanUtil::bufferBarrier(commandBuffer, tangentBuffer.buffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_WHOLE_SIZE, 0, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
-
-	VkBufferCopy uvCopy{};
-	uvCopy.size = sizeof(vec2) * uvs.size();
-	vkCmdCopyBuffer(commandBuffer, uvStagingBuffer.buffer, uvBuffer.buffer, 1, &uvCopy);
-
-	WillEngine::VulkanUtil::bufferBarrier(commandBuffer, uvBuffer.buffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_WHOLE_SIZE, 0, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
-
-	VkBufferCopy indexCopy{};
-	indexCopy.size = sizeof(u32) * indicies.size();
-	vkCmdCopyBuffer(commandBuffer, indexStagingBuffer.buffer, indexBuffer.buffer, 1, &indexCopy);
+	readyToDraw = true;
 
-	WillEngine::VulkanUtil::bufferBarrier(commandBuffer, indexBuffer.buffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_WHOLE_SIZE, 0, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
+	releaseVertexData();
+}
 
-	// End Command buffer
-	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
-		throw std::runtime_error("Failed to end command buffer");
+void Mesh::cleanup(VkDevice& logicalDevice, VmaAllocator vmaAllocator)
+{
+	if (!geometryArena)
+		return;
 
-	// Submit the recorded commands
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
+	geometryArena->free(geometryRange);
+	geometryArena = nullptr;
 
+	readyToDraw = false;
+}
 
-	if (vkQueueSubmit(queue, 1, &submitInfo, uploadComplete) != VK_SUCCESS)
-		throw std::runtime_error("Failed to submit commands");
+void Mesh::computeBounds()
+{
+	if (positions.empty())
+	{
+		aabbMin = vec3(0);
+		aabbMax = vec3(0);
+		boundingSphere = vec4(0);
+		return;
+	}
+
+	aabbMin = positions[0];
+	aabbMax = positions[0];
+	for (const vec3& position : positions)
+	{
+		aabbMin = glm::min(aabbMin, position);
+		aabbMax = glm::max(aabbMax, position);
+	}
+
+	// Centre of the bounding box, not the tightest sphere but cheap and stable
+	vec3 centre = (aabbMin + aabbMax) * 0.5f;
+
+	f32 radiusSquared = 0;
+	for (const vec3& position : positions)
+	{
+		vec3 offset = position - centre;
+		radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+	}
+
+	boundingSphere = vec4(centre, std::sqrt(radiusSquared));
+}
 
-	if (vkWaitForFences(logicalDevice, 1, &uploadComplete, VK_TRUE, std::numeric_limits<u64>::max()) != VK_SUCCESS)
-		throw std::runtime_error("Failed to wait for fence");
+MeshLod Mesh::getLod(u32 lod) const
+{
+	if (lods.empty())
+		return MeshLod{ 0, indiciesSize, 0, static_cast<u32>(meshlets.size()), 0.0f };
 
-	readyToDraw = true;
+	return lods[std::min(lod, static_cast<u32>(lods.size()) - 1)];
+}
 
-	// Clean up staging buffers
-	vmaDestroyBuffer(vmaAllocator, positionStagingBuffer.buffer, positionStagingBuffer.allocation);
-	vmaDestroyBuffer(vmaAllocator, normalStagingBuffer.buffer, normalStagingBuffer.allocation);
-	vmaDestroyBuffer(vmaAllocator, tangentStagingBuffer.buffer, tangentStagingBuffer.allocation);
-	vmaDestroyBuffer(vmaAllocator, uvStagingBuffer.buffer, uvStagingBuffer.allocation);
-	vmaDestroyBuffer(vmaAllocator, indexStagingBuffer.buffer, indexStagingBuffer.allocation);
+void Mesh::remapVertices(const std::vector<u32>& remap, u32 numVertices)
+{
+	remapAttribute(positions, remap, numVertices);
+	remapAttribute(normals, remap, numVertices);
+	remapAttribute(tangents, remap, numVertices);
+	remapAttribute(uvs, remap, numVertices);
+}
 
-	// Clean up command pool, command buffer, and fence
-	vkDestroyFence(logicalDevice, uploadComplete, nullptr);
-	vkFreeCommandBuffers(logicalDevice, commandPool, 1, &commandBuffer);
-	vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+void Mesh::compressVertices(std::vector<u64>& compressedPositions, std::vector<VulkanCompressedAttributes>& compressedAttributes)
+{
+	// The bounds are computed when the mesh is imported
+	positionOffset = aabbMin;
+	positionScale = aabbMax - aabbMin;
+
+	// A flat axis stays at the offset
+	const vec3 inverseScale(positionScale.x > 0 ? 1.0f / positionScale.x : 0.0f, positionScale.y > 0 ? 1.0f / positionScale.y : 0.0f,
+		positionScale.z > 0 ? 1.0f / positionScale.z : 0.0f);
+
+	compressedPositions.resize(positions.size());
+	compressedAttributes.resize(positions.size());
+
+	for (u32 i = 0; i < positions.size(); i++)
+	{
+		const vec3 quantised = glm::clamp((positions[i] - positionOffset) * inverseScale, vec3(0), vec3(1));
+		compressedPositions[i] = glm::packUnorm4x16(vec4(quantised, 0));
+
+		VulkanCompressedAttributes& attributes = compressedAttributes[i];
+		attributes.normal = glm::packSnorm2x16(WillEngine::Utils::EncodeOctahedral(normals[i]));
+		attributes.tangent = glm::packSnorm4x8(vec4(WillEngine::Utils::EncodeOctahedral(vec3(tangents[i])), 0, tangents[i].w));
+		attributes.uv = glm::packHalf2x16(uvs[i]);
+	}
+}
 
+void Mesh::releaseVertexData()
+{
 	// Remove unnecessary data from memory
 	positions.clear();
 	normals.clear();
@@ -212,36 +195,4 @@ void Mesh::uploadDataToPhysicalDevice(VkDevice& logicalDevice, VkPhysicalDevice&
 	tangents.shrink_to_fit();
 	uvs.shrink_to_fit();
 	indicies.shrink_to_fit();
-}
-
-std::vector<VkBuffer> Mesh::getVulkanBuffers() const
-{
-	std::vector<VkBuffer> returnBuffers = { positionBuffer.buffer, normalBuffer.buffer, tangentBuffer.buffer, uvBuffer.buffer };
-
-	return std::move(returnBuffers);
-}
-
-std::vector<VkDeviceSize> Mesh::getVulkanOffset() const
-{
-	std::vector<VkDeviceSize> returnOffsets(getVulkanBufferSize());
-
-	return std::move(returnOffsets);
-}
-
-void Mesh::cleanup(VkDevice& logicalDevice, VmaAllocator vmaAllocator)
-{
-	// Vertex Buffer
-	vmaDestroyBuffer(vmaAllocator, positionBuffer.buffer, positionBuffer.allocation);
-
-	// Normal Buffer
-	vmaDestroyBuffer(vmaAllocator, normalBuffer.buffer, normalBuffer.allocation);
-
-	// Tangent Buffer
-	vmaDestroyBuffer(vmaAllocator, tangentBuffer.buffer, tangentBuffer.allocation);
-
-	// UV Buffer
-	vmaDestroyBuffer(vmaAllocator, uvBuffer.buffer, uvBuffer.allocation);
-
-	// Index Buffer
-	vmaDestroyBuffer(vmaAllocator, indexBuffer.buffer, indexBuffer.allocation);
 }
\ No newline at end of file
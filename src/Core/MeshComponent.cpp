@@ -1,13 +1,24 @@
 #include "pch.h"
 #include "Core/MeshComponent.h"
 
+#include "Utils/MathUtil.h"
+
 using namespace WillEngine;
 
 MeshComponent::MeshComponent() :
 	Component(nullptr),
 	name(""),
 	meshIndicies(),
-	materialIndicies()
+	materialIndicies(),
+	worldAabbMin(),
+	worldAabbMax(),
+	worldBoundingSpheres(),
+	worldTransformation(1.0f),
+	previousWorldTransformation(1.0f),
+	indirectObjectSlots(),
+	worldBoundsVersion(0),
+	worldBoundsValid(false),
+	transformationHistoryValid(false)
 {
 
 }
@@ -16,7 +27,16 @@ MeshComponent::MeshComponent(Entity* entity):
 	Component(entity),
 	name(""),
 	meshIndicies(),
-	materialIndicies()
+	materialIndicies(),
+	worldAabbMin(),
+	worldAabbMax(),
+	worldBoundingSpheres(),
+	worldTransformation(1.0f),
+	previousWorldTransformation(1.0f),
+	indirectObjectSlots(),
+	worldBoundsVersion(0),
+	worldBoundsValid(false),
+	transformationHistoryValid(false)
 {
 
 }
@@ -25,7 +45,16 @@ MeshComponent::MeshComponent(const MeshComponent* meshComp) :
 	Component(meshComp->parent),
 	name(meshComp->name),
 	meshIndicies(meshComp->meshIndicies),
-	materialIndicies(meshComp->materialIndicies)
+	materialIndicies(meshComp->materialIndicies),
+	worldAabbMin(),
+	worldAabbMax(),
+	worldBoundingSpheres(),
+	worldTransformation(1.0f),
+	previousWorldTransformation(1.0f),
+	indirectObjectSlots(),
+	worldBoundsVersion(0),
+	worldBoundsValid(false),
+	transformationHistoryValid(false)
 {
 
 }
@@ -39,10 +68,45 @@ void MeshComponent::addMesh(Mesh* mesh)
 {
 	meshIndicies.push_back(mesh->id);
 	materialIndicies.push_back(mesh->materialIndex);
+
+	worldBoundsValid = false;
 }
 
 void MeshComponent::addMesh(Mesh* mesh, Material* material)
 {
 	meshIndicies.push_back(mesh->id);
 	materialIndicies.push_back(material->id);
+
+	worldBoundsValid = false;
+}
+
+void MeshComponent::updateWorldBounds(TransformComponent* transformComp, const std::unordered_map<u32, Mesh*>& meshes)
+{
+	if (worldBoundsValid && worldBoundsVersion == transformComp->getWorldVersion())
+		return;
+
+	const mat4& worldTransformation = transformComp->getWorldTransformation();
+
+	worldAabbMin.resize(meshIndicies.size());
+	worldAabbMax.resize(meshIndicies.size());
+	worldBoundingSpheres.resize(meshIndicies.size());
+
+	for (u32 i = 0; i < meshIndicies.size(); i++)
+	{
+		const Mesh* mesh = meshes.at(meshIndicies[i]);
+
+		WillEngine::Utils::TransformAabb(worldTransformation, mesh->aabbMin, mesh->aabbMax, worldAabbMin[i], worldAabbMax[i]);
+		worldBoundingSpheres[i] = WillEngine::Utils::TransformBoundingSphere(worldTransformation, mesh->boundingSphere);
+	}
+
+	worldBoundsVersion = transformComp->getWorldVersion();
+	worldBoundsValid = true;
+}
+
+void MeshComponent::updateTransformationHistory(const mat4& transformation)
+{
+	previousWorldTransformation = transformationHistoryValid ? worldTransformation : transformation;
+	worldTransformation = transformation;
+
+	transformationHistoryValid = true;
 }
\ No newline at end of file
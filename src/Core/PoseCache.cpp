@@ -0,0 +1,66 @@
+#include "pch.h"
+#include "Core/PoseCache.h"
+
+size_t PoseCacheKeyHash::operator()(const PoseCacheKey& key) const
+{
+	size_t hash = std::hash<u64>()(key.layoutHash);
+	hash ^= std::hash<u32>()(key.animationId) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	hash ^= std::hash<u64>()(key.tick) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+
+	return hash;
+}
+
+PoseCache::PoseCache() :
+	hits(0),
+	misses(0),
+	totalHits(0),
+	totalMisses(0),
+	poseIndices(),
+	poses(),
+	numPosesUsed(0)
+{
+
+}
+
+PoseCache::~PoseCache()
+{
+
+}
+
+void PoseCache::beginFrame()
+{
+	poseIndices.clear();
+	numPosesUsed = 0;
+
+	hits = 0;
+	misses = 0;
+}
+
+const std::vector<mat4>* PoseCache::find(const PoseCacheKey& key)
+{
+	auto it = poseIndices.find(key);
+
+	if (it == poseIndices.end())
+	{
+		misses++;
+		totalMisses++;
+
+		return nullptr;
+	}
+
+	hits++;
+	totalHits++;
+
+	return &poses[it->second];
+}
+
+std::vector<mat4>& PoseCache::insert(const PoseCacheKey& key)
+{
+	if (numPosesUsed == poses.size())
+		poses.emplace_back();
+
+	const u32 index = numPosesUsed++;
+	poseIndices[key] = index;
+
+	return poses[index];
+}
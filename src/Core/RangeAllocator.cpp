@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "Core/RangeAllocator.h"
+
+RangeAllocator::RangeAllocator() :
+	freeByOffset(),
+	freeBySize(),
+	capacity(0),
+	allocated(0)
+{
+
+}
+
+RangeAllocator::~RangeAllocator()
+{
+
+}
+
+void RangeAllocator::reset(u32 capacity)
+{
+	freeByOffset.clear();
+	freeBySize.clear();
+
+	this->capacity = capacity;
+	allocated = 0;
+
+	if (capacity > 0)
+		addFreeRange(0, capacity);
+}
+
+void RangeAllocator::grow(u32 newCapacity)
+{
+	if (newCapacity <= capacity)
+		return;
+
+	const u32 oldCapacity = capacity;
+	capacity = newCapacity;
+
+	// The added space was never allocated, so only the free ranges change
+	mergeFreeRange(oldCapacity, newCapacity - oldCapacity);
+}
+
+bool RangeAllocator::allocate(u32 count, u32& offset)
+{
+	if (count == 0)
+	{
+		offset = 0;
+		return true;
+	}
+
+	auto fit = freeBySize.lower_bound(count);
+	if (fit == freeBySize.end())
+		return false;
+
+	const u32 rangeOffset = fit->second;
+	const u32 rangeCount = fit->first;
+
+	removeFreeRange(freeByOffset.find(rangeOffset));
+
+	// The rest of the range stays free
+	if (rangeCount > count)
+		addFreeRange(rangeOffset + count, rangeCount - count);
+
+	offset = rangeOffset;
+	allocated += count;
+
+	return true;
+}
+
+void RangeAllocator::free(u32 offset, u32 count)
+{
+	if (count == 0)
+		return;
+
+	allocated -= count;
+
+	mergeFreeRange(offset, count);
+}
+
+f32 RangeAllocator::getFragmentation() const
+{
+	const u32 freeCount = capacity - allocated;
+	if (freeCount == 0)
+		return 0;
+
+	return 1.0f - static_cast<f32>(getLargestFreeRange()) / static_cast<f32>(freeCount);
+}
+
+void RangeAllocator::mergeFreeRange(u32 offset, u32 count)
+{
+	// Merge with the free range after
+	auto next = freeByOffset.find(offset + count);
+	if (next != freeByOffset.end())
+	{
+		count += next->second;
+		removeFreeRange(next);
+	}
+
+	// Merge with the free range before
+	auto previous = freeByOffset.lower_bound(offset);
+	if (previous != freeByOffset.begin())
+	{
+		previous--;
+
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			count += previous->second;
+			removeFreeRange(previous);
+		}
+	}
+
+	addFreeRange(offset, count);
+}
+
+void RangeAllocator::addFreeRange(u32 offset, u32 count)
+{
+	freeByOffset[offset] = count;
+	freeBySize.emplace(count, offset);
+}
+
+void RangeAllocator::removeFreeRange(std::map<u32, u32>::iterator range)
+{
+	// Several free ranges can have the same size
+	auto sizes = freeBySize.equal_range(range->second);
+	for (auto it = sizes.first; it != sizes.second; it++)
+	{
+		if (it->second == range->first)
+		{
+			freeBySize.erase(it);
+			break;
+		}
+	}
+
+	freeByOffset.erase(range);
+}
\ No newline at end of file
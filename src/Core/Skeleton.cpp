@@ -2,6 +2,7 @@
 #include "Core/Skeleton.h"
 
 #include "Core/ECS/TransformComponent.h"
+#include "Core/ECS/SkeletalComponent.h"
 #include "Core/MeshComponent.h"
 
 #include "Utils/MathUtil.h"
@@ -26,7 +27,9 @@ u32 Skeleton::idCounter = 0;
 
 Skeleton::Skeleton():
 	id(++idCounter),
-	boneInfos()
+	boneInfos(),
+	layoutHash(0),
+	syncAllEntities(false)
 {
 
 }
@@ -52,109 +55,382 @@ void Skeleton::generateBoneUniform()
 	}
 }
 
-void Skeleton::updateBoneUniform(Entity* rootEntity)
+void Skeleton::updateBoneUniform()
 {
-	calculateBoneTransform(rootEntity);
+	// The bones are stored in the same order as their inverse bind matrices so this is a single linear pass
+	for (u32 i = 0; i < boneNodeIndices.size(); i++)
+	{
+		boneUniform.boneMatrices[boneIds[i]] = modelPose[boneNodeIndices[i]] * inverseBindMatrices[i];
+	}
 }
 
-void Skeleton::calculateBoneTransform(Entity* entity)
+void Skeleton::readLocalPose(const Entity* entity, bool includeSubtree)
 {
-	// If the bone has not been visited before, we simple ignore it and its child
-	if (necessityMap.at(entity->name) == false)
+	std::optional<u32> index = getHierarchyIndex(entity);
+
+	if (!index.has_value())
 		return;
 
-	// We iterate over the node hierarchy and copy global world transformation to the uniform if necessary
-	if (boneInfos.contains(entity->name))
+	const u32 end = includeSubtree ? subtreeEnds[index.value()] : index.value() + 1;
+
+	for (u32 i = index.value(); i < end; i++)
 	{
-		TransformComponent* transComp = entity->GetComponent<TransformComponent>();
-		const mat4& transformation = transComp->getWorldTransformation();
+		bindPose[i] = hierarchy[i]->GetComponent<TransformComponent>()->getLocalTransformation();
+		localPose[i] = bindPose[i];
+	}
+
+	// The bind pose below the root is part of the layout
+	if (end > 1)
+		generateLayoutHash();
+}
+
+void Skeleton::updatePose(const Animation* animation, const AnimationComponent* animationComp, PoseCache* poseCache)
+{
+	if (animation && animationComp && poseCache)
+	{
+		const std::vector<const AnimationNode*>& channels = getAnimationChannels(animation);
+
+		const f64 tick = getSampleTick(animation, animationComp);
+		const PoseCacheKey key = { layoutHash, animation->id, static_cast<u64>(tick) };
+
+		// The cached pose is relative to the root so it can be shared between skeletons placed anywhere
+		const std::vector<mat4>* cachedPose = poseCache->find(key);
+
+		if (!cachedPose)
+		{
+			std::vector<mat4>& pose = poseCache->insert(key);
+			evaluateModelPose(channels, tick, true, pose);
+
+			cachedPose = &pose;
+		}
+
+		// An animated root replaces the placement of the root entity
+		const mat4 rootTransformation = channels[0] ? mat4(1) : bindPose[0];
 
-		BoneInfo& boneInfo = boneInfos[entity->name.c_str()];
-		boneUniform.boneMatrices[boneInfo.id] = transformation * boneInfo.offsetMatrix;
+		for (u32 i = 0; i < hierarchy.size(); i++)
+		{
+			if (!necessityMask[i])
+			{
+				i = subtreeEnds[i] - 1;
+				continue;
+			}
+
+			modelPose[i] = rootTransformation * (*cachedPose)[i];
+		}
+
+		return;
 	}
 
-	for (u32 i = 0; i < entity->children.size(); i++)
+	if (animation && animationComp)
+		samplePose(animation, animationComp);
+
+	// Parents are always placed before their children so the model pose can be built in one pass
+	for (u32 i = 0; i < hierarchy.size(); i++)
 	{
-		Entity* childEntity = entity->children[i];
+		// If the node has not been marked, we simply skip it and its whole subtree
+		if (!necessityMask[i])
+		{
+			i = subtreeEnds[i] - 1;
+			continue;
+		}
+
+		const i32 parentIndex = parentIndices[i];
 
-		calculateBoneTransform(childEntity);
+		modelPose[i] = parentIndex < 0 ? localPose[i] : modelPose[parentIndex] * localPose[i];
 	}
 }
 
-void Skeleton::generateNecessityMap(Entity* rootEntity)
+void Skeleton::syncEntities()
 {
-	necessityMap[rootEntity->name] = false;
+	if (!syncAllEntities)
+	{
+		for (u32 index : attachmentIndices)
+		{
+			hierarchy[index]->GetComponent<TransformComponent>()->setWorldTransformation(modelPose[index]);
+		}
+
+		return;
+	}
 
-	for (auto* child : rootEntity->children)
+	for (u32 i = 0; i < hierarchy.size(); i++)
 	{
-		generateNecessityMap(child);
+		if (!necessityMask[i])
+		{
+			i = subtreeEnds[i] - 1;
+			continue;
+		}
+
+		hierarchy[i]->GetComponent<TransformComponent>()->setWorldTransformation(modelPose[i]);
 	}
 }
 
-void Skeleton::resetNecessityMap()
+void Skeleton::evaluateBonePalette(const Animation* animation, f64 time, mat4* palette) const
 {
-	// Resetting every boolean to false
-	for (auto& it : necessityMap)
+	std::vector<mat4> sampledModelPose;
+	evaluateModelPose(bindAnimationChannels(animation), time * animation->getTicksPerSecond(), false, sampledModelPose);
+
+	for (u32 i = 0; i < boneNodeIndices.size(); i++)
 	{
-		it.second = false;
+		palette[boneIds[i]] = sampledModelPose[boneNodeIndices[i]] * inverseBindMatrices[i];
 	}
 }
 
-void Skeleton::addToNecessityMap(Entity* entity)
+void Skeleton::generateHierarchy(Entity* rootEntity)
 {
-	traverseChildNecessityMapUpdate(entity);
+	hierarchy.clear();
+	parentIndices.clear();
+	subtreeEnds.clear();
+	hierarchyIndices.clear();
+	animationChannels.clear();
+
+	flattenHierarchy(rootEntity, -1);
+
+	generateNecessityMask();
+	generatePoseBuffers();
+	generateLayoutHash();
 }
 
-void Skeleton::buildNecessityMap(Entity* entity)
+std::optional<u32> Skeleton::getHierarchyIndex(const Entity* entity) const
 {
-	traverseRootNecessityMapUpdate(entity);
+	auto it = hierarchyIndices.find(entity->id);
+
+	if (it == hierarchyIndices.end())
+		return std::nullopt;
+
+	return it->second;
 }
 
-void Skeleton::traverseRootNecessityMapUpdate(Entity* entity)
+void Skeleton::flattenHierarchy(Entity* entity, i32 parentIndex)
 {
-	if (necessityMap.contains(entity->name))
+	const u32 index = static_cast<u32>(hierarchy.size());
+
+	hierarchy.push_back(entity);
+	parentIndices.push_back(parentIndex);
+	subtreeEnds.push_back(index + 1);
+	hierarchyIndices[entity->id] = index;
+
+	for (auto* child : entity->children)
+	{
+		flattenHierarchy(child, static_cast<i32>(index));
+	}
+
+	subtreeEnds[index] = static_cast<u32>(hierarchy.size());
+}
+
+void Skeleton::generateNecessityMask()
+{
+	necessityMask.assign(hierarchy.size(), false);
+
+	for (u32 i = 0; i < hierarchy.size(); i++)
 	{
-		if (necessityMap.at(entity->name) == true)
-			return;
+		Entity* entity = hierarchy[i];
 
-		necessityMap.at(entity->name) = true;
+		// Skip the skinned meshes that are deformed by this skeleton
+		SkeletalComponent* skeletalComponent = entity->AnyParentGetComponent<SkeletalComponent>();
 
-		// Traverse the hierarchy back to the root and mark every node visited to true
-		if (entity->hasParent())
+		if (skeletalComponent && skeletalComponent->skeletalId == id)
+			continue;
+
+		if (hasBone(entity->name))
+			traverseRootNecessityMaskUpdate(i);
+	}
+}
+
+void Skeleton::generatePoseBuffers()
+{
+	bindPose.resize(hierarchy.size());
+	localPose.resize(hierarchy.size());
+	modelPose.resize(hierarchy.size());
+
+	boneNodeIndices.clear();
+	boneIds.clear();
+	inverseBindMatrices.clear();
+	attachmentIndices.clear();
+
+	for (u32 i = 0; i < hierarchy.size(); i++)
+	{
+		Entity* entity = hierarchy[i];
+
+		// The bind pose comes from the entities' transformation
+		bindPose[i] = entity->GetComponent<TransformComponent>()->getLocalTransformation();
+		localPose[i] = bindPose[i];
+
+		const i32 parentIndex = parentIndices[i];
+		modelPose[i] = parentIndex < 0 ? localPose[i] : modelPose[parentIndex] * localPose[i];
+
+		auto it = boneInfos.find(entity->name);
+		if (it != boneInfos.end())
 		{
-			Entity* parentEntity = entity->getParent();
+			boneNodeIndices.push_back(i);
+			boneIds.push_back(it->second.id);
+			inverseBindMatrices.push_back(it->second.offsetMatrix);
+		}
 
-			// We also want to make sure to include meshes that are outside the skeleton
-			// by check if the current entity's has a mesh component or is a parent of the mesh component
-			for (auto& child : parentEntity->children)
-			{
-				if (child->HasComponent<MeshComponent>() || child->ChildHasComponent<MeshComponent>())
-				{
-					if (!necessityMap.contains(child->name))
-					{
-						return;
-					}
-
-					necessityMap.at(child->name) = true;
-					traverseChildNecessityMapUpdate(child);
-				}
-			}
+		if (necessityMask[i] && entity->HasComponent<MeshComponent>())
+			attachmentIndices.push_back(i);
+	}
+}
 
-			traverseRootNecessityMapUpdate(parentEntity);
+void Skeleton::generateLayoutHash()
+{
+	// FNV-1a
+	u64 hash = 14695981039346656037ull;
+
+	auto hashBytes = [&hash](const void* data, u64 size)
+	{
+		const u8* bytes = static_cast<const u8*>(data);
+
+		for (u64 i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
 		}
+	};
+
+	for (u32 i = 0; i < hierarchy.size(); i++)
+	{
+		const std::string& name = hierarchy[i]->name;
+		hashBytes(name.data(), name.size());
+		hashBytes(&parentIndices[i], sizeof(i32));
+
+		// The root only places the skeleton in the world
+		if (i > 0)
+			hashBytes(&bindPose[i], sizeof(mat4));
 	}
+
+	hashBytes(boneNodeIndices.data(), sizeof(u32) * boneNodeIndices.size());
+	hashBytes(boneIds.data(), sizeof(i32) * boneIds.size());
+	hashBytes(inverseBindMatrices.data(), sizeof(mat4) * inverseBindMatrices.size());
+
+	layoutHash = hash;
 }
 
-void Skeleton::traverseChildNecessityMapUpdate(Entity* entity)
+void Skeleton::samplePose(const Animation* animation, const AnimationComponent* animationComp)
 {
-	if (necessityMap.contains(entity->name))
+	const std::vector<const AnimationNode*>& channels = getAnimationChannels(animation);
+
+	const f64 tick = getSampleTick(animation, animationComp);
+
+	for (u32 i = 0; i < hierarchy.size(); i++)
 	{
-		necessityMap.at(entity->name) = true;
+		if (!necessityMask[i])
+		{
+			i = subtreeEnds[i] - 1;
+			continue;
+		}
+
+		// The previous clip may have animated a node without a channel
+		localPose[i] = channels[i] ? sampleLocalTransformation(channels[i], tick) : bindPose[i];
+	}
+}
 
-		// Traverse the all child and mark every node visited to true
-		for (auto& child : entity->children)
+f64 Skeleton::getSampleTick(const Animation* animation, const AnimationComponent* animationComp)
+{
+	return std::floor(animationComp->getTime() * animation->getTicksPerSecond());
+}
+
+mat4 Skeleton::sampleLocalTransformation(const AnimationNode* animationNode, f64 tick)
+{
+	// The first key after the tick, the same key the animation component steps to, the keys are not interpolated
+	const vec3& animationPosition = animationNode->getPosition(animationNode->findPositionIndex(tick)).value;
+	const quat& animationRotation = animationNode->getRotation(animationNode->findRotationIndex(tick)).value;
+	const vec3& animationScale = animationNode->getScale(animationNode->findScaleIndex(tick)).value;
+
+	// Translate
+	mat4 translation = glm::translate(mat4(1), animationPosition);
+
+	// Rotation
+	mat4 rotate = glm::mat4(animationRotation);
+
+	// Scaling
+	return glm::scale(translation * rotate, animationScale);
+}
+
+const std::vector<const AnimationNode*>& Skeleton::getAnimationChannels(const Animation* animation)
+{
+	auto it = animationChannels.find(animation->id);
+
+	if (it != animationChannels.end())
+		return it->second;
+
+	// Bind the animation nodes to the hierarchy the first time this animation is played
+	return animationChannels.emplace(animation->id, bindAnimationChannels(animation)).first->second;
+}
+
+std::vector<const AnimationNode*> Skeleton::bindAnimationChannels(const Animation* animation) const
+{
+	std::vector<const AnimationNode*> channels(hierarchy.size(), nullptr);
+
+	for (u32 i = 0; i < hierarchy.size(); i++)
+	{
+		auto it = animation->animationNodes.find(hierarchy[i]->name);
+
+		if (it != animation->animationNodes.end())
+			channels[i] = &it->second;
+	}
+
+	return channels;
+}
+
+void Skeleton::evaluateModelPose(const std::vector<const AnimationNode*>& channels, f64 tick, bool rootRelative, std::vector<mat4>& pose) const
+{
+	// Nodes outside of the necessity mask keep their bind pose
+	pose = modelPose;
+
+	for (u32 i = 0; i < hierarchy.size(); i++)
+	{
+		if (!necessityMask[i])
 		{
-			traverseChildNecessityMapUpdate(child);
+			i = subtreeEnds[i] - 1;
+			continue;
 		}
+
+		mat4 local = bindPose[i];
+
+		if (channels[i])
+		{
+			local = sampleLocalTransformation(channels[i], tick);
+		}
+		else if (i == 0 && rootRelative)
+		{
+			local = mat4(1);
+		}
+
+		const i32 parentIndex = parentIndices[i];
+		pose[i] = parentIndex < 0 ? local : pose[parentIndex] * local;
 	}
+}
+
+void Skeleton::traverseRootNecessityMaskUpdate(u32 index)
+{
+	if (necessityMask[index])
+		return;
+
+	necessityMask[index] = true;
+
+	// Traverse the hierarchy back to the root and mark every node visited to true
+	const i32 parentIndex = parentIndices[index];
+
+	if (parentIndex < 0)
+		return;
+
+	Entity* parentEntity = hierarchy[parentIndex];
+
+	// We also want to make sure to include meshes that are outside the skeleton
+	// by check if the current entity's has a mesh component or is a parent of the mesh component
+	for (auto& child : parentEntity->children)
+	{
+		if (child->HasComponent<MeshComponent>() || child->ChildHasComponent<MeshComponent>())
+		{
+			traverseChildNecessityMaskUpdate(hierarchyIndices.at(child->id));
+		}
+	}
+
+	traverseRootNecessityMaskUpdate(static_cast<u32>(parentIndex));
+}
+
+void Skeleton::traverseChildNecessityMaskUpdate(u32 index)
+{
+	// A subtree is stored contiguously so we can mark it in one go
+	std::fill(necessityMask.begin() + index, necessityMask.begin() + subtreeEnds[index], true);
 }
\ No newline at end of file
@@ -4,12 +4,6 @@
 // VulkanFramebuffer
 void VulkanFramebuffer::cleanUp(VkDevice& logicalDevice, VmaAllocator& vmaAllocator)
 {
-	// Clear attachments
+	// The attachments are owned by the render graph
 	vkDestroyFramebuffer(logicalDevice, framebuffer, nullptr);
-
-	for (VulkanFramebufferAttachment& attachment : attachments)
-	{
-		vkDestroyImageView(logicalDevice, attachment.imageView, nullptr);
-		vmaDestroyImage(vmaAllocator, attachment.vulkanImage.image, attachment.vulkanImage.allocation);
-	}
 }
\ No newline at end of file
@@ -14,12 +14,43 @@ VulkanEngine::VulkanEngine(u32 numThreads) :
 	framebuffers(),
 	postProcessingImages(),
 	presentFramebuffers(),
+	renderGraph(),
+	renderGraphBloom(false),
+	renderGraphViewRenderTargets(false),
+	currentImageIndex(0),
+	computeQueue(VK_NULL_HANDLE),
+	graphicsQueueFamily(0),
+	computeQueueFamily(0),
+	asyncCompute(false),
+	timelineSemaphore(VK_NULL_HANDLE),
+	timelineValue(0),
+	computeTimelineValue(0),
 	samplers(),
 	commandPool(VK_NULL_HANDLE),
-	pipelineCommandBuffers(),
-	semaphores(),
-	fences(),
+	frames(),
+	currentFrame(0),
+	drawLists(),
+	numActiveWorkers(0),
+	workerPool(numThreads),
+	frustumCuller(),
+	drawSorter(),
+	sortKeys(),
+	numBinds(0),
+	numSkippedBinds(0),
+	indirectBatchLookup(),
+	indirectObjects(),
+	indirectObjectSlots(),
+	freeIndirectObjectSlots(),
+	drawIndirectCount(false),
+	multiDrawIndirect(false),
+	hiZPyramid(),
+	occlusionCulling(false),
+	bakedAnimationTime(0),
 	descriptorPool(VK_NULL_HANDLE),
+	bindlessTextures(),
+	geometryArenas(),
+	compressedVertices(true),
+	geometryFreed(false),
 	pipelines(),
 	descriptorSets(),
 	pipelineShaders(),
@@ -34,6 +65,15 @@ VulkanEngine::~VulkanEngine()
 
 }
 
+void VulkanEngine::setComputeQueue(VkQueue computeQueue, u32 graphicsQueueFamily, u32 computeQueueFamily)
+{
+	this->computeQueue = computeQueue;
+	this->graphicsQueueFamily = graphicsQueueFamily;
+	this->computeQueueFamily = computeQueueFamily;
+
+	asyncCompute = computeQueue != VK_NULL_HANDLE;
+}
+
 void VulkanEngine::init(GLFWwindow* window, VkInstance& instance, VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR surface, VkQueue& graphicsQueue,
 	GameState* gameState)
 {
@@ -42,17 +82,23 @@ void VulkanEngine::init(GLFWwindow* window, VkInstance& instance, VkDevice& logi
 	// Create / Allocate resources
 	createVmaAllocator(instance, physicalDevice, logicalDevice);
 	createCommandPool(logicalDevice, physicalDevice, surface, commandPool);
-	createCommandBuffers(logicalDevice);
-	createSecondaryCommandBuffers(logicalDevice);
-	createSemaphore(logicalDevice);
-	createFence(logicalDevice, fences, VK_FENCE_CREATE_SIGNALED_BIT);
+	createFrames(logicalDevice, physicalDevice, surface);
 	createDescriptionPool(logicalDevice);
 
+	if (asyncCompute)
+		createTimelineSemaphore(logicalDevice, timelineSemaphore);
+
 	VkSampler& defaultSampler = samplers[VulkanSamplerType::Default];
 	VkSampler& attachmentSampler = samplers[VulkanSamplerType::Attachment];
 	WillEngine::VulkanUtil::createDefaultSampler(logicalDevice, defaultSampler);
 	WillEngine::VulkanUtil::createAttachmentSampler(logicalDevice, attachmentSampler);
 
+	// R16G16_SNORM is optional as a color attachment, R16G16_SFLOAT is always supported
+	VkFormatProperties normalFormatProperties{};
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, gBufferFormats[1], &normalFormatProperties);
+	if (!(normalFormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT))
+		gBufferFormats[1] = VK_FORMAT_R16G16_SFLOAT;
+
 	// Create swapchain
 	createSwapchain(window, logicalDevice, physicalDevice, surface);
 	getSwapchainImages(logicalDevice);
@@ -60,31 +106,30 @@ void VulkanEngine::init(GLFWwindow* window, VkInstance& instance, VkDevice& logi
 
 	// Create Render Pass
 	VkRenderPass& depthRenderPass = renderPasses[VulkanRenderPassType::Depth];
+	VkRenderPass& depthLateRenderPass = renderPasses[VulkanRenderPassType::DepthLate];
 	VkRenderPass& shadowRenderPass = renderPasses[VulkanRenderPassType::Shadow];
 	VkRenderPass& geometryRenderPass = renderPasses[VulkanRenderPassType::Geometry];
 	VkRenderPass& shadingRenderPass = renderPasses[VulkanRenderPassType::Shading];
 	VkRenderPass& presentRenderPass = renderPasses[VulkanRenderPassType::Present];
 	createDepthPrePass(logicalDevice, depthRenderPass, depthFormat);
+	createDepthPrePass(logicalDevice, depthLateRenderPass, depthFormat, true);
 	createShadowRenderPass(logicalDevice, shadowRenderPass, shadowDepthFormat);
-	createGeometryRenderPass(logicalDevice, geometryRenderPass, VK_FORMAT_R16G16B16A16_SFLOAT, depthFormat);
+	createGeometryRenderPass(logicalDevice, geometryRenderPass, gBufferFormats, depthFormat);
 	createShadingRenderPass(logicalDevice, shadingRenderPass, generalImageFormat, depthFormat);
 	createPresentRenderPass(logicalDevice, presentRenderPass, swapchainImageFormat);
 
-	// Create and allocate GBuffer resources
-	createDepthBuffer(logicalDevice, vmaAllocator, sceneExtent);
+	// Declare the passes of a frame
+	// The graph allocates the depth buffer, G-Buffers, shading image and bloom images
+	buildRenderGraph(logicalDevice);
+
+	// Create GBuffer framebuffer
 	createGBuffers(logicalDevice, sceneExtent);
 
 	// Create framebuffer for shading
 	VulkanFramebuffer& shadingFramebuffer = framebuffers[VulkanFramebufferType::Shading];
-	VulkanAllocatedImage& shadingImage = framebuffersImages[VulkanFramebufferType::Shading];
-	WillEngine::VulkanUtil::createShadingImage(logicalDevice, vmaAllocator, generalImageFormat, sceneExtent, shadingImage);
 	createShadingFramebuffer(logicalDevice, shadingFramebuffer.framebuffer, shadingRenderPass, sceneExtent);
 
-	// Create image for postprocessing
-	createImageBuffersForPostProcessing(logicalDevice, graphicsQueue);
-
 	// Create and allocate framebuffer for presenting
-	VulkanFramebuffer& depthFramebuffer = framebuffers[VulkanFramebufferType::Depth];
 	VulkanAllocatedImage& depthImage = framebuffersImages[VulkanFramebufferType::Depth];
 	VulkanFramebuffer& offscreenFramebuffer = framebuffers[VulkanFramebufferType::Geometry];
 	createSwapchainFramebuffer(logicalDevice, swapchainImageViews, presentFramebuffers, offscreenFramebuffer, geometryRenderPass, presentRenderPass, depthImage.imageView, swapchainExtent);
@@ -94,14 +139,32 @@ void VulkanEngine::init(GLFWwindow* window, VkInstance& instance, VkDevice& logi
 
 	initDescriptorSets(logicalDevice, descriptorPool);
 
+	// Every material texture is sampled from one descriptor array
+	initBindlessTextures(logicalDevice, physicalDevice);
+
+	// Meshes are uploaded into vertex and index buffers shared by every mesh with the same vertex layout
+	initGeometryArenas();
+
 	// Graphics Pipeline
 	initDepthPipeline(logicalDevice);
 	initDepthSkeletalPipeline(logicalDevice);
 	initShadowPipeline(logicalDevice);
 	initSkeletalPipeline(logicalDevice);
+	initDepthBakedSkeletalPipeline(logicalDevice);
+	initBakedSkeletalPipeline(logicalDevice);
 	initGeometryPipeline(logicalDevice);
 	initShadingPipeline(logicalDevice);
 
+	// GPU driven rendering of static meshes, occlusion culled against a depth pyramid
+	initIndirectDescriptors(logicalDevice, descriptorPool);
+	initHiZDescriptors(logicalDevice, descriptorPool);
+	createHiZPyramid(logicalDevice);
+	initCullPipeline(logicalDevice);
+	initHiZPipeline(logicalDevice);
+	initDepthIndirectPipeline(logicalDevice);
+	initGeometryIndirectPipeline(logicalDevice);
+	initShadowIndirectPipeline(logicalDevice);
+
 	// Descriptor Set for the final shaded image to be used in the UI rendering
 	initRenderedDescriptors(logicalDevice, descriptorPool);
 
@@ -163,11 +226,19 @@ void VulkanEngine::cleanup(VkDevice& logicalDevice)
 	{
 		Material* material = it->second;
 
-		material->cleanUp(logicalDevice, vmaAllocator, descriptorPool);
+		material->cleanUp(logicalDevice, vmaAllocator);
 		delete material;
 		gameState->graphicsResources.materials.erase(it);
 	}
 
+	// Destroy all baked animations
+	for (auto it : gameState->gameResources.bakedAnimations)
+	{
+		BakedAnimation* bakedAnimation = it.second;
+
+		bakedAnimation->cleanup(logicalDevice, vmaAllocator, descriptorPool);
+	}
+
 	// Destroy all data from a mesh
 	for (auto it = gameState->gameResources.entities.begin(); it != gameState->gameResources.entities.end(); it++)
 	{
@@ -184,37 +255,28 @@ void VulkanEngine::cleanup(VkDevice& logicalDevice)
 		}
 	}
 
-	// Destroy Descriptor Pool
-	vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+	// Destroy fences, semaphores, command pools and uniform buffers of every frame in flight
+	destroyFrames(logicalDevice);
 
-	// Destroy Fences
-	for (auto& fence : fences)
-	{
-		vkDestroyFence(logicalDevice, fence, nullptr);
-	}
+	destroyHiZPyramid(logicalDevice);
 
-	// Destroy Semaphore
-	for (auto it : semaphores)
-	{
-		VkSemaphore& semaphore = it.second;
-		vkDestroySemaphore(logicalDevice, semaphore, nullptr);
-	}
+	destroyBindlessTextures(logicalDevice);
 
-	// Free Command Buffer and Destroy Command Pool
-	for (auto it : pipelineCommandBuffers)
-	{
-		std::vector<VkCommandBuffer>& commandBuffers = it.second;
-		vkFreeCommandBuffers(logicalDevice, commandPool, NUM_SWAPCHAIN, commandBuffers.data());
-	}
+	destroyGeometryArenas();
+
+	if (timelineSemaphore != VK_NULL_HANDLE)
+		vkDestroySemaphore(logicalDevice, timelineSemaphore, nullptr);
+
+	// Destroy Descriptor Pool
+	vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+
+	// Destroy Command Pool
 	vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
 
-	// Destroy framebuffer images
-	for (auto it : framebuffersImages)
-	{
-		VulkanAllocatedImage& image = it.second;
-		vmaDestroyImage(vmaAllocator, image.image, image.allocation);
-		vkDestroyImageView(logicalDevice, image.imageView, nullptr);
-	}
+	// Destroy the shadow map, every other framebuffer image is owned by the render graph
+	VulkanAllocatedImage& shadowCubemapImage = framebuffersImages[VulkanFramebufferType::ShadowMap];
+	vkDestroyImageView(logicalDevice, shadowCubemapImage.imageView, nullptr);
+	vmaDestroyImage(vmaAllocator, shadowCubemapImage.image, shadowCubemapImage.allocation);
 
 	for (auto it : framebuffers)
 	{
@@ -222,16 +284,8 @@ void VulkanEngine::cleanup(VkDevice& logicalDevice)
 		vulkanFramebuffer.cleanUp(logicalDevice, vmaAllocator);
 	}
 
-	for (auto it : postProcessingImages)
-	{
-		VulkanPostProcessingImages& postProcessingImages = it.second;
-		std::vector<VulkanAllocatedImage>& images = postProcessingImages.allocatedImages;
-		for (VulkanAllocatedImage& image : images)
-		{
-			vmaDestroyImage(vmaAllocator, image.image, image.allocation);
-			vkDestroyImageView(logicalDevice, image.imageView, nullptr);
-		}
-	}
+	// Destroy transient images
+	renderGraph.destroy(logicalDevice, vmaAllocator);
 
 	// Destroy framebuffer
 	for (auto& presentFramebuffer : presentFramebuffers)
@@ -280,15 +334,15 @@ void VulkanEngine::createVmaAllocator(VkInstance& instance, VkPhysicalDevice& ph
 		throw std::runtime_error("Failed to create vma allocator");
 }
 
-void VulkanEngine::createDepthPrePass(VkDevice& logicalDevice, VkRenderPass& renderPass, const VkFormat& depthFormat)
+void VulkanEngine::createDepthPrePass(VkDevice& logicalDevice, VkRenderPass& renderPass, const VkFormat& depthFormat, bool loadDepth)
 {
 	// Only the depth buffer
 	VkAttachmentDescription attachments[1]{};
 	attachments[0].format = depthFormat;
 	attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
-	attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[0].loadOp = loadDepth ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
 	attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachments[0].initialLayout = loadDepth ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
 	attachments[0].finalLayout = VK_IMAGE_LAYOUT_GENERAL;
 
 	VkAttachmentReference depthAttachment{};
@@ -408,7 +462,7 @@ void VulkanEngine::createShadowRenderPass(VkDevice& logicalDevice, VkRenderPass&
 		throw std::runtime_error("Failed to create render pass");
 }
 
-void VulkanEngine::createGeometryRenderPass(VkDevice& logicalDevice, VkRenderPass& renderPass, VkFormat format, const VkFormat& depthFormat)
+void VulkanEngine::createGeometryRenderPass(VkDevice& logicalDevice, VkRenderPass& renderPass, const VkFormat* formats, const VkFormat& depthFormat)
 {
 	// GBuffers + Depth Buffer
 	std::vector<VkAttachmentDescription> attachments(VulkanFramebuffer::ATTACHMENT_SIZE + 1);
@@ -432,10 +486,7 @@ void VulkanEngine::createGeometryRenderPass(VkDevice& logicalDevice, VkRenderPas
 		else
 		{
 			// G-Buffers
-			attachments[i].format = generalImageFormat;
-
-			if(i <= 1)
-				attachments[i].format = format;
+			attachments[i].format = formats[i];
 
 			attachments[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 			attachments[i].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -446,7 +497,6 @@ void VulkanEngine::createGeometryRenderPass(VkDevice& logicalDevice, VkRenderPas
 	// 0 is GBuffer0
 	// 1 is GBuffer1
 	// 2 is GBuffer2
-	// 3 is GBuffer3
 	std::vector<VkAttachmentReference> colorAttachments(attachments.size() - 1);
 	for (u32 i = 0; i < colorAttachments.size(); i++)
 	{
@@ -575,35 +625,329 @@ void VulkanEngine::createSwapchainImageViews(VkDevice& logicalDevice)
 	}
 }
 
-void VulkanEngine::createDepthBuffer(VkDevice& logicalDevice, VmaAllocator& vmaAllocator, const VkExtent2D& extent)
+void VulkanEngine::buildRenderGraph(VkDevice& logicalDevice)
 {
-	VulkanAllocatedImage& depthImage = framebuffersImages[VulkanFramebufferType::Depth];
+	const bool enableBloom = gameState->gameSettings.enableBloom;
+	const bool viewRenderTargets = gameState->gameSettings.viewRenderTargets;
+
+	const VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	const VkAccessFlags depthAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	const VkAccessFlags storageAccess = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	renderGraph.setQueueFamilies(graphicsQueueFamily, computeQueueFamily);
+
+	// Images
+	// The Hi-Z pyramid is built from the depth buffer
+	RenderGraphImageId depthImage = renderGraph.createImage("Depth", depthFormat, sceneExtent,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+	RenderGraphImageId gBufferImages[VulkanFramebuffer::ATTACHMENT_SIZE]{};
+	for (u32 i = 0; i < VulkanFramebuffer::ATTACHMENT_SIZE; i++)
+	{
+		gBufferImages[i] = renderGraph.createImage("GBuffer" + std::to_string(i), gBufferFormats[i], sceneExtent, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+			VK_IMAGE_ASPECT_COLOR_BIT);
+	}
+
+	RenderGraphImageId shadingImage = renderGraph.createImage("Shading", generalImageFormat, sceneExtent,
+		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+	// Every mip of the bloom chain is half the size of the one before
+	std::vector<RenderGraphImageId> downSampleImages(numDownSampleImage);
+	std::vector<RenderGraphImageId> upSampleImages(numUpSampleImage);
+	VkExtent2D mipExtent = sceneExtent;
+	for (u32 i = 0; i < numUpSampleImage; i++)
+	{
+		if (i < numDownSampleImage)
+			downSampleImages[i] = renderGraph.createImage("Downscale" + std::to_string(i), generalImageFormat, mipExtent,
+				VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+		upSampleImages[i] = renderGraph.createImage("Upscale" + std::to_string(i), generalImageFormat, mipExtent,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+		mipExtent.width = std::max(1u, mipExtent.width / 2);
+		mipExtent.height = std::max(1u, mipExtent.height / 2);
+	}
+
+	// The shadow map keeps its content between frames, it is only re-rendered when the light has changed
+	RenderGraphImageId shadowMap = renderGraph.importImage("ShadowMap", &framebuffersImages[VulkanFramebufferType::ShadowMap], VK_IMAGE_ASPECT_DEPTH_BIT);
+
+	// The pyramid of a frame is read by the first culling phase of the next frame
+	RenderGraphImageId hiZImage = renderGraph.importImage("HiZ", &hiZPyramid.image, VK_IMAGE_ASPECT_COLOR_BIT);
+
+	// Passes, in execution order
+	RenderGraphPassId uniformPass = renderGraph.addPass("UniformUpdate", VulkanCommandBufferType::UniformUpdate, [this](VkCommandBuffer& commandBuffer)
+		{
+			recordUniformUpdate(commandBuffer);
+		});
+	// Buffers are not tracked by the graph
+	renderGraph.setSideEffect(uniformPass);
+
+	// Fills in the indirect draws of the depth, shadow and geometry passes
+	RenderGraphPassId cullPass = renderGraph.addPass("Cull", VulkanCommandBufferType::Cull, [this](VkCommandBuffer& commandBuffer)
+		{
+			recordCullPass(commandBuffer, frames[currentFrame]);
+		});
+	renderGraph.setSideEffect(cullPass);
+	renderGraph.readImage(cullPass, hiZImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL);
+	renderGraph.setCondition(cullPass, [this]()
+		{
+			return drawLists.numIndirectObjects > 0;
+		});
+
+	RenderGraphPassId depthPass = renderGraph.addPass("Depth", VulkanCommandBufferType::Depth, [this](VkCommandBuffer& commandBuffer)
+		{
+			recordDepthPrePass(commandBuffer, frames[currentFrame]);
+		});
+	renderGraph.writeImage(depthPass, depthImage, depthStages, depthAccess, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+	// Occlusion culling
+	// The objects the first phase rejected are tested against the depth of the objects it accepted, the visible ones are added to the depth buffer
+	// The three passes share one condition, so a pass after them never depends on a skipped one
+	RenderGraphPassId hiZPass = renderGraph.addPass("HiZ", VulkanCommandBufferType::HiZ, [this](VkCommandBuffer& commandBuffer)
+		{
+			recordHiZPass(commandBuffer);
+		});
+	renderGraph.readImage(hiZPass, depthImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL);
+	renderGraph.writeImage(hiZPass, hiZImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, storageAccess, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
+	renderGraph.setCondition(hiZPass, [this]()
+		{
+			return occlusionCulling;
+		});
+
+	RenderGraphPassId lateCullPass = renderGraph.addPass("LateCull", VulkanCommandBufferType::LateCull, [this](VkCommandBuffer& commandBuffer)
+		{
+			recordLateCullPass(commandBuffer, frames[currentFrame]);
+		});
+	renderGraph.setSideEffect(lateCullPass);
+	renderGraph.readImage(lateCullPass, hiZImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL);
+	renderGraph.setCondition(lateCullPass, [this]()
+		{
+			return occlusionCulling;
+		});
+
+	RenderGraphPassId depthLatePass = renderGraph.addPass("DepthLate", VulkanCommandBufferType::DepthLate, [this](VkCommandBuffer& commandBuffer)
+		{
+			recordDepthLatePass(commandBuffer, frames[currentFrame]);
+		});
+	renderGraph.writeImage(depthLatePass, depthImage, depthStages, depthAccess, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
+	renderGraph.setCondition(depthLatePass, [this]()
+		{
+			return occlusionCulling;
+		});
+
+	RenderGraphPassId shadowPass = renderGraph.addPass("Shadow", VulkanCommandBufferType::Shadow, [this](VkCommandBuffer& commandBuffer)
+		{
+			recordShadowPass(commandBuffer, frames[currentFrame]);
+			gameState->graphicsResources.lights[1]->shadowRendered();
+		});
+	renderGraph.writeImage(shadowPass, shadowMap, depthStages, depthAccess, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	renderGraph.setCondition(shadowPass, [this]()
+		{
+			return gameState->graphicsResources.lights[1]->shouldRenderShadow();
+		});
+
+	RenderGraphPassId geometryPass = renderGraph.addPass("Geometry", VulkanCommandBufferType::Geometry, [this](VkCommandBuffer& commandBuffer)
+		{
+			recordGeometryPass(commandBuffer, frames[currentFrame]);
+		});
+	renderGraph.writeImage(geometryPass, depthImage, depthStages, depthAccess, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
+	for (u32 i = 0; i < VulkanFramebuffer::ATTACHMENT_SIZE; i++)
+	{
+		renderGraph.writeImage(geometryPass, gBufferImages[i], VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+
+	RenderGraphPassId shadingPass = renderGraph.addPass("Shading", VulkanCommandBufferType::Shading, [this](VkCommandBuffer& commandBuffer)
+		{
+			recordShadingPass(commandBuffer);
+		});
+	for (u32 i = 0; i < VulkanFramebuffer::ATTACHMENT_SIZE; i++)
+	{
+		renderGraph.readImage(shadingPass, gBufferImages[i], VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+	// The world position of a pixel is reconstructed from its depth
+	renderGraph.readImage(shadingPass, depthImage, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	renderGraph.readImage(shadingPass, shadowMap, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	renderGraph.writeImage(shadingPass, shadingImage, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+	// Bloom
+	// Nothing reads the bloom chain if bloom is disabled, so downscale and upscale are culled and their images never allocated
+	// With a compute queue the chain runs there, overlapping the depth and shadow passes of the next frame
+	RenderGraphPassId downscalePass = renderGraph.addPass("Downscale", VulkanCommandBufferType::Downscale, [this](VkCommandBuffer& commandBuffer)
+		{
+			recordDownscaleComputeCommands(commandBuffer);
+		});
+	if (asyncCompute)
+		renderGraph.setAsyncCompute(downscalePass);
+	renderGraph.readImage(downscalePass, shadingImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL);
+	for (u32 i = 0; i < numDownSampleImage; i++)
+	{
+		renderGraph.writeImage(downscalePass, downSampleImages[i], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, storageAccess, VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_LAYOUT_GENERAL);
+	}
+	// The last downscaled image is the last mip of upSampled
+	renderGraph.writeImage(downscalePass, upSampleImages[numUpSampleImage - 1], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, storageAccess, VK_IMAGE_LAYOUT_GENERAL,
+		VK_IMAGE_LAYOUT_GENERAL);
+
+	RenderGraphPassId upscalePass = renderGraph.addPass("Upscale", VulkanCommandBufferType::Upscale, [this](VkCommandBuffer& commandBuffer)
+		{
+			recordUpscaleComputeCommands(commandBuffer);
+		});
+	if (asyncCompute)
+		renderGraph.setAsyncCompute(upscalePass);
+	renderGraph.readImage(upscalePass, upSampleImages[numUpSampleImage - 1], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_GENERAL);
+	for (u32 i = 0; i < numUpSampleImage - 1; i++)
+	{
+		renderGraph.writeImage(upscalePass, upSampleImages[i], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, storageAccess, VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_LAYOUT_GENERAL);
+	}
+
+	if (enableBloom)
+	{
+		RenderGraphPassId blendPass = renderGraph.addPass("BlendColor", VulkanCommandBufferType::BlendColor, [this](VkCommandBuffer& commandBuffer)
+			{
+				recordBlendColorComputeCommands(commandBuffer);
+			});
+		if (asyncCompute)
+			renderGraph.setAsyncCompute(blendPass);
+		renderGraph.readImage(blendPass, upSampleImages[0], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL);
+		renderGraph.writeImage(blendPass, shadingImage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, storageAccess, VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_LAYOUT_GENERAL);
+	}
 
-	depthImage =  WillEngine::VulkanUtil::createImage(logicalDevice, vmaAllocator, depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, extent.width,
-		extent.height, 1);
+	// UI
+	RenderGraphPassId presentPass = renderGraph.addPass("Present", VulkanCommandBufferType::Present, [this](VkCommandBuffer& commandBuffer)
+		{
+			recordUICommands(commandBuffer, presentFramebuffers[currentImageIndex], swapchainExtent);
+		});
+	renderGraph.setSideEffect(presentPass);
+	renderGraph.readImage(presentPass, shadingImage, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL);
+
+	// The debugger displays the G-Buffers and bloom images, which keeps them alive until the UI pass instead of aliasing them
+	if (viewRenderTargets)
+	{
+		for (u32 i = 0; i < VulkanFramebuffer::ATTACHMENT_SIZE; i++)
+		{
+			renderGraph.readImage(presentPass, gBufferImages[i], VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		}
+
+		if (enableBloom)
+		{
+			for (u32 i = 0; i < numDownSampleImage; i++)
+			{
+				renderGraph.readImage(presentPass, downSampleImages[i], VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL);
+			}
+			for (u32 i = 0; i < numUpSampleImage; i++)
+			{
+				renderGraph.readImage(presentPass, upSampleImages[i], VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL);
+			}
+		}
+	}
+
+	renderGraph.compile(logicalDevice, vmaAllocator);
+
+	// Hand the images over to the framebuffers and descriptors using them
+	framebuffersImages[VulkanFramebufferType::Depth] = renderGraph.getImage(depthImage);
+	framebuffersImages[VulkanFramebufferType::Shading] = renderGraph.getImage(shadingImage);
+
+	VulkanFramebuffer& offscreenFramebuffer = framebuffers[VulkanFramebufferType::Geometry];
+	offscreenFramebuffer.attachments.resize(VulkanFramebuffer::ATTACHMENT_SIZE);
+	for (u32 i = 0; i < VulkanFramebuffer::ATTACHMENT_SIZE; i++)
+	{
+		offscreenFramebuffer.attachments[i].vulkanImage = renderGraph.getImage(gBufferImages[i]);
+		offscreenFramebuffer.attachments[i].imageView = offscreenFramebuffer.attachments[i].vulkanImage.imageView;
+		offscreenFramebuffer.attachments[i].format = gBufferFormats[i];
+	}
+
+	gameState->graphicsState.bloomImagesAvailable = renderGraph.isImageUsed(downSampleImages[0]);
+	if (gameState->graphicsState.bloomImagesAvailable)
+	{
+		VulkanPostProcessingImages& downSampled = postProcessingImages[VulkanPostProcessingType::Downscale];
+		downSampled.allocatedImages.resize(numDownSampleImage);
+		for (u32 i = 0; i < numDownSampleImage; i++)
+		{
+			downSampled.allocatedImages[i] = renderGraph.getImage(downSampleImages[i]);
+		}
 
-	// Create depth buffer image view
-	WillEngine::VulkanUtil::createImageView(logicalDevice, depthImage.image, depthImage.imageView, 1, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+		VulkanPostProcessingImages& upSampled = postProcessingImages[VulkanPostProcessingType::Upscale];
+		upSampled.allocatedImages.resize(numUpSampleImage);
+		for (u32 i = 0; i < numUpSampleImage; i++)
+		{
+			upSampled.allocatedImages[i] = renderGraph.getImage(upSampleImages[i]);
+		}
+	}
+
+	gameState->graphicsState.renderTargetsViewable = viewRenderTargets;
+	gameState->graphicsState.renderGraphMemory = renderGraph.getTransientMemorySize();
+	gameState->graphicsState.renderGraphUnaliasedMemory = renderGraph.getUnaliasedMemorySize();
+	gameState->graphicsState.renderGraphCulledPasses = renderGraph.getNumCulledPasses();
+
+	renderGraphBloom = enableBloom;
+	renderGraphViewRenderTargets = viewRenderTargets;
 }
 
-void VulkanEngine::destroyDepthBuffer(VkDevice& logicalDevice, VmaAllocator& vmaAllocator)
+void VulkanEngine::destroyRenderTargets(VkDevice& logicalDevice)
 {
-	VulkanAllocatedImage& depthImage = framebuffersImages[VulkanFramebufferType::Depth];
-	vkDestroyImageView(logicalDevice, depthImage.imageView, nullptr);
-	vmaDestroyImage(vmaAllocator, depthImage.image, depthImage.allocation);
+	// Descriptors
+	VulkanDescriptorSet& attachmentDescriptorSet = descriptorSets[VulkanDescriptorSetType::Attachment];
+	freeAttachmentDescriptors(logicalDevice, descriptorPool, attachmentDescriptorSet);
+	freeRenderedDescriptors(logicalDevice, descriptorPool);
+	freeComputedImageDescriptors(logicalDevice, descriptorPool);
+
+	// Framebuffers
+	framebuffers[VulkanFramebufferType::Depth].cleanUp(logicalDevice, vmaAllocator);
+	framebuffers[VulkanFramebufferType::Geometry].cleanUp(logicalDevice, vmaAllocator);
+	framebuffers[VulkanFramebufferType::Shading].cleanUp(logicalDevice, vmaAllocator);
+
+	// Images
+	renderGraph.destroy(logicalDevice, vmaAllocator);
+	destroyHiZPyramid(logicalDevice);
+}
+
+void VulkanEngine::createRenderTargets(VkDevice& logicalDevice)
+{
+	// Images
+	buildRenderGraph(logicalDevice);
+
+	// Framebuffers
+	VulkanFramebuffer& depthFramebuffer = framebuffers[VulkanFramebufferType::Depth];
+	VkRenderPass& depthRenderPass = renderPasses[VulkanRenderPassType::Depth];
+	createDepthFramebuffer(logicalDevice, depthFramebuffer.framebuffer, depthRenderPass, sceneExtent);
+
+	createGBuffers(logicalDevice, sceneExtent);
+
+	VulkanFramebuffer& shadingFramebuffer = framebuffers[VulkanFramebufferType::Shading];
+	VkRenderPass& shadingRenderPass = renderPasses[VulkanRenderPassType::Shading];
+	createShadingFramebuffer(logicalDevice, shadingFramebuffer.framebuffer, shadingRenderPass, sceneExtent);
+
+	// Descriptors
+	VulkanDescriptorSet& attachmentDescriptorSet = descriptorSets[VulkanDescriptorSetType::Attachment];
+	initAttachmentDescriptors(logicalDevice, descriptorPool, attachmentDescriptorSet);
+	initRenderedDescriptors(logicalDevice, descriptorPool);
+	initComputedImageDescriptors(logicalDevice, descriptorPool);
+
+	// Built from the new depth buffer
+	createHiZPyramid(logicalDevice);
+}
+
+void VulkanEngine::recreateRenderGraph(VkDevice& logicalDevice)
+{
+	// The frames in flight can still be using the images
+	vkDeviceWaitIdle(logicalDevice);
+
+	destroyRenderTargets(logicalDevice);
+	createRenderTargets(logicalDevice);
 }
 
 void VulkanEngine::createGBuffers(VkDevice& logicalDevice, const VkExtent2D& extent)
 {
+	// The attachments are allocated by the render graph
 	VulkanFramebuffer& offscreenFramebuffer = framebuffers[VulkanFramebufferType::Geometry];
-	offscreenFramebuffer.attachments.resize(VulkanFramebuffer::ATTACHMENT_SIZE);
-
-	// The back buffer
-	// Create offscreen framebuffer attachments
-	WillEngine::VulkanUtil::createFramebufferAttachment(logicalDevice, vmaAllocator, VK_FORMAT_R16G16B16A16_SFLOAT, extent, offscreenFramebuffer.attachments[0]);
-	WillEngine::VulkanUtil::createFramebufferAttachment(logicalDevice, vmaAllocator, VK_FORMAT_R16G16B16A16_SFLOAT, extent, offscreenFramebuffer.attachments[1]);
-	WillEngine::VulkanUtil::createFramebufferAttachment(logicalDevice, vmaAllocator, generalImageFormat, extent, offscreenFramebuffer.attachments[2]);
-	WillEngine::VulkanUtil::createFramebufferAttachment(logicalDevice, vmaAllocator, generalImageFormat, extent, offscreenFramebuffer.attachments[3]);
+	assert(offscreenFramebuffer.attachments.size() == VulkanFramebuffer::ATTACHMENT_SIZE);
 
 	// GBuffers + Depth Buffer
 	const u32 totalAttachmentSize = VulkanFramebuffer::ATTACHMENT_SIZE + 1;
@@ -611,11 +955,11 @@ void VulkanEngine::createGBuffers(VkDevice& logicalDevice, const VkExtent2D& ext
 	VulkanAllocatedImage& depthImage = framebuffersImages[VulkanFramebufferType::Depth];
 
 	VkImageView attachments[totalAttachmentSize]{};
-	attachments[0] = offscreenFramebuffer.attachments[0].imageView;
-	attachments[1] = offscreenFramebuffer.attachments[1].imageView;
-	attachments[2] = offscreenFramebuffer.attachments[2].imageView;
-	attachments[3] = offscreenFramebuffer.attachments[3].imageView;
-	attachments[4] = depthImage.imageView;
+	for (u32 i = 0; i < VulkanFramebuffer::ATTACHMENT_SIZE; i++)
+	{
+		attachments[i] = offscreenFramebuffer.attachments[i].imageView;
+	}
+	attachments[VulkanFramebuffer::ATTACHMENT_SIZE] = depthImage.imageView;
 
 	VkRenderPass& geometryRenderPass = renderPasses[VulkanRenderPassType::Geometry];
 
@@ -699,102 +1043,39 @@ void VulkanEngine::recreateSwapchainFramebuffer(GLFWwindow* window, VkDevice& lo
 	if (formatChanged)
 	{
 		VkRenderPass& depthRenderPass = renderPasses[VulkanRenderPassType::Depth];
+		VkRenderPass& depthLateRenderPass = renderPasses[VulkanRenderPassType::DepthLate];
 		VkRenderPass& geometryRenderPass = renderPasses[VulkanRenderPassType::Geometry];
 		VkRenderPass& shadingRenderPass = renderPasses[VulkanRenderPassType::Shading];
 		VkRenderPass& presentRenderPass = renderPasses[VulkanRenderPassType::Present];
 		createDepthPrePass(logicalDevice, depthRenderPass, depthFormat);
-		createGeometryRenderPass(logicalDevice, geometryRenderPass, VK_FORMAT_R16G16B16A16_SFLOAT, depthFormat);
+		createDepthPrePass(logicalDevice, depthLateRenderPass, depthFormat, true);
+		createGeometryRenderPass(logicalDevice, geometryRenderPass, gBufferFormats, depthFormat);
 		createShadingRenderPass(logicalDevice, shadingRenderPass, generalImageFormat, depthFormat);
 		createPresentRenderPass(logicalDevice, presentRenderPass, swapchainImageFormat);
 	}
 
-	if (extentChanged)
-	{
-		// Destroy the old depth buffer
-		destroyDepthBuffer(logicalDevice, vmaAllocator);
-
-		// Shading
-		VulkanAllocatedImage& shadingImage = framebuffersImages[VulkanFramebufferType::Shading];
-		WillEngine::VulkanUtil::destroyAllocatedImage(logicalDevice, vmaAllocator, shadingImage);
-
-		// Computed
-		destroyImageBuffersForPostProcessing(logicalDevice, vmaAllocator);
-
-		// Free and destroy descriptor sets
-		freeComputedImageDescriptors(logicalDevice, descriptorPool);
-
-		// Stuffs for Imgui
-		vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &gameState->graphicsState.renderedImage.descriptorSet);
-		vkDestroyDescriptorSetLayout(logicalDevice, gameState->graphicsState.renderedImage.layout, nullptr);
-		vkFreeDescriptorSets(logicalDevice, vulkanGui->getDescriptorPool(), 1, &gameState->graphicsState.renderedImage_ImGui);
-	}
-
-
+	// Destroy old framebuffers
+	for (auto presentFramebuffer : presentFramebuffers)
 	{
-		// Destroy old framebuffers
-
-		for (auto presentFramebuffer : presentFramebuffers)
-		{
-			vkDestroyFramebuffer(logicalDevice, presentFramebuffer, nullptr);
-		}
-		presentFramebuffers.clear();
-		
-		for (auto it : framebuffers)
-		{
-			// Exceptions
-			if (it.first == VulkanFramebufferType::ShadowMap)
-			{
-				continue;
-			}
-
-			VulkanFramebuffer& framebuffer = it.second;
-			framebuffer.cleanUp(logicalDevice, vmaAllocator);
-		}
+		vkDestroyFramebuffer(logicalDevice, presentFramebuffer, nullptr);
 	}
+	presentFramebuffers.clear();
 
+	// The render graph images follow the scene extent
+	if (extentChanged || formatChanged)
 	{
-		// Recreate necessary buffers
-
-		// Create a new depth buffer if extent has changed
-		if(extentChanged)
-			createDepthBuffer(logicalDevice, vmaAllocator, sceneExtent);
-
-		// Recreate framebuffers
-		VulkanFramebuffer& depthFramebuffer = framebuffers[VulkanFramebufferType::Depth];
-		VkRenderPass& depthRenderPass = renderPasses[VulkanRenderPassType::Depth];
-		createDepthFramebuffer(logicalDevice, depthFramebuffer.framebuffer, depthRenderPass, sceneExtent);
-
-		// Recreate G-Buffers
-		createGBuffers(logicalDevice, sceneExtent);
-
-		// Recreate framebuffer for shading
-		VulkanFramebuffer& shadingFramebuffer = framebuffers[VulkanFramebufferType::Shading];
-		VkRenderPass& shadingRenderPass = renderPasses[VulkanRenderPassType::Shading];
-		VulkanAllocatedImage& shadingImage = framebuffersImages[VulkanFramebufferType::Shading];
-		WillEngine::VulkanUtil::createShadingImage(logicalDevice, vmaAllocator, generalImageFormat, sceneExtent, shadingImage);
-		createShadingFramebuffer(logicalDevice, shadingFramebuffer.framebuffer, shadingRenderPass, sceneExtent);
-
-		// Recreate image buffers for post procesing
-		createImageBuffersForPostProcessing(logicalDevice, graphicsQueue);
-
-		// Recreate swapchainFramebuffer
-		VulkanFramebuffer& offscreenFramebuffer = framebuffers[VulkanFramebufferType::Geometry];
-		VkRenderPass& geometryRenderPass = renderPasses[VulkanRenderPassType::Geometry];
-		VkRenderPass& presentRenderPass = renderPasses[VulkanRenderPassType::Present];
-		VulkanAllocatedImage& depthImage = framebuffersImages[VulkanFramebufferType::Depth];
-		createSwapchainFramebuffer(logicalDevice, swapchainImageViews, presentFramebuffers, offscreenFramebuffer, geometryRenderPass, presentRenderPass, depthImage.imageView, swapchainExtent);
+		destroyRenderTargets(logicalDevice);
+		createRenderTargets(logicalDevice);
 	}
 
-	if (extentChanged)
-	{
-		// Recreate attachment descriptor sets
-		VulkanDescriptorSet& attachmentDescriptorSet = descriptorSets[VulkanDescriptorSetType::Attachment];
-		initAttachmentDescriptors(logicalDevice, descriptorPool, attachmentDescriptorSet);
-		initRenderedDescriptors(logicalDevice, descriptorPool);
-		initComputedImageDescriptors(logicalDevice, descriptorPool);
+	// Recreate swapchainFramebuffer
+	VulkanFramebuffer& offscreenFramebuffer = framebuffers[VulkanFramebufferType::Geometry];
+	VkRenderPass& geometryRenderPass = renderPasses[VulkanRenderPassType::Geometry];
+	VkRenderPass& presentRenderPass = renderPasses[VulkanRenderPassType::Present];
+	VulkanAllocatedImage& depthImage = framebuffersImages[VulkanFramebufferType::Depth];
+	createSwapchainFramebuffer(logicalDevice, swapchainImageViews, presentFramebuffers, offscreenFramebuffer, geometryRenderPass, presentRenderPass, depthImage.imageView, swapchainExtent);
 
-		sceneExtentChanged = false;
-	}
+	sceneExtentChanged = false;
 }
 
 void VulkanEngine::createShadowFramebuffer(VkDevice& logicalDevice, VkFramebuffer& shadowFramebuffer, VkRenderPass& shadowRenderPass, u32 width, u32 height)
@@ -858,114 +1139,65 @@ void VulkanEngine::createDepthFramebuffer(VkDevice& logicalDevice, VkFramebuffer
 
 }
 
-void VulkanEngine::createImageBuffersForPostProcessing(VkDevice& logicalDevice, VkQueue& graphicsQueue)
+void VulkanEngine::createCommandPool(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface, VkCommandPool& commandPool)
 {
-	VkExtent2D sceneExtentTemp = sceneExtent;
-	VulkanPostProcessingImages& downSampleImages = postProcessingImages[VulkanPostProcessingType::Downscale];
-	downSampleImages.allocatedImages.resize(numDownSampleImage);
-
-	for (u32 i = 0; i < numDownSampleImage; i++)
-	{
-		WillEngine::VulkanUtil::createComputedImage(logicalDevice, vmaAllocator, commandPool, graphicsQueue, generalImageFormat, sceneExtentTemp, downSampleImages.allocatedImages[i]);
-
-		sceneExtentTemp.width /= 2;
-		sceneExtentTemp.height /= 2;
-	}
-
-	sceneExtentTemp = sceneExtent;
-	VulkanPostProcessingImages& upSampleImages = postProcessingImages[VulkanPostProcessingType::Upscale];
-	upSampleImages.allocatedImages.resize(numUpSampleImage);
-	for (u32 i = 0; i < numUpSampleImage; i++)
-	{
-		WillEngine::VulkanUtil::createComputedImage(logicalDevice, vmaAllocator, commandPool, graphicsQueue, generalImageFormat, sceneExtentTemp, upSampleImages.allocatedImages[i]);
-
-		sceneExtentTemp.width /= 2;
-		sceneExtentTemp.height /= 2;
-	}
+	commandPool = WillEngine::VulkanUtil::createCommandPool(logicalDevice, physicalDevice, surface);
 }
 
-void VulkanEngine::destroyImageBuffersForPostProcessing(VkDevice& logicalDevice, VmaAllocator& vmaAllocator)
+void VulkanEngine::createCommandBuffers(VkDevice& logicalDevice, VulkanFrame& frame)
 {
-	VulkanPostProcessingImages& downSampleImages = postProcessingImages[VulkanPostProcessingType::Downscale];
-	for (u32 i = 0; i < numDownSampleImage; i++)
-	{
-		vkDestroyImageView(logicalDevice, downSampleImages.allocatedImages[i].imageView, nullptr);
-		vmaDestroyImage(vmaAllocator, downSampleImages.allocatedImages[i].image, downSampleImages.allocatedImages[i].allocation);
-	}
-	VulkanPostProcessingImages& upSampleImages = postProcessingImages[VulkanPostProcessingType::Upscale];
-	for (u32 i = 0; i < numUpSampleImage; i++)
+	const VulkanCommandBufferType types[] = {
+		VulkanCommandBufferType::UniformUpdate,
+		VulkanCommandBufferType::Cull,
+		VulkanCommandBufferType::Depth,
+		VulkanCommandBufferType::HiZ,
+		VulkanCommandBufferType::LateCull,
+		VulkanCommandBufferType::DepthLate,
+		VulkanCommandBufferType::Shadow,
+		VulkanCommandBufferType::Geometry,
+		VulkanCommandBufferType::Shading,
+		VulkanCommandBufferType::Downscale,
+		VulkanCommandBufferType::Upscale,
+		VulkanCommandBufferType::BlendColor,
+		VulkanCommandBufferType::Present
+	};
+
+	for (VulkanCommandBufferType type : types)
 	{
-		vkDestroyImageView(logicalDevice, upSampleImages.allocatedImages[i].imageView, nullptr);
-		vmaDestroyImage(vmaAllocator, upSampleImages.allocatedImages[i].image, upSampleImages.allocatedImages[i].allocation);
+		frame.commandBuffers[type] = WillEngine::VulkanUtil::createCommandBuffer(logicalDevice, frame.commandPool);
 	}
-}
-
-void VulkanEngine::createCommandPool(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface, VkCommandPool& commandPool)
-{
-	commandPool = WillEngine::VulkanUtil::createCommandPool(logicalDevice, physicalDevice, surface);
-}
 
-void VulkanEngine::createCommandBuffers(VkDevice& logicalDevice)
-{
-	std::vector<VkCommandBuffer>& uniformUpdateBuffers = pipelineCommandBuffers[VulkanCommandBufferType::UniformUpdate];
-	std::vector<VkCommandBuffer>& depthBuffers = pipelineCommandBuffers[VulkanCommandBufferType::Depth];
-	std::vector<VkCommandBuffer>& shadowBuffers = pipelineCommandBuffers[VulkanCommandBufferType::Shadow];
-	std::vector<VkCommandBuffer>& geometryBuffers = pipelineCommandBuffers[VulkanCommandBufferType::Geometry];
-	std::vector<VkCommandBuffer>& shadingBuffers = pipelineCommandBuffers[VulkanCommandBufferType::Shading];
-	std::vector<VkCommandBuffer>& downscaleCommandBuffers = pipelineCommandBuffers[VulkanCommandBufferType::Downscale];
-	std::vector<VkCommandBuffer>& upscaleCommandBuffers = pipelineCommandBuffers[VulkanCommandBufferType::Upscale];
-	std::vector<VkCommandBuffer>& blendColorCommandBuffers = pipelineCommandBuffers[VulkanCommandBufferType::BlendColor];
-	std::vector<VkCommandBuffer>& presentCommandBuffers = pipelineCommandBuffers[VulkanCommandBufferType::Present];
+	if (frame.computeCommandPool == VK_NULL_HANDLE)
+		return;
 
-	uniformUpdateBuffers.resize(NUM_SWAPCHAIN);
-	depthBuffers.resize(NUM_SWAPCHAIN);
-	shadowBuffers.resize(NUM_SWAPCHAIN);
-	geometryBuffers.resize(NUM_SWAPCHAIN);
-	shadingBuffers.resize(NUM_SWAPCHAIN);
-	downscaleCommandBuffers.resize(NUM_SWAPCHAIN);
-	upscaleCommandBuffers.resize(NUM_SWAPCHAIN);
-	blendColorCommandBuffers.resize(NUM_SWAPCHAIN);
-	presentCommandBuffers.resize(NUM_SWAPCHAIN);
+	// Passes the render graph submits to the compute queue
+	const VulkanCommandBufferType computeTypes[] = {
+		VulkanCommandBufferType::Downscale,
+		VulkanCommandBufferType::Upscale,
+		VulkanCommandBufferType::BlendColor
+	};
 
-	for (u32 i = 0; i < NUM_SWAPCHAIN; i++)
+	for (VulkanCommandBufferType type : computeTypes)
 	{
-		uniformUpdateBuffers[i] = WillEngine::VulkanUtil::createCommandBuffer(logicalDevice, commandPool);
-		depthBuffers[i] = WillEngine::VulkanUtil::createCommandBuffer(logicalDevice, commandPool);
-		shadowBuffers[i] = WillEngine::VulkanUtil::createCommandBuffer(logicalDevice, commandPool);
-		geometryBuffers[i] = WillEngine::VulkanUtil::createCommandBuffer(logicalDevice, commandPool);
-		shadingBuffers[i] = WillEngine::VulkanUtil::createCommandBuffer(logicalDevice, commandPool);
-		downscaleCommandBuffers[i] = WillEngine::VulkanUtil::createCommandBuffer(logicalDevice, commandPool);
-		upscaleCommandBuffers[i] = WillEngine::VulkanUtil::createCommandBuffer(logicalDevice, commandPool);
-		blendColorCommandBuffers[i] = WillEngine::VulkanUtil::createCommandBuffer(logicalDevice, commandPool);
-		presentCommandBuffers[i] = WillEngine::VulkanUtil::createCommandBuffer(logicalDevice, commandPool);
+		frame.computeCommandBuffers[type] = WillEngine::VulkanUtil::createCommandBuffer(logicalDevice, frame.computeCommandPool);
 	}
 }
 
-void VulkanEngine::createSecondaryCommandBuffers(VkDevice& logicalDevice)
+void VulkanEngine::createSecondaryCommandBuffers(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface, VulkanFrame& frame)
 {
-	depthMeshBuffers.resize(NUM_SWAPCHAIN);
-	depthSkeletalBuffers.resize(NUM_SWAPCHAIN);
-
-	shadowMeshBuffers.resize(NUM_SWAPCHAIN);
-	shadowSkeletalBuffers.resize(NUM_SWAPCHAIN);
-
-	geometryMeshBuffers.resize(NUM_SWAPCHAIN);
-	geometrySkeletalBuffers.resize(NUM_SWAPCHAIN);
+	frame.workers.resize(std::max(MAX_THREADS, 1u));
 
-	for (u32 i = 0; i < NUM_SWAPCHAIN; i++)
+	for (VulkanWorkerCommandBuffers& worker : frame.workers)
 	{
-		depthMeshBuffers[i] = WillEngine::VulkanUtil::createSecondaryCommandBuffer(logicalDevice, commandPool);
-		depthSkeletalBuffers[i] = WillEngine::VulkanUtil::createSecondaryCommandBuffer(logicalDevice, commandPool);
+		worker.commandPool = WillEngine::VulkanUtil::createCommandPool(logicalDevice, physicalDevice, surface);
 
-		shadowMeshBuffers[i] = WillEngine::VulkanUtil::createSecondaryCommandBuffer(logicalDevice, commandPool);
-		shadowSkeletalBuffers[i] = WillEngine::VulkanUtil::createSecondaryCommandBuffer(logicalDevice, commandPool);
-
-		geometryMeshBuffers[i] = WillEngine::VulkanUtil::createSecondaryCommandBuffer(logicalDevice, commandPool);
-		geometrySkeletalBuffers[i] = WillEngine::VulkanUtil::createSecondaryCommandBuffer(logicalDevice, commandPool);
+		worker.depthBuffer = WillEngine::VulkanUtil::createSecondaryCommandBuffer(logicalDevice, worker.commandPool);
+		worker.shadowBuffer = WillEngine::VulkanUtil::createSecondaryCommandBuffer(logicalDevice, worker.commandPool);
+		worker.geometryBuffer = WillEngine::VulkanUtil::createSecondaryCommandBuffer(logicalDevice, worker.commandPool);
 	}
 }
 
-void VulkanEngine::createSemaphore(VkDevice& logicalDevice)
+void VulkanEngine::createSemaphore(VkDevice& logicalDevice, VulkanFrame& frame)
 {
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -973,7 +1205,7 @@ void VulkanEngine::createSemaphore(VkDevice& logicalDevice)
 	for (u32 i = 0; i <= static_cast<u32>(VulkanSemaphoreType::End); i++)
 	{
 		VulkanSemaphoreType type = static_cast<VulkanSemaphoreType>(i);
-		VkSemaphore& semaphore = semaphores[type];
+		VkSemaphore& semaphore = frame.semaphores[type];
 
 		if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
 		{
@@ -982,90 +1214,205 @@ void VulkanEngine::createSemaphore(VkDevice& logicalDevice)
 	}
 }
 
-void VulkanEngine::createFence(VkDevice& logicalDevice, std::vector<VkFence>& fences, VkFenceCreateFlagBits flag)
+void VulkanEngine::createFence(VkDevice& logicalDevice, VkFence& fence, VkFenceCreateFlagBits flag)
 {
-	fences.resize(NUM_SWAPCHAIN);
-
-	for (u32 i = 0; i < fences.size(); i++)
-	{
-		VkFenceCreateInfo fenceInfo{};
-		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		fenceInfo.flags = flag;
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags = flag;
 
-		if (vkCreateFence(logicalDevice, &fenceInfo, nullptr, &fences[i]) != VK_SUCCESS)
-			throw std::runtime_error("Failed to create fence");
-	}
+	if (vkCreateFence(logicalDevice, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create fence");
 }
 
-void VulkanEngine::createDescriptionPool(VkDevice& logicalDevice)
+void VulkanEngine::createTimelineSemaphore(VkDevice& logicalDevice, VkSemaphore& semaphore)
 {
-	VkDescriptorPoolSize const pools[] = {
-			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2048},
-			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2048}
-	};
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
 
-	VkDescriptorPoolCreateInfo poolInfo{};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.maxSets = 1024;
-	poolInfo.poolSizeCount = sizeof(pools) / sizeof(pools[0]);
-	poolInfo.pPoolSizes = pools;
-	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
 
-	vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &descriptorPool);
+	if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create timeline semaphore");
 }
 
-void VulkanEngine::initUniformBuffer(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool, VulkanAllocatedMemory& uniformBuffer, 
-	VkDescriptorSet& descriptorSet, VkDescriptorSetLayout& descriptorSetLayout, u32 binding, u32 bufferSize, VkShaderStageFlagBits shaderStage)
+void VulkanEngine::createFrames(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface)
 {
-	createUniformBuffer(logicalDevice, uniformBuffer, bufferSize);
+	for (VulkanFrame& frame : frames)
+	{
+		frame.commandPool = WillEngine::VulkanUtil::createCommandPool(logicalDevice, physicalDevice, surface);
+		frame.computeCommandPool = asyncCompute ? WillEngine::VulkanUtil::createCommandPool(logicalDevice, computeQueueFamily) : VK_NULL_HANDLE;
 
-	WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, descriptorSetLayout, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-		shaderStage, binding, 1);
+		createCommandBuffers(logicalDevice, frame);
+		createSecondaryCommandBuffers(logicalDevice, physicalDevice, surface, frame);
+		createSemaphore(logicalDevice, frame);
 
-	WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, descriptorPool, descriptorSetLayout, descriptorSet);
+		// Signaled so the first wait on every frame returns immediately
+		createFence(logicalDevice, frame.fence, VK_FENCE_CREATE_SIGNALED_BIT);
+	}
 
-	WillEngine::VulkanUtil::writeDescriptorSetBuffer(logicalDevice, descriptorSet, uniformBuffer.buffer, binding);
+	currentFrame = 0;
 }
 
-void VulkanEngine::createUniformBuffer(VkDevice& logicalDevice, VulkanAllocatedMemory& uniformBuffer, u32 bufferSize)
+void VulkanEngine::destroyFrames(VkDevice& logicalDevice)
 {
-	uniformBuffer =
-		WillEngine::VulkanUtil::createBuffer(vmaAllocator, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
-}
+	for (VulkanFrame& frame : frames)
+	{
+		flushDeletionQueue(frame);
 
-void VulkanEngine::initDescriptorSets(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool)
+		for (auto it : frame.uniformDescriptorSets)
+		{
+			VulkanDescriptorSet& descriptorSet = it.second;
+
+			if (descriptorSet.descriptorSet != VK_NULL_HANDLE)
+				vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &descriptorSet.descriptorSet);
+
+			if (descriptorSet.buffer.buffer != VK_NULL_HANDLE && descriptorSet.buffer.allocation != VK_NULL_HANDLE)
+				vmaDestroyBuffer(vmaAllocator, descriptorSet.buffer.buffer, descriptorSet.buffer.allocation);
+		}
+
+		if (frame.indirectBuffers.descriptorSet != VK_NULL_HANDLE)
+			vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &frame.indirectBuffers.descriptorSet);
+
+		destroyIndirectBuffers(frame);
+
+		if (frame.instanceBuffer.descriptorSet != VK_NULL_HANDLE)
+			vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &frame.instanceBuffer.descriptorSet);
+
+		destroyInstanceBuffer(frame);
+
+		vkDestroyFence(logicalDevice, frame.fence, nullptr);
+
+		for (auto it : frame.semaphores)
+		{
+			VkSemaphore& semaphore = it.second;
+			vkDestroySemaphore(logicalDevice, semaphore, nullptr);
+		}
+
+		// Destroying the pool frees every command buffer allocated from it
+		vkDestroyCommandPool(logicalDevice, frame.commandPool, nullptr);
+
+		if (frame.computeCommandPool != VK_NULL_HANDLE)
+			vkDestroyCommandPool(logicalDevice, frame.computeCommandPool, nullptr);
+
+		for (VulkanWorkerCommandBuffers& worker : frame.workers)
+		{
+			vkDestroyCommandPool(logicalDevice, worker.commandPool, nullptr);
+		}
+	}
+}
+
+void VulkanEngine::flushDeletionQueue(VulkanFrame& frame)
+{
+	for (auto& deletion : frame.deletionQueue)
+	{
+		deletion();
+	}
+
+	frame.deletionQueue.clear();
+}
+
+void VulkanEngine::createDescriptionPool(VkDevice& logicalDevice)
+{
+	VkDescriptorPoolSize const pools[] = {
+			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2048},
+			{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 256},
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2048},
+			{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 256}
+	};
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1024;
+	poolInfo.poolSizeCount = sizeof(pools) / sizeof(pools[0]);
+	poolInfo.pPoolSizes = pools;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+
+	vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &descriptorPool);
+}
+
+void VulkanEngine::initUniformBuffer(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool, VulkanAllocatedMemory& uniformBuffer, 
+	VkDescriptorSet& descriptorSet, VkDescriptorSetLayout& descriptorSetLayout, u32 binding, u32 bufferSize, VkShaderStageFlagBits shaderStage)
+{
+	createUniformBuffer(logicalDevice, uniformBuffer, bufferSize);
+
+	WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, descriptorSetLayout, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+		shaderStage, binding, 1);
+
+	WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, descriptorPool, descriptorSetLayout, descriptorSet);
+
+	WillEngine::VulkanUtil::writeDescriptorSetBuffer(logicalDevice, descriptorSet, uniformBuffer.buffer, binding);
+}
+
+void VulkanEngine::createUniformBuffer(VkDevice& logicalDevice, VulkanAllocatedMemory& uniformBuffer, u32 bufferSize)
+{
+	uniformBuffer =
+		WillEngine::VulkanUtil::createBuffer(vmaAllocator, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+}
+
+void VulkanEngine::initFrameUniformBuffers(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool, VulkanDescriptorSetType type, u32 binding, u32 bufferSize,
+	VkShaderStageFlagBits shaderStage)
+{
+	VkDescriptorSetLayout& descriptorSetLayout = descriptorSets[type].layout;
+
+	WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, descriptorSetLayout, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, shaderStage, binding, 1);
+
+	for (VulkanFrame& frame : frames)
+	{
+		VulkanDescriptorSet& descriptorSet = frame.uniformDescriptorSets[type];
+
+		createUniformBuffer(logicalDevice, descriptorSet.buffer, bufferSize);
+
+		WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, descriptorPool, descriptorSetLayout, descriptorSet.descriptorSet);
+
+		WillEngine::VulkanUtil::writeDescriptorSetBuffer(logicalDevice, descriptorSet.descriptorSet, descriptorSet.buffer.buffer, binding);
+	}
+}
+
+void VulkanEngine::initDescriptorSets(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool)
 {
-	VulkanDescriptorSet& sceneDescriptorSet = descriptorSets[VulkanDescriptorSetType::Scene];
-	VulkanDescriptorSet& lightDescriptorSet = descriptorSets[VulkanDescriptorSetType::Light];
-	VulkanDescriptorSet& lightMatrixDescriptorSet = descriptorSets[VulkanDescriptorSetType::LightMatrix];
-	VulkanDescriptorSet& cameraDescriptorSet = descriptorSets[VulkanDescriptorSetType::Camera];
-	VulkanDescriptorSet& textureDescriptorSet = descriptorSets[VulkanDescriptorSetType::Texture];
 	VulkanDescriptorSet& skeletalDescriptorSet = descriptorSets[VulkanDescriptorSetType::Skeletal];
+	VulkanDescriptorSet& bakedAnimationDescriptorSet = descriptorSets[VulkanDescriptorSetType::BakedAnimation];
+	VulkanDescriptorSet& instanceDescriptorSet = descriptorSets[VulkanDescriptorSetType::Instance];
+
+	// These uniform buffers are updated every frame, so every frame in flight has its own copy
 
 	// Used in mostly all passes
 	// Scene Descriptors for scene matrix with binding 0 in vertex shader
-	initUniformBuffer(logicalDevice, descriptorPool, sceneDescriptorSet.buffer, sceneDescriptorSet.descriptorSet, sceneDescriptorSet.layout, 0, sizeof(CameraMatrix), VK_SHADER_STAGE_VERTEX_BIT);
+	initFrameUniformBuffers(logicalDevice, descriptorPool, VulkanDescriptorSetType::Scene, 0, sizeof(CameraMatrix), VK_SHADER_STAGE_VERTEX_BIT);
 
 	// For shading phase
 	// Light Descriptors for light with binding 1 in fragment shader
-	initUniformBuffer(logicalDevice, descriptorPool, lightDescriptorSet.buffer, lightDescriptorSet.descriptorSet, lightDescriptorSet.layout, 1, sizeof(LightUniform), VK_SHADER_STAGE_FRAGMENT_BIT);
+	initFrameUniformBuffers(logicalDevice, descriptorPool, VulkanDescriptorSetType::Light, 1, sizeof(LightUniform), VK_SHADER_STAGE_FRAGMENT_BIT);
 
 	// For Shadowing mapping
 	// Light Descriptor for light view projection with binding 2 in geometry shader
-	initUniformBuffer(logicalDevice, descriptorPool, lightMatrixDescriptorSet.buffer, lightMatrixDescriptorSet.descriptorSet, lightMatrixDescriptorSet.layout, 2, sizeof(mat4) * 6,
-		VK_SHADER_STAGE_GEOMETRY_BIT);
+	initFrameUniformBuffers(logicalDevice, descriptorPool, VulkanDescriptorSetType::LightMatrix, 2, sizeof(mat4) * 6, VK_SHADER_STAGE_GEOMETRY_BIT);
 
 	// Camera View Projection
-	// Camera Descriptors for camera position with binding 1 in fragment shader
-	initUniformBuffer(logicalDevice, descriptorPool, cameraDescriptorSet.buffer, cameraDescriptorSet.descriptorSet, cameraDescriptorSet.layout, 1, sizeof(vec4), VK_SHADER_STAGE_FRAGMENT_BIT);
-
-	// Texture Descriptor with binding 1 in fragment shader
-	// We only need to know the layout of the descriptor
-	WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, textureDescriptorSet.layout, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-		VK_SHADER_STAGE_FRAGMENT_BIT, 1, Material::TEXTURE_SIZE);
+	// Camera Descriptors for camera position and inverse view projection with binding 1 in fragment shader
+	initFrameUniformBuffers(logicalDevice, descriptorPool, VulkanDescriptorSetType::Camera, 1, sizeof(CameraUniform), VK_SHADER_STAGE_FRAGMENT_BIT);
 
 	WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, skeletalDescriptorSet.layout, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
 		VK_SHADER_STAGE_VERTEX_BIT, 2, 1);
+
+	// Baked bone matrices with binding 2 in vertex shader
+	// Each baked animation allocates its own descriptor set with this layout
+	WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, bakedAnimationDescriptorSet.layout, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_SHADER_STAGE_VERTEX_BIT, 2, 1);
+
+	// Object data of the instanced mesh draws with binding 0 in vertex shader
+	// The buffers are created and written to the set once the first meshes are drawn
+	WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, instanceDescriptorSet.layout, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_SHADER_STAGE_VERTEX_BIT, 0, 1);
+
+	for (VulkanFrame& frame : frames)
+	{
+		WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, descriptorPool, instanceDescriptorSet.layout, frame.instanceBuffer.descriptorSet);
+	}
 }
 
 void VulkanEngine::initShadowMapDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool, VulkanDescriptorSet& descriptorSet)
@@ -1091,29 +1438,43 @@ void VulkanEngine::initAttachmentDescriptors(VkDevice& logicalDevice, VkDescript
 	VkSampler& attachmentSampler = samplers[VulkanSamplerType::Attachment];
 
 	// Descriptor sets for ImGui UI
+	for (u32 i = 0; i < VulkanFramebuffer::ATTACHMENT_SIZE; i++)
 	{
-		offscreenFramebuffer.attachments[0].imguiTextureDescriptorSet = (VkDescriptorSet)ImGui_ImplVulkan_AddTexture(attachmentSampler, offscreenFramebuffer.attachments[0].imageView,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-		offscreenFramebuffer.attachments[1].imguiTextureDescriptorSet = (VkDescriptorSet)ImGui_ImplVulkan_AddTexture(attachmentSampler, offscreenFramebuffer.attachments[1].imageView,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-		offscreenFramebuffer.attachments[2].imguiTextureDescriptorSet = (VkDescriptorSet)ImGui_ImplVulkan_AddTexture(attachmentSampler, offscreenFramebuffer.attachments[2].imageView,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-		offscreenFramebuffer.attachments[3].imguiTextureDescriptorSet = (VkDescriptorSet)ImGui_ImplVulkan_AddTexture(attachmentSampler, offscreenFramebuffer.attachments[3].imageView,
+		offscreenFramebuffer.attachments[i].imguiTextureDescriptorSet = (VkDescriptorSet)ImGui_ImplVulkan_AddTexture(attachmentSampler, offscreenFramebuffer.attachments[i].imageView,
 			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 	}
 
+	// The G-Buffers followed by the depth buffer
 	WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, descriptorSet.layout, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-		VK_SHADER_STAGE_FRAGMENT_BIT, 2, VulkanFramebuffer::ATTACHMENT_SIZE);
+		VK_SHADER_STAGE_FRAGMENT_BIT, 2, VulkanFramebuffer::ATTACHMENT_SIZE + 1);
 
 	WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, descriptorPool, descriptorSet.layout, descriptorSet.descriptorSet);
 
-	std::vector<VkImageView> imageViews = { offscreenFramebuffer.attachments[0].imageView, offscreenFramebuffer.attachments[1].imageView, offscreenFramebuffer.attachments[2].imageView,
-		offscreenFramebuffer.attachments[3].imageView};
+	std::vector<VkImageView> imageViews;
+	for (u32 i = 0; i < VulkanFramebuffer::ATTACHMENT_SIZE; i++)
+	{
+		imageViews.push_back(offscreenFramebuffer.attachments[i].imageView);
+	}
+	imageViews.push_back(framebuffersImages[VulkanFramebufferType::Depth].imageView);
 
 	WillEngine::VulkanUtil::writeDescriptorSetImage(logicalDevice, descriptorSet.descriptorSet, &attachmentSampler, imageViews.data(),
 		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, imageViews.size());
 }
 
+void VulkanEngine::freeAttachmentDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool, VulkanDescriptorSet& descriptorSet)
+{
+	VulkanFramebuffer& offscreenFramebuffer = framebuffers[VulkanFramebufferType::Geometry];
+
+	// Stuffs for Imgui
+	for (VulkanFramebufferAttachment& attachment : offscreenFramebuffer.attachments)
+	{
+		vkFreeDescriptorSets(logicalDevice, vulkanGui->getDescriptorPool(), 1, &attachment.imguiTextureDescriptorSet);
+	}
+
+	vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &descriptorSet.descriptorSet);
+	vkDestroyDescriptorSetLayout(logicalDevice, descriptorSet.layout, nullptr);
+}
+
 void VulkanEngine::initRenderedDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool)
 {
 	VulkanAllocatedImage& shadingImage = framebuffersImages[VulkanFramebufferType::Shading];
@@ -1134,6 +1495,15 @@ void VulkanEngine::initRenderedDescriptors(VkDevice& logicalDevice, VkDescriptor
 		VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0, 1);
 }
 
+void VulkanEngine::freeRenderedDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool)
+{
+	vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &gameState->graphicsState.renderedImage.descriptorSet);
+	vkDestroyDescriptorSetLayout(logicalDevice, gameState->graphicsState.renderedImage.layout, nullptr);
+
+	// Stuffs for Imgui
+	vkFreeDescriptorSets(logicalDevice, vulkanGui->getDescriptorPool(), 1, &gameState->graphicsState.renderedImage_ImGui);
+}
+
 void VulkanEngine::initComputedImageDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool)
 {
 	VulkanPostProcessingImages& downSampleImages = postProcessingImages[VulkanPostProcessingType::Downscale];
@@ -1145,6 +1515,9 @@ void VulkanEngine::initComputedImageDescriptors(VkDevice& logicalDevice, VkDescr
 	std::array<VulkanDescriptorSet, 7>& upSampledImageDescriptorSetInput = gameState->graphicsState.upSampledImageDescriptorSetInput;
 	std::array<VulkanDescriptorSet, 7>& upSampledImageDescriptorSetOutput = gameState->graphicsState.upSampledImageDescriptorSetOutput;
 
+	// The layouts are needed by the bloom pipelines even if the render graph did not allocate the bloom images
+	const bool allocateSets = gameState->graphicsState.bloomImagesAvailable;
+
 	// Downscale
 	// Output binding
 	for (u32 i = 0; i < downSampledImageDescriptorSetOutput.size(); i++)
@@ -1152,6 +1525,9 @@ void VulkanEngine::initComputedImageDescriptors(VkDevice& logicalDevice, VkDescr
 
 		WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, downSampledImageDescriptorSetOutput[i].layout, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1, 1);
 
+		if (!allocateSets)
+			continue;
+
 		WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, descriptorPool, downSampledImageDescriptorSetOutput[i].layout, downSampledImageDescriptorSetOutput[i].descriptorSet);
 
 		std::vector<VkImageView> imageViews = { downSampleImages.allocatedImages[i].imageView };
@@ -1168,6 +1544,9 @@ void VulkanEngine::initComputedImageDescriptors(VkDevice& logicalDevice, VkDescr
 	{
 		WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, downSampledImageDescriptorSetInput[i].layout, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 0, 1);
 
+		if (!allocateSets)
+			continue;
+
 		WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, descriptorPool, downSampledImageDescriptorSetInput[i].layout, downSampledImageDescriptorSetInput[i].descriptorSet);
 
 		std::vector<VkImageView> imageViews = { downSampleImages.allocatedImages[i].imageView };
@@ -1184,6 +1563,9 @@ void VulkanEngine::initComputedImageDescriptors(VkDevice& logicalDevice, VkDescr
 	{
 		WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, upSampledImageDescriptorSetOutput[i].layout, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1, 1);
 	
+		if (!allocateSets)
+			continue;
+
 		WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, descriptorPool, upSampledImageDescriptorSetOutput[i].layout, upSampledImageDescriptorSetOutput[i].descriptorSet);
 	
 		std::vector<VkImageView> imageViews = { upSampleImages.allocatedImages[i].imageView };
@@ -1200,6 +1582,9 @@ void VulkanEngine::initComputedImageDescriptors(VkDevice& logicalDevice, VkDescr
 	{
 		WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, upSampledImageDescriptorSetInput[i].layout, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 0, 1);
 
+		if (!allocateSets)
+			continue;
+
 		WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, descriptorPool, upSampledImageDescriptorSetInput[i].layout, upSampledImageDescriptorSetInput[i].descriptorSet);
 
 		std::vector<VkImageView> imageViews = { upSampleImages.allocatedImages[i].imageView };
@@ -1213,26 +1598,245 @@ void VulkanEngine::initComputedImageDescriptors(VkDevice& logicalDevice, VkDescr
 
 void VulkanEngine::freeComputedImageDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool)
 {
+	const bool freeSets = gameState->graphicsState.bloomImagesAvailable;
+
 	for (u32 i = 0; i < gameState->graphicsState.downSampledImageDescriptorSetOutput.size(); i++)
 	{
 		// Downscale
 		// Output bindings
-		vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &gameState->graphicsState.downSampledImageDescriptorSetOutput[i].descriptorSet);
+		if (freeSets)
+			vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &gameState->graphicsState.downSampledImageDescriptorSetOutput[i].descriptorSet);
 		vkDestroyDescriptorSetLayout(logicalDevice, gameState->graphicsState.downSampledImageDescriptorSetOutput[i].layout, nullptr);
 		// Input bindings
-		vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &gameState->graphicsState.downSampledImageDescriptorSetInput[i].descriptorSet);
+		if (freeSets)
+			vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &gameState->graphicsState.downSampledImageDescriptorSetInput[i].descriptorSet);
 		vkDestroyDescriptorSetLayout(logicalDevice, gameState->graphicsState.downSampledImageDescriptorSetInput[i].layout, nullptr);
 
 		// Upscale
 		// Output bindings
-		vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &gameState->graphicsState.upSampledImageDescriptorSetOutput[i].descriptorSet);
+		if (freeSets)
+			vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &gameState->graphicsState.upSampledImageDescriptorSetOutput[i].descriptorSet);
 		vkDestroyDescriptorSetLayout(logicalDevice, gameState->graphicsState.upSampledImageDescriptorSetOutput[i].layout, nullptr);
 		// Input bindings
-		vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &gameState->graphicsState.upSampledImageDescriptorSetInput[i].descriptorSet);
+		if (freeSets)
+			vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &gameState->graphicsState.upSampledImageDescriptorSetInput[i].descriptorSet);
 		vkDestroyDescriptorSetLayout(logicalDevice, gameState->graphicsState.upSampledImageDescriptorSetInput[i].layout, nullptr);
 
-		vkFreeDescriptorSets(logicalDevice, vulkanGui->getDescriptorPool(), 1, &gameState->graphicsState.downSampledImage_ImGui[i]);
-		vkFreeDescriptorSets(logicalDevice, vulkanGui->getDescriptorPool(), 1, &gameState->graphicsState.upSampledImage_ImGui[i]);
+		if (freeSets)
+		{
+			vkFreeDescriptorSets(logicalDevice, vulkanGui->getDescriptorPool(), 1, &gameState->graphicsState.downSampledImage_ImGui[i]);
+			vkFreeDescriptorSets(logicalDevice, vulkanGui->getDescriptorPool(), 1, &gameState->graphicsState.upSampledImage_ImGui[i]);
+		}
+	}
+}
+
+void VulkanEngine::initBindlessTextures(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice)
+{
+	// The array can't have more elements than the device allows in an update after bind set
+	VkPhysicalDeviceVulkan12Properties vulkan12Properties{};
+	vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &vulkan12Properties;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+	bindlessTextures.maxTextures = std::min({ MAX_BINDLESS_TEXTURES,
+		vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers, vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		vulkan12Properties.maxDescriptorSetUpdateAfterBindSamplers, vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages });
+
+	VkDescriptorPoolSize const pools[] = {
+			{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1},
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, bindlessTextures.maxTextures}
+	};
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = sizeof(pools) / sizeof(pools[0]);
+	poolInfo.pPoolSizes = pools;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+
+	if (vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &bindlessTextures.descriptorPool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create bindless descriptor pool");
+
+	// Material buffer with binding 0 and texture array with binding 1 in fragment shader
+	VkDescriptorSetLayoutBinding layoutBindings[2]{};
+	layoutBindings[0].binding = 0;
+	layoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	layoutBindings[0].descriptorCount = 1;
+	layoutBindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	layoutBindings[1].binding = 1;
+	layoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	layoutBindings[1].descriptorCount = bindlessTextures.maxTextures;
+	layoutBindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	// Only the elements of loaded textures are written, the others are never read
+	// New textures are written to elements no frame in flight reads while the set stays bound
+	VkDescriptorBindingFlags bindingFlags[2]{};
+	bindingFlags[0] = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+	bindingFlags[1] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+		VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = sizeof(bindingFlags) / sizeof(bindingFlags[0]);
+	bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo descriptorInfo{};
+	descriptorInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptorInfo.pNext = &bindingFlagsInfo;
+	descriptorInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	descriptorInfo.bindingCount = sizeof(layoutBindings) / sizeof(layoutBindings[0]);
+	descriptorInfo.pBindings = layoutBindings;
+
+	if (vkCreateDescriptorSetLayout(logicalDevice, &descriptorInfo, nullptr, &bindlessTextures.layout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create bindless descriptor set layout");
+
+	WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, bindlessTextures.descriptorPool, bindlessTextures.layout, bindlessTextures.descriptorSet);
+
+	createMaterialBuffer(logicalDevice, INITIAL_MATERIAL_CAPACITY);
+}
+
+void VulkanEngine::destroyBindlessTextures(VkDevice& logicalDevice)
+{
+	if (bindlessTextures.materials)
+		vmaUnmapMemory(vmaAllocator, bindlessTextures.materialBuffer.allocation);
+
+	if (bindlessTextures.materialBuffer.buffer != VK_NULL_HANDLE && bindlessTextures.materialBuffer.allocation != VK_NULL_HANDLE)
+		vmaDestroyBuffer(vmaAllocator, bindlessTextures.materialBuffer.buffer, bindlessTextures.materialBuffer.allocation);
+
+	vkDestroyDescriptorSetLayout(logicalDevice, bindlessTextures.layout, nullptr);
+
+	// Frees the descriptor set as well
+	vkDestroyDescriptorPool(logicalDevice, bindlessTextures.descriptorPool, nullptr);
+
+	bindlessTextures = VulkanBindlessTextures{};
+}
+
+void VulkanEngine::addMaterial(VkDevice& logicalDevice, Material* material)
+{
+	if (bindlessTextures.numTextures + Material::TEXTURE_SIZE > bindlessTextures.maxTextures)
+		throw std::runtime_error("Bindless texture array is full");
+
+	// Material ids are never reused, so the buffer is indexed by them
+	if (material->id >= bindlessTextures.materialCapacity)
+		createMaterialBuffer(logicalDevice, std::max(material->id + 1, bindlessTextures.materialCapacity * 2));
+
+	VulkanMaterialData& materialData = bindlessTextures.materials[material->id];
+
+	for (u32 i = 0; i < Material::TEXTURE_SIZE; i++)
+	{
+		TextureDescriptorSet& texture = material->textures[i];
+
+		// The element has never been written, so no frame in flight reads it
+		texture.bindlessIndex = bindlessTextures.numTextures++;
+		writeBindlessTexture(logicalDevice, texture);
+
+		materialData.textures[i] = texture.bindlessIndex;
+	}
+
+	updateMaterialFlags(material);
+}
+
+void VulkanEngine::updateMaterialFlags(Material* material)
+{
+	VulkanMaterialData& materialData = bindlessTextures.materials[material->id];
+
+	// A material without an emissive texture emits its colour, which is black for most materials
+	const vec3 emissive = vec3(material->materialUniform.emissive);
+	const bool isEmissive = material->textures[0].has_texture || glm::any(glm::greaterThan(emissive, vec3(0)));
+
+	materialData.flags = isEmissive ? MATERIAL_EMISSIVE : 0;
+
+	// The memory may not be host coherent
+	vmaFlushAllocation(vmaAllocator, bindlessTextures.materialBuffer.allocation, sizeof(VulkanMaterialData) * material->id, sizeof(VulkanMaterialData));
+}
+
+void VulkanEngine::writeBindlessTexture(VkDevice& logicalDevice, const TextureDescriptorSet& texture)
+{
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.sampler = texture.textureSampler;
+	imageInfo.imageView = texture.imageView;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet writeSet{};
+	writeSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writeSet.dstSet = bindlessTextures.descriptorSet;
+	writeSet.dstBinding = 1;
+	writeSet.dstArrayElement = texture.bindlessIndex;
+	writeSet.descriptorCount = 1;
+	writeSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	writeSet.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(logicalDevice, 1, &writeSet, 0, nullptr);
+}
+
+void VulkanEngine::createMaterialBuffer(VkDevice& logicalDevice, u32 capacity)
+{
+	// Only written when a material is loaded, it stays mapped so a new material is written without a copy
+	VulkanAllocatedMemory materialBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(VulkanMaterialData) * capacity,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	void* materialPtr = nullptr;
+	if (vmaMapMemory(vmaAllocator, materialBuffer.allocation, &materialPtr) != VK_SUCCESS)
+		throw std::runtime_error("Failed to map material buffer");
+
+	VulkanMaterialData* materials = static_cast<VulkanMaterialData*>(materialPtr);
+
+	// Material 0 of the meshes without a material samples the first texture of the array
+	std::memset(materials, 0, sizeof(VulkanMaterialData) * capacity);
+
+	if (bindlessTextures.materials)
+	{
+		// The buffer binding is read by every frame in flight, it can only be rewritten once they have finished
+		// Growing only happens when a model is loaded, so it is not worth keeping the old buffer alive instead
+		vkDeviceWaitIdle(logicalDevice);
+
+		std::memcpy(materials, bindlessTextures.materials, sizeof(VulkanMaterialData) * bindlessTextures.materialCapacity);
+
+		vmaUnmapMemory(vmaAllocator, bindlessTextures.materialBuffer.allocation);
+		vmaDestroyBuffer(vmaAllocator, bindlessTextures.materialBuffer.buffer, bindlessTextures.materialBuffer.allocation);
+	}
+
+	vmaFlushAllocation(vmaAllocator, materialBuffer.allocation, 0, VK_WHOLE_SIZE);
+
+	bindlessTextures.materialBuffer = materialBuffer;
+	bindlessTextures.materials = materials;
+	bindlessTextures.materialCapacity = capacity;
+
+	WillEngine::VulkanUtil::writeDescriptorSetBuffer(logicalDevice, bindlessTextures.descriptorSet, bindlessTextures.materialBuffer.buffer, 0,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+}
+
+void VulkanEngine::initGeometryArenas()
+{
+	// Position, normal, tangent and uv
+	geometryArenas[VulkanGeometryType::Static].init(vmaAllocator, WillEngine::VulkanUtil::createVertexInput(VulkanGeometryType::Static, compressedVertices, false),
+		VulkanGeometryArena::INITIAL_VERTEX_CAPACITY, VulkanGeometryArena::INITIAL_INDEX_CAPACITY);
+
+	// Followed by the bone ids and weights
+	geometryArenas[VulkanGeometryType::Skinned].init(vmaAllocator, WillEngine::VulkanUtil::createVertexInput(VulkanGeometryType::Skinned, compressedVertices, false),
+		VulkanGeometryArena::INITIAL_VERTEX_CAPACITY, VulkanGeometryArena::INITIAL_INDEX_CAPACITY);
+}
+
+void VulkanEngine::destroyGeometryArenas()
+{
+	for (auto& it : geometryArenas)
+	{
+		it.second.destroy(vmaAllocator);
+	}
+
+}
+
+void VulkanEngine::defragmentGeometry(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface, VkQueue& queue)
+{
+	for (auto& it : geometryArenas)
+	{
+		VulkanGeometryArena& geometryArena = it.second;
+
+		if (geometryArena.getFragmentation() > GEOMETRY_DEFRAGMENT_THRESHOLD)
+			geometryArena.defragment(logicalDevice, physicalDevice, vmaAllocator, surface, queue);
 	}
 }
 
@@ -1251,6 +1855,12 @@ void VulkanEngine::initDepthSkeletalPipeline(VkDevice& logicalDevice)
 	VkDescriptorSetLayout depthLayouts[] = { sceneDescriptorSet.layout, skeletalDescriptorSet.layout };
 	u32 depthSkeletalDescriptorSetLayoutSize = sizeof(depthLayouts) / sizeof(depthLayouts[0]);
 
+	// Push constant for the dequantisation of the positions
+	VkPushConstantRange pushConstant{};
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(PushConstantSkinnedMesh);
+	pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
 	u32& idx = pipelineIndexLookup[VulkanPipelineType::DepthSkeletal];
 	idx = pipelines.size();
 
@@ -1258,11 +1868,12 @@ void VulkanEngine::initDepthSkeletalPipeline(VkDevice& logicalDevice)
 
 	VulkanPipeline& pipeline = pipelines[idx];
 
-	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout, depthSkeletalDescriptorSetLayoutSize, depthLayouts, 0, nullptr);
+	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout, depthSkeletalDescriptorSetLayoutSize, depthLayouts, 1, &pushConstant);
 
 	VkRenderPass& depthRenderPass = renderPasses[VulkanRenderPassType::Depth];
 	WillEngine::VulkanUtil::createDepthSkeletalPipeline(logicalDevice, pipeline.pipeline, pipeline.layout, depthRenderPass, vertShader,
-		fragShader, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, sceneExtent);
+		fragShader, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, sceneExtent,
+		WillEngine::VulkanUtil::createVertexInput(VulkanGeometryType::Skinned, compressedVertices, true));
 }
 
 void VulkanEngine::initSkeletalPipeline(VkDevice& logicalDevice)
@@ -1275,13 +1886,18 @@ void VulkanEngine::initSkeletalPipeline(VkDevice& logicalDevice)
 	WillEngine::VulkanUtil::initSkeletalShaderModule(logicalDevice, vertShader, fragShader);
 	
 	VulkanDescriptorSet& sceneDescriptorSet = descriptorSets[VulkanDescriptorSetType::Scene];
-	VulkanDescriptorSet& textureDescriptorSet = descriptorSets[VulkanDescriptorSetType::Texture];
 	VulkanDescriptorSet& skeletalDescriptorSet = descriptorSets[VulkanDescriptorSetType::Skeletal];
 
 	// Create pipeline and pipeline layout
-	VkDescriptorSetLayout layouts[] = { sceneDescriptorSet.layout, textureDescriptorSet.layout, skeletalDescriptorSet.layout };
+	VkDescriptorSetLayout layouts[] = { sceneDescriptorSet.layout, bindlessTextures.layout, skeletalDescriptorSet.layout };
 	u32 descriptorSetLayoutSize = sizeof(layouts) / sizeof(layouts[0]);
 
+	// Push constant for the material and the dequantisation of the positions of the draw
+	VkPushConstantRange pushConstant{};
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(PushConstantSkinnedMesh);
+	pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
 	u32& idx = pipelineIndexLookup[VulkanPipelineType::Skeletal];
 	idx = pipelines.size();
 
@@ -1290,12 +1906,86 @@ void VulkanEngine::initSkeletalPipeline(VkDevice& logicalDevice)
 	VulkanPipeline& pipeline = pipelines[idx];
 
 	// Create deferred pipeline layout with our just created push constant
-	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout, descriptorSetLayoutSize, layouts, 0, nullptr);
+	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout, descriptorSetLayoutSize, layouts, 1, &pushConstant);
 
 	// Create deferred pipeline
 	VkRenderPass& geometryRenderPass = renderPasses[VulkanRenderPassType::Geometry];
 	WillEngine::VulkanUtil::createSkeletalPipeline(logicalDevice, pipeline.pipeline, pipeline.layout,
-		geometryRenderPass, vertShader, fragShader, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, sceneExtent);
+		geometryRenderPass, vertShader, fragShader, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, sceneExtent,
+		WillEngine::VulkanUtil::createVertexInput(VulkanGeometryType::Skinned, compressedVertices, false));
+}
+
+void VulkanEngine::initDepthBakedSkeletalPipeline(VkDevice& logicalDevice)
+{
+	// Set up shader modules
+	VulkanShaderModule& shaderModule = pipelineShaders[VulkanPipelineType::DepthBakedSkeletal];
+	VkShaderModule& vertShader = shaderModule.shaders[VulkanShaderType::Vert];
+	VkShaderModule& fragShader = shaderModule.shaders[VulkanShaderType::Frag];
+
+	WillEngine::VulkanUtil::initDepthBakedSkeletonShaderModule(logicalDevice, vertShader, fragShader);
+
+	VulkanDescriptorSet& sceneDescriptorSet = descriptorSets[VulkanDescriptorSetType::Scene];
+	VulkanDescriptorSet& bakedAnimationDescriptorSet = descriptorSets[VulkanDescriptorSetType::BakedAnimation];
+
+	VkDescriptorSetLayout depthLayouts[] = { sceneDescriptorSet.layout, bakedAnimationDescriptorSet.layout };
+	u32 depthBakedSkeletalDescriptorSetLayoutSize = sizeof(depthLayouts) / sizeof(depthLayouts[0]);
+
+	// Push constant for the animation time and the dequantisation of the positions
+	VkPushConstantRange pushConstant{};
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(PushConstantBakedAnimation);
+	pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	u32& idx = pipelineIndexLookup[VulkanPipelineType::DepthBakedSkeletal];
+	idx = pipelines.size();
+
+	pipelines.push_back(VulkanPipeline{});
+
+	VulkanPipeline& pipeline = pipelines[idx];
+
+	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout, depthBakedSkeletalDescriptorSetLayoutSize, depthLayouts, 1, &pushConstant);
+
+	VkRenderPass& depthRenderPass = renderPasses[VulkanRenderPassType::Depth];
+	WillEngine::VulkanUtil::createDepthSkeletalPipeline(logicalDevice, pipeline.pipeline, pipeline.layout, depthRenderPass, vertShader,
+		fragShader, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, sceneExtent,
+		WillEngine::VulkanUtil::createVertexInput(VulkanGeometryType::Skinned, compressedVertices, true, true));
+}
+
+void VulkanEngine::initBakedSkeletalPipeline(VkDevice& logicalDevice)
+{
+	// Set up shader modules
+	VulkanShaderModule& shaderModule = pipelineShaders[VulkanPipelineType::BakedSkeletal];
+	VkShaderModule& vertShader = shaderModule.shaders[VulkanShaderType::Vert];
+	VkShaderModule& fragShader = shaderModule.shaders[VulkanShaderType::Frag];
+
+	WillEngine::VulkanUtil::initBakedSkeletalShaderModule(logicalDevice, vertShader, fragShader);
+
+	VulkanDescriptorSet& sceneDescriptorSet = descriptorSets[VulkanDescriptorSetType::Scene];
+	VulkanDescriptorSet& bakedAnimationDescriptorSet = descriptorSets[VulkanDescriptorSetType::BakedAnimation];
+
+	// Create pipeline and pipeline layout
+	VkDescriptorSetLayout layouts[] = { sceneDescriptorSet.layout, bindlessTextures.layout, bakedAnimationDescriptorSet.layout };
+	u32 descriptorSetLayoutSize = sizeof(layouts) / sizeof(layouts[0]);
+
+	// Push constant for the animation time, the material and the dequantisation of the positions of the mesh
+	VkPushConstantRange pushConstant{};
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(PushConstantBakedAnimation);
+	pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	u32& idx = pipelineIndexLookup[VulkanPipelineType::BakedSkeletal];
+	idx = pipelines.size();
+
+	pipelines.push_back(VulkanPipeline{});
+
+	VulkanPipeline& pipeline = pipelines[idx];
+
+	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout, descriptorSetLayoutSize, layouts, 1, &pushConstant);
+
+	VkRenderPass& geometryRenderPass = renderPasses[VulkanRenderPassType::Geometry];
+	WillEngine::VulkanUtil::createSkeletalPipeline(logicalDevice, pipeline.pipeline, pipeline.layout,
+		geometryRenderPass, vertShader, fragShader, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, sceneExtent,
+		WillEngine::VulkanUtil::createVertexInput(VulkanGeometryType::Skinned, compressedVertices, false, true));
 }
 
 void VulkanEngine::initGeometryPipeline(VkDevice& logicalDevice)
@@ -1308,20 +1998,13 @@ void VulkanEngine::initGeometryPipeline(VkDevice& logicalDevice)
 	WillEngine::VulkanUtil::initGeometryShaderModule(logicalDevice, vertShader, fragShader);
 
 	VulkanDescriptorSet& sceneDescriptorSet = descriptorSets[VulkanDescriptorSetType::Scene];
-	VulkanDescriptorSet& textureDescriptorSet = descriptorSets[VulkanDescriptorSetType::Texture];
+	VulkanDescriptorSet& instanceDescriptorSet = descriptorSets[VulkanDescriptorSetType::Instance];
 
 	// Create pipeline and pipeline layout
-	VkDescriptorSetLayout layouts[] = { sceneDescriptorSet.layout, textureDescriptorSet.layout };
+	// The model matrix and material are read from the object data of the instance buffer
+	VkDescriptorSetLayout layouts[] = { sceneDescriptorSet.layout, bindlessTextures.layout, instanceDescriptorSet.layout };
 	u32 descriptorSetLayoutSize = sizeof(layouts) / sizeof(layouts[0]);
 
-	VkPushConstantRange pushConstants[1];
-	// Push constant object for model matrix to be used in vertex shader
-	pushConstants[0].offset = 0;
-	pushConstants[0].size = sizeof(mat4);
-	pushConstants[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
-	u32 pushConstantCount = sizeof(pushConstants) / sizeof(pushConstants[0]);
-
 	u32& idx = pipelineIndexLookup[VulkanPipelineType::Geometry];
 	idx = pipelines.size();
 
@@ -1329,14 +2012,15 @@ void VulkanEngine::initGeometryPipeline(VkDevice& logicalDevice)
 
 	VulkanPipeline& pipeline = pipelines[idx];
 
-	// Create deferred pipeline layout with our just created push constant
+	// Create deferred pipeline layout
 	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout,
-		descriptorSetLayoutSize, layouts, pushConstantCount, pushConstants);
+		descriptorSetLayoutSize, layouts, 0, nullptr);
 
 	// Create deferred pipeline
 	VkRenderPass& geometryRenderPass = renderPasses[VulkanRenderPassType::Geometry];
 	WillEngine::VulkanUtil::createGeometryPipeline(logicalDevice, pipeline.pipeline, pipeline.layout,
-		geometryRenderPass, vertShader, fragShader, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, sceneExtent);
+		geometryRenderPass, vertShader, fragShader, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, sceneExtent,
+		WillEngine::VulkanUtil::createVertexInput(VulkanGeometryType::Static, compressedVertices, false));
 }
 
 void VulkanEngine::initDepthPipeline(VkDevice& logicalDevice)
@@ -1350,20 +2034,14 @@ void VulkanEngine::initDepthPipeline(VkDevice& logicalDevice)
 	VkShaderModule& fragShader = shaderModule.shaders[VulkanShaderType::Frag];
 
 	VulkanDescriptorSet& sceneDescriptorSet = descriptorSets[VulkanDescriptorSetType::Scene];
+	VulkanDescriptorSet& instanceDescriptorSet = descriptorSets[VulkanDescriptorSetType::Instance];
 
-	VkDescriptorSetLayout depthLayouts[] = { sceneDescriptorSet.layout };
+	// The model matrix is read from the object data of the instance buffer
+	VkDescriptorSetLayout depthLayouts[] = { sceneDescriptorSet.layout, instanceDescriptorSet.layout };
 	u32 depthDescriptorSetLayoutSize = sizeof(depthLayouts) / sizeof(depthLayouts[0]);
 
 	WillEngine::VulkanUtil::initDepthShaderModule(logicalDevice, vertShader, fragShader);
 
-	VkPushConstantRange pushConstants[1];
-	// Push constant object for model matrix to be used in vertex shader
-	pushConstants[0].offset = 0;
-	pushConstants[0].size = sizeof(mat4);
-	pushConstants[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
-	u32 pushConstantCount = sizeof(pushConstants) / sizeof(pushConstants[0]);
-
 	u32& idx = pipelineIndexLookup[VulkanPipelineType::Depth];
 	idx = pipelines.size();
 
@@ -1371,10 +2049,10 @@ void VulkanEngine::initDepthPipeline(VkDevice& logicalDevice)
 
 	VulkanPipeline& pipeline = pipelines[idx];
 
-	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout, depthDescriptorSetLayoutSize, depthLayouts, pushConstantCount, pushConstants);
+	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout, depthDescriptorSetLayoutSize, depthLayouts, 0, nullptr);
 
 	WillEngine::VulkanUtil::createDepthPipeline(logicalDevice, pipeline.pipeline , pipeline.layout, depthRenderPass, vertShader, fragShader,
-		VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, sceneExtent);
+		VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, sceneExtent, WillEngine::VulkanUtil::createVertexInput(VulkanGeometryType::Static, compressedVertices, true));
 }
 
 void VulkanEngine::initShadowPipeline(VkDevice& logicalDevice)
@@ -1384,7 +2062,7 @@ void VulkanEngine::initShadowPipeline(VkDevice& logicalDevice)
 	// Create an image, imageview and sampler for point light's cube shadow map
 	shadowCubemapImage = WillEngine::VulkanUtil::createImageWithFlags(logicalDevice, vmaAllocator, shadowDepthFormat,
 		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT,
-		1024, 1024, 1, 6);
+		SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1, 6);
 
 	WillEngine::VulkanUtil::createDepthImageView(logicalDevice, shadowCubemapImage.image, shadowCubemapImage.imageView, 6, shadowDepthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 
@@ -1394,20 +2072,16 @@ void VulkanEngine::initShadowPipeline(VkDevice& logicalDevice)
 	// Shadow Framebuffer
 	VulkanFramebuffer& shadowFramebuffer = framebuffers[VulkanFramebufferType::ShadowMap];
 	VkRenderPass& shadowRenderPass = renderPasses[VulkanRenderPassType::Shadow];
-	createShadowFramebuffer(logicalDevice, shadowFramebuffer.framebuffer, shadowRenderPass, 1024, 1024);
+	createShadowFramebuffer(logicalDevice, shadowFramebuffer.framebuffer, shadowRenderPass, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
 
 	VulkanDescriptorSet& lightMatrixDescriptorSet = descriptorSets[VulkanDescriptorSetType::LightMatrix];
 	VulkanDescriptorSet& lightDescriptorSet = descriptorSets[VulkanDescriptorSetType::Light];
+	VulkanDescriptorSet& instanceDescriptorSet = descriptorSets[VulkanDescriptorSetType::Instance];
 
-	VkDescriptorSetLayout layout[] = { lightMatrixDescriptorSet.layout, lightDescriptorSet.layout };
+	// The model matrix is read from the object data of the instance buffer
+	VkDescriptorSetLayout layout[] = { lightMatrixDescriptorSet.layout, lightDescriptorSet.layout, instanceDescriptorSet.layout };
 	u32 layoutSize = sizeof(layout) / sizeof(layout[0]);
 
-	VkPushConstantRange pushConstant[1];
-	pushConstant[0].offset = 0;
-	pushConstant[0].size = sizeof(mat4);
-	pushConstant[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	u32 pushConstantCount = sizeof(pushConstant) / sizeof(pushConstant[0]);
-
 	VulkanShaderModule& shaderModule = pipelineShaders[VulkanPipelineType::Shadow];
 	VkShaderModule& vertShader = shaderModule.shaders[VulkanShaderType::Vert];
 	VkShaderModule& geomShader = shaderModule.shaders[VulkanShaderType::Geom];
@@ -1422,10 +2096,10 @@ void VulkanEngine::initShadowPipeline(VkDevice& logicalDevice)
 
 	VulkanPipeline& pipeline = pipelines[idx];
 
-	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout, layoutSize, layout, pushConstantCount, pushConstant);
+	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout, layoutSize, layout, 0, nullptr);
 
 	WillEngine::VulkanUtil::createShadowPipeline(logicalDevice, pipeline.pipeline, pipeline.layout, shadowRenderPass, vertShader, geomShader,
-		fragShader, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 1024, 1024);
+		fragShader, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, WillEngine::VulkanUtil::createVertexInput(VulkanGeometryType::Static, compressedVertices, true));
 }
 
 void VulkanEngine::initShadingPipeline(VkDevice& logicalDevice)
@@ -1549,17 +2223,253 @@ void VulkanEngine::initBlendColorPipeline(VkDevice& logicalDevice)
 	WillEngine::VulkanUtil::createComputePipeline(logicalDevice, pipeline.pipeline, pipeline.layout, compShader);
 }
 
-void VulkanEngine::initGui(GLFWwindow* window, VkInstance& instance, VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkQueue& queue,
-	VkSurfaceKHR& surface)
+void VulkanEngine::initIndirectDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool)
 {
-	vulkanGui = new VulkanGui();
+	VulkanDescriptorSet& indirectDescriptorSet = descriptorSets[VulkanDescriptorSetType::Indirect];
 
-	std::optional<u32> graphicsFamilyIndicies = WillEngine::VulkanUtil::findQueueFamilies(physicalDevice, VK_QUEUE_GRAPHICS_BIT, VK_NULL_HANDLE);
+	// Objects, draw commands, draw counts and visible objects with binding 0 to 3 in the culling and vertex shaders
+	// Object states, statistics, clusters, the clusters of every batch and the batches of every object with binding 4 to 8 in the culling shader
+	WillEngine::VulkanUtil::createDescriptorSetLayoutBindings(logicalDevice, indirectDescriptorSet.layout, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, 9);
 
-	if (!graphicsFamilyIndicies.has_value())
-		throw std::runtime_error("Failed to get graphics queue family index");
+	// The buffers are created and written to the set once the first objects are drawn
+	for (VulkanFrame& frame : frames)
+	{
+		WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, descriptorPool, indirectDescriptorSet.layout, frame.indirectBuffers.descriptorSet);
+	}
+}
 
-	VkRenderPass& presentRenderPass = renderPasses[VulkanRenderPassType::Present];
+void VulkanEngine::initCullPipeline(VkDevice& logicalDevice)
+{
+	VulkanShaderModule& shaderModule = pipelineShaders[VulkanPipelineType::Cull];
+	VkShaderModule& compShader = shaderModule.shaders[VulkanShaderType::Comp];
+
+	WillEngine::VulkanUtil::initCullShaderModule(logicalDevice, compShader);
+
+	VkDescriptorSetLayout layout[] = { descriptorSets[VulkanDescriptorSetType::Indirect].layout, descriptorSets[VulkanDescriptorSetType::Cull].layout,
+		descriptorSets[VulkanDescriptorSetType::HiZ].layout };
+	u32 layoutSize = sizeof(layout) / sizeof(layout[0]);
+
+	VkPushConstantRange pushConstants[1];
+	// Push constant object for the number of objects and the culling phase
+	pushConstants[0].offset = 0;
+	pushConstants[0].size = sizeof(VulkanCullPhase);
+	pushConstants[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	u32 pushConstantCount = sizeof(pushConstants) / sizeof(pushConstants[0]);
+
+	u32& idx = pipelineIndexLookup[VulkanPipelineType::Cull];
+	idx = pipelines.size();
+
+	pipelines.push_back(VulkanPipeline{});
+
+	VulkanPipeline& pipeline = pipelines[idx];
+
+	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout, layoutSize, layout, pushConstantCount, pushConstants);
+	WillEngine::VulkanUtil::createComputePipeline(logicalDevice, pipeline.pipeline, pipeline.layout, compShader);
+}
+
+void VulkanEngine::initDepthIndirectPipeline(VkDevice& logicalDevice)
+{
+	VulkanShaderModule& shaderModule = pipelineShaders[VulkanPipelineType::DepthIndirect];
+	VkShaderModule& vertShader = shaderModule.shaders[VulkanShaderType::Vert];
+	VkShaderModule& fragShader = shaderModule.shaders[VulkanShaderType::Frag];
+
+	WillEngine::VulkanUtil::initDepthIndirectShaderModule(logicalDevice, vertShader, fragShader);
+
+	VulkanDescriptorSet& sceneDescriptorSet = descriptorSets[VulkanDescriptorSetType::Scene];
+	VulkanDescriptorSet& indirectDescriptorSet = descriptorSets[VulkanDescriptorSetType::Indirect];
+
+	// The model matrix is read from the object buffer instead of a push constant
+	VkDescriptorSetLayout layouts[] = { sceneDescriptorSet.layout, indirectDescriptorSet.layout };
+	u32 layoutSize = sizeof(layouts) / sizeof(layouts[0]);
+
+	u32& idx = pipelineIndexLookup[VulkanPipelineType::DepthIndirect];
+	idx = pipelines.size();
+
+	pipelines.push_back(VulkanPipeline{});
+
+	VulkanPipeline& pipeline = pipelines[idx];
+
+	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout, layoutSize, layouts, 0, nullptr);
+
+	VkRenderPass& depthRenderPass = renderPasses[VulkanRenderPassType::Depth];
+	WillEngine::VulkanUtil::createDepthPipeline(logicalDevice, pipeline.pipeline, pipeline.layout, depthRenderPass, vertShader, fragShader,
+		VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, sceneExtent, WillEngine::VulkanUtil::createVertexInput(VulkanGeometryType::Static, compressedVertices, true));
+}
+
+void VulkanEngine::initGeometryIndirectPipeline(VkDevice& logicalDevice)
+{
+	VulkanShaderModule& shaderModule = pipelineShaders[VulkanPipelineType::GeometryIndirect];
+	VkShaderModule& vertShader = shaderModule.shaders[VulkanShaderType::Vert];
+	VkShaderModule& fragShader = shaderModule.shaders[VulkanShaderType::Frag];
+
+	WillEngine::VulkanUtil::initGeometryIndirectShaderModule(logicalDevice, vertShader, fragShader);
+
+	VulkanDescriptorSet& sceneDescriptorSet = descriptorSets[VulkanDescriptorSetType::Scene];
+	VulkanDescriptorSet& indirectDescriptorSet = descriptorSets[VulkanDescriptorSetType::Indirect];
+
+	VkDescriptorSetLayout layouts[] = { sceneDescriptorSet.layout, bindlessTextures.layout, indirectDescriptorSet.layout };
+	u32 layoutSize = sizeof(layouts) / sizeof(layouts[0]);
+
+	u32& idx = pipelineIndexLookup[VulkanPipelineType::GeometryIndirect];
+	idx = pipelines.size();
+
+	pipelines.push_back(VulkanPipeline{});
+
+	VulkanPipeline& pipeline = pipelines[idx];
+
+	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout, layoutSize, layouts, 0, nullptr);
+
+	VkRenderPass& geometryRenderPass = renderPasses[VulkanRenderPassType::Geometry];
+	WillEngine::VulkanUtil::createGeometryPipeline(logicalDevice, pipeline.pipeline, pipeline.layout,
+		geometryRenderPass, vertShader, fragShader, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, sceneExtent,
+		WillEngine::VulkanUtil::createVertexInput(VulkanGeometryType::Static, compressedVertices, false));
+}
+
+void VulkanEngine::initShadowIndirectPipeline(VkDevice& logicalDevice)
+{
+	VulkanShaderModule& shaderModule = pipelineShaders[VulkanPipelineType::ShadowIndirect];
+	VkShaderModule& vertShader = shaderModule.shaders[VulkanShaderType::Vert];
+	VkShaderModule& geomShader = shaderModule.shaders[VulkanShaderType::Geom];
+	VkShaderModule& fragShader = shaderModule.shaders[VulkanShaderType::Frag];
+
+	WillEngine::VulkanUtil::initShadowIndirectShaderModule(logicalDevice, vertShader, geomShader, fragShader);
+
+	VulkanDescriptorSet& lightMatrixDescriptorSet = descriptorSets[VulkanDescriptorSetType::LightMatrix];
+	VulkanDescriptorSet& lightDescriptorSet = descriptorSets[VulkanDescriptorSetType::Light];
+	VulkanDescriptorSet& indirectDescriptorSet = descriptorSets[VulkanDescriptorSetType::Indirect];
+
+	VkDescriptorSetLayout layout[] = { lightMatrixDescriptorSet.layout, lightDescriptorSet.layout, indirectDescriptorSet.layout };
+	u32 layoutSize = sizeof(layout) / sizeof(layout[0]);
+
+	u32& idx = pipelineIndexLookup[VulkanPipelineType::ShadowIndirect];
+	idx = pipelines.size();
+
+	pipelines.push_back(VulkanPipeline{});
+
+	VulkanPipeline& pipeline = pipelines[idx];
+
+	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout, layoutSize, layout, 0, nullptr);
+
+	VkRenderPass& shadowRenderPass = renderPasses[VulkanRenderPassType::Shadow];
+	WillEngine::VulkanUtil::createShadowPipeline(logicalDevice, pipeline.pipeline, pipeline.layout, shadowRenderPass, vertShader, geomShader,
+		fragShader, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, WillEngine::VulkanUtil::createVertexInput(VulkanGeometryType::Static, compressedVertices, true));
+}
+
+void VulkanEngine::initHiZDescriptors(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool)
+{
+	// Frustum planes and view projection matrices with binding 0 in the culling shader, updated every frame
+	initFrameUniformBuffers(logicalDevice, descriptorPool, VulkanDescriptorSetType::Cull, 0, sizeof(VulkanCullData), VK_SHADER_STAGE_COMPUTE_BIT);
+
+	// The whole pyramid with binding 0 in the culling shader
+	WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, descriptorSets[VulkanDescriptorSetType::HiZ].layout,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 0, 1);
+
+	// The mip being read with binding 0 and the mip being written with binding 1 when the pyramid is built
+	WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, descriptorSets[VulkanDescriptorSetType::HiZInput].layout,
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 0, 1);
+	WillEngine::VulkanUtil::createDescriptorSetLayout(logicalDevice, descriptorSets[VulkanDescriptorSetType::HiZOutput].layout,
+		VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1, 1);
+}
+
+void VulkanEngine::initHiZPipeline(VkDevice& logicalDevice)
+{
+	VulkanShaderModule& shaderModule = pipelineShaders[VulkanPipelineType::HiZ];
+	VkShaderModule& compShader = shaderModule.shaders[VulkanShaderType::Comp];
+
+	WillEngine::VulkanUtil::initHiZShaderModule(logicalDevice, compShader);
+
+	VkDescriptorSetLayout layout[] = { descriptorSets[VulkanDescriptorSetType::HiZInput].layout, descriptorSets[VulkanDescriptorSetType::HiZOutput].layout };
+	u32 layoutSize = sizeof(layout) / sizeof(layout[0]);
+
+	u32& idx = pipelineIndexLookup[VulkanPipelineType::HiZ];
+	idx = pipelines.size();
+
+	pipelines.push_back(VulkanPipeline{});
+
+	VulkanPipeline& pipeline = pipelines[idx];
+
+	WillEngine::VulkanUtil::createPipelineLayout(logicalDevice, pipeline.layout, layoutSize, layout, 0, nullptr);
+	WillEngine::VulkanUtil::createComputePipeline(logicalDevice, pipeline.pipeline, pipeline.layout, compShader);
+}
+
+void VulkanEngine::createHiZPyramid(VkDevice& logicalDevice)
+{
+	// Half the size of the depth buffer, rounded up so every depth texel is covered
+	hiZPyramid.extent.width = std::max(1u, (sceneExtent.width + 1) / 2);
+	hiZPyramid.extent.height = std::max(1u, (sceneExtent.height + 1) / 2);
+	hiZPyramid.numMips = static_cast<u32>(std::floor(std::log2(std::max(hiZPyramid.extent.width, hiZPyramid.extent.height)))) + 1;
+
+	hiZPyramid.image = WillEngine::VulkanUtil::createImage(logicalDevice, vmaAllocator, hiZFormat, VK_IMAGE_USAGE_STORAGE_BIT, hiZPyramid.extent.width,
+		hiZPyramid.extent.height, hiZPyramid.numMips);
+	WillEngine::VulkanUtil::createMipImageView(logicalDevice, hiZPyramid.image.image, hiZPyramid.image.imageView, 0, hiZPyramid.numMips, hiZFormat,
+		VK_IMAGE_ASPECT_COLOR_BIT);
+
+	hiZPyramid.mipViews.resize(hiZPyramid.numMips);
+	hiZPyramid.inputDescriptorSets.resize(hiZPyramid.numMips);
+	hiZPyramid.outputDescriptorSets.resize(hiZPyramid.numMips);
+
+	VkSampler& attachmentSampler = samplers[VulkanSamplerType::Attachment];
+	VulkanAllocatedImage& depthImage = framebuffersImages[VulkanFramebufferType::Depth];
+
+	for (u32 i = 0; i < hiZPyramid.numMips; i++)
+	{
+		WillEngine::VulkanUtil::createMipImageView(logicalDevice, hiZPyramid.image.image, hiZPyramid.mipViews[i], i, 1, hiZFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+
+		// The first mip is built from the depth buffer, every other mip from the mip before
+		VkImageView* inputView = i == 0 ? &depthImage.imageView : &hiZPyramid.mipViews[i - 1];
+
+		WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, descriptorPool, descriptorSets[VulkanDescriptorSetType::HiZInput].layout,
+			hiZPyramid.inputDescriptorSets[i]);
+		WillEngine::VulkanUtil::writeDescriptorSetImage(logicalDevice, hiZPyramid.inputDescriptorSets[i], &attachmentSampler, inputView,
+			VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, 1);
+
+		WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, descriptorPool, descriptorSets[VulkanDescriptorSetType::HiZOutput].layout,
+			hiZPyramid.outputDescriptorSets[i]);
+		WillEngine::VulkanUtil::writeDescriptorSetImage(logicalDevice, hiZPyramid.outputDescriptorSets[i], &attachmentSampler, &hiZPyramid.mipViews[i],
+			VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, 1);
+	}
+
+	WillEngine::VulkanUtil::allocDescriptorSet(logicalDevice, descriptorPool, descriptorSets[VulkanDescriptorSetType::HiZ].layout, hiZPyramid.descriptorSet);
+	WillEngine::VulkanUtil::writeDescriptorSetImage(logicalDevice, hiZPyramid.descriptorSet, &attachmentSampler, &hiZPyramid.image.imageView,
+		VK_IMAGE_LAYOUT_GENERAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, 1);
+
+	hiZPyramid.initialised = false;
+	hiZPyramid.valid = false;
+}
+
+void VulkanEngine::destroyHiZPyramid(VkDevice& logicalDevice)
+{
+	if (hiZPyramid.image.image == VK_NULL_HANDLE)
+		return;
+
+	for (u32 i = 0; i < hiZPyramid.numMips; i++)
+	{
+		vkDestroyImageView(logicalDevice, hiZPyramid.mipViews[i], nullptr);
+		vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &hiZPyramid.inputDescriptorSets[i]);
+		vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &hiZPyramid.outputDescriptorSets[i]);
+	}
+
+	vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &hiZPyramid.descriptorSet);
+
+	vkDestroyImageView(logicalDevice, hiZPyramid.image.imageView, nullptr);
+	vmaDestroyImage(vmaAllocator, hiZPyramid.image.image, hiZPyramid.image.allocation);
+
+	hiZPyramid = VulkanHiZPyramid{};
+}
+
+void VulkanEngine::initGui(GLFWwindow* window, VkInstance& instance, VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkQueue& queue,
+	VkSurfaceKHR& surface)
+{
+	vulkanGui = new VulkanGui();
+
+	std::optional<u32> graphicsFamilyIndicies = WillEngine::VulkanUtil::findQueueFamilies(physicalDevice, VK_QUEUE_GRAPHICS_BIT, VK_NULL_HANDLE);
+
+	if (!graphicsFamilyIndicies.has_value())
+		throw std::runtime_error("Failed to get graphics queue family index");
+
+	VkRenderPass& presentRenderPass = renderPasses[VulkanRenderPassType::Present];
 
 	vulkanGui->init(window, instance, logicalDevice, physicalDevice, surface, graphicsFamilyIndicies.value(), commandPool, descriptorPool, NUM_SWAPCHAIN, presentRenderPass,
 		swapchainExtent);
@@ -1568,9 +2478,37 @@ void VulkanEngine::initGui(GLFWwindow* window, VkInstance& instance, VkDevice& l
 void VulkanEngine::update(GLFWwindow* window, VkInstance& instance, VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR surface,
 	VkQueue graphicsQueue, bool renderWithBRDF)
 {
+	// Resources of this frame were last used FRAMES_IN_FLIGHT frames ago
+	VulkanFrame& frame = frames[currentFrame];
+
+	// Wait for the GPU to finish with this frame's resources
+	// The other frames in flight can still be executing while we record this one
+	if (vkWaitForFences(logicalDevice, 1, &frame.fence, VK_TRUE, std::numeric_limits<u64>::max()) != VK_SUCCESS)
+		throw std::runtime_error("Failed to wait for fences to be available");
+
+	// Destroy the resources released while this frame was in flight
+	flushDeletionQueue(frame);
+
+	// Compact the geometry arenas if the flushed deletions freed any mesh
+	// This happens before anything of this frame is recorded, the wait for the other frame in flight only stalls after a mesh is released
+	if (geometryFreed)
+	{
+		defragmentGeometry(logicalDevice, physicalDevice, surface, graphicsQueue);
+		geometryFreed = false;
+	}
+
+	// Toggling a setting that changes the passes of a frame rebuilds the render graph
+	// The GUI of this frame may still show the old images, so the frame is skipped
+	if (renderGraphBloom != gameState->gameSettings.enableBloom || renderGraphViewRenderTargets != gameState->gameSettings.viewRenderTargets)
+	{
+		recreateRenderGraph(logicalDevice);
+
+		return;
+	}
+
 	// Acquire next image of the swapchain
 	u32 imageIndex = 0;
-	VkSemaphore& imageAvailable = semaphores[VulkanSemaphoreType::ImageAvailable];
+	VkSemaphore& imageAvailable = frame.semaphores[VulkanSemaphoreType::ImageAvailable];
 	const VkResult res = vkAcquireNextImageKHR(logicalDevice, swapchain, std::numeric_limits<u64>::max(), imageAvailable, VK_NULL_HANDLE, &imageIndex);
 
 	if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR || sceneExtentChanged)
@@ -1580,342 +2518,1107 @@ void VulkanEngine::update(GLFWwindow* window, VkInstance& instance, VkDevice& lo
 
 		vkDeviceWaitIdle(logicalDevice);
 
-		recreateSwapchainFramebuffer(window, logicalDevice, physicalDevice, surface, graphicsQueue);
+		recreateSwapchainFramebuffer(window, logicalDevice, physicalDevice, surface, graphicsQueue);
+
+		return;
+	}
+
+	if (res != VK_SUCCESS)
+		throw std::runtime_error("Failed to acquire swapchain image index");
+
+	assert(imageIndex < presentFramebuffers.size());
+
+	// Only reset the fence once we know this frame is going to be submitted
+	if (vkResetFences(logicalDevice, 1, &frame.fence) != VK_SUCCESS)
+		throw std::runtime_error("Failed to reset fence");
+
+	// Reset every primary and secondary command buffer of this frame at once
+	if (vkResetCommandPool(logicalDevice, frame.commandPool, 0) != VK_SUCCESS)
+		throw std::runtime_error("Failed to reset command pool");
+
+	if (frame.computeCommandPool != VK_NULL_HANDLE && vkResetCommandPool(logicalDevice, frame.computeCommandPool, 0) != VK_SUCCESS)
+		throw std::runtime_error("Failed to reset compute command pool");
+
+	for (VulkanWorkerCommandBuffers& worker : frame.workers)
+	{
+		if (vkResetCommandPool(logicalDevice, worker.commandPool, 0) != VK_SUCCESS)
+			throw std::runtime_error("Failed to reset worker command pool");
+	}
+
+	// Initialise skeleton uniform buffer if needed
+	processTodoSkeleton(logicalDevice);
+
+	// Upload baked animations if needed
+	processTodoBakedAnimation(logicalDevice, physicalDevice, surface, graphicsQueue);
+
+	// Every pass of this frame draws the crowds at the same baked frame
+	bakedAnimationTime = glfwGetTime();
+
+	// Swapchain image the UI pass renders to
+	currentImageIndex = imageIndex;
+
+	const bool renderShadow = gameState->graphicsResources.lights[1]->shouldRenderShadow();
+
+	// Binds of the previous frame, its late depth pass was recorded after the worker threads
+	gameState->graphicsState.recordedBinds = numBinds.exchange(0);
+	gameState->graphicsState.skippedBinds = numSkippedBinds.exchange(0);
+
+	// Record the draws of the depth, shadow and geometry passes on the worker threads
+	gatherDrawLists();
+	cullMeshDraws();
+	buildInstancedDraws(renderShadow);
+	updateInstanceBuffer(logicalDevice, frame);
+	occlusionCulling = gameState->gameSettings.enableOcclusionCulling && drawLists.numIndirectObjects > 0;
+	updateIndirectBuffers(logicalDevice, frame);
+	recordSecondaryCommandBuffers(frame, renderShadow);
+
+	// Record the passes of the render graph with the barriers between them
+	// Consecutive passes on the same queue are submitted at once, without a compute queue that is the whole frame
+	std::vector<VulkanRenderGraphBatch> batches;
+	renderGraph.execute(frame, batches);
+
+	VkSemaphore& readyToPresent = frame.semaphores[VulkanSemaphoreType::ReadyToPresent];
+	submitRenderGraphBatches(batches, imageAvailable, readyToPresent, graphicsQueue, frame.fence);
+
+	presentImage(graphicsQueue, readyToPresent, swapchain, imageIndex);
+
+	// Move on to the next frame in flight
+	currentFrame = (currentFrame + 1) % FRAMES_IN_FLIGHT;
+
+	// Update Texture after recording all rendering commands
+	if (gameState->materialUpdateInfo.updateTexture || gameState->materialUpdateInfo.updateColor)
+	{
+		changeMaterialTexture(logicalDevice, physicalDevice, graphicsQueue, gameState);
+		gameState->materialUpdateInfo.textureFilepath = "";
+	}
+}
+
+void VulkanEngine::updateSceneUniform(Camera* camera)
+{
+	// Update camera 
+	sceneMatrix.viewMatrix = camera->getCameraMatrix();
+	sceneMatrix.projectionMatrix = camera->getProjectionMatrix(sceneExtent.width, sceneExtent.height);
+}
+
+void VulkanEngine::updateSkeletonUniform(VkCommandBuffer& commandBuffer)
+{
+	for (auto it = gameState->gameResources.skeletons.begin(); it != gameState->gameResources.skeletons.end(); it++)
+	{
+		Skeleton* skeleton = it->second;
+		BoneUniform& boneUniform = skeleton->boneUniform;
+
+		vkCmdUpdateBuffer(commandBuffer, skeleton->boneUniformBuffers[currentFrame].buffer, 0, sizeof(mat4) * MAX_BONES, &boneUniform);
+	}
+}
+
+void VulkanEngine::updateBakedAnimationInstances(VkCommandBuffer& commandBuffer)
+{
+	for (auto it = gameState->gameResources.bakedAnimations.begin(); it != gameState->gameResources.bakedAnimations.end(); it++)
+	{
+		BakedAnimation* bakedAnimation = it->second;
+
+		bakedAnimation->updateInstanceBuffer(commandBuffer, currentFrame);
+	}
+}
+
+void VulkanEngine::processTodoSkeleton(VkDevice& logicalDevice)
+{
+	while (!skeletonToInitialise.empty())
+	{
+		Skeleton* skeleton = skeletonToInitialise.front();
+
+		// Bone Uniform Buffer
+		// Used for skeletal rendering / animation
+		// Every frame in flight has its own copy as the bones are updated every frame
+		skeleton->boneUniformBuffers.resize(FRAMES_IN_FLIGHT);
+		skeleton->boneDescriptorSets.resize(FRAMES_IN_FLIGHT);
+
+		for (u32 i = 0; i < FRAMES_IN_FLIGHT; i++)
+		{
+			initUniformBuffer(logicalDevice, descriptorPool, skeleton->boneUniformBuffers[i], skeleton->boneDescriptorSets[i].descriptorSet, skeleton->boneDescriptorSets[i].layout,
+				2, sizeof(mat4) * MAX_BONES, VK_SHADER_STAGE_VERTEX_BIT);
+		}
+
+		skeletonToInitialise.pop();
+	}
+}
+
+void VulkanEngine::processTodoBakedAnimation(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface, VkQueue& graphicsQueue)
+{
+	VulkanDescriptorSet& bakedAnimationDescriptorSet = descriptorSets[VulkanDescriptorSetType::BakedAnimation];
+
+	while (!bakedAnimationToInitialise.empty())
+	{
+		BakedAnimation* bakedAnimation = bakedAnimationToInitialise.front();
+
+		// Baked bone matrices and instance buffer
+		// Used for rendering crowds of skinned meshes
+		bakedAnimation->uploadDataToPhysicalDevice(logicalDevice, physicalDevice, vmaAllocator, surface, graphicsQueue, descriptorPool,
+			bakedAnimationDescriptorSet.layout, FRAMES_IN_FLIGHT);
+
+		bakedAnimationToInitialise.pop();
+	}
+}
+
+void VulkanEngine::releaseMesh(VkDevice& logicalDevice, Mesh* mesh)
+{
+	gameState->graphicsResources.meshes.erase(mesh->id);
+
+	deferDeletion([this, logicalDevice, mesh]() mutable
+		{
+			mesh->cleanup(logicalDevice, vmaAllocator);
+			delete mesh;
+
+			geometryFreed = true;
+		});
+}
+
+void VulkanEngine::releaseSkeleton(VkDevice& logicalDevice, Skeleton* skeleton)
+{
+	gameState->gameResources.skeletons.erase(skeleton->id);
+
+	deferDeletion([this, logicalDevice, skeleton]()
+		{
+			// Every frame in flight has its own bone uniform buffer and descriptor set
+			for (u32 i = 0; i < skeleton->boneDescriptorSets.size(); i++)
+			{
+				VulkanDescriptorSet& boneDescriptorSet = skeleton->boneDescriptorSets[i];
+				VulkanAllocatedMemory& boneUniformBuffer = skeleton->boneUniformBuffers[i];
+
+				vkFreeDescriptorSets(logicalDevice, descriptorPool, 1, &boneDescriptorSet.descriptorSet);
+				vkDestroyDescriptorSetLayout(logicalDevice, boneDescriptorSet.layout, nullptr);
+				vmaDestroyBuffer(vmaAllocator, boneUniformBuffer.buffer, boneUniformBuffer.allocation);
+			}
+
+			delete skeleton;
+		});
+}
+
+void VulkanEngine::releaseBakedAnimation(VkDevice& logicalDevice, BakedAnimation* bakedAnimation)
+{
+	gameState->gameResources.bakedAnimations.erase(bakedAnimation->skeletonId);
+
+	deferDeletion([this, logicalDevice, bakedAnimation]() mutable
+		{
+			bakedAnimation->cleanup(logicalDevice, vmaAllocator, descriptorPool);
+			delete bakedAnimation;
+		});
+}
+
+void VulkanEngine::recordUniformUpdate(VkCommandBuffer& commandBuffer)
+{
+	VulkanDescriptorSet& sceneDescriptorSet = frames[currentFrame].uniformDescriptorSets[VulkanDescriptorSetType::Scene];
+	VulkanDescriptorSet& lightDescriptorSet = frames[currentFrame].uniformDescriptorSets[VulkanDescriptorSetType::Light];
+	VulkanDescriptorSet& cameraDescriptorSet = frames[currentFrame].uniformDescriptorSets[VulkanDescriptorSetType::Camera];
+
+	// Update uniform buffers
+	vkCmdUpdateBuffer(commandBuffer, sceneDescriptorSet.buffer.buffer, 0, sizeof(sceneMatrix), &sceneMatrix);
+
+	// Update light uniform buffers
+	vkCmdUpdateBuffer(commandBuffer, lightDescriptorSet.buffer.buffer, 0, sizeof(gameState->graphicsResources.lights[1]->lightUniform), &gameState->graphicsResources.lights[1]->lightUniform);
+
+	vec4 cameraPosition = vec4(camera->position, 1);
+	const mat4 viewProjection = sceneMatrix.projectionMatrix * sceneMatrix.viewMatrix;
+
+	CameraUniform cameraUniform{};
+	cameraUniform.position = cameraPosition;
+	cameraUniform.inverseViewProjection = glm::inverse(viewProjection);
+
+	// Update camera uniform buffers
+	vkCmdUpdateBuffer(commandBuffer, cameraDescriptorSet.buffer.buffer, 0, sizeof(CameraUniform), &cameraUniform);
+
+	// Update culling uniform buffers
+	VulkanDescriptorSet& cullDescriptorSet = frames[currentFrame].uniformDescriptorSets[VulkanDescriptorSetType::Cull];
+
+	VulkanCullData cullData{};
+	cullData.viewProjection = viewProjection;
+	cullData.previousViewProjection = hiZPyramid.viewProjection;
+	cullData.hiZSize = vec4(hiZPyramid.extent.width, hiZPyramid.extent.height, hiZPyramid.numMips, hiZPyramid.valid ? 1.0f : 0.0f);
+	cullData.cameraPosition = cameraPosition;
+	FrustumCuller::getFrustumPlanes(cullData.viewProjection, cullData.frustumPlanes);
+
+	vkCmdUpdateBuffer(commandBuffer, cullDescriptorSet.buffer.buffer, 0, sizeof(VulkanCullData), &cullData);
+
+	// Update all skeleton uniform buffers
+	updateSkeletonUniform(commandBuffer);
+
+	// Update instances of baked animations if they have changed
+	updateBakedAnimationInstances(commandBuffer);
+
+	// Uniform, bone and instance buffers are read by every pass after this
+	recordPassBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+}
+
+void VulkanEngine::gatherDrawLists()
+{
+	drawLists.meshDraws.clear();
+	drawLists.skeletalDraws.clear();
+	drawLists.shadowDraws.clear();
+	drawLists.indirectBatches.clear();
+	drawLists.numIndirectObjects = 0;
+	indirectBatchLookup.clear();
+
+	// A slot not drawn in this frame is handed out again
+	for (VulkanIndirectObjectSlot& slot : indirectObjectSlots)
+	{
+		slot.drawn = false;
+	}
+	drawLists.indirectObjectBatches.assign(indirectObjectSlots.size(), VulkanIndirectObjectBatches{ OBJECT_NO_BATCH, OBJECT_NO_BATCH });
+
+	const bool gpuDrivenRendering = gameState->gameSettings.gpuDrivenRendering;
+
+	// Levels of detail are picked by their error projected to the camera's image and to a face of the shadow cube map
+	// A face covers 90 degrees, so one unit at a distance of one covers half of it
+	const vec3 cameraPosition = camera->position;
+	const f32 cameraPixelsPerUnit = std::abs(sceneMatrix.projectionMatrix[1][1]) * 0.5f * static_cast<f32>(sceneExtent.height);
+	const vec3 lightPosition = gameState->graphicsResources.lights[1]->currentPosition;
+	const f32 shadowPixelsPerUnit = 0.5f * static_cast<f32>(SHADOW_MAP_SIZE);
+	const f32 shadowErrorPixels = LOD_ERROR_PIXELS * gameState->gameSettings.shadowLodBias;
+
+	std::fill(std::begin(gameState->graphicsState.cameraLodDraws), std::end(gameState->graphicsState.cameraLodDraws), 0);
+	std::fill(std::begin(gameState->graphicsState.shadowLodDraws), std::end(gameState->graphicsState.shadowLodDraws), 0);
+
+	// Batch of a level of detail of a mesh, added by the first object drawing it
+	auto getIndirectBatch = [&](Mesh* mesh, u32 meshIndex, u32 lod)
+		{
+			const u64 key = (static_cast<u64>(meshIndex) << 32) | lod;
+
+			auto [batchIt, inserted] = indirectBatchLookup.try_emplace(key, static_cast<u32>(drawLists.indirectBatches.size()));
+			if (inserted)
+				drawLists.indirectBatches.push_back(VulkanIndirectBatch{ mesh, meshIndex, lod, 0, 0, 0, 0 });
+
+			return batchIt->second;
+		};
+
+	for (auto it = gameState->gameResources.entities.begin(); it != gameState->gameResources.entities.end(); it++)
+	{
+		Entity* entity = it->second;
+
+		if (!entity->isEnable)
+			continue;
+
+		MeshComponent* meshComponent = entity->GetComponent<MeshComponent>();
+
+		if (!meshComponent)
+			continue;
+
+		TransformComponent* transformComponent = entity->GetComponent<TransformComponent>();
+
+		// Skinned meshes are drawn with the bones of their skeleton
+		SkeletalComponent* skeletalComp = entity->AnyParentGetComponent<SkeletalComponent>();
+		VkDescriptorSet boneDescriptorSet = VK_NULL_HANDLE;
+
+		if (skeletalComp)
+		{
+			Skeleton* skeleton = gameState->gameResources.skeletons[skeletalComp->skeletalId];
+
+			// The bone uniform buffers have not been created yet
+			if (skeleton->boneDescriptorSets.empty())
+				continue;
+
+			boneDescriptorSet = skeleton->boneDescriptorSets[currentFrame].descriptorSet;
+		}
+
+		// Lights are not casting shadows
+		const bool castShadow = !entity->HasComponent<LightComponent>();
+
+		// Only recomputed if the entity has moved
+		meshComponent->updateWorldBounds(transformComponent, gameState->graphicsResources.meshes);
+		meshComponent->updateTransformationHistory(transformComponent->getWorldTransformation());
+
+		for (u32 i = 0; i < meshComponent->getNumMesh(); i++)
+		{
+			Mesh* mesh = gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]];
+
+			if (!mesh->isReadyToDraw())
+				continue;
+
+			VulkanDrawItem draw{};
+			draw.mesh = mesh;
+			draw.boneDescriptorSet = boneDescriptorSet;
+			draw.transformation = &meshComponent->worldTransformation;
+			draw.previousTransformation = &meshComponent->previousWorldTransformation;
+			draw.worldBoundingSphere = meshComponent->worldBoundingSpheres[i];
+			draw.flags = castShadow ? OBJECT_CAST_SHADOW : 0;
+			draw.materialIndex = meshComponent->materialIndicies[i];
+			draw.meshIndex = meshComponent->meshIndicies[i];
+
+			// Distance from the camera to the front of the bounding sphere
+			const vec4 viewCentre = sceneMatrix.viewMatrix * vec4(vec3(draw.worldBoundingSphere), 1);
+			const f32 depth = std::clamp((-viewCentre.z - draw.worldBoundingSphere.w) / SORT_MAX_DEPTH, 0.0f, 1.0f);
+			draw.depthBucket = static_cast<u32>(depth * ((1u << SORT_DEPTH_BITS) - 1));
+
+			// The shadow may use a coarser level than the camera
+			draw.lod = selectLod(mesh, draw.worldBoundingSphere, cameraPosition, cameraPixelsPerUnit, LOD_ERROR_PIXELS);
+			const u32 shadowLod = selectLod(mesh, draw.worldBoundingSphere, lightPosition, shadowPixelsPerUnit, shadowErrorPixels);
+
+			gameState->graphicsState.cameraLodDraws[draw.lod]++;
+			if (castShadow)
+				gameState->graphicsState.shadowLodDraws[shadowLod]++;
+
+			// Static meshes are culled on the GPU, every object sharing a mesh and level of detail is drawn by the same indirect draw
+			if (gpuDrivenRendering && !skeletalComp)
+			{
+				const u32 batch = getIndirectBatch(mesh, draw.meshIndex, draw.lod);
+				drawLists.indirectBatches[batch].numObjects++;
+
+				// A shadow of another level is drawn by the batch of that level, which needs room for the object as well
+				u32 shadowBatch = batch;
+				if (castShadow && shadowLod != draw.lod)
+				{
+					shadowBatch = getIndirectBatch(mesh, draw.meshIndex, shadowLod);
+					drawLists.indirectBatches[shadowBatch].numObjects++;
+				}
+
+				// The object data stays in the object buffers until the object moves
+				bool moved = false;
+				const u32 slot = getIndirectObjectSlot(meshComponent, transformComponent, i, moved);
+
+				if (moved)
+				{
+					VulkanIndirectObject& object = indirectObjects[slot];
+					object.transformation = *draw.transformation;
+					object.boundingSphere = mesh->boundingSphere;
+					object.flags = draw.flags;
+					object.materialIndex = draw.materialIndex;
+					object.positionOffset = vec4(mesh->positionOffset, 0);
+					object.positionScale = vec4(mesh->positionScale, 0);
+				}
+
+				if (slot >= drawLists.indirectObjectBatches.size())
+					drawLists.indirectObjectBatches.resize(slot + 1, VulkanIndirectObjectBatches{ OBJECT_NO_BATCH, OBJECT_NO_BATCH });
+
+				drawLists.indirectObjectBatches[slot] = VulkanIndirectObjectBatches{ batch, shadowBatch };
+				drawLists.numIndirectObjects++;
+
+				continue;
+			}
+
+			if (skeletalComp)
+				drawLists.skeletalDraws.push_back(draw);
+			else
+				drawLists.meshDraws.push_back(draw);
+
+			if (castShadow)
+			{
+				VulkanDrawItem shadowDraw = draw;
+				shadowDraw.lod = shadowLod;
+				drawLists.shadowDraws.push_back(shadowDraw);
+			}
+		}
+	}
+
+	// Free the slots of the objects that are no longer drawn, e.g. disabled or unloaded
+	for (u32 i = 0; i < indirectObjectSlots.size(); i++)
+	{
+		VulkanIndirectObjectSlot& slot = indirectObjectSlots[i];
+
+		if (slot.drawn || !slot.meshComponent)
+			continue;
+
+		slot.meshComponent = nullptr;
+		freeIndirectObjectSlots.push_back(i);
+	}
+
+	// Keep the draws of a skeleton together so every chunk only binds the bones when the skeleton changes
+	std::stable_sort(drawLists.skeletalDraws.begin(), drawLists.skeletalDraws.end(), [](const VulkanDrawItem& a, const VulkanDrawItem& b)
+		{
+			return a.boneDescriptorSet < b.boneDescriptorSet;
+		});
+
+	sortIndirectBatches();
+
+	// Every cluster of a batch owns a range of the visible object buffer large enough for all of the batch's objects
+	// A level without meshlets is drawn whole as one cluster
+	u32 firstInstance = 0;
+	u32 firstCluster = 0;
+	for (VulkanIndirectBatch& batch : drawLists.indirectBatches)
+	{
+		batch.firstCluster = firstCluster;
+		batch.numClusters = std::max(1u, batch.mesh->getLod(batch.lod).numMeshlets);
+		batch.firstInstance = firstInstance;
+
+		firstCluster += batch.numClusters;
+		firstInstance += batch.numObjects * batch.numClusters;
+	}
+
+	drawLists.numIndirectClusters = firstCluster;
+	drawLists.numIndirectInstances = firstInstance;
+
+	gameState->graphicsState.indirectObjects = drawLists.numIndirectObjects;
+	gameState->graphicsState.indirectBatches = static_cast<u32>(drawLists.indirectBatches.size());
+	gameState->graphicsState.indirectClusters = drawLists.numIndirectClusters;
+}
+
+u32 VulkanEngine::getIndirectObjectSlot(MeshComponent* meshComponent, TransformComponent* transformComponent, u32 meshSlot, bool& moved)
+{
+	std::vector<u32>& slots = meshComponent->indirectObjectSlots;
+
+	if (slots.size() != meshComponent->getNumMesh())
+		slots.resize(meshComponent->getNumMesh(), OBJECT_NO_BATCH);
+
+	// The slot may have been freed and handed to another object while the mesh component was not drawn
+	u32 slotIndex = slots[meshSlot];
+	bool owned = slotIndex < indirectObjectSlots.size() && indirectObjectSlots[slotIndex].meshComponent == meshComponent &&
+		indirectObjectSlots[slotIndex].meshSlot == meshSlot;
+
+	if (!owned)
+	{
+		if (!freeIndirectObjectSlots.empty())
+		{
+			slotIndex = freeIndirectObjectSlots.back();
+			freeIndirectObjectSlots.pop_back();
+		}
+		else
+		{
+			slotIndex = static_cast<u32>(indirectObjectSlots.size());
+			indirectObjectSlots.push_back(VulkanIndirectObjectSlot{});
+			indirectObjects.push_back(VulkanIndirectObject{});
+		}
+
+		slots[meshSlot] = slotIndex;
+	}
+
+	VulkanIndirectObjectSlot& slot = indirectObjectSlots[slotIndex];
+	slot.drawn = true;
+
+	// Every frame in flight has its own object buffer to write the new object data to
+	moved = !owned || slot.worldVersion != transformComponent->getWorldVersion();
+	if (moved)
+	{
+		slot.meshComponent = meshComponent;
+		slot.meshSlot = meshSlot;
+		slot.worldVersion = transformComponent->getWorldVersion();
+		slot.dirtyFrames = (1u << FRAMES_IN_FLIGHT) - 1;
+	}
+
+	return slotIndex;
+}
+
+u32 VulkanEngine::selectLod(const Mesh* mesh, const vec4& worldBoundingSphere, const vec3& viewPosition, f32 pixelsPerUnit, f32 errorPixels) const
+{
+	const u32 numLods = mesh->getNumLods();
+
+	// Debug view of a single level
+	if (gameState->gameSettings.forcedLod >= 0)
+		return std::min(static_cast<u32>(gameState->gameSettings.forcedLod), numLods - 1);
+
+	if (!gameState->gameSettings.enableLods || numLods == 1)
+		return 0;
+
+	// The error scales with the object, the ratio of its world and mesh bounding spheres
+	const f32 scale = mesh->boundingSphere.w > 0.0f ? worldBoundingSphere.w / mesh->boundingSphere.w : 1.0f;
+
+	// The front of the bounding sphere is the closest the surface can be
+	const f32 distance = std::max(glm::length(vec3(worldBoundingSphere) - viewPosition) - worldBoundingSphere.w, LOD_MIN_DISTANCE);
+
+	const f32 pixelsPerMeshUnit = pixelsPerUnit * scale / distance;
+
+	// The coarsest level whose error stays under the threshold, the errors grow with every level
+	u32 lod = 0;
+	for (u32 i = 1; i < numLods; i++)
+	{
+		if (mesh->getLod(i).error * pixelsPerMeshUnit > errorPixels)
+			break;
+
+		lod = i;
+	}
+
+	return lod;
+}
+
+void VulkanEngine::cullMeshDraws()
+{
+	frustumCuller.clear();
+
+	if (!gameState->gameSettings.enableFrustumCulling)
+	{
+		gameState->graphicsState.frustumTestedObjects = 0;
+		gameState->graphicsState.frustumCulledObjects = 0;
+
+		return;
+	}
+
+	// Skinned meshes move away from their bind pose bounds and shadow casters can be behind the camera, so only the mesh draws are culled
+	for (const VulkanDrawItem& draw : drawLists.meshDraws)
+	{
+		frustumCuller.addObject(draw.worldBoundingSphere);
+	}
+
+	frustumCuller.cull(sceneMatrix.projectionMatrix * sceneMatrix.viewMatrix, MAX_THREADS);
+
+	// Keep the visible draws in their original order
+	u32 numVisible = 0;
+	for (u32 i = 0; i < drawLists.meshDraws.size(); i++)
+	{
+		if (frustumCuller.isVisible(i))
+			drawLists.meshDraws[numVisible++] = drawLists.meshDraws[i];
+	}
+	drawLists.meshDraws.resize(numVisible);
+
+	gameState->graphicsState.frustumTestedObjects = frustumCuller.numTested;
+	gameState->graphicsState.frustumCulledObjects = frustumCuller.numCulled;
+}
+
+void VulkanEngine::buildInstancedDraws(bool renderShadow)
+{
+	drawLists.meshInstances.clear();
+	drawLists.shadowInstances.clear();
+	drawLists.instanceDraws.clear();
+
+	// Sort the draws of a pass, then every run of draws with the same mesh and level of detail becomes one instanced draw
+	// The material of every instance is in its object data, so the instances of a draw can use different materials
+	auto appendInstancedDraws = [&](const std::vector<VulkanDrawItem>& draws, VulkanRenderPassType pass, VulkanPipelineType pipeline,
+		std::vector<VulkanInstancedDraw>& instancedDraws)
+		{
+			sortKeys.resize(draws.size());
+			for (u32 i = 0; i < draws.size(); i++)
+			{
+				const VulkanDrawItem& draw = draws[i];
+
+				// The point light renders in every direction, so the distance from the camera does not order the shadow draws
+				const u32 depthBucket = pass == VulkanRenderPassType::Shadow ? 0 : draw.depthBucket;
+
+				sortKeys[i] = getSortKey(pass, pipeline, draw.meshIndex, draw.lod, depthBucket);
+			}
+
+			drawSorter.sort(sortKeys, MAX_THREADS);
+
+			for (u32 index : drawSorter.getOrder())
+			{
+				const VulkanDrawItem& draw = draws[index];
+
+				if (instancedDraws.empty() || instancedDraws.back().mesh != draw.mesh || instancedDraws.back().lod != draw.lod)
+				{
+					const u32 firstInstance = static_cast<u32>(drawLists.instanceDraws.size());
+					instancedDraws.push_back(VulkanInstancedDraw{ draw.mesh, draw.lod, firstInstance, 0 });
+				}
+
+				drawLists.instanceDraws.push_back(&draw);
+				instancedDraws.back().numInstances++;
+			}
+		};
+
+	// The depth and geometry passes draw the same meshes in the same order, so they share their instanced draws
+	appendInstancedDraws(drawLists.meshDraws, VulkanRenderPassType::Geometry, VulkanPipelineType::Geometry, drawLists.meshInstances);
+
+	if (renderShadow)
+		appendInstancedDraws(drawLists.shadowDraws, VulkanRenderPassType::Shadow, VulkanPipelineType::Shadow, drawLists.shadowInstances);
+
+	gameState->graphicsState.instancedMeshes = static_cast<u32>(drawLists.meshDraws.size());
+	gameState->graphicsState.instancedDraws = static_cast<u32>(drawLists.meshInstances.size());
+}
+
+void VulkanEngine::sortIndirectBatches()
+{
+	const u32 numBatches = static_cast<u32>(drawLists.indirectBatches.size());
+
+	if (numBatches == 0)
+		return;
+
+	// The depth pass draws every batch in the same order as the geometry pass
+	sortKeys.resize(numBatches);
+	for (u32 i = 0; i < numBatches; i++)
+	{
+		const VulkanIndirectBatch& batch = drawLists.indirectBatches[i];
+		sortKeys[i] = getSortKey(VulkanRenderPassType::Geometry, VulkanPipelineType::GeometryIndirect, batch.meshIndex, batch.lod, 0);
+	}
+
+	drawSorter.sort(sortKeys, MAX_THREADS);
+	const std::vector<u32>& order = drawSorter.getOrder();
+
+	// New index of every batch
+	std::vector<u32> batchIndices(numBatches);
+	std::vector<VulkanIndirectBatch> sortedBatches(numBatches);
+	for (u32 i = 0; i < numBatches; i++)
+	{
+		sortedBatches[i] = drawLists.indirectBatches[order[i]];
+		batchIndices[order[i]] = i;
+	}
+
+	drawLists.indirectBatches.swap(sortedBatches);
+
+	for (VulkanIndirectObjectBatches& objectBatches : drawLists.indirectObjectBatches)
+	{
+		if (objectBatches.batch == OBJECT_NO_BATCH)
+			continue;
+
+		objectBatches.batch = batchIndices[objectBatches.batch];
+		objectBatches.shadowBatch = batchIndices[objectBatches.shadowBatch];
+	}
+}
+
+u64 VulkanEngine::getSortKey(VulkanRenderPassType pass, VulkanPipelineType pipeline, u32 mesh, u32 lod, u32 depthBucket)
+{
+	// Indices wider than their field wrap around, their draws may then be interleaved with others but are still drawn correctly
+	auto field = [](u64 value, u32 bits)
+		{
+			return value & ((1ull << bits) - 1);
+		};
+
+	u64 key = static_cast<u64>(pass);
+	key = (key << SORT_PIPELINE_BITS) | field(static_cast<u64>(pipeline), SORT_PIPELINE_BITS);
+	key = (key << SORT_MESH_BITS) | field(mesh, SORT_MESH_BITS);
+	key = (key << SORT_LOD_BITS) | field(lod, SORT_LOD_BITS);
+	key = (key << SORT_DEPTH_BITS) | field(depthBucket, SORT_DEPTH_BITS);
+
+	return key;
+}
+
+void VulkanEngine::updateInstanceBuffer(VkDevice& logicalDevice, VulkanFrame& frame)
+{
+	const u32 numInstances = static_cast<u32>(drawLists.instanceDraws.size());
+
+	if (numInstances == 0)
+		return;
+
+	VulkanInstanceBuffer& instanceBuffer = frame.instanceBuffer;
+
+	// The GPU has finished with this frame's buffer, so it can be replaced straight away
+	// It grows to at least twice its size so adding a few meshes does not reallocate every frame
+	if (numInstances > instanceBuffer.capacity)
+	{
+		const u32 capacity = std::max(numInstances, instanceBuffer.capacity * 2);
+
+		destroyInstanceBuffer(frame);
+		createInstanceBuffer(logicalDevice, frame, capacity);
+	}
+
+	// Only use as many threads as there is enough work for
+	const u32 numThreads = std::clamp((numInstances + MIN_INSTANCES_PER_THREAD - 1) / MIN_INSTANCES_PER_THREAD, 1u, std::max(MAX_THREADS, 1u));
+
+	// Every thread writes a range of instances straight into the mapped buffer
+	workerPool.run(numThreads, [&](u32 i)
+		{
+			writeObjectData(instanceBuffer.objects, numInstances * i / numThreads, numInstances * (i + 1) / numThreads);
+		});
+
+	// The memory may not be host coherent
+	vmaFlushAllocation(vmaAllocator, instanceBuffer.buffer.allocation, 0, sizeof(VulkanObjectData) * numInstances);
+}
 
-		return;
+void VulkanEngine::writeObjectData(VulkanObjectData* objects, u32 begin, u32 end)
+{
+	for (u32 i = begin; i < end; i++)
+	{
+		const VulkanDrawItem& draw = *drawLists.instanceDraws[i];
+
+		VulkanObjectData& object = objects[i];
+		object.transformation = *draw.transformation;
+		object.previousTransformation = *draw.previousTransformation;
+		object.materialIndex = draw.materialIndex;
+		object.flags = draw.flags;
+		object.lodTint = getLodTint(draw.lod);
+		object.positionOffset = vec4(draw.mesh->positionOffset, 0);
+		object.positionScale = vec4(draw.mesh->positionScale, 0);
 	}
+}
 
-	if (res != VK_SUCCESS)
-		throw std::runtime_error("Failed to acquire swapchain image index");
+void VulkanEngine::createInstanceBuffer(VkDevice& logicalDevice, VulkanFrame& frame, u32 capacity)
+{
+	VulkanInstanceBuffer& instanceBuffer = frame.instanceBuffer;
 
-	// Wait for command buffer to be available
-	if (vkWaitForFences(logicalDevice, 1, &fences[imageIndex], VK_TRUE, std::numeric_limits<u64>::max()) != VK_SUCCESS)
-		throw std::runtime_error("Failed to wait for fences to be available");
+	// Written by the CPU every frame, it stays mapped so the object data is written without a copy
+	instanceBuffer.buffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(VulkanObjectData) * capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VMA_MEMORY_USAGE_CPU_TO_GPU);
 
-	if (vkResetFences(logicalDevice, 1, &fences[imageIndex]) != VK_SUCCESS)
-		throw std::runtime_error("Failed to reset fence");
+	void* objectPtr = nullptr;
+	if (vmaMapMemory(vmaAllocator, instanceBuffer.buffer.allocation, &objectPtr) != VK_SUCCESS)
+		throw std::runtime_error("Failed to map instance buffer");
 
-	std::vector<VkCommandBuffer>& uniformUpdateBuffers = pipelineCommandBuffers[VulkanCommandBufferType::UniformUpdate];
-	std::vector<VkCommandBuffer>& depthBuffers = pipelineCommandBuffers[VulkanCommandBufferType::Depth];
-	std::vector<VkCommandBuffer>& shadowBuffers = pipelineCommandBuffers[VulkanCommandBufferType::Shadow];
-	std::vector<VkCommandBuffer>& geometryBuffers = pipelineCommandBuffers[VulkanCommandBufferType::Geometry];
-	std::vector<VkCommandBuffer>& shadingBuffers = pipelineCommandBuffers[VulkanCommandBufferType::Shading];
-	std::vector<VkCommandBuffer>& downscaleCommandBuffers = pipelineCommandBuffers[VulkanCommandBufferType::Downscale];
-	std::vector<VkCommandBuffer>& upscaleCommandBuffers = pipelineCommandBuffers[VulkanCommandBufferType::Upscale];
-	std::vector<VkCommandBuffer>& blendColorCommandBuffers = pipelineCommandBuffers[VulkanCommandBufferType::BlendColor];
-	std::vector<VkCommandBuffer>& presentCommandBuffers = pipelineCommandBuffers[VulkanCommandBufferType::Present];
-
-	assert(imageIndex < uniformUpdateBuffers.size());
-	assert(imageIndex < depthBuffers.size());
-	assert(imageIndex < shadowBuffers.size());
-	assert(imageIndex < geometryBuffers.size());
-	assert(imageIndex < shadingBuffers.size());
-	assert(imageIndex < downscaleCommandBuffers.size());
-	assert(imageIndex < upscaleCommandBuffers.size());
-	assert(imageIndex < blendColorCommandBuffers.size());
-	assert(imageIndex < presentCommandBuffers.size());
-	assert(imageIndex < fences.size());
-
-	// Make sure command buffer finishes executing
-	// Primary buffers
-	vkResetCommandBuffer(uniformUpdateBuffers[imageIndex], 0);
-	vkResetCommandBuffer(depthBuffers[imageIndex], 0);
-	vkResetCommandBuffer(shadowBuffers[imageIndex], 0);
-	vkResetCommandBuffer(geometryBuffers[imageIndex], 0);
-	vkResetCommandBuffer(shadingBuffers[imageIndex], 0);
-	vkResetCommandBuffer(downscaleCommandBuffers[imageIndex], 0);
-	vkResetCommandBuffer(upscaleCommandBuffers[imageIndex], 0);
-	vkResetCommandBuffer(blendColorCommandBuffers[imageIndex], 0);
-	vkResetCommandBuffer(presentCommandBuffers[imageIndex], 0);
-	// Secondary buffers
-	vkResetCommandBuffer(depthMeshBuffers[imageIndex], 0);
-	vkResetCommandBuffer(depthSkeletalBuffers[imageIndex], 0);
-	vkResetCommandBuffer(shadowMeshBuffers[imageIndex], 0);
-	vkResetCommandBuffer(shadowSkeletalBuffers[imageIndex], 0);
-	vkResetCommandBuffer(geometryMeshBuffers[imageIndex], 0);
-	vkResetCommandBuffer(geometrySkeletalBuffers[imageIndex], 0);
+	instanceBuffer.objects = static_cast<VulkanObjectData*>(objectPtr);
+	instanceBuffer.capacity = capacity;
 
-	// Initialise skeleton uniform buffer if needed
-	processTodoSkeleton(logicalDevice);
+	WillEngine::VulkanUtil::writeDescriptorSetBuffer(logicalDevice, instanceBuffer.descriptorSet, instanceBuffer.buffer.buffer, 0,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+}
+
+void VulkanEngine::destroyInstanceBuffer(VulkanFrame& frame)
+{
+	VulkanInstanceBuffer& instanceBuffer = frame.instanceBuffer;
 
-	// Updating uniform buffer
-	VkSemaphore& uniformUpdated = semaphores[VulkanSemaphoreType::UniformUpdate];
-	recordUniformUpdate(uniformUpdateBuffers[imageIndex]);
-	submitCommands(1, &uniformUpdateBuffers[imageIndex], 1, &imageAvailable, 1, &uniformUpdated, graphicsQueue, nullptr);
+	if (instanceBuffer.objects)
+		vmaUnmapMemory(vmaAllocator, instanceBuffer.buffer.allocation);
 
-	// Record depth rendering command on thread 1
-	//std::thread t1(&VulkanEngine::recordDepthPrePass, this, std::ref(depthBuffers[imageIndex]), std::ref(depthMeshBuffers[imageIndex]), 
-	//	std::ref(depthSkeletalBuffers[imageIndex]));
+	if (instanceBuffer.buffer.buffer != VK_NULL_HANDLE && instanceBuffer.buffer.allocation != VK_NULL_HANDLE)
+		vmaDestroyBuffer(vmaAllocator, instanceBuffer.buffer.buffer, instanceBuffer.buffer.allocation);
 
-	recordDepthPrePass(depthBuffers[imageIndex], depthMeshBuffers[imageIndex], depthSkeletalBuffers[imageIndex]);
+	instanceBuffer.buffer = VulkanAllocatedMemory{};
+	instanceBuffer.objects = nullptr;
+	instanceBuffer.capacity = 0;
+}
 
-	const bool renderShadow = gameState->graphicsResources.lights[1]->shouldRenderShadow();
+void VulkanEngine::updateIndirectBuffers(VkDevice& logicalDevice, VulkanFrame& frame)
+{
+	// Every object slot, including the free ones between the objects drawn in this frame
+	const u32 numObjects = static_cast<u32>(drawLists.indirectObjectBatches.size());
+	const u32 numBatches = static_cast<u32>(drawLists.indirectBatches.size());
+	const u32 numClusters = drawLists.numIndirectClusters;
+	const u32 numInstances = drawLists.numIndirectInstances;
 
-	// Use thread 2 and thread 3 if we have to render shadows in this frame
-	// Otherwise, just use thread 2
-	if (renderShadow)
-	//if (true)
+	if (drawLists.numIndirectObjects == 0)
 	{
-		//t2 = std::thread(&VulkanEngine::recordShadowPass, this, std::ref(shadowBuffers[imageIndex]));
-		//gameState->graphicsResources.lights[1]->shadowRendered();
+		gameState->graphicsState.occlusionCulledObjects = 0;
+		gameState->graphicsState.occlusionLateObjects = 0;
+		gameState->graphicsState.testedClusters = 0;
+		gameState->graphicsState.culledClusters = 0;
 
-		//t3 = std::thread(&VulkanEngine::recordGeometryPass, this, std::ref(geometryBuffers[imageIndex]), std::ref(geometryMeshBuffers[imageIndex]), 
-		//	std::ref(geometrySkeletalBuffers[imageIndex]));
+		return;
+	}
 
-		recordShadowPass(shadowBuffers[imageIndex]);
-		gameState->graphicsResources.lights[1]->shadowRendered();
+	VulkanIndirectBuffers& indirectBuffers = frame.indirectBuffers;
 
-		recordGeometryPass(geometryBuffers[imageIndex], geometryMeshBuffers[imageIndex], geometrySkeletalBuffers[imageIndex]);
-	}
-	else
+	// The GPU has finished with this frame's buffers, so they can be replaced straight away
+	// They grow to at least twice their size so adding a few objects does not reallocate every frame
+	// The buffers are replaced together, a new object buffer has none of the object data written yet
+	const bool writeAllObjects = numObjects > indirectBuffers.objectCapacity || numBatches > indirectBuffers.batchCapacity ||
+		numClusters > indirectBuffers.clusterCapacity || numInstances > indirectBuffers.instanceCapacity;
+	if (writeAllObjects)
 	{
-		//t2 = std::thread(&VulkanEngine::recordGeometryPass, this, std::ref(geometryBuffers[imageIndex]), std::ref(geometryMeshBuffers[imageIndex]),
-		//	std::ref(geometrySkeletalBuffers[imageIndex]));
-		recordGeometryPass(geometryBuffers[imageIndex], geometryMeshBuffers[imageIndex], geometrySkeletalBuffers[imageIndex]);
+		const u32 objectCapacity = std::max(numObjects, indirectBuffers.objectCapacity * 2);
+		const u32 batchCapacity = std::max(numBatches, indirectBuffers.batchCapacity * 2);
+		const u32 clusterCapacity = std::max(numClusters, indirectBuffers.clusterCapacity * 2);
+		const u32 instanceCapacity = std::max(numInstances, indirectBuffers.instanceCapacity * 2);
+
+		destroyIndirectBuffers(frame);
+		createIndirectBuffers(logicalDevice, frame, objectCapacity, batchCapacity, clusterCapacity, instanceCapacity);
 	}
 
-	// Check if thread 1 has done recording
-	//t1.join();
+	// The statistics were written when this frame was last in flight
+	void* statisticsPtr = nullptr;
+	if (vmaMapMemory(vmaAllocator, indirectBuffers.statisticsBuffer.allocation, &statisticsPtr) != VK_SUCCESS)
+		throw std::runtime_error("Failed to map cull statistics buffer");
 
-	// Submit Depth rendering command
-	VkSemaphore& preDepthFinished = semaphores[VulkanSemaphoreType::PreDepthFinished];
-	submitCommands(1, &depthBuffers[imageIndex], 1, &uniformUpdated, 1, &preDepthFinished, graphicsQueue, nullptr);
+	vmaInvalidateAllocation(vmaAllocator, indirectBuffers.statisticsBuffer.allocation, 0, VK_WHOLE_SIZE);
 
-	// Check if thread 2 has done recording
-	//t2.join();
+	VulkanCullStatistics* statistics = static_cast<VulkanCullStatistics*>(statisticsPtr);
+	gameState->graphicsState.occlusionCulledObjects = statistics->occludedObjects;
+	gameState->graphicsState.occlusionLateObjects = statistics->lateObjects;
+	gameState->graphicsState.testedClusters = statistics->testedClusters;
+	gameState->graphicsState.culledClusters = statistics->culledClusters;
+	*statistics = VulkanCullStatistics{};
 
-	VkSemaphore& geometryFinished = semaphores[VulkanSemaphoreType::GeometryFinished];
+	vmaUnmapMemory(vmaAllocator, indirectBuffers.statisticsBuffer.allocation);
 
-	// If we need to render shadows, submit shadow rendering command
-	// Otherwise, submit geometry rendering commands with a different set of semaphores
-	if (renderShadow)
-	{
-		// Shadow
-		VkSemaphore& shadowFinished = semaphores[VulkanSemaphoreType::ShadowFinished];
-		submitCommands(1, &shadowBuffers[imageIndex], 1, &preDepthFinished, 1, &shadowFinished, graphicsQueue, nullptr);
+	// Objects, only the ones that moved since this frame's object buffer was last written
+	void* objectPtr = nullptr;
+	if (vmaMapMemory(vmaAllocator, indirectBuffers.objectBuffer.allocation, &objectPtr) != VK_SUCCESS)
+		throw std::runtime_error("Failed to map indirect object buffer");
 
-		// Check if thread 3 has done recording
-		//t3.join();
-		// Geometry
-		submitCommands(1, &geometryBuffers[imageIndex], 1, &shadowFinished, 1, &geometryFinished, graphicsQueue, nullptr);
-	}
-	else
+	VulkanIndirectObject* objects = static_cast<VulkanIndirectObject*>(objectPtr);
+	const u32 frameBit = 1u << currentFrame;
+	for (u32 i = 0; i < numObjects; i++)
 	{
-		// Geometry
-		submitCommands(1, &geometryBuffers[imageIndex], 1, &preDepthFinished, 1, &geometryFinished, graphicsQueue, nullptr);
+		VulkanIndirectObjectSlot& slot = indirectObjectSlots[i];
+
+		// Free slots are skipped by the culling shader
+		if (!slot.meshComponent || (!writeAllObjects && !(slot.dirtyFrames & frameBit)))
+			continue;
+
+		objects[i] = indirectObjects[i];
+		slot.dirtyFrames &= ~frameBit;
 	}
 
-	// Record Shading and other commands on the main thread
-	VkSemaphore& renderFinished = semaphores[VulkanSemaphoreType::RenderFinished];
-	recordShadingPass(shadingBuffers[imageIndex]);
-	submitCommands(1, &shadingBuffers[imageIndex], 1, &geometryFinished, 1, &renderFinished, graphicsQueue, nullptr);
+	vmaUnmapMemory(vmaAllocator, indirectBuffers.objectBuffer.allocation);
 
-	VkSemaphore& readyToPresent = semaphores[VulkanSemaphoreType::ReadyToPresent];
+	// Batches of every object slot, the levels of detail are picked every frame
+	void* objectBatchPtr = nullptr;
+	if (vmaMapMemory(vmaAllocator, indirectBuffers.objectBatchBuffer.allocation, &objectBatchPtr) != VK_SUCCESS)
+		throw std::runtime_error("Failed to map indirect object batch buffer");
 
-	if (gameState->gameSettings.enableBloom)
-	{
-		// Record bloom commands if enabled
-		VkSemaphore& downscaleFinished = semaphores[VulkanSemaphoreType::DownscaleFinished];
-		recordDownscaleComputeCommands(downscaleCommandBuffers[imageIndex]);
-		submitCommands(1, &downscaleCommandBuffers[imageIndex], 1, &renderFinished, 1, &downscaleFinished, graphicsQueue, nullptr);
+	memcpy(objectBatchPtr, drawLists.indirectObjectBatches.data(), sizeof(VulkanIndirectObjectBatches) * numObjects);
 
-		VkSemaphore& upscaleFinished = semaphores[VulkanSemaphoreType::UpscaleFinished];
-		recordUpscaleComputeCommands(upscaleCommandBuffers[imageIndex]);
-		submitCommands(1, &upscaleCommandBuffers[imageIndex], 1, &downscaleFinished, 1, &upscaleFinished, graphicsQueue, nullptr);
+	vmaUnmapMemory(vmaAllocator, indirectBuffers.objectBatchBuffer.allocation);
 
-		VkSemaphore& colorBlendFinished = semaphores[VulkanSemaphoreType::ColorBlendFinished];
-		recordBlendColorComputeCommands(blendColorCommandBuffers[imageIndex]);
-		submitCommands(1, &blendColorCommandBuffers[imageIndex], 1, &upscaleFinished, 1, &colorBlendFinished, graphicsQueue, nullptr);
+	// Clusters, draw commands with no instances and the clusters of every batch, the culling shader adds the visible objects
+	// The camera draws come first, the shadow draws and the camera draws of the second culling phase use the second and third part
+	// of the visible object buffer
+	void* clusterPtr = nullptr;
+	if (vmaMapMemory(vmaAllocator, indirectBuffers.clusterBuffer.allocation, &clusterPtr) != VK_SUCCESS)
+		throw std::runtime_error("Failed to map indirect cluster buffer");
 
-		recordUICommands(presentCommandBuffers[imageIndex], presentFramebuffers[imageIndex], swapchainExtent);
-		submitCommands(1, &presentCommandBuffers[imageIndex], 1, &colorBlendFinished, 1, &readyToPresent, graphicsQueue, &fences[imageIndex]);
-	}
-	else
-	{
-		recordUICommands(presentCommandBuffers[imageIndex], presentFramebuffers[imageIndex], swapchainExtent);
-		submitCommands(1, &presentCommandBuffers[imageIndex], 1, &renderFinished, 1, &readyToPresent, graphicsQueue, &fences[imageIndex]);
-	}
+	void* batchPtr = nullptr;
+	if (vmaMapMemory(vmaAllocator, indirectBuffers.batchBuffer.allocation, &batchPtr) != VK_SUCCESS)
+		throw std::runtime_error("Failed to map indirect batch buffer");
 
-	presentImage(graphicsQueue, readyToPresent, swapchain, imageIndex);
+	void* drawCommandPtr = nullptr;
+	if (vmaMapMemory(vmaAllocator, indirectBuffers.drawCommandBuffer.allocation, &drawCommandPtr) != VK_SUCCESS)
+		throw std::runtime_error("Failed to map indirect draw command buffer");
 
-	// Update Texture after recording all rendering commands
-	if (gameState->materialUpdateInfo.updateTexture || gameState->materialUpdateInfo.updateColor)
+	VulkanIndirectCluster* clusters = static_cast<VulkanIndirectCluster*>(clusterPtr);
+	VulkanIndirectBatchClusters* batchClusters = static_cast<VulkanIndirectBatchClusters*>(batchPtr);
+	VkDrawIndexedIndirectCommand* drawCommands = static_cast<VkDrawIndexedIndirectCommand*>(drawCommandPtr);
+	for (u32 i = 0; i < numBatches; i++)
 	{
-		changeMaterialTexture(logicalDevice, physicalDevice, graphicsQueue, gameState);
-		gameState->materialUpdateInfo.textureFilepath = "";
-	}
-}
+		const VulkanIndirectBatch& batch = drawLists.indirectBatches[i];
+		const Mesh* mesh = batch.mesh;
+		const MeshLod lod = mesh->getLod(batch.lod);
 
-void VulkanEngine::updateSceneUniform(Camera* camera)
-{
-	// Update camera 
-	sceneMatrix.viewMatrix = camera->getCameraMatrix();
-	sceneMatrix.projectionMatrix = camera->getProjectionMatrix(sceneExtent.width, sceneExtent.height);
-}
+		batchClusters[i] = VulkanIndirectBatchClusters{ batch.firstCluster, batch.numClusters, getLodTint(batch.lod), 0 };
 
-void VulkanEngine::updateSkeletonUniform(VkCommandBuffer& commandBuffer)
-{
-	for (auto it = gameState->gameResources.skeletons.begin(); it != gameState->gameResources.skeletons.end(); it++)
-	{
-		Skeleton* skeleton = it->second;
-		BoneUniform& boneUniform = skeleton->boneUniform;
+		for (u32 j = 0; j < batch.numClusters; j++)
+		{
+			const u32 clusterIndex = batch.firstCluster + j;
 
-		vkCmdUpdateBuffer(commandBuffer, skeleton->boneUniformBuffer.buffer, 0, sizeof(mat4) * MAX_BONES, &boneUniform);
-	}
-}
+			VulkanIndirectCluster& cluster = clusters[clusterIndex];
 
-void VulkanEngine::processTodoSkeleton(VkDevice& logicalDevice)
-{
-	while (!skeletonToInitialise.empty())
-	{
-		Skeleton* skeleton = skeletonToInitialise.front();
+			VkDrawIndexedIndirectCommand drawCommand{};
+			drawCommand.instanceCount = 0;
+			drawCommand.vertexOffset = static_cast<i32>(mesh->geometryRange.vertexOffset);
+			drawCommand.firstInstance = batch.firstInstance + batch.numObjects * j;
 
-		// Bone Uniform Buffer
-		// Used for skeletal rendering / animation
-		initUniformBuffer(logicalDevice, descriptorPool, skeleton->boneUniformBuffer, skeleton->boneDescriptorSet.descriptorSet, skeleton->boneDescriptorSet.layout, 2,
-			sizeof(mat4) * MAX_BONES, VK_SHADER_STAGE_VERTEX_BIT);
+			if (lod.numMeshlets == 0)
+			{
+				drawCommand.indexCount = lod.numIndices;
+				drawCommand.firstIndex = mesh->geometryRange.firstIndex + lod.firstIndex;
 
-		skeletonToInitialise.pop();
-	}
-}
+				cluster.boundingSphere = mesh->boundingSphere;
+				cluster.coneApex = vec4(0, 0, 0, MESHLET_NO_CONE);
+				cluster.coneAxis = vec4(0, 0, 1, 0);
+			}
+			else
+			{
+				const Meshlet& meshlet = mesh->meshlets[lod.firstMeshlet + j];
 
-void VulkanEngine::recordUniformUpdate(VkCommandBuffer& commandBuffer)
-{
-	VulkanDescriptorSet& sceneDescriptorSet = descriptorSets[VulkanDescriptorSetType::Scene];
-	VulkanDescriptorSet& lightDescriptorSet = descriptorSets[VulkanDescriptorSetType::Light];
-	VulkanDescriptorSet& cameraDescriptorSet = descriptorSets[VulkanDescriptorSetType::Camera];
+				drawCommand.indexCount = meshlet.numIndices;
+				drawCommand.firstIndex = mesh->geometryRange.firstIndex + meshlet.firstIndex;
 
-	// Begin command buffer
-	VkCommandBufferBeginInfo commandBeginInfo{};
-	commandBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	commandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+				cluster.boundingSphere = meshlet.boundingSphere;
+				cluster.coneApex = vec4(meshlet.coneApex, meshlet.coneCutoff);
+				cluster.coneAxis = vec4(meshlet.coneAxis, 0);
+			}
 
-	if (vkBeginCommandBuffer(commandBuffer, &commandBeginInfo) != VK_SUCCESS)
-		throw std::runtime_error("Failed to begin command buffer");
+			drawCommands[clusterIndex] = drawCommand;
 
-	// Update uniform buffers
-	vkCmdUpdateBuffer(commandBuffer, sceneDescriptorSet.buffer.buffer, 0, sizeof(sceneMatrix), &sceneMatrix);
+			drawCommand.firstInstance += numInstances;
+			drawCommands[numClusters + clusterIndex] = drawCommand;
 
-	// Update light uniform buffers
-	vkCmdUpdateBuffer(commandBuffer, lightDescriptorSet.buffer.buffer, 0, sizeof(gameState->graphicsResources.lights[1]->lightUniform), &gameState->graphicsResources.lights[1]->lightUniform);
+			drawCommand.firstInstance += numInstances;
+			drawCommands[numClusters * 2 + clusterIndex] = drawCommand;
+		}
+	}
 
-	vec4 cameraPosition = vec4(camera->position, 1);
+	vmaUnmapMemory(vmaAllocator, indirectBuffers.clusterBuffer.allocation);
+	vmaUnmapMemory(vmaAllocator, indirectBuffers.batchBuffer.allocation);
+	vmaUnmapMemory(vmaAllocator, indirectBuffers.drawCommandBuffer.allocation);
 
-	// Update camera uniform buffers
-	vkCmdUpdateBuffer(commandBuffer, cameraDescriptorSet.buffer.buffer, 0, sizeof(vec4), &cameraPosition);
+	// Draw counts
+	void* drawCountPtr = nullptr;
+	if (vmaMapMemory(vmaAllocator, indirectBuffers.drawCountBuffer.allocation, &drawCountPtr) != VK_SUCCESS)
+		throw std::runtime_error("Failed to map indirect draw count buffer");
 
-	// Update all skeleton uniform buffers
-	updateSkeletonUniform(commandBuffer);
+	memset(drawCountPtr, 0, sizeof(u32) * numBatches * 3);
 
-	// End command buffer
-	vkEndCommandBuffer(commandBuffer);
+	vmaUnmapMemory(vmaAllocator, indirectBuffers.drawCountBuffer.allocation);
+
+	// The memory may not be host coherent
+	vmaFlushAllocation(vmaAllocator, indirectBuffers.objectBuffer.allocation, 0, VK_WHOLE_SIZE);
+	vmaFlushAllocation(vmaAllocator, indirectBuffers.objectBatchBuffer.allocation, 0, VK_WHOLE_SIZE);
+	vmaFlushAllocation(vmaAllocator, indirectBuffers.clusterBuffer.allocation, 0, VK_WHOLE_SIZE);
+	vmaFlushAllocation(vmaAllocator, indirectBuffers.batchBuffer.allocation, 0, VK_WHOLE_SIZE);
+	vmaFlushAllocation(vmaAllocator, indirectBuffers.drawCommandBuffer.allocation, 0, VK_WHOLE_SIZE);
+	vmaFlushAllocation(vmaAllocator, indirectBuffers.drawCountBuffer.allocation, 0, VK_WHOLE_SIZE);
+	vmaFlushAllocation(vmaAllocator, indirectBuffers.statisticsBuffer.allocation, 0, VK_WHOLE_SIZE);
 }
 
-void VulkanEngine::recordMeshSecondaryCommandBuffer(VkCommandBuffer& commandBuffer, VkRenderPass& renderPass, VkFramebuffer& framebuffer, VkPipeline& pipeline,
-	VkPipelineLayout& pipelineLayout)
+void VulkanEngine::createIndirectBuffers(VkDevice& logicalDevice, VulkanFrame& frame, u32 objectCapacity, u32 batchCapacity, u32 clusterCapacity,
+	u32 instanceCapacity)
 {
-	VulkanDescriptorSet& sceneDescriptorSet = descriptorSets[VulkanDescriptorSetType::Scene];
-
-	VkCommandBufferInheritanceInfo inheritInfo{};
-	inheritInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
-	inheritInfo.renderPass = renderPass;
-	inheritInfo.subpass = 0;
-	inheritInfo.framebuffer = framebuffer;
-	inheritInfo.occlusionQueryEnable = VK_FALSE;
+	VulkanIndirectBuffers& indirectBuffers = frame.indirectBuffers;
+
+	// Written by the CPU when an object moves
+	indirectBuffers.objectBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(VulkanIndirectObject) * objectCapacity,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	// Written by the CPU every frame
+	indirectBuffers.objectBatchBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(VulkanIndirectObjectBatches) * objectCapacity,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	indirectBuffers.clusterBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(VulkanIndirectCluster) * clusterCapacity,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	indirectBuffers.batchBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(VulkanIndirectBatchClusters) * batchCapacity,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	// Written by the CPU every frame and incremented by the culling shader
+	// Every cluster has a camera draw for each culling phase and a shadow draw
+	indirectBuffers.drawCommandBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(VkDrawIndexedIndirectCommand) * clusterCapacity * 3,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	indirectBuffers.drawCountBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(u32) * batchCapacity * 3,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	// Only touched by the GPU, every object can be visible to the camera in either phase and the shadow in every cluster of its batch
+	indirectBuffers.visibleObjectBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(u32) * instanceCapacity * 3,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+	indirectBuffers.objectStateBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(u32) * objectCapacity,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+	// Reset by the CPU every frame and read back once the frame has finished
+	indirectBuffers.statisticsBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, sizeof(VulkanCullStatistics),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+
+	// The statistics are read before the first frame culls with this buffer, so they start at zero
+	void* statisticsPtr = nullptr;
+	if (vmaMapMemory(vmaAllocator, indirectBuffers.statisticsBuffer.allocation, &statisticsPtr) != VK_SUCCESS)
+		throw std::runtime_error("Failed to map cull statistics buffer");
+
+	*static_cast<VulkanCullStatistics*>(statisticsPtr) = VulkanCullStatistics{};
+
+	vmaFlushAllocation(vmaAllocator, indirectBuffers.statisticsBuffer.allocation, 0, VK_WHOLE_SIZE);
+	vmaUnmapMemory(vmaAllocator, indirectBuffers.statisticsBuffer.allocation);
+
+	indirectBuffers.objectCapacity = objectCapacity;
+	indirectBuffers.batchCapacity = batchCapacity;
+	indirectBuffers.clusterCapacity = clusterCapacity;
+	indirectBuffers.instanceCapacity = instanceCapacity;
+
+	WillEngine::VulkanUtil::writeDescriptorSetBuffer(logicalDevice, indirectBuffers.descriptorSet, indirectBuffers.objectBuffer.buffer, 0,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+	WillEngine::VulkanUtil::writeDescriptorSetBuffer(logicalDevice, indirectBuffers.descriptorSet, indirectBuffers.drawCommandBuffer.buffer, 1,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+	WillEngine::VulkanUtil::writeDescriptorSetBuffer(logicalDevice, indirectBuffers.descriptorSet, indirectBuffers.drawCountBuffer.buffer, 2,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+	WillEngine::VulkanUtil::writeDescriptorSetBuffer(logicalDevice, indirectBuffers.descriptorSet, indirectBuffers.visibleObjectBuffer.buffer, 3,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+	WillEngine::VulkanUtil::writeDescriptorSetBuffer(logicalDevice, indirectBuffers.descriptorSet, indirectBuffers.objectStateBuffer.buffer, 4,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+	WillEngine::VulkanUtil::writeDescriptorSetBuffer(logicalDevice, indirectBuffers.descriptorSet, indirectBuffers.statisticsBuffer.buffer, 5,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+	WillEngine::VulkanUtil::writeDescriptorSetBuffer(logicalDevice, indirectBuffers.descriptorSet, indirectBuffers.clusterBuffer.buffer, 6,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+	WillEngine::VulkanUtil::writeDescriptorSetBuffer(logicalDevice, indirectBuffers.descriptorSet, indirectBuffers.batchBuffer.buffer, 7,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+	WillEngine::VulkanUtil::writeDescriptorSetBuffer(logicalDevice, indirectBuffers.descriptorSet, indirectBuffers.objectBatchBuffer.buffer, 8,
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+}
 
-	// Begin command buffer
-	VkCommandBufferBeginInfo commandBeginInfo{};
-	commandBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	commandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
-	commandBeginInfo.pInheritanceInfo = &inheritInfo;
+void VulkanEngine::destroyIndirectBuffers(VulkanFrame& frame)
+{
+	VulkanIndirectBuffers& indirectBuffers = frame.indirectBuffers;
 
-	if (vkBeginCommandBuffer(commandBuffer, &commandBeginInfo) != VK_SUCCESS)
-		throw std::runtime_error("Failed to begin command buffer");
+	VulkanAllocatedMemory* buffers[] = { &indirectBuffers.objectBuffer, &indirectBuffers.clusterBuffer, &indirectBuffers.batchBuffer,
+		&indirectBuffers.drawCommandBuffer, &indirectBuffers.drawCountBuffer, &indirectBuffers.visibleObjectBuffer, &indirectBuffers.objectStateBuffer,
+		&indirectBuffers.statisticsBuffer, &indirectBuffers.objectBatchBuffer };
 
-	// Set dynamic viewport and scissor
+	for (VulkanAllocatedMemory* buffer : buffers)
 	{
-		VkViewport viewport = WillEngine::VulkanUtil::getViewport(sceneExtent);
-		VkRect2D scissor = WillEngine::VulkanUtil::getScissor(sceneExtent);
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		if (buffer->buffer != VK_NULL_HANDLE && buffer->allocation != VK_NULL_HANDLE)
+			vmaDestroyBuffer(vmaAllocator, buffer->buffer, buffer->allocation);
+
+		*buffer = VulkanAllocatedMemory{};
 	}
 
-	// Bind pipeline
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	indirectBuffers.objectCapacity = 0;
+	indirectBuffers.batchCapacity = 0;
+	indirectBuffers.clusterCapacity = 0;
+	indirectBuffers.instanceCapacity = 0;
+}
 
-	// Bind Scene Uniform Buffer
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &sceneDescriptorSet.descriptorSet, 0, nullptr);
+void VulkanEngine::recordSecondaryCommandBuffers(VulkanFrame& frame, bool renderShadow)
+{
+	const u32 numDraws = static_cast<u32>(std::max(drawLists.meshInstances.size() + drawLists.skeletalDraws.size(),
+		renderShadow ? drawLists.shadowInstances.size() : 0) + drawLists.indirectBatches.size());
 
-	// Actual rendering commands here
-	for (auto it = gameState->gameResources.entities.begin(); it != gameState->gameResources.entities.end(); it++)
-	{
-		Entity* entity = it->second;
+	// Only use as many workers as there is enough work for
+	const u32 numWorkers = static_cast<u32>(frame.workers.size());
+	numActiveWorkers = std::clamp((numDraws + MIN_DRAWS_PER_WORKER - 1) / MIN_DRAWS_PER_WORKER, 1u, numWorkers);
 
-		MeshComponent* meshComponent = entity->GetComponent<MeshComponent>();
+	// The main thread records the first chunk
+	workerPool.run(numActiveWorkers, [&](u32 i)
+		{
+			recordWorkerCommandBuffers(frame.workers[i], i, renderShadow);
+		});
+}
+
+void VulkanEngine::recordWorkerCommandBuffers(VulkanWorkerCommandBuffers& worker, u32 workerIndex, bool renderShadow)
+{
+	// The chunk [begin, end) of a draw list this worker records
+	auto getChunk = [&](size_t size, u32& begin, u32& end)
+		{
+			begin = static_cast<u32>(size * workerIndex / numActiveWorkers);
+			end = static_cast<u32>(size * (workerIndex + 1) / numActiveWorkers);
+		};
 
-		bool hasRenderable = meshComponent != nullptr;
+	u32 begin = 0;
+	u32 end = 0;
 
-		if (!entity->isEnable)
-			continue;
+	// Depth
+	{
+		VkRenderPass depthRenderPass = renderPasses.at(VulkanRenderPassType::Depth);
+		VkFramebuffer depthFramebuffer = framebuffers.at(VulkanFramebufferType::Depth).framebuffer;
 
-		if (!hasRenderable)
-			continue;
+		beginSecondaryCommandBuffer(worker.depthBuffer, depthRenderPass, depthFramebuffer, true);
 
-		TransformComponent* transformComponent = entity->components[typeid(TransformComponent)]->GetComponent<TransformComponent>();
+		// Render Skeletal meshes first
+		getChunk(drawLists.skeletalDraws.size(), begin, end);
+		depthSkeletalPrePasses(worker.depthBuffer, begin, end);
 
-		u32 geometryPipelineIdx = pipelineIndexLookup[VulkanPipelineType::Geometry];
+		// Render instances of baked animations, they are already instanced so they are not split
+		if (workerIndex == 0)
+			depthBakedSkeletalPrePasses(worker.depthBuffer);
 
-		VulkanPipeline& geometryPipeline = pipelines[geometryPipelineIdx];
+		// Render normal meshes
+		getChunk(drawLists.meshInstances.size(), begin, end);
+		depthPrePasses(worker.depthBuffer, begin, end);
 
-		for (u32 i = 0; i < meshComponent->getNumMesh(); i++)
-		{
-			if (!gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]]->isReadyToDraw())
-				continue;
+		// Render the meshes culled on the GPU
+		getChunk(drawLists.indirectBatches.size(), begin, end);
+		depthIndirectPrePasses(worker.depthBuffer, begin, end, 0);
 
-			// Don't render if it has skeletal component
-			if (entity->AnyParentHasComponent<SkeletalComponent>())
-				continue;
+		vkEndCommandBuffer(worker.depthBuffer);
+	}
 
-			Mesh* mesh = gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]];
+	// Shadow
+	if (renderShadow)
+	{
+		VkRenderPass shadowRenderPass = renderPasses.at(VulkanRenderPassType::Shadow);
+		VkFramebuffer shadowFramebuffer = framebuffers.at(VulkanFramebufferType::ShadowMap).framebuffer;
 
-			u32 bufferSize = mesh->getVulkanBufferSize();
+		// The shadow pipeline has a fixed viewport
+		beginSecondaryCommandBuffer(worker.shadowBuffer, shadowRenderPass, shadowFramebuffer, false);
 
-			std::vector<VkBuffer> buffers = mesh->getVulkanBuffers();
+		getChunk(drawLists.shadowInstances.size(), begin, end);
+		shadowPasses(worker.shadowBuffer, begin, end);
 
-			std::vector<VkDeviceSize> offsets = mesh->getVulkanOffset();
+		getChunk(drawLists.indirectBatches.size(), begin, end);
+		shadowIndirectPasses(worker.shadowBuffer, begin, end);
 
-			// Bind buffers
-			vkCmdBindVertexBuffers(commandBuffer, 0, bufferSize, buffers.data(), offsets.data());
+		vkEndCommandBuffer(worker.shadowBuffer);
+	}
 
-			vkCmdBindIndexBuffer(commandBuffer, mesh->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+	// Geometry
+	{
+		VkRenderPass geometryRenderPass = renderPasses.at(VulkanRenderPassType::Geometry);
+		VkFramebuffer geometryFramebuffer = framebuffers.at(VulkanFramebufferType::Geometry).framebuffer;
 
-			// Bind Texture
-			// Check if the mesh has a material
-			if (gameState->graphicsResources.materials[meshComponent->materialIndicies[i]])
-			{
-				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, geometryPipeline.layout, 1, 1, &gameState->graphicsResources.materials[meshComponent->materialIndicies[i]]->textureDescriptorSet, 0, nullptr);
-			}
+		beginSecondaryCommandBuffer(worker.geometryBuffer, geometryRenderPass, geometryFramebuffer, true);
 
-			// Push constant for model matrix
-			mat4 transformation = transformComponent->getWorldTransformation();
-			//mat4 transformation = transformComponent->getGlobalTransformation();
-			//mat4 transformation = transformComponent->getLocalTransformation();
+		// Render Skeletal geometry first
+		getChunk(drawLists.skeletalDraws.size(), begin, end);
+		geometrySkeletalPasses(worker.geometryBuffer, sceneExtent, begin, end);
 
-			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
-				sizeof(transformation), &transformation);
+		// Render instances of baked animations
+		if (workerIndex == 0)
+			geometryBakedSkeletalPasses(worker.geometryBuffer, sceneExtent);
 
-			vkCmdDrawIndexed(commandBuffer, static_cast<u32>(mesh->indiciesSize), 3, 0, 0, 0);
-		}
-	}
+		// Render normal geometry
+		getChunk(drawLists.meshInstances.size(), begin, end);
+		geometryPasses(worker.geometryBuffer, sceneExtent, begin, end);
+
+		// Render the geometry culled on the GPU
+		getChunk(drawLists.indirectBatches.size(), begin, end);
+		geometryIndirectPasses(worker.geometryBuffer, begin, end);
 
-	vkEndCommandBuffer(commandBuffer);
+		vkEndCommandBuffer(worker.geometryBuffer);
+	}
 }
 
-void VulkanEngine::recordSkeletalSecondaryCommandBuffer(VkCommandBuffer& commandBuffer, VkRenderPass& renderPass, VkFramebuffer& framebuffer, VkPipeline& pipeline,
-	VkPipelineLayout& pipelineLayout)
+void VulkanEngine::beginSecondaryCommandBuffer(VkCommandBuffer& commandBuffer, VkRenderPass& renderPass, VkFramebuffer& framebuffer, bool setViewport)
 {
-	VulkanDescriptorSet& sceneDescriptorSet = descriptorSets[VulkanDescriptorSetType::Scene];
-
 	VkCommandBufferInheritanceInfo inheritInfo{};
 	inheritInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
 	inheritInfo.renderPass = renderPass;
@@ -1926,117 +3629,112 @@ void VulkanEngine::recordSkeletalSecondaryCommandBuffer(VkCommandBuffer& command
 	// Begin command buffer
 	VkCommandBufferBeginInfo commandBeginInfo{};
 	commandBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	commandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	commandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 	commandBeginInfo.pInheritanceInfo = &inheritInfo;
 
 	if (vkBeginCommandBuffer(commandBuffer, &commandBeginInfo) != VK_SUCCESS)
 		throw std::runtime_error("Failed to begin command buffer");
 
-	// Set dynamic viewport and scissor
+	// Dynamic states are not inherited from the primary command buffer
+	if (setViewport)
 	{
 		VkViewport viewport = WillEngine::VulkanUtil::getViewport(sceneExtent);
 		VkRect2D scissor = WillEngine::VulkanUtil::getScissor(sceneExtent);
 		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 	}
+}
 
-	u32 skeletalPipelineIdx = pipelineIndexLookup[VulkanPipelineType::Skeletal];
-	VulkanPipeline& skeletalPipeline = pipelines[skeletalPipelineIdx];
+void VulkanEngine::recordCullPass(VkCommandBuffer& commandBuffer, VulkanFrame& frame)
+{
+	dispatchCull(commandBuffer, frame, 0);
 
-	// Bind pipeline
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	// The draw commands and visible objects are read by the indirect draws of every pass after this
+	// The second culling phase reads the object states and adds to the draw commands
+	recordPassBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
 
-	// Bind Scene Uniform Buffer
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &sceneDescriptorSet.descriptorSet, 0, nullptr);
+void VulkanEngine::recordHiZPass(VkCommandBuffer& commandBuffer)
+{
+	const VulkanPipeline& hiZPipeline = pipelines[pipelineIndexLookup.at(VulkanPipelineType::HiZ)];
 
-	// Actual rendering commands here
-	for (auto it = gameState->gameResources.entities.begin(); it != gameState->gameResources.entities.end(); it++)
-	{
-		Entity* entity = it->second;
+	const VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, hiZPyramid.numMips, 0, 1 };
 
-		MeshComponent* meshComponent = entity->GetComponent<MeshComponent>();
+	// The render graph expects the pyramid in GENERAL
+	if (!hiZPyramid.initialised)
+	{
+		WillEngine::VulkanUtil::imageBarrier(commandBuffer, hiZPyramid.image.image, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_GENERAL, subresourceRange, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 
-		bool hasRenderable = meshComponent != nullptr;
+		hiZPyramid.initialised = true;
+	}
 
-		if (!entity->isEnable)
-			continue;
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hiZPipeline.pipeline);
 
-		if (!hasRenderable)
-			continue;
+	u32 width = hiZPyramid.extent.width;
+	u32 height = hiZPyramid.extent.height;
 
-		// Don't render it if it does not have skeletal component
-		if (!entity->AnyParentHasComponent<SkeletalComponent>())
-			continue;
+	for (u32 i = 0; i < hiZPyramid.numMips; i++)
+	{
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hiZPipeline.layout, 0, 1, &hiZPyramid.inputDescriptorSets[i], 0, nullptr);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hiZPipeline.layout, 1, 1, &hiZPyramid.outputDescriptorSets[i], 0, nullptr);
 
-		TransformComponent* transformComponent = entity->components[typeid(TransformComponent)]->GetComponent<TransformComponent>();
+		vkCmdDispatch(commandBuffer, (width + 7) / 8, (height + 7) / 8, 1);
 
-		//SkeletalComponent* skeletalComp = rootEntity->GetComponent<SkeletalComponent>();
-		SkeletalComponent* skeletalComp = entity->AnyParentGetComponent<SkeletalComponent>();
-		Skeleton* skeleton = gameState->gameResources.skeletons[skeletalComp->skeletalId];
+		// The next mip is built from this one
+		WillEngine::VulkanUtil::memoryBarrier(commandBuffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 
-		// Bind bone uniform buffer
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skeletalPipeline.layout, 2, 1, &skeleton->boneDescriptorSet.descriptorSet, 0, nullptr);
+		width = std::max(1u, (width + 1) / 2);
+		height = std::max(1u, (height + 1) / 2);
+	}
 
-		for (u32 i = 0; i < meshComponent->getNumMesh(); i++)
-		{
-			if (!gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]]->isReadyToDraw())
-				continue;
+	// The next frame tests its objects against this pyramid with the matrices it was rendered with
+	hiZPyramid.valid = true;
+	hiZPyramid.viewProjection = sceneMatrix.projectionMatrix * sceneMatrix.viewMatrix;
+}
 
-			Mesh* mesh = dynamic_cast<Mesh*>(gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]]);
+void VulkanEngine::recordLateCullPass(VkCommandBuffer& commandBuffer, VulkanFrame& frame)
+{
+	dispatchCull(commandBuffer, frame, 1);
 
-			u32 bufferSize = mesh->getVulkanBufferSize();
+	// The late draws are read by the depth and geometry passes, the statistics by the CPU once the frame has finished
+	recordPassBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT);
+}
 
-			std::vector<VkBuffer> buffers = mesh->getVulkanBuffers();
+void VulkanEngine::dispatchCull(VkCommandBuffer& commandBuffer, VulkanFrame& frame, u32 phase)
+{
+	const VulkanPipeline& cullPipeline = pipelines[pipelineIndexLookup.at(VulkanPipelineType::Cull)];
 
-			std::vector<VkDeviceSize> offsets = mesh->getVulkanOffset();
+	const VulkanDescriptorSet& cullDescriptorSet = frame.uniformDescriptorSets.at(VulkanDescriptorSetType::Cull);
 
-			// Bind buffers
-			vkCmdBindVertexBuffers(commandBuffer, 0, bufferSize, buffers.data(), offsets.data());
+	VulkanCullPhase cullPhase{};
+	cullPhase.numObjects = static_cast<u32>(drawLists.indirectObjectBatches.size());
+	cullPhase.numBatches = static_cast<u32>(drawLists.indirectBatches.size());
+	cullPhase.numClusters = drawLists.numIndirectClusters;
+	cullPhase.phase = phase;
+	cullPhase.occlusionCulling = occlusionCulling ? 1 : 0;
+	cullPhase.clusterCulling = gameState->gameSettings.enableClusterCulling ? 1 : 0;
 
-			vkCmdBindIndexBuffer(commandBuffer, mesh->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline.pipeline);
 
-			// Bind Texture
-			// Check if the mesh has a material
-			if (gameState->graphicsResources.materials[meshComponent->materialIndicies[i]])
-			{
-				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skeletalPipeline.layout, 1, 1, &gameState->graphicsResources.materials[meshComponent->materialIndicies[i]]->textureDescriptorSet, 0, nullptr);
-			}
+	VkDescriptorSet descriptorSets[] = { frame.indirectBuffers.descriptorSet, cullDescriptorSet.descriptorSet, hiZPyramid.descriptorSet };
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline.layout, 0, static_cast<u32>(sizeof(descriptorSets) / sizeof(descriptorSets[0])),
+		descriptorSets, 0, nullptr);
 
-			vkCmdDrawIndexed(commandBuffer, static_cast<u32>(mesh->indiciesSize), 3, 0, 0, 0);
-		}
-	}
+	vkCmdPushConstants(commandBuffer, cullPipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(VulkanCullPhase), &cullPhase);
 
-	vkEndCommandBuffer(commandBuffer);
+	// One thread per object
+	vkCmdDispatch(commandBuffer, (cullPhase.numObjects + 63) / 64, 1, 1);
 }
 
-void VulkanEngine::recordDepthPrePass(VkCommandBuffer& commandBuffer, VkCommandBuffer& meshBuffer, VkCommandBuffer& skeletalBuffer)
+void VulkanEngine::recordDepthPrePass(VkCommandBuffer& commandBuffer, VulkanFrame& frame)
 {
-	//std::thread t1(&VulkanEngine::recordMeshSecondaryCommandBuffer, this, std::ref(meshBuffer), std::ref(depthRenderPass), std::ref(depthFramebuffer),
-	//	std::ref(depthPipeline), std::ref(depthPipelineLayout));
-
-	//std::thread t2(&VulkanEngine::recordSkeletalSecondaryCommandBuffer, this, std::ref(skeletalBuffer), std::ref(depthRenderPass), std::ref(depthFramebuffer),
-	//	std::ref(depthSkeletalPipeline), std::ref(depthSkeletalPipelineLayout));
-
-	//t1.join();
-	//t2.join();
-
-	// Begin command buffer
-	VkCommandBufferBeginInfo commandBeginInfo{};
-	commandBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	commandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-	//commandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
-
-	if (vkBeginCommandBuffer(commandBuffer, &commandBeginInfo) != VK_SUCCESS)
-		throw std::runtime_error("Failed to begin command buffer");
-
-	// Set dynamic viewport and scissor
-	{
-		VkViewport viewport = WillEngine::VulkanUtil::getViewport(sceneExtent);
-		VkRect2D scissor = WillEngine::VulkanUtil::getScissor(sceneExtent);
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-	}
-
 	VkClearValue clearValue[1];
 	clearValue[0].depthStencil.depth = 1.0f;
 
@@ -2052,76 +3750,90 @@ void VulkanEngine::recordDepthPrePass(VkCommandBuffer& commandBuffer, VkCommandB
 	renderPassBeginInfo.pClearValues = clearValue;
 
 	// Begin Render pass
-	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-	//vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-	// Render Skeletal meshes first
-	depthSkeletalPrePasses(commandBuffer);
-	//vkCmdExecuteCommands(commandBuffer, 1, &skeletalBuffer);
-
-	// Render normal meshes
-	depthPrePasses(commandBuffer);
-	//vkCmdExecuteCommands(commandBuffer, 1, &meshBuffer);
+	// Execute the draws recorded by the workers
+	std::vector<VkCommandBuffer> secondaryBuffers(numActiveWorkers);
+	for (u32 i = 0; i < numActiveWorkers; i++)
+	{
+		secondaryBuffers[i] = frame.workers[i].depthBuffer;
+	}
+	vkCmdExecuteCommands(commandBuffer, numActiveWorkers, secondaryBuffers.data());
 
 	// End Render pass
 	vkCmdEndRenderPass(commandBuffer);
-
-	// End command buffer
-	vkEndCommandBuffer(commandBuffer);
 }
 
-void VulkanEngine::recordShadowPass(VkCommandBuffer& commandBuffer)
+void VulkanEngine::recordDepthLatePass(VkCommandBuffer& commandBuffer, VulkanFrame& frame)
 {
-	// Begin command buffer
-	VkCommandBufferBeginInfo commandBeginInfo{};
-	commandBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	commandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VulkanFramebuffer& depthFramebuffer = framebuffers[VulkanFramebufferType::Depth];
+	VkRenderPass& depthLateRenderPass = renderPasses[VulkanRenderPassType::DepthLate];
 
-	if (vkBeginCommandBuffer(commandBuffer, &commandBeginInfo) != VK_SUCCESS)
-		throw std::runtime_error("Failed to begin command buffer");
+	// The depth of the first phase is loaded, nothing is cleared
+	VkRenderPassBeginInfo renderPassBeginInfo{};
+	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassBeginInfo.renderPass = depthLateRenderPass;
+	renderPassBeginInfo.framebuffer = depthFramebuffer.framebuffer;
+	renderPassBeginInfo.renderArea.extent = sceneExtent;
 
-	// Set dynamic viewport and scissor
-	{
-		VkViewport viewport = WillEngine::VulkanUtil::getViewport(sceneExtent);
-		VkRect2D scissor = WillEngine::VulkanUtil::getScissor(sceneExtent);
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-	}
+	// There is one draw per batch, so they are recorded here instead of on the workers
+	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-	shadowPasses(commandBuffer);
+	VkViewport viewport = WillEngine::VulkanUtil::getViewport(sceneExtent);
+	VkRect2D scissor = WillEngine::VulkanUtil::getScissor(sceneExtent);
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-	// End command buffer
-	vkEndCommandBuffer(commandBuffer);
+	// The late draws come after the camera and shadow draws
+	const u32 numBatches = static_cast<u32>(drawLists.indirectBatches.size());
+	depthIndirectPrePasses(commandBuffer, 0, numBatches, 2);
+
+	vkCmdEndRenderPass(commandBuffer);
 }
 
-void VulkanEngine::recordGeometryPass(VkCommandBuffer& commandBuffer, VkCommandBuffer& meshBuffer, VkCommandBuffer& skeletalBuffer)
+void VulkanEngine::recordShadowPass(VkCommandBuffer& commandBuffer, VulkanFrame& frame)
 {
-	//std::thread t1(&VulkanEngine::recordMeshSecondaryCommandBuffer, this, std::ref(meshBuffer), std::ref(geometryRenderPass), std::ref(offscreenFramebuffer.framebuffer),
-	//	std::ref(geometryPipeline), std::ref(geometryPipelineLayout));
+	VulkanDescriptorSet& lightMatrixDescriptorSet = frame.uniformDescriptorSets[VulkanDescriptorSetType::LightMatrix];
 
-	//std::thread t2(&VulkanEngine::recordSkeletalSecondaryCommandBuffer, this, std::ref(skeletalBuffer), std::ref(geometryRenderPass), std::ref(offscreenFramebuffer.framebuffer),
-	//	std::ref(skeletalPipeline), std::ref(skeletalPipelineLayout));
+	// Update light matrices buffer
+	vkCmdUpdateBuffer(commandBuffer, lightMatrixDescriptorSet.buffer.buffer, 0, sizeof(mat4) * 6, &gameState->graphicsResources.lights[1]->matrices);
 
-	//t1.join();
-	//t2.join();
+	WillEngine::VulkanUtil::bufferBarrier(commandBuffer, lightMatrixDescriptorSet.buffer.buffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_UNIFORM_READ_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_GEOMETRY_SHADER_BIT, sizeof(mat4) * 6, 0,
+		VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
 
-	// Begin command buffer
-	VkCommandBufferBeginInfo commandBeginInfo{};
-	commandBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	//commandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
-	commandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VkClearValue clearValue[1];
+	// Clear Depth
+	clearValue[0].depthStencil.depth = 1.0f;
 
-	if (vkBeginCommandBuffer(commandBuffer, &commandBeginInfo) != VK_SUCCESS)
-		throw std::runtime_error("Failed to begin command buffer");
+	VulkanFramebuffer& shadowFramebuffer = framebuffers[VulkanFramebufferType::ShadowMap];
+	VkRenderPass& shadowRenderPass = renderPasses[VulkanRenderPassType::Shadow];
 
-	// Set dynamic viewport and scissor
+	// Begin Render Pass
+	VkRenderPassBeginInfo renderPassBeginInfo{};
+	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassBeginInfo.renderPass = shadowRenderPass;
+	renderPassBeginInfo.framebuffer = shadowFramebuffer.framebuffer;
+	renderPassBeginInfo.renderArea.extent.width = SHADOW_MAP_SIZE;
+	renderPassBeginInfo.renderArea.extent.height = SHADOW_MAP_SIZE;
+	renderPassBeginInfo.clearValueCount = static_cast<u32>(sizeof(clearValue) / sizeof(clearValue[0]));
+	renderPassBeginInfo.pClearValues = clearValue;
+
+	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+	// Execute the draws recorded by the workers
+	std::vector<VkCommandBuffer> secondaryBuffers(numActiveWorkers);
+	for (u32 i = 0; i < numActiveWorkers; i++)
 	{
-		VkViewport viewport = WillEngine::VulkanUtil::getViewport(sceneExtent);
-		VkRect2D scissor = WillEngine::VulkanUtil::getScissor(sceneExtent);
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		secondaryBuffers[i] = frame.workers[i].shadowBuffer;
 	}
+	vkCmdExecuteCommands(commandBuffer, numActiveWorkers, secondaryBuffers.data());
+
+	vkCmdEndRenderPass(commandBuffer);
+}
 
+void VulkanEngine::recordGeometryPass(VkCommandBuffer& commandBuffer, VulkanFrame& frame)
+{
 	VkClearValue clearValue[5];
 	// Clear attachments
 	// We're not clearing depth as we're using compare_equal to the depth buffer from depth pre-pass
@@ -2146,34 +3858,22 @@ void VulkanEngine::recordGeometryPass(VkCommandBuffer& commandBuffer, VkCommandB
 	renderPassBeginInfo.pClearValues = clearValue;
 
 	// Begin Render Pass
-	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-	//vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
-
-	// Render Skeletal geometry first
-	geometrySkeletalPasses(commandBuffer, sceneExtent);
-	//vkCmdExecuteCommands(commandBuffer, 1, &skeletalBuffer);
+	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-	// Render normal geometry
-	geometryPasses(commandBuffer, sceneExtent);
-	//vkCmdExecuteCommands(commandBuffer, 1, &meshBuffer);
+	// Execute the draws recorded by the workers
+	std::vector<VkCommandBuffer> secondaryBuffers(numActiveWorkers);
+	for (u32 i = 0; i < numActiveWorkers; i++)
+	{
+		secondaryBuffers[i] = frame.workers[i].geometryBuffer;
+	}
+	vkCmdExecuteCommands(commandBuffer, numActiveWorkers, secondaryBuffers.data());
 
 	// End Render Pass
 	vkCmdEndRenderPass(commandBuffer);
-
-	// End command buffer
-	vkEndCommandBuffer(commandBuffer);
 }
 
 void VulkanEngine::recordShadingPass(VkCommandBuffer& commandBuffer)
 {
-	// Begin command buffer
-	VkCommandBufferBeginInfo commandBeginInfo{};
-	commandBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	commandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-	if (vkBeginCommandBuffer(commandBuffer, &commandBeginInfo) != VK_SUCCESS)
-		throw std::runtime_error("Failed to begin command buffer");
-
 	// Set dynamic viewport and scissor
 	{
 		VkViewport viewport = WillEngine::VulkanUtil::getViewport(sceneExtent);
@@ -2187,475 +3887,514 @@ void VulkanEngine::recordShadingPass(VkCommandBuffer& commandBuffer)
 
 	// Shading
 	shadingPasses(commandBuffer, shadingRenderPass, shadingFramebuffer.framebuffer, sceneExtent);
-
-	// End command buffer
-	vkEndCommandBuffer(commandBuffer);
 }
 
-void VulkanEngine::depthSkeletalPrePasses(VkCommandBuffer& commandBuffer)
+void VulkanEngine::depthSkeletalPrePasses(VkCommandBuffer& commandBuffer, u32 begin, u32 end)
 {
-	u32 depthSkeletalPipelineIdx = pipelineIndexLookup[VulkanPipelineType::DepthSkeletal];
+	if (begin == end)
+		return;
 
-	VulkanDescriptorSet& sceneDescriptorSet = descriptorSets[VulkanDescriptorSetType::Scene];
+	const VulkanPipeline& depthSkeletalPipeline = pipelines[pipelineIndexLookup.at(VulkanPipelineType::DepthSkeletal)];
+
+	const VulkanDescriptorSet& sceneDescriptorSet = frames[currentFrame].uniformDescriptorSets.at(VulkanDescriptorSetType::Scene);
 
 	// Bind pipeline
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[depthSkeletalPipelineIdx].pipeline);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthSkeletalPipeline.pipeline);
 
 	// Bind Scene Uniform Buffer
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[depthSkeletalPipelineIdx].layout, 0, 1, &sceneDescriptorSet.descriptorSet, 0, nullptr);
-
-	//=======================================================
-	for (auto it = gameState->gameResources.skeletons.begin(); it != gameState->gameResources.skeletons.end(); it++)
-	{
-		u32 skeletonId = it->first;
-		Skeleton* skeleton = it->second;
-
-		// Bind bone uniform buffer
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[depthSkeletalPipelineIdx].layout, 1, 1, &skeleton->boneDescriptorSet.descriptorSet, 0, nullptr);
-
-		for (auto jt = gameState->gameResources.entities.begin(); jt != gameState->gameResources.entities.end(); jt++)
-		{
-			u32 entityId = jt->first;
-			Entity* entity = jt->second;
-
-			if (!entity->isEnable)
-				continue;
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthSkeletalPipeline.layout, 0, 1, &sceneDescriptorSet.descriptorSet, 0, nullptr);
 
-			if (!entity->HasComponent<MeshComponent>())
-				continue;
+	VkDescriptorSet boundBoneDescriptorSet = VK_NULL_HANDLE;
 
-			// Don't render if it does not have Skeletal Component
-			if (!entity->AnyParentHasComponent<SkeletalComponent>())
-				continue;
+	VulkanBindState bindState{};
 
-			// Don't render if the skeleton id is NOT the same
-			if (entity->AnyParentGetComponent<SkeletalComponent>()->skeletalId != skeletonId)
-				continue;
+	for (u32 i = begin; i < end; i++)
+	{
+		const VulkanDrawItem& draw = drawLists.skeletalDraws[i];
+		Mesh* mesh = draw.mesh;
 
-			TransformComponent* transformComponent = entity->GetComponent<TransformComponent>();
-			MeshComponent* meshComponent = entity->GetComponent<MeshComponent>();
+		// The draws are sorted by skeleton, only bind the bone uniform buffer when it changes
+		if (draw.boneDescriptorSet != boundBoneDescriptorSet)
+		{
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthSkeletalPipeline.layout, 1, 1, &draw.boneDescriptorSet, 0, nullptr);
+			boundBoneDescriptorSet = draw.boneDescriptorSet;
+		}
 
-			for (u32 i = 0; i < meshComponent->getNumMesh(); i++)
-			{
-				if (!gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]]->isReadyToDraw())
-					continue;
+		// Bind buffers
+		bindGeometry(commandBuffer, mesh, bindState);
 
-				Mesh* mesh = dynamic_cast<Mesh*>(gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]]);
+		// Dequantisation of the positions
+		PushConstantSkinnedMesh pushConstant{};
+		pushConstant.positionOffset = vec4(mesh->positionOffset, 0);
+		pushConstant.positionScale = vec4(mesh->positionScale, 0);
 
-				u32 bufferSize = mesh->getVulkanBufferSize();
+		vkCmdPushConstants(commandBuffer, depthSkeletalPipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstantSkinnedMesh), &pushConstant);
 
-				std::vector<VkBuffer> buffers = mesh->getVulkanBuffers();
+		const MeshLod lod = mesh->getLod(draw.lod);
+		vkCmdDrawIndexed(commandBuffer, lod.numIndices, 1, mesh->geometryRange.firstIndex + lod.firstIndex,
+			static_cast<i32>(mesh->geometryRange.vertexOffset), 0);
+	}
 
-				std::vector<VkDeviceSize> offsets = mesh->getVulkanOffset();
+	addBindStatistics(bindState);
+}
 
-				// Bind buffers
-				vkCmdBindVertexBuffers(commandBuffer, 0, bufferSize, buffers.data(), offsets.data());
+void VulkanEngine::depthBakedSkeletalPrePasses(VkCommandBuffer& commandBuffer)
+{
+	const VulkanPipeline& depthBakedSkeletalPipeline = pipelines[pipelineIndexLookup.at(VulkanPipelineType::DepthBakedSkeletal)];
 
-				vkCmdBindIndexBuffer(commandBuffer, mesh->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+	const VulkanDescriptorSet& sceneDescriptorSet = frames[currentFrame].uniformDescriptorSets.at(VulkanDescriptorSetType::Scene);
 
-				vkCmdDrawIndexed(commandBuffer, static_cast<u32>(mesh->indiciesSize), 3, 0, 0, 0);
-			}
-		}
-	}
+	// Bind pipeline
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthBakedSkeletalPipeline.pipeline);
 
-	//for (auto it = gameState->gameResources.entities.begin(); it != gameState->gameResources.entities.end(); it++)
-	//{
-	//	Entity* entity = it->second;
+	// Bind Scene Uniform Buffer
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthBakedSkeletalPipeline.layout, 0, 1, &sceneDescriptorSet.descriptorSet, 0, nullptr);
 
-	//	MeshComponent* meshComponent = entity->GetComponent<MeshComponent>();
+	// The instance buffer follows the vertex streams of the skinned meshes
+	const u32 instanceBinding = geometryArenas.at(VulkanGeometryType::Skinned).getNumStreams();
 
-	//	bool hasRenderable = meshComponent != nullptr;
+	// Only read here, this runs on a worker thread
+	const std::unordered_map<u32, Mesh*>& meshes = gameState->graphicsResources.meshes;
 
-	//	if (!entity->isEnable)
-	//		continue;
+	VulkanBindState bindState{};
 
-	//	if (!hasRenderable)
-	//		continue;
+	for (auto it = gameState->gameResources.bakedAnimations.begin(); it != gameState->gameResources.bakedAnimations.end(); it++)
+	{
+		BakedAnimation* bakedAnimation = it->second;
 
-	//	// Don't render if it does not have Skeletal Component
-	//	if (!entity->AnyParentHasComponent<SkeletalComponent>())
-	//		continue;
+		if (!bakedAnimation->isReadyToDraw() || bakedAnimation->getNumInstances() == 0)
+			continue;
 
-	//	TransformComponent* transformComponent = entity->components[typeid(TransformComponent)]->GetComponent<TransformComponent>();
+		// Bind baked bone matrices
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthBakedSkeletalPipeline.layout, 1, 1, &bakedAnimation->boneMatrixDescriptorSet, 0, nullptr);
 
-	//	//SkeletalComponent* skeletalComp = rootEntity->GetComponent<SkeletalComponent>();
-	//	SkeletalComponent* skeletalComp = entity->AnyParentGetComponent<SkeletalComponent>();
-	//	Skeleton* skeleton = gameState->gameResources.skeletons[skeletalComp->skeletalId];
+		// Bind instance buffer
+		VkDeviceSize instanceOffset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, instanceBinding, 1, &bakedAnimation->instanceBuffers[currentFrame].buffer, &instanceOffset);
 
-	//	// Bind bone uniform buffer
-	//	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthSkeletalPipelineLayout, 1, 1, &skeleton->boneDescriptorSet.descriptorSet, 0, nullptr);
+		PushConstantBakedAnimation pushConstant{};
+		bakedAnimation->getPlaybackFrame(bakedAnimationTime, pushConstant.frame, pushConstant.frameFraction);
+		pushConstant.numBones = bakedAnimation->numBones;
 
-	//	for (u32 i = 0; i < meshComponent->getNumMesh(); i++)
-	//	{
-	//		if (!gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]]->isReadyToDraw())
-	//			continue;
+		for (u32 i = 0; i < bakedAnimation->meshIndicies.size(); i++)
+		{
+			const Mesh* mesh = meshes.at(bakedAnimation->meshIndicies[i]);
 
-	//		Mesh* mesh = dynamic_cast<Mesh*>(gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]]);
+			if (!mesh->isReadyToDraw())
+				continue;
 
-	//		u32 bufferSize = mesh->getVulkanBufferSize();
+			// Bind buffers
+			bindGeometry(commandBuffer, mesh, bindState);
 
-	//		std::vector<VkBuffer> buffers = mesh->getVulkanBuffers();
+			// Dequantisation of the positions of the mesh
+			pushConstant.positionOffset = vec4(mesh->positionOffset, 0);
+			pushConstant.positionScale = vec4(mesh->positionScale, 0);
 
-	//		std::vector<VkDeviceSize> offsets = mesh->getVulkanOffset();
+			vkCmdPushConstants(commandBuffer, depthBakedSkeletalPipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstantBakedAnimation), &pushConstant);
 
-	//		// Bind buffers
-	//		vkCmdBindVertexBuffers(commandBuffer, 0, bufferSize, buffers.data(), offsets.data());
+			// The instances of a crowd share one draw, so they keep the full mesh
+			const MeshLod lod = mesh->getLod(0);
 
-	//		vkCmdBindIndexBuffer(commandBuffer, mesh->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdDrawIndexed(commandBuffer, lod.numIndices, bakedAnimation->getNumInstances(), mesh->geometryRange.firstIndex + lod.firstIndex,
+				static_cast<i32>(mesh->geometryRange.vertexOffset), 0);
+		}
+	}
 
-	//		vkCmdDrawIndexed(commandBuffer, static_cast<u32>(mesh->indiciesSize), 3, 0, 0, 0);
-	//	}
-	//}
+	addBindStatistics(bindState);
 }
 
-void VulkanEngine::depthPrePasses(VkCommandBuffer& commandBuffer)
+void VulkanEngine::depthPrePasses(VkCommandBuffer& commandBuffer, u32 begin, u32 end)
 {
-	u32 depthPipelineIdx = pipelineIndexLookup[VulkanPipelineType::Depth];
+	if (begin == end)
+		return;
 
-	VulkanDescriptorSet& sceneDescriptorSet = descriptorSets[VulkanDescriptorSetType::Scene];
+	const VulkanPipeline& depthPipeline = pipelines[pipelineIndexLookup.at(VulkanPipelineType::Depth)];
+
+	const VulkanDescriptorSet& sceneDescriptorSet = frames[currentFrame].uniformDescriptorSets.at(VulkanDescriptorSetType::Scene);
 
 	// Bind pipeline
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[depthPipelineIdx].pipeline);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPipeline.pipeline);
 
 	// Bind Scene Uniform Buffer
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[depthPipelineIdx].layout, 0, 1, &sceneDescriptorSet.descriptorSet, 0, nullptr);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPipeline.layout, 0, 1, &sceneDescriptorSet.descriptorSet, 0, nullptr);
 
-	for (auto it = gameState->gameResources.entities.begin(); it != gameState->gameResources.entities.end(); it++)
-	{
-		Entity* entity = it->second;
+	// Bind object data
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPipeline.layout, 1, 1, &frames[currentFrame].instanceBuffer.descriptorSet,
+		0, nullptr);
 
-		MeshComponent* meshComponent = entity->GetComponent<MeshComponent>();
+	VulkanBindState bindState{};
 
-		bool hasRenderable = meshComponent != nullptr;
+	for (u32 i = begin; i < end; i++)
+	{
+		const VulkanInstancedDraw& draw = drawLists.meshInstances[i];
+		Mesh* mesh = draw.mesh;
 
-		if (!entity->isEnable)
-			continue;
+		// Bind buffers
+		bindGeometry(commandBuffer, mesh, bindState);
 
-		if (!hasRenderable)
-			continue;
+		const MeshLod lod = mesh->getLod(draw.lod);
 
-		// Don't render if it has skeletal component as we have rendered it already
-		if (entity->AnyParentHasComponent<SkeletalComponent>())
-			continue;
+		// The instance index starts at the draw's first object
+		vkCmdDrawIndexed(commandBuffer, lod.numIndices, draw.numInstances, mesh->geometryRange.firstIndex + lod.firstIndex,
+			static_cast<i32>(mesh->geometryRange.vertexOffset), draw.firstInstance);
+	}
 
-		TransformComponent* transformComponent = entity->components[typeid(TransformComponent)]->GetComponent<TransformComponent>();
+	addBindStatistics(bindState);
+}
 
-		for (u32 i = 0; i < meshComponent->getNumMesh(); i++)
-		{
-			if (!gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]]->isReadyToDraw())
-				continue;
+void VulkanEngine::geometrySkeletalPasses(VkCommandBuffer& commandBuffer, VkExtent2D extent, u32 begin, u32 end)
+{
+	if (begin == end)
+		return;
 
-			Mesh* mesh = gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]];
+	const VulkanPipeline& skeletalPipeline = pipelines[pipelineIndexLookup.at(VulkanPipelineType::Skeletal)];
 
-			u32 bufferSize = mesh->getVulkanBufferSize();
+	const VulkanDescriptorSet& sceneDescriptorSet = frames[currentFrame].uniformDescriptorSets.at(VulkanDescriptorSetType::Scene);
 
-			std::vector<VkBuffer> buffers = mesh->getVulkanBuffers();
+	// Bind default pipeline
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skeletalPipeline.pipeline);
 
-			std::vector<VkDeviceSize> offsets = mesh->getVulkanOffset();
+	// Bind Scene Uniform Buffer
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skeletalPipeline.layout, 0, 1, &sceneDescriptorSet.descriptorSet, 0, nullptr);
 
-			// Bind buffers
-			vkCmdBindVertexBuffers(commandBuffer, 0, bufferSize, buffers.data(), offsets.data());
+	// Bind textures and materials
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skeletalPipeline.layout, 1, 1, &bindlessTextures.descriptorSet, 0, nullptr);
 
-			vkCmdBindIndexBuffer(commandBuffer, mesh->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+	VkDescriptorSet boundBoneDescriptorSet = VK_NULL_HANDLE;
 
-			// Push constant for model matrix
-			// Copying the reference is faster than copying the actual mat4 value
-			mat4& transformation = transformComponent->getWorldTransformation();
+	VulkanBindState bindState{};
 
-			vkCmdPushConstants(commandBuffer, pipelines[depthPipelineIdx].layout, VK_SHADER_STAGE_VERTEX_BIT, 0,
-				sizeof(transformation), &transformation);
+	for (u32 i = begin; i < end; i++)
+	{
+		const VulkanDrawItem& draw = drawLists.skeletalDraws[i];
+		Mesh* mesh = draw.mesh;
 
-			vkCmdDrawIndexed(commandBuffer, static_cast<u32>(mesh->indiciesSize), 3, 0, 0, 0);
+		// The draws are sorted by skeleton, only bind the bone uniform buffer when it changes
+		if (draw.boneDescriptorSet != boundBoneDescriptorSet)
+		{
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skeletalPipeline.layout, 2, 1, &draw.boneDescriptorSet, 0, nullptr);
+			boundBoneDescriptorSet = draw.boneDescriptorSet;
 		}
+
+		// Bind buffers
+		bindGeometry(commandBuffer, mesh, bindState);
+
+		// Material and dequantisation of the positions of the draw
+		PushConstantSkinnedMesh pushConstant{};
+		pushConstant.positionOffset = vec4(mesh->positionOffset, 0);
+		pushConstant.positionScale = vec4(mesh->positionScale, 0);
+		pushConstant.materialIndex = draw.materialIndex;
+
+		vkCmdPushConstants(commandBuffer, skeletalPipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstantSkinnedMesh), &pushConstant);
+
+		const MeshLod lod = mesh->getLod(draw.lod);
+		vkCmdDrawIndexed(commandBuffer, lod.numIndices, 1, mesh->geometryRange.firstIndex + lod.firstIndex,
+			static_cast<i32>(mesh->geometryRange.vertexOffset), 0);
 	}
+
+	addBindStatistics(bindState);
 }
 
-void VulkanEngine::geometrySkeletalPasses(VkCommandBuffer& commandBuffer, VkExtent2D extent)
+void VulkanEngine::geometryBakedSkeletalPasses(VkCommandBuffer& commandBuffer, VkExtent2D extent)
 {
-	PipelineId skeletalPipelineIdx = pipelineIndexLookup[VulkanPipelineType::Skeletal];
+	const VulkanPipeline& bakedSkeletalPipeline = pipelines[pipelineIndexLookup.at(VulkanPipelineType::BakedSkeletal)];
 
-	VulkanDescriptorSet& sceneDescriptorSet = descriptorSets[VulkanDescriptorSetType::Scene];
+	const VulkanDescriptorSet& sceneDescriptorSet = frames[currentFrame].uniformDescriptorSets.at(VulkanDescriptorSetType::Scene);
 
-	// Bind default pipeline
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[skeletalPipelineIdx].pipeline);
+	// Bind pipeline
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bakedSkeletalPipeline.pipeline);
 
 	// Bind Scene Uniform Buffer
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[skeletalPipelineIdx].layout, 0, 1, &sceneDescriptorSet.descriptorSet, 0, nullptr);
-
-	//================================
-	for (auto it = gameState->gameResources.skeletons.begin(); it != gameState->gameResources.skeletons.end(); it++)
-	{
-		u32 skeletonId = it->first;
-		Skeleton* skeleton = it->second;
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bakedSkeletalPipeline.layout, 0, 1, &sceneDescriptorSet.descriptorSet, 0, nullptr);
 
-		// Bind bone uniform buffer
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[skeletalPipelineIdx].layout, 2, 1, &skeleton->boneDescriptorSet.descriptorSet, 0, nullptr);
+	// Bind textures and materials
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bakedSkeletalPipeline.layout, 1, 1, &bindlessTextures.descriptorSet, 0, nullptr);
 
-		for (auto jt = gameState->gameResources.entities.begin(); jt != gameState->gameResources.entities.end(); jt++)
-		{
-			u32 entityId = jt->first;
-			Entity* entity = jt->second;
+	// The instance buffer follows the vertex streams of the skinned meshes
+	const u32 instanceBinding = geometryArenas.at(VulkanGeometryType::Skinned).getNumStreams();
 
-			if (!entity->isEnable)
-				continue;
+	// Only read here, this runs on a worker thread
+	const std::unordered_map<u32, Mesh*>& meshes = gameState->graphicsResources.meshes;
 
-			if (!entity->HasComponent<MeshComponent>())
-				continue;
+	VulkanBindState bindState{};
 
-			// Don't render if it does not have Skeletal Component
-			if (!entity->AnyParentHasComponent<SkeletalComponent>())
-				continue;
+	for (auto it = gameState->gameResources.bakedAnimations.begin(); it != gameState->gameResources.bakedAnimations.end(); it++)
+	{
+		BakedAnimation* bakedAnimation = it->second;
 
-			// Don't render if the skeleton id is NOT the same
-			if (entity->AnyParentGetComponent<SkeletalComponent>()->skeletalId != skeletonId)
-				continue;
+		if (!bakedAnimation->isReadyToDraw() || bakedAnimation->getNumInstances() == 0)
+			continue;
 
-			TransformComponent* transformComponent = entity->GetComponent<TransformComponent>();
-			MeshComponent* meshComponent = entity->GetComponent<MeshComponent>();
+		// Bind baked bone matrices
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bakedSkeletalPipeline.layout, 2, 1, &bakedAnimation->boneMatrixDescriptorSet, 0, nullptr);
 
-			for (u32 i = 0; i < meshComponent->getNumMesh(); i++)
-			{
-				if (!gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]]->isReadyToDraw())
-					continue;
+		// Bind instance buffer
+		VkDeviceSize instanceOffset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, instanceBinding, 1, &bakedAnimation->instanceBuffers[currentFrame].buffer, &instanceOffset);
 
-				Mesh* mesh = dynamic_cast<Mesh*>(gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]]);
+		PushConstantBakedAnimation pushConstant{};
+		bakedAnimation->getPlaybackFrame(bakedAnimationTime, pushConstant.frame, pushConstant.frameFraction);
+		pushConstant.numBones = bakedAnimation->numBones;
 
-				u32 bufferSize = mesh->getVulkanBufferSize();
+		for (u32 i = 0; i < bakedAnimation->meshIndicies.size(); i++)
+		{
+			const Mesh* mesh = meshes.at(bakedAnimation->meshIndicies[i]);
 
-				std::vector<VkBuffer> buffers = mesh->getVulkanBuffers();
+			if (!mesh->isReadyToDraw())
+				continue;
 
-				std::vector<VkDeviceSize> offsets = mesh->getVulkanOffset();
+			// Bind buffers
+			bindGeometry(commandBuffer, mesh, bindState);
 
-				// Bind buffers
-				vkCmdBindVertexBuffers(commandBuffer, 0, bufferSize, buffers.data(), offsets.data());
+			// Material and dequantisation of the positions of the mesh
+			pushConstant.positionOffset = vec4(mesh->positionOffset, 0);
+			pushConstant.positionScale = vec4(mesh->positionScale, 0);
+			pushConstant.materialIndex = bakedAnimation->materialIndicies[i];
 
-				vkCmdBindIndexBuffer(commandBuffer, mesh->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdPushConstants(commandBuffer, bakedSkeletalPipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstantBakedAnimation), &pushConstant);
 
-				// Bind Texture
-				// Check if the mesh has a material
-				if (gameState->graphicsResources.materials[meshComponent->materialIndicies[i]])
-					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[skeletalPipelineIdx].layout, 1, 1, &gameState->graphicsResources.materials[meshComponent->materialIndicies[i]]->textureDescriptorSet, 0, nullptr);
+			// The instances of a crowd share one draw, so they keep the full mesh
+			const MeshLod lod = mesh->getLod(0);
 
-				vkCmdDrawIndexed(commandBuffer, static_cast<u32>(mesh->indiciesSize), 3, 0, 0, 0);
-			}
+			vkCmdDrawIndexed(commandBuffer, lod.numIndices, bakedAnimation->getNumInstances(), mesh->geometryRange.firstIndex + lod.firstIndex,
+				static_cast<i32>(mesh->geometryRange.vertexOffset), 0);
 		}
 	}
 
-	//for (auto it = gameState->gameResources.entities.begin(); it != gameState->gameResources.entities.end(); it++)
-	//{
-	//	Entity* entity = it->second;
-
-	//	MeshComponent* meshComponent = entity->GetComponent<MeshComponent>();
-
-	//	bool hasRenderable = meshComponent != nullptr;
-
-	//	if (!entity->isEnable)
-	//		continue;
-
-	//	if (!hasRenderable)
-	//		continue;
-
-	//	// Get the skeletal
-	//	//Entity* rootEntity = entity->getRoot();
+	addBindStatistics(bindState);
+}
 
-	//	//if (!rootEntity->HasComponent<SkeletalComponent>())
-	//	//	continue;
-	//	if (!entity->AnyParentHasComponent<SkeletalComponent>())
-	//		continue;
+void VulkanEngine::geometryPasses(VkCommandBuffer& commandBuffer, VkExtent2D extent, u32 begin, u32 end)
+{
+	if (begin == end)
+		return;
 
-	//	TransformComponent* transformComponent = entity->components[typeid(TransformComponent)]->GetComponent<TransformComponent>();
+	const VulkanPipeline& geometryPipeline = pipelines[pipelineIndexLookup.at(VulkanPipelineType::Geometry)];
 
-	//	//SkeletalComponent* skeletalComp = rootEntity->GetComponent<SkeletalComponent>();
-	//	SkeletalComponent* skeletalComp = entity->AnyParentGetComponent<SkeletalComponent>();
-	//	Skeleton* skeleton = gameState->gameResources.skeletons[skeletalComp->skeletalId];
+	const VulkanDescriptorSet& sceneDescriptorSet = frames[currentFrame].uniformDescriptorSets.at(VulkanDescriptorSetType::Scene);
 
-	//	// Bind bone uniform buffer
-	//	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skeletalPipelineLayout, 2, 1, &skeleton->boneDescriptorSet.descriptorSet, 0, nullptr);
+	// Bind default pipeline
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, geometryPipeline.pipeline);
 
-	//	for (u32 i = 0; i < meshComponent->getNumMesh(); i++)
-	//	{
-	//		if (!gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]]->isReadyToDraw())
-	//			continue;
+	// Bind Scene Uniform Buffer
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, geometryPipeline.layout, 0, 1, &sceneDescriptorSet.descriptorSet, 0, nullptr);
 
-	//		Mesh* mesh = dynamic_cast<Mesh*>(gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]]);
+	// Bind textures and materials
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, geometryPipeline.layout, 1, 1, &bindlessTextures.descriptorSet, 0, nullptr);
 
-	//		u32 bufferSize = mesh->getVulkanBufferSize();
+	// Bind object data
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, geometryPipeline.layout, 2, 1, &frames[currentFrame].instanceBuffer.descriptorSet,
+		0, nullptr);
 
-	//		std::vector<VkBuffer> buffers = mesh->getVulkanBuffers();
+	VulkanBindState bindState{};
 
-	//		std::vector<VkDeviceSize> offsets = mesh->getVulkanOffset();
+	for (u32 i = begin; i < end; i++)
+	{
+		const VulkanInstancedDraw& draw = drawLists.meshInstances[i];
+		Mesh* mesh = draw.mesh;
 
-	//		// Bind buffers
-	//		vkCmdBindVertexBuffers(commandBuffer, 0, bufferSize, buffers.data(), offsets.data());
+		// Bind buffers
+		bindGeometry(commandBuffer, mesh, bindState);
 
-	//		vkCmdBindIndexBuffer(commandBuffer, mesh->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+		const MeshLod lod = mesh->getLod(draw.lod);
 
-	//		// Bind Texture
-	//		// Check if the mesh has a material
-	//		if (gameState->graphicsResources.materials[meshComponent->materialIndicies[i]])
-	//			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skeletalPipelineLayout, 1, 1, &gameState->graphicsResources.materials[meshComponent->materialIndicies[i]]->textureDescriptorSet, 0, nullptr);
+		// The instance index starts at the draw's first object
+		vkCmdDrawIndexed(commandBuffer, lod.numIndices, draw.numInstances, mesh->geometryRange.firstIndex + lod.firstIndex,
+			static_cast<i32>(mesh->geometryRange.vertexOffset), draw.firstInstance);
+	}
 
-	//		vkCmdDrawIndexed(commandBuffer, static_cast<u32>(mesh->indiciesSize), 3, 0, 0, 0);
-	//	}
-	//}
+	addBindStatistics(bindState);
 }
 
-void VulkanEngine::geometryPasses(VkCommandBuffer& commandBuffer, VkExtent2D extent)
+void VulkanEngine::shadowPasses(VkCommandBuffer& commandBuffer, u32 begin, u32 end)
 {
-	u32 geometryPipelineIdx = pipelineIndexLookup[VulkanPipelineType::Geometry];
-
-	VulkanDescriptorSet& sceneDescriptorSet = descriptorSets[VulkanDescriptorSetType::Scene];
-
-	// Bind default pipeline
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[geometryPipelineIdx].pipeline);
+	if (begin == end)
+		return;
 
-	// Bind Scene Uniform Buffer
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[geometryPipelineIdx].layout, 0, 1, &sceneDescriptorSet.descriptorSet, 0, nullptr);
+	const VulkanPipeline& shadowPipeline = pipelines[pipelineIndexLookup.at(VulkanPipelineType::Shadow)];
 
-	for(auto it = gameState->gameResources.entities.begin(); it != gameState->gameResources.entities.end(); it++)
-	{
-		Entity* entity = it->second;
+	const VulkanDescriptorSet& lightDescriptorSet = frames[currentFrame].uniformDescriptorSets.at(VulkanDescriptorSetType::Light);
+	const VulkanDescriptorSet& lightMatrixDescriptorSet = frames[currentFrame].uniformDescriptorSets.at(VulkanDescriptorSetType::LightMatrix);
 
-		MeshComponent* meshComponent = entity->GetComponent<MeshComponent>();
+	// Bind shadow pipeline
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline.pipeline);
 
-		bool hasRenderable = meshComponent != nullptr;
+	// Bind Light Uniform Buffer
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline.layout, 1, 1, &lightDescriptorSet.descriptorSet, 0, nullptr);
 
-		if (!entity->isEnable)
-			continue;
+	// Bind light matrices
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline.layout, 0, 1, &lightMatrixDescriptorSet.descriptorSet, 0, nullptr);
 
-		if (!hasRenderable)
-			continue;
+	// Bind object data
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline.layout, 2, 1, &frames[currentFrame].instanceBuffer.descriptorSet,
+		0, nullptr);
 
-		TransformComponent* transformComponent = entity->components[typeid(TransformComponent)]->GetComponent<TransformComponent>();
+	VulkanBindState bindState{};
 
-		for (u32 i = 0; i < meshComponent->getNumMesh(); i++)
-		{
-			if (!gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]]->isReadyToDraw())
-				continue;
+	for (u32 i = begin; i < end; i++)
+	{
+		const VulkanInstancedDraw& draw = drawLists.shadowInstances[i];
+		Mesh* mesh = draw.mesh;
 
-			// Don't render if it has skeletal component as we have rendered it already
-			if (entity->AnyParentHasComponent<SkeletalComponent>())
-				continue;
+		// Bind buffers
+		bindGeometry(commandBuffer, mesh, bindState);
 
-			Mesh* mesh = gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]];
+		const MeshLod lod = mesh->getLod(draw.lod);
 
-			u32 bufferSize = mesh->getVulkanBufferSize();
+		// The instance index starts at the draw's first object
+		vkCmdDrawIndexed(commandBuffer, lod.numIndices, draw.numInstances, mesh->geometryRange.firstIndex + lod.firstIndex,
+			static_cast<i32>(mesh->geometryRange.vertexOffset), draw.firstInstance);
+	}
 
-			std::vector<VkBuffer> buffers = mesh->getVulkanBuffers();
+	addBindStatistics(bindState);
+}
 
-			std::vector<VkDeviceSize> offsets = mesh->getVulkanOffset();
+void VulkanEngine::depthIndirectPrePasses(VkCommandBuffer& commandBuffer, u32 begin, u32 end, u32 part)
+{
+	if (begin == end)
+		return;
 
-			// Bind buffers
-			vkCmdBindVertexBuffers(commandBuffer, 0, bufferSize, buffers.data(), offsets.data());
+	const VulkanPipeline& depthPipeline = pipelines[pipelineIndexLookup.at(VulkanPipelineType::DepthIndirect)];
 
-			vkCmdBindIndexBuffer(commandBuffer, mesh->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+	const VulkanDescriptorSet& sceneDescriptorSet = frames[currentFrame].uniformDescriptorSets.at(VulkanDescriptorSetType::Scene);
 
-			// Bind Texture
-			// Check if the mesh has a material
-			if (gameState->graphicsResources.materials[meshComponent->materialIndicies[i]])
-				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[geometryPipelineIdx].layout, 1, 1, &gameState->graphicsResources.materials[meshComponent->materialIndicies[i]]->textureDescriptorSet, 0, nullptr);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPipeline.pipeline);
 
-			// Push constant for model matrix
-			// Copying the reference is faster than copying the actual mat4 value
-			mat4& transformation = transformComponent->getWorldTransformation();
+	// Bind Scene Uniform Buffer
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPipeline.layout, 0, 1, &sceneDescriptorSet.descriptorSet, 0, nullptr);
 
-			vkCmdPushConstants(commandBuffer, pipelines[geometryPipelineIdx].layout, VK_SHADER_STAGE_VERTEX_BIT, 0,
-				sizeof(transformation), &transformation);
+	// Bind objects and visible objects
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPipeline.layout, 1, 1, &frames[currentFrame].indirectBuffers.descriptorSet,
+		0, nullptr);
 
-			vkCmdDrawIndexed(commandBuffer, static_cast<u32>(mesh->indiciesSize), 3, 0, 0, 0);
-		}
-	}
+	drawIndirectBatches(commandBuffer, begin, end, part);
 }
 
-void VulkanEngine::shadowPasses(VkCommandBuffer& commandBuffer)
+void VulkanEngine::geometryIndirectPasses(VkCommandBuffer& commandBuffer, u32 begin, u32 end)
 {
-	u32 shadowPipelineIdx = pipelineIndexLookup[VulkanPipelineType::Shadow];
+	if (begin == end)
+		return;
 
-	VulkanDescriptorSet& lightDescriptorSet = descriptorSets[VulkanDescriptorSetType::Light];
-	VulkanDescriptorSet& lightMatrixDescriptorSet = descriptorSets[VulkanDescriptorSetType::LightMatrix];
+	const VulkanPipeline& geometryPipeline = pipelines[pipelineIndexLookup.at(VulkanPipelineType::GeometryIndirect)];
 
-	// Update light matrices buffer
-	vkCmdUpdateBuffer(commandBuffer, lightMatrixDescriptorSet.buffer.buffer, 0, sizeof(mat4) * 6, &gameState->graphicsResources.lights[1]->matrices);
+	const VulkanDescriptorSet& sceneDescriptorSet = frames[currentFrame].uniformDescriptorSets.at(VulkanDescriptorSetType::Scene);
 
-	VkClearValue clearValue[1];
-	// Clear Depth
-	clearValue[0].depthStencil.depth = 1.0f;
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, geometryPipeline.pipeline);
 
-	VulkanFramebuffer& shadowFramebuffer = framebuffers[VulkanFramebufferType::ShadowMap];
-	VkRenderPass& shadowRenderPass = renderPasses[VulkanRenderPassType::Shadow];
+	// Bind Scene Uniform Buffer
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, geometryPipeline.layout, 0, 1, &sceneDescriptorSet.descriptorSet, 0, nullptr);
 
-	// Begin Render Pass
-	VkRenderPassBeginInfo renderPassBeginInfo{};
-	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassBeginInfo.renderPass = shadowRenderPass;
-	renderPassBeginInfo.framebuffer = shadowFramebuffer.framebuffer;
-	renderPassBeginInfo.renderArea.extent.width = 1024;
-	renderPassBeginInfo.renderArea.extent.height = 1024;
-	renderPassBeginInfo.clearValueCount = static_cast<u32>(sizeof(clearValue) / sizeof(clearValue[0]));
-	renderPassBeginInfo.pClearValues = clearValue;
+	// Bind textures and materials
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, geometryPipeline.layout, 1, 1, &bindlessTextures.descriptorSet, 0, nullptr);
 
-	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	// Bind objects and visible objects
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, geometryPipeline.layout, 2, 1,
+		&frames[currentFrame].indirectBuffers.descriptorSet, 0, nullptr);
 
-	// Bind shadow pipeline
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[shadowPipelineIdx].pipeline);
+	drawIndirectBatches(commandBuffer, begin, end, 0);
 
-	// Bind Light Uniform Buffer
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[shadowPipelineIdx].layout, 1, 1, &lightDescriptorSet.descriptorSet, 0, nullptr);
+	// The objects found visible by the second culling phase, the late depth pass has added their depth
+	if (occlusionCulling)
+		drawIndirectBatches(commandBuffer, begin, end, 2);
+}
 
-	// Bind light matrices
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[shadowPipelineIdx].layout, 0, 1, &lightMatrixDescriptorSet.descriptorSet, 0, nullptr);
+void VulkanEngine::shadowIndirectPasses(VkCommandBuffer& commandBuffer, u32 begin, u32 end)
+{
+	if (begin == end)
+		return;
 
-	for(auto it = gameState->gameResources.entities.begin(); it != gameState->gameResources.entities.end(); it++)
-	{
-		Entity* entity = it->second;
+	const VulkanPipeline& shadowPipeline = pipelines[pipelineIndexLookup.at(VulkanPipelineType::ShadowIndirect)];
 
-		MeshComponent* meshComponent = entity->GetComponent<MeshComponent>();
+	const VulkanDescriptorSet& lightDescriptorSet = frames[currentFrame].uniformDescriptorSets.at(VulkanDescriptorSetType::Light);
+	const VulkanDescriptorSet& lightMatrixDescriptorSet = frames[currentFrame].uniformDescriptorSets.at(VulkanDescriptorSetType::LightMatrix);
 
-		if (!entity->isEnable)
-			continue;
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline.pipeline);
 
-		if (!meshComponent)
-			continue;
+	// Bind light matrices and Light Uniform Buffer
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline.layout, 0, 1, &lightMatrixDescriptorSet.descriptorSet, 0, nullptr);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline.layout, 1, 1, &lightDescriptorSet.descriptorSet, 0, nullptr);
 
-		// Ignore this entity if it is a light
-		if (entity->HasComponent<LightComponent>())
-			continue;
+	// Bind objects and visible objects
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline.layout, 2, 1,
+		&frames[currentFrame].indirectBuffers.descriptorSet, 0, nullptr);
 
-		for (u32 i = 0; i < meshComponent->getNumMesh(); i++)
-		{
-			if (!gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]]->isReadyToDraw())
-				continue;
+	// The shadow draws come after the camera draws
+	drawIndirectBatches(commandBuffer, begin, end, 1);
+}
 
-			Mesh* mesh = gameState->graphicsResources.meshes[meshComponent->meshIndicies[i]];
+void VulkanEngine::bindGeometry(VkCommandBuffer& commandBuffer, const Mesh* mesh, VulkanBindState& bindState)
+{
+	const VkIndexType indexType = mesh->geometryRange.indexType;
+
+	// Every mesh of a pass usually shares one arena, so the buffers are bound by the first draw only
+	if (mesh->geometryArena == bindState.geometryArena && indexType == bindState.indexType)
+	{
+		bindState.skippedBinds++;
 
-			u32 bufferSize = mesh->getVulkanBufferSize();
+		return;
+	}
 
-			std::vector<VkBuffer> buffers = mesh->getVulkanBuffers();
+	// The vertex buffers stay bound if only the index type changes
+	if (mesh->geometryArena != bindState.geometryArena)
+		mesh->geometryArena->bindVertices(commandBuffer);
 
-			std::vector<VkDeviceSize> offsets = mesh->getVulkanOffset();
+	mesh->geometryArena->bindIndices(commandBuffer, indexType);
 
-			// Bind buffers
-			vkCmdBindVertexBuffers(commandBuffer, 0, bufferSize, buffers.data(), offsets.data());
+	bindState.geometryArena = mesh->geometryArena;
+	bindState.indexType = indexType;
+	bindState.binds++;
+}
 
-			vkCmdBindIndexBuffer(commandBuffer, mesh->indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+void VulkanEngine::addBindStatistics(const VulkanBindState& bindState)
+{
+	numBinds += bindState.binds;
+	numSkippedBinds += bindState.skippedBinds;
+}
+
+void VulkanEngine::drawIndirectBatches(VkCommandBuffer& commandBuffer, u32 begin, u32 end, u32 part)
+{
+	const VulkanIndirectBuffers& indirectBuffers = frames[currentFrame].indirectBuffers;
 
-			// Push constant for model matrix
-			TransformComponent* transformComponent = entity->GetComponent<TransformComponent>();
-			// Copying the reference is faster than copying the actual mat4 value
-			mat4& transformation = transformComponent->getWorldTransformation();
-			vkCmdPushConstants(commandBuffer, pipelines[shadowPipelineIdx].layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(transformation), &transformation);
+	const u32 numBatches = static_cast<u32>(drawLists.indirectBatches.size());
 
-			vkCmdDrawIndexed(commandBuffer, static_cast<u32>(mesh->indiciesSize), 3, 0, 0, 0);
+	VulkanBindState bindState{};
+
+	for (u32 i = begin; i < end; i++)
+	{
+		const VulkanIndirectBatch& batch = drawLists.indirectBatches[i];
+		Mesh* mesh = batch.mesh;
+
+		// Bind buffers
+		bindGeometry(commandBuffer, mesh, bindState);
+
+		// The clusters of a batch have consecutive draws
+		const VkDeviceSize drawOffset = sizeof(VkDrawIndexedIndirectCommand) * (part * drawLists.numIndirectClusters + batch.firstCluster);
+		const u32 countIndex = part * numBatches + i;
+
+		// The count ends at the last cluster with a visible object, it is 0 if the culling shader found none
+		if (drawIndirectCount)
+			vkCmdDrawIndexedIndirectCount(commandBuffer, indirectBuffers.drawCommandBuffer.buffer, drawOffset, indirectBuffers.drawCountBuffer.buffer,
+				sizeof(u32) * countIndex, batch.numClusters, sizeof(VkDrawIndexedIndirectCommand));
+		else if (multiDrawIndirect)
+			vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffers.drawCommandBuffer.buffer, drawOffset, batch.numClusters,
+				sizeof(VkDrawIndexedIndirectCommand));
+		else
+		{
+			for (u32 j = 0; j < batch.numClusters; j++)
+			{
+				vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffers.drawCommandBuffer.buffer, drawOffset + sizeof(VkDrawIndexedIndirectCommand) * j, 1,
+					sizeof(VkDrawIndexedIndirectCommand));
+			}
 		}
 	}
 
-	vkCmdEndRenderPass(commandBuffer);
+	addBindStatistics(bindState);
 }
 
 void VulkanEngine::shadingPasses(VkCommandBuffer& commandBuffer, VkRenderPass& renderPass, VkFramebuffer& framebuffer, VkExtent2D extent)
 {
-	VulkanDescriptorSet& lightDescriptorSet = descriptorSets[VulkanDescriptorSetType::Light];
-	VulkanDescriptorSet& cameraDescriptorSet = descriptorSets[VulkanDescriptorSetType::Camera];
+	VulkanDescriptorSet& lightDescriptorSet = frames[currentFrame].uniformDescriptorSets[VulkanDescriptorSetType::Light];
+	VulkanDescriptorSet& cameraDescriptorSet = frames[currentFrame].uniformDescriptorSets[VulkanDescriptorSetType::Camera];
 	VulkanDescriptorSet& attachmentDescriptorSet = descriptorSets[VulkanDescriptorSetType::Attachment];
 	VulkanDescriptorSet& shadowMapDescriptorSet = descriptorSets[VulkanDescriptorSetType::ShadowMap];
 
@@ -2726,18 +4465,9 @@ void VulkanEngine::UIPasses(VkCommandBuffer& commandBuffer, VkRenderPass& render
 
 void VulkanEngine::recordDownscaleComputeCommands(VkCommandBuffer& commandBuffer)
 {
-	// Begin command buffer
-	VkCommandBufferBeginInfo commandBeginInfo{};
-	commandBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	commandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
 	u32 filterBrightPipelineIdx = pipelineIndexLookup[VulkanPipelineType::FilterBright];
 	u32 downscalePipelineIdx = pipelineIndexLookup[VulkanPipelineType::Downscale];
 
-
-	if (vkBeginCommandBuffer(commandBuffer, &commandBeginInfo) != VK_SUCCESS)
-		throw std::runtime_error("Failed to begin command buffer");
-
 	// Bind Pipeline for filtering bright color
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[filterBrightPipelineIdx].pipeline);
 
@@ -2773,22 +4503,12 @@ void VulkanEngine::recordDownscaleComputeCommands(VkCommandBuffer& commandBuffer
 		&gameState->graphicsState.upSampledImageDescriptorSetOutput[gameState->graphicsState.upSampledImageDescriptorSetOutput.size() - 1].descriptorSet, 0, nullptr);
 
 	vkCmdDispatch(commandBuffer, sceneExtent.width / 16, sceneExtent.height / 16, 1);
-
-	vkEndCommandBuffer(commandBuffer);
 }
 
 void VulkanEngine::recordUpscaleComputeCommands(VkCommandBuffer& commandBuffer)
 {
 	u32 upscalePipelineIdx = pipelineIndexLookup[VulkanPipelineType::Upscale];
 
-	// Begin command buffer
-	VkCommandBufferBeginInfo commandBeginInfo{};
-	commandBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	commandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-	if (vkBeginCommandBuffer(commandBuffer, &commandBeginInfo) != VK_SUCCESS)
-		throw std::runtime_error("Failed to begin command buffer");
-
 	// Upscaling the image
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[upscalePipelineIdx].pipeline);
 
@@ -2805,22 +4525,12 @@ void VulkanEngine::recordUpscaleComputeCommands(VkCommandBuffer& commandBuffer)
 
 		vkCmdDispatch(commandBuffer, sceneExtent.width / 16, sceneExtent.height / 16, 1);
 	}
-
-	vkEndCommandBuffer(commandBuffer);
 }
 
 void VulkanEngine::recordBlendColorComputeCommands(VkCommandBuffer& commandBuffer)
 {
 	u32 blendColorPipelineIdx = pipelineIndexLookup[VulkanPipelineType::BlendColor];
 
-	// Begin command buffer
-	VkCommandBufferBeginInfo commandBeginInfo{};
-	commandBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	commandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-	if (vkBeginCommandBuffer(commandBuffer, &commandBeginInfo) != VK_SUCCESS)
-		throw std::runtime_error("Failed to begin command buffer");
-
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[blendColorPipelineIdx].pipeline);
 
 	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[blendColorPipelineIdx].layout, 0, 1,
@@ -2830,25 +4540,13 @@ void VulkanEngine::recordBlendColorComputeCommands(VkCommandBuffer& commandBuffe
 		&gameState->graphicsState.upSampledImageDescriptorSetOutput[0].descriptorSet, 0, nullptr);
 
 	vkCmdDispatch(commandBuffer, sceneExtent.width / 16, sceneExtent.height / 16, 1);
-
-	vkEndCommandBuffer(commandBuffer);
 }
 
 void VulkanEngine::recordUICommands(VkCommandBuffer& commandBuffer, VkFramebuffer& framebuffer, VkExtent2D& extent)
 {
-	// Begin command buffer
-	VkCommandBufferBeginInfo commandBeginInfo{};
-	commandBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	commandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-	if (vkBeginCommandBuffer(commandBuffer, &commandBeginInfo) != VK_SUCCESS)
-		throw std::runtime_error("Failed to begin command buffer");
-
 	VkRenderPass& presentRenderPass = renderPasses[VulkanRenderPassType::Present];
 
 	UIPasses(commandBuffer, presentRenderPass, framebuffer, extent);
-
-	vkEndCommandBuffer(commandBuffer);
 }
 
 void VulkanEngine::submitCommands(u32 commandBufferCount, VkCommandBuffer* commandBuffer, u32 waitSemaphoreCount, VkSemaphore* waitSemaphore, u32 signalSemaphoreCount, 
@@ -2872,6 +4570,91 @@ void VulkanEngine::submitCommands(u32 commandBufferCount, VkCommandBuffer* comma
 		vkQueueSubmit(graphicsQueue, 1, &submitInfo, *fence);
 }
 
+void VulkanEngine::submitRenderGraphBatches(std::vector<VulkanRenderGraphBatch>& batches, VkSemaphore& imageAvailable, VkSemaphore& readyToPresent,
+	VkQueue& graphicsQueue, VkFence& fence)
+{
+	for (u32 i = 0; i < batches.size(); i++)
+	{
+		VulkanRenderGraphBatch& batch = batches[i];
+		const bool lastBatch = i == batches.size() - 1;
+
+		// The values of binary semaphores are ignored
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<VkPipelineStageFlags> waitStages;
+		std::vector<u64> waitValues;
+
+		std::vector<VkSemaphore> signalSemaphores;
+		std::vector<u64> signalValues;
+
+		// Only the UI pass writes to the swapchain image, so only the last batch waits for it to be acquired
+		if (lastBatch)
+		{
+			waitSemaphores.push_back(imageAvailable);
+			waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+			waitValues.push_back(0);
+
+			signalSemaphores.push_back(readyToPresent);
+			signalValues.push_back(0);
+		}
+
+		if (asyncCompute)
+		{
+			if (i > 0)
+			{
+				// The batch before ran on the other queue
+				waitSemaphores.push_back(timelineSemaphore);
+				waitStages.push_back(batch.asyncCompute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+				waitValues.push_back(timelineValue);
+			}
+			else if (computeTimelineValue > 0)
+			{
+				// The bloom of the previous frame may still be using the shading image
+				// Only writing color attachments waits for it, the depth and shadow passes overlap with it
+				waitSemaphores.push_back(timelineSemaphore);
+				waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+				waitValues.push_back(computeTimelineValue);
+			}
+
+			timelineValue++;
+			signalSemaphores.push_back(timelineSemaphore);
+			signalValues.push_back(timelineValue);
+
+			if (batch.asyncCompute)
+				computeTimelineValue = timelineValue;
+		}
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.waitSemaphoreValueCount = static_cast<u32>(waitValues.size());
+		timelineInfo.pWaitSemaphoreValues = waitValues.data();
+		timelineInfo.signalSemaphoreValueCount = static_cast<u32>(signalValues.size());
+		timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = asyncCompute ? &timelineInfo : nullptr;
+		submitInfo.waitSemaphoreCount = static_cast<u32>(waitSemaphores.size());
+		submitInfo.pWaitSemaphores = waitSemaphores.data();
+		submitInfo.pWaitDstStageMask = waitStages.data();
+		submitInfo.commandBufferCount = static_cast<u32>(batch.commandBuffers.size());
+		submitInfo.pCommandBuffers = batch.commandBuffers.data();
+		submitInfo.signalSemaphoreCount = static_cast<u32>(signalSemaphores.size());
+		submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+		// Every batch before the last one is waited on by the last one, so the fence covers the whole frame
+		VkQueue& queue = batch.asyncCompute ? computeQueue : graphicsQueue;
+		if (vkQueueSubmit(queue, 1, &submitInfo, lastBatch ? fence : VK_NULL_HANDLE) != VK_SUCCESS)
+			throw std::runtime_error("Failed to submit render graph batch");
+	}
+}
+
+void VulkanEngine::recordPassBarrier(VkCommandBuffer& commandBuffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage,
+	VkAccessFlags dstAccess)
+{
+	// Passes in the same submission are not ordered by semaphores, so every pass ends with a barrier for the passes reading its output
+	WillEngine::VulkanUtil::memoryBarrier(commandBuffer, srcAccess, dstAccess, srcStage, dstStage);
+}
+
 void VulkanEngine::presentImage(VkQueue& graphicsQueue, VkSemaphore& waitSemaphore, VkSwapchainKHR& swapchain, u32& swapchainIndex)
 {
 	VkPresentInfoKHR presentInfo{};
@@ -2989,6 +4772,12 @@ void VulkanEngine::changeMaterialTexture(VkDevice& logicalDevice, VkPhysicalDevi
 		gameState->materialUpdateInfo.updateColor = false;
 	}
 
-	// Update the associated descriptor set
-	currentMaterial->updateDescriptorSet(logicalDevice, physicalDevice, vmaAllocator, commandPool, descriptorPool, graphicsQueue, textureIndex);
+	// Recreate the image, the texture keeps its element of the bindless texture array
+	currentMaterial->updateTexture(logicalDevice, physicalDevice, vmaAllocator, commandPool, graphicsQueue, textureIndex);
+
+	// Every frame has finished on the GPU, so the element can be rewritten even though it is in use
+	writeBindlessTexture(logicalDevice, currentTexture);
+
+	// The emissive texture or colour may have changed
+	updateMaterialFlags(currentMaterial);
 }
\ No newline at end of file
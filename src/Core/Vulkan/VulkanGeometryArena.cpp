@@ -0,0 +1,478 @@
+#include "pch.h"
+#include "Core/Vulkan/VulkanGeometryArena.h"
+
+#include "Utils/VulkanUtil.h"
+
+VulkanGeometryArena::VulkanGeometryArena() :
+	strides(),
+	compressed(false),
+	vertexBuffers(),
+	vertexBufferHandles(),
+	vertexBufferOffsets(),
+	vertexAllocator(),
+	indexBuffers(),
+	ranges()
+{
+	indexBuffers[0].indexType = VK_INDEX_TYPE_UINT16;
+	indexBuffers[0].indexSize = sizeof(u16);
+	indexBuffers[1].indexType = VK_INDEX_TYPE_UINT32;
+	indexBuffers[1].indexSize = sizeof(u32);
+
+	for (VulkanGeometryIndices& indexBuffer : indexBuffers)
+	{
+		indexBuffer.buffer = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+	}
+}
+
+VulkanGeometryArena::~VulkanGeometryArena()
+{
+
+}
+
+void VulkanGeometryArena::init(VmaAllocator& vmaAllocator, const VulkanVertexInput& vertexInput, u32 vertexCapacity, u32 indexCapacity)
+{
+	strides.clear();
+	for (u32 i = 0; i < vertexInput.numStreams; i++)
+	{
+		strides.push_back(vertexInput.bindings[i].stride);
+	}
+
+	compressed = vertexInput.compressed;
+
+	createVertexBuffers(vmaAllocator, vertexCapacity);
+	vertexAllocator.reset(vertexCapacity);
+
+	for (VulkanGeometryIndices& indexBuffer : indexBuffers)
+	{
+		createIndexBuffer(vmaAllocator, indexBuffer, indexCapacity);
+		indexBuffer.allocator.reset(indexCapacity);
+	}
+}
+
+void VulkanGeometryArena::destroy(VmaAllocator& vmaAllocator)
+{
+	for (VulkanAllocatedMemory& vertexBuffer : vertexBuffers)
+	{
+		vmaDestroyBuffer(vmaAllocator, vertexBuffer.buffer, vertexBuffer.allocation);
+	}
+
+	vertexBuffers.clear();
+	vertexBufferHandles.clear();
+	vertexBufferOffsets.clear();
+	vertexAllocator.reset(0);
+
+	for (VulkanGeometryIndices& indexBuffer : indexBuffers)
+	{
+		vmaDestroyBuffer(vmaAllocator, indexBuffer.buffer.buffer, indexBuffer.buffer.allocation);
+
+		indexBuffer.buffer = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+		indexBuffer.allocator.reset(0);
+	}
+
+	// The ranges still handed out point into destroyed buffers
+	for (VulkanGeometryRange* range : ranges)
+	{
+		*range = VulkanGeometryRange{};
+	}
+
+	ranges.clear();
+}
+
+void VulkanGeometryArena::upload(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkSurfaceKHR& surface,
+	VkQueue& queue, VulkanGeometryRange& range, const std::vector<const void*>& vertexData, u32 numVertices, const u32* indices, u32 numIndices)
+{
+	if (vertexData.size() != strides.size())
+		throw std::runtime_error("Vertex streams do not match the geometry arena");
+
+	const VkIndexType indexType = numVertices <= MAX_16_BIT_VERTICES ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	VulkanGeometryIndices& indexBuffer = getIndexBuffer(indexType);
+
+	// Grow the buffers if no free range is large enough, the added space is at the end so it always fits
+	const u32 vertexCapacity = vertexAllocator.getCapacity();
+	const u32 newVertexCapacity = vertexAllocator.getLargestFreeRange() < numVertices ?
+		std::max(vertexCapacity * 2, vertexCapacity + numVertices) : vertexCapacity;
+
+	std::array<u32, NUM_INDEX_TYPES> indexCapacities{};
+	for (u32 i = 0; i < NUM_INDEX_TYPES; i++)
+	{
+		indexCapacities[i] = indexBuffers[i].allocator.getCapacity();
+	}
+
+	const u32 indexCapacity = indexBuffer.allocator.getCapacity();
+	const u32 newIndexCapacity = indexBuffer.allocator.getLargestFreeRange() < numIndices ?
+		std::max(indexCapacity * 2, indexCapacity + numIndices) : indexCapacity;
+
+	if (newVertexCapacity != vertexCapacity || newIndexCapacity != indexCapacity)
+	{
+		std::vector<VkBufferCopy> vertexCopies;
+		if (newVertexCapacity != vertexCapacity)
+			vertexCopies.push_back({ 0, 0, vertexCapacity });
+
+		std::array<std::vector<VkBufferCopy>, NUM_INDEX_TYPES> indexCopies;
+		if (newIndexCapacity != indexCapacity)
+		{
+			const u32 i = indexType == VK_INDEX_TYPE_UINT16 ? 0 : 1;
+			indexCapacities[i] = newIndexCapacity;
+			indexCopies[i].push_back({ 0, 0, indexCapacity });
+		}
+
+		resize(logicalDevice, physicalDevice, vmaAllocator, surface, queue, newVertexCapacity, indexCapacities, vertexCopies, indexCopies);
+
+		vertexAllocator.grow(newVertexCapacity);
+		indexBuffer.allocator.grow(newIndexCapacity);
+	}
+
+	range = VulkanGeometryRange{};
+	range.numVertices = numVertices;
+	range.numIndices = numIndices;
+	range.indexType = indexType;
+
+	if (!vertexAllocator.allocate(numVertices, range.vertexOffset) || !indexBuffer.allocator.allocate(numIndices, range.firstIndex))
+		throw std::runtime_error("Failed to allocate geometry");
+
+	ranges.push_back(&range);
+
+	// Every stream and the indices share one staging buffer
+	u64 stagingSize = static_cast<u64>(indexBuffer.indexSize) * numIndices;
+	for (u32 stride : strides)
+	{
+		stagingSize += static_cast<u64>(stride) * numVertices;
+	}
+
+	if (stagingSize == 0)
+		return;
+
+	VulkanAllocatedMemory stagingBuffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	void* stagingPtr = nullptr;
+	if (vmaMapMemory(vmaAllocator, stagingBuffer.allocation, &stagingPtr) != VK_SUCCESS)
+		throw std::runtime_error("Failed to map memory");
+
+	std::vector<VkBufferCopy> vertexCopies(strides.size());
+
+	u8* stagingData = static_cast<u8*>(stagingPtr);
+	VkDeviceSize stagingOffset = 0;
+	for (u32 i = 0; i < strides.size(); i++)
+	{
+		vertexCopies[i].srcOffset = stagingOffset;
+		vertexCopies[i].dstOffset = static_cast<VkDeviceSize>(strides[i]) * range.vertexOffset;
+		vertexCopies[i].size = static_cast<VkDeviceSize>(strides[i]) * numVertices;
+
+		std::memcpy(stagingData + stagingOffset, vertexData[i], vertexCopies[i].size);
+		stagingOffset += vertexCopies[i].size;
+	}
+
+	VkBufferCopy indexCopy{};
+	indexCopy.srcOffset = stagingOffset;
+	indexCopy.dstOffset = static_cast<VkDeviceSize>(indexBuffer.indexSize) * range.firstIndex;
+	indexCopy.size = static_cast<VkDeviceSize>(indexBuffer.indexSize) * numIndices;
+
+	// Narrowed while copying, the staging buffer is the only copy of the 16 bit indices
+	if (indexType == VK_INDEX_TYPE_UINT16)
+	{
+		u16* stagingIndices = reinterpret_cast<u16*>(stagingData + stagingOffset);
+		for (u32 i = 0; i < numIndices; i++)
+		{
+			stagingIndices[i] = static_cast<u16>(indices[i]);
+		}
+	}
+	else
+	{
+		std::memcpy(stagingData + stagingOffset, indices, indexCopy.size);
+	}
+
+	vmaUnmapMemory(vmaAllocator, stagingBuffer.allocation);
+
+	submit(logicalDevice, physicalDevice, surface, queue, [&](VkCommandBuffer& commandBuffer)
+		{
+			for (u32 i = 0; i < strides.size(); i++)
+			{
+				if (vertexCopies[i].size == 0)
+					continue;
+
+				vkCmdCopyBuffer(commandBuffer, stagingBuffer.buffer, vertexBuffers[i].buffer, 1, &vertexCopies[i]);
+
+				WillEngine::VulkanUtil::bufferBarrier(commandBuffer, vertexBuffers[i].buffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+					VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, vertexCopies[i].size, vertexCopies[i].dstOffset,
+					VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
+			}
+
+			if (indexCopy.size == 0)
+				return;
+
+			vkCmdCopyBuffer(commandBuffer, stagingBuffer.buffer, indexBuffer.buffer.buffer, 1, &indexCopy);
+
+			WillEngine::VulkanUtil::bufferBarrier(commandBuffer, indexBuffer.buffer.buffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_INDEX_READ_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, indexCopy.size, indexCopy.dstOffset,
+				VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
+		});
+
+	vmaDestroyBuffer(vmaAllocator, stagingBuffer.buffer, stagingBuffer.allocation);
+}
+
+void VulkanGeometryArena::free(VulkanGeometryRange& range)
+{
+	// A range is only freed once
+	auto it = std::find(ranges.begin(), ranges.end(), &range);
+	if (it == ranges.end())
+		return;
+
+	*it = ranges.back();
+	ranges.pop_back();
+
+	vertexAllocator.free(range.vertexOffset, range.numVertices);
+	getIndexBuffer(range.indexType).allocator.free(range.firstIndex, range.numIndices);
+
+	range = VulkanGeometryRange{};
+}
+
+void VulkanGeometryArena::defragment(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkSurfaceKHR& surface,
+	VkQueue& queue)
+{
+	std::vector<VulkanGeometryRange*> sortedRanges = ranges;
+
+	// Allocating the ranges in order from an empty allocator packs them at the start, keeping their order
+	std::vector<VkBufferCopy> vertexCopies;
+	vertexCopies.reserve(sortedRanges.size());
+
+	std::sort(sortedRanges.begin(), sortedRanges.end(), [](const VulkanGeometryRange* a, const VulkanGeometryRange* b)
+		{
+			return a->vertexOffset < b->vertexOffset;
+		});
+
+	vertexAllocator.reset(vertexAllocator.getCapacity());
+	for (VulkanGeometryRange* range : sortedRanges)
+	{
+		VkBufferCopy copy{};
+		copy.srcOffset = range->vertexOffset;
+		copy.size = range->numVertices;
+
+		u32 vertexOffset = 0;
+		vertexAllocator.allocate(range->numVertices, vertexOffset);
+		copy.dstOffset = vertexOffset;
+
+		range->vertexOffset = vertexOffset;
+
+		if (copy.size > 0)
+			vertexCopies.push_back(copy);
+	}
+
+	std::array<u32, NUM_INDEX_TYPES> indexCapacities{};
+	std::array<std::vector<VkBufferCopy>, NUM_INDEX_TYPES> indexCopies;
+
+	std::sort(sortedRanges.begin(), sortedRanges.end(), [](const VulkanGeometryRange* a, const VulkanGeometryRange* b)
+		{
+			return a->firstIndex < b->firstIndex;
+		});
+
+	for (u32 i = 0; i < NUM_INDEX_TYPES; i++)
+	{
+		VulkanGeometryIndices& indexBuffer = indexBuffers[i];
+
+		indexCapacities[i] = indexBuffer.allocator.getCapacity();
+		indexBuffer.allocator.reset(indexCapacities[i]);
+
+		for (VulkanGeometryRange* range : sortedRanges)
+		{
+			if (range->indexType != indexBuffer.indexType)
+				continue;
+
+			VkBufferCopy copy{};
+			copy.srcOffset = range->firstIndex;
+			copy.size = range->numIndices;
+
+			u32 firstIndex = 0;
+			indexBuffer.allocator.allocate(range->numIndices, firstIndex);
+			copy.dstOffset = firstIndex;
+
+			range->firstIndex = firstIndex;
+
+			if (copy.size > 0)
+				indexCopies[i].push_back(copy);
+		}
+	}
+
+	resize(logicalDevice, physicalDevice, vmaAllocator, surface, queue, vertexAllocator.getCapacity(), indexCapacities, vertexCopies, indexCopies);
+}
+
+void VulkanGeometryArena::bindVertices(VkCommandBuffer& commandBuffer) const
+{
+	vkCmdBindVertexBuffers(commandBuffer, 0, getNumStreams(), vertexBufferHandles.data(), vertexBufferOffsets.data());
+}
+
+void VulkanGeometryArena::bindIndices(VkCommandBuffer& commandBuffer, VkIndexType indexType) const
+{
+	vkCmdBindIndexBuffer(commandBuffer, getIndexBuffer(indexType).buffer.buffer, 0, indexType);
+}
+
+f32 VulkanGeometryArena::getFragmentation() const
+{
+	f32 fragmentation = vertexAllocator.getFragmentation();
+	for (const VulkanGeometryIndices& indexBuffer : indexBuffers)
+	{
+		fragmentation = std::max(fragmentation, indexBuffer.allocator.getFragmentation());
+	}
+
+	return fragmentation;
+}
+
+u64 VulkanGeometryArena::getMemorySize() const
+{
+	u64 vertexSize = 0;
+	for (u32 stride : strides)
+	{
+		vertexSize += stride;
+	}
+
+	u64 memorySize = vertexSize * vertexAllocator.getCapacity();
+	for (const VulkanGeometryIndices& indexBuffer : indexBuffers)
+	{
+		memorySize += static_cast<u64>(indexBuffer.indexSize) * indexBuffer.allocator.getCapacity();
+	}
+
+	return memorySize;
+}
+
+void VulkanGeometryArena::resize(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VmaAllocator& vmaAllocator, VkSurfaceKHR& surface,
+	VkQueue& queue, u32 vertexCapacity, const std::array<u32, NUM_INDEX_TYPES>& indexCapacities, const std::vector<VkBufferCopy>& vertexCopies,
+	const std::array<std::vector<VkBufferCopy>, NUM_INDEX_TYPES>& indexCopies)
+{
+	// Frames in flight still read the old buffers
+	vkDeviceWaitIdle(logicalDevice);
+
+	const bool replaceVertices = vertexCapacity != vertexAllocator.getCapacity() || !vertexCopies.empty();
+
+	std::array<bool, NUM_INDEX_TYPES> replaceIndices{};
+	for (u32 i = 0; i < NUM_INDEX_TYPES; i++)
+	{
+		replaceIndices[i] = indexCapacities[i] != indexBuffers[i].allocator.getCapacity() || !indexCopies[i].empty();
+	}
+
+	std::vector<VulkanAllocatedMemory> oldVertexBuffers = vertexBuffers;
+	if (replaceVertices)
+		createVertexBuffers(vmaAllocator, vertexCapacity);
+
+	std::array<VulkanAllocatedMemory, NUM_INDEX_TYPES> oldIndexBuffers{};
+	for (u32 i = 0; i < NUM_INDEX_TYPES; i++)
+	{
+		oldIndexBuffers[i] = indexBuffers[i].buffer;
+
+		if (replaceIndices[i])
+			createIndexBuffer(vmaAllocator, indexBuffers[i], indexCapacities[i]);
+	}
+
+	submit(logicalDevice, physicalDevice, surface, queue, [&](VkCommandBuffer& commandBuffer)
+		{
+			std::vector<VkBufferCopy> regions;
+
+			for (u32 i = 0; i < strides.size() && !vertexCopies.empty(); i++)
+			{
+				regions = vertexCopies;
+				for (VkBufferCopy& region : regions)
+				{
+					region.srcOffset *= strides[i];
+					region.dstOffset *= strides[i];
+					region.size *= strides[i];
+				}
+
+				vkCmdCopyBuffer(commandBuffer, oldVertexBuffers[i].buffer, vertexBuffers[i].buffer, static_cast<u32>(regions.size()), regions.data());
+
+				WillEngine::VulkanUtil::bufferBarrier(commandBuffer, vertexBuffers[i].buffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+					VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_WHOLE_SIZE, 0, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
+			}
+
+			for (u32 i = 0; i < NUM_INDEX_TYPES; i++)
+			{
+				if (indexCopies[i].empty())
+					continue;
+
+				const VulkanGeometryIndices& indexBuffer = indexBuffers[i];
+
+				regions = indexCopies[i];
+				for (VkBufferCopy& region : regions)
+				{
+					region.srcOffset *= indexBuffer.indexSize;
+					region.dstOffset *= indexBuffer.indexSize;
+					region.size *= indexBuffer.indexSize;
+				}
+
+				vkCmdCopyBuffer(commandBuffer, oldIndexBuffers[i].buffer, indexBuffer.buffer.buffer, static_cast<u32>(regions.size()), regions.data());
+
+				WillEngine::VulkanUtil::bufferBarrier(commandBuffer, indexBuffer.buffer.buffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_INDEX_READ_BIT,
+					VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_WHOLE_SIZE, 0, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED);
+			}
+		});
+
+	if (replaceVertices)
+	{
+		for (VulkanAllocatedMemory& vertexBuffer : oldVertexBuffers)
+		{
+			vmaDestroyBuffer(vmaAllocator, vertexBuffer.buffer, vertexBuffer.allocation);
+		}
+	}
+
+	for (u32 i = 0; i < NUM_INDEX_TYPES; i++)
+	{
+		if (replaceIndices[i])
+			vmaDestroyBuffer(vmaAllocator, oldIndexBuffers[i].buffer, oldIndexBuffers[i].allocation);
+	}
+}
+
+void VulkanGeometryArena::createVertexBuffers(VmaAllocator& vmaAllocator, u32 vertexCapacity)
+{
+	// The buffers are copied from when they grow or are defragmented
+	vertexBuffers.resize(strides.size());
+	vertexBufferHandles.resize(strides.size());
+	vertexBufferOffsets.assign(strides.size(), 0);
+
+	for (u32 i = 0; i < strides.size(); i++)
+	{
+		vertexBuffers[i] = WillEngine::VulkanUtil::createBuffer(vmaAllocator, static_cast<u64>(strides[i]) * vertexCapacity,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+		vertexBufferHandles[i] = vertexBuffers[i].buffer;
+	}
+}
+
+void VulkanGeometryArena::createIndexBuffer(VmaAllocator& vmaAllocator, VulkanGeometryIndices& indexBuffer, u32 indexCapacity)
+{
+	indexBuffer.buffer = WillEngine::VulkanUtil::createBuffer(vmaAllocator, static_cast<u64>(indexBuffer.indexSize) * indexCapacity,
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+}
+
+void VulkanGeometryArena::submit(VkDevice& logicalDevice, VkPhysicalDevice& physicalDevice, VkSurfaceKHR& surface, VkQueue& queue,
+	const std::function<void(VkCommandBuffer&)>& record)
+{
+	VkFence uploadComplete = WillEngine::VulkanUtil::createFence(logicalDevice, false);
+
+	VkCommandPool commandPool = WillEngine::VulkanUtil::createCommandPool(logicalDevice, physicalDevice, surface);
+	VkCommandBuffer commandBuffer = WillEngine::VulkanUtil::createCommandBuffer(logicalDevice, commandPool);
+
+	VkCommandBufferBeginInfo commandInfo{};
+	commandInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	commandInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(commandBuffer, &commandInfo) != VK_SUCCESS)
+		throw std::runtime_error("Failed to begin command buffer");
+
+	record(commandBuffer);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("Failed to end command buffer");
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	if (vkQueueSubmit(queue, 1, &submitInfo, uploadComplete) != VK_SUCCESS)
+		throw std::runtime_error("Failed to submit commands");
+
+	if (vkWaitForFences(logicalDevice, 1, &uploadComplete, VK_TRUE, std::numeric_limits<u64>::max()) != VK_SUCCESS)
+		throw std::runtime_error("Failed to wait for fence");
+
+	vkDestroyFence(logicalDevice, uploadComplete, nullptr);
+	vkFreeCommandBuffers(logicalDevice, commandPool, 1, &commandBuffer);
+	vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+}
\ No newline at end of file
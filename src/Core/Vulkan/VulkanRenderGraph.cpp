@@ -0,0 +1,621 @@
+#include "pch.h"
+
+#include "Core/Vulkan/VulkanRenderGraph.h"
+
+#include "Utils/VulkanUtil.h"
+
+// State of an image after the passes that have been simulated so far
+struct RenderGraphImageState
+{
+	VkPipelineStageFlags stage;
+	VkAccessFlags access;
+	VkImageLayout layout;
+	bool write;
+	bool valid;
+
+	// Queue and pass of the last use
+	bool asyncCompute;
+	i32 lastPass;
+};
+
+static const u32 RENDER_GRAPH_GRAPHICS_QUEUE = 1 << 0;
+static const u32 RENDER_GRAPH_COMPUTE_QUEUE = 1 << 1;
+
+VulkanRenderGraph::VulkanRenderGraph() :
+	images(),
+	passes(),
+	executionOrder(),
+	memorySlots(),
+	graphicsQueueFamily(0),
+	computeQueueFamily(0),
+	compiled(false)
+{
+
+}
+
+VulkanRenderGraph::~VulkanRenderGraph()
+{
+
+}
+
+RenderGraphImageId VulkanRenderGraph::createImage(const std::string& name, VkFormat format, VkExtent2D extent, VkImageUsageFlags usage, VkImageAspectFlags aspect)
+{
+	VulkanRenderGraphImage image{};
+	image.name = name;
+	image.format = format;
+	image.extent = extent;
+	image.usage = usage;
+	image.aspect = aspect;
+	image.imported = false;
+	image.importedImage = nullptr;
+	image.firstPass = -1;
+	image.lastPass = -1;
+	image.memorySlot = -1;
+	image.queueMask = 0;
+
+	images.push_back(image);
+
+	return static_cast<RenderGraphImageId>(images.size() - 1);
+}
+
+RenderGraphImageId VulkanRenderGraph::importImage(const std::string& name, VulkanAllocatedImage* importedImage, VkImageAspectFlags aspect)
+{
+	VulkanRenderGraphImage image{};
+	image.name = name;
+	image.aspect = aspect;
+	image.imported = true;
+	image.importedImage = importedImage;
+	image.firstPass = -1;
+	image.lastPass = -1;
+	image.memorySlot = -1;
+	image.queueMask = 0;
+
+	images.push_back(image);
+
+	return static_cast<RenderGraphImageId>(images.size() - 1);
+}
+
+RenderGraphPassId VulkanRenderGraph::addPass(const std::string& name, VulkanCommandBufferType commandBufferType, std::function<void(VkCommandBuffer&)> record)
+{
+	VulkanRenderGraphPass pass{};
+	pass.name = name;
+	pass.commandBufferType = commandBufferType;
+	pass.record = record;
+	pass.sideEffect = false;
+	pass.culled = false;
+	pass.asyncCompute = false;
+	pass.releaseSrcStage = 0;
+
+	passes.push_back(pass);
+
+	return static_cast<RenderGraphPassId>(passes.size() - 1);
+}
+
+void VulkanRenderGraph::readImage(RenderGraphPassId pass, RenderGraphImageId image, VkPipelineStageFlags stage, VkAccessFlags access, VkImageLayout layout)
+{
+	passes[pass].accesses.push_back({ image, stage, access, layout, layout, false });
+}
+
+void VulkanRenderGraph::writeImage(RenderGraphPassId pass, RenderGraphImageId image, VkPipelineStageFlags stage, VkAccessFlags access, VkImageLayout layout,
+	VkImageLayout finalLayout)
+{
+	passes[pass].accesses.push_back({ image, stage, access, layout, finalLayout, true });
+}
+
+void VulkanRenderGraph::setQueueFamilies(u32 graphicsQueueFamily, u32 computeQueueFamily)
+{
+	this->graphicsQueueFamily = graphicsQueueFamily;
+	this->computeQueueFamily = computeQueueFamily;
+}
+
+void VulkanRenderGraph::compile(VkDevice& logicalDevice, VmaAllocator& vmaAllocator)
+{
+	assert(!compiled);
+
+	cullPasses();
+	computeLifetimes();
+	allocateTransientImages(logicalDevice, vmaAllocator);
+	computeBarriers();
+
+	compiled = true;
+}
+
+void VulkanRenderGraph::cullPasses()
+{
+	// Walk the passes backwards, a pass is alive if it has a side effect or writes an image a later alive pass reads
+	std::vector<bool> needed(images.size(), false);
+
+	for (i32 i = static_cast<i32>(passes.size()) - 1; i >= 0; i--)
+	{
+		VulkanRenderGraphPass& pass = passes[i];
+
+		bool alive = pass.sideEffect;
+		for (const VulkanRenderGraphAccess& access : pass.accesses)
+		{
+			if (access.write && needed[access.image])
+				alive = true;
+		}
+
+		pass.culled = !alive;
+
+		if (!alive)
+			continue;
+
+		// Images this pass overwrites entirely do not need the passes writing them before
+		for (const VulkanRenderGraphAccess& access : pass.accesses)
+		{
+			if (access.write && access.layout == VK_IMAGE_LAYOUT_UNDEFINED)
+				needed[access.image] = false;
+		}
+
+		// Everything else this pass uses needs the content written before
+		for (const VulkanRenderGraphAccess& access : pass.accesses)
+		{
+			if (!access.write || access.layout != VK_IMAGE_LAYOUT_UNDEFINED)
+				needed[access.image] = true;
+		}
+	}
+}
+
+void VulkanRenderGraph::computeLifetimes()
+{
+	executionOrder.clear();
+
+	for (u32 i = 0; i < passes.size(); i++)
+	{
+		if (!passes[i].culled)
+			executionOrder.push_back(i);
+	}
+
+	for (i32 order = 0; order < static_cast<i32>(executionOrder.size()); order++)
+	{
+		const VulkanRenderGraphPass& pass = passes[executionOrder[order]];
+
+		for (const VulkanRenderGraphAccess& access : pass.accesses)
+		{
+			VulkanRenderGraphImage& image = images[access.image];
+
+			if (image.firstPass < 0)
+				image.firstPass = order;
+
+			image.lastPass = order;
+			image.queueMask |= pass.asyncCompute ? RENDER_GRAPH_COMPUTE_QUEUE : RENDER_GRAPH_GRAPHICS_QUEUE;
+		}
+	}
+}
+
+void VulkanRenderGraph::allocateTransientImages(VkDevice& logicalDevice, VmaAllocator& vmaAllocator)
+{
+	std::vector<RenderGraphImageId> transientImages;
+
+	// Create the images first, their memory requirements decide which ones can share memory
+	for (u32 i = 0; i < images.size(); i++)
+	{
+		VulkanRenderGraphImage& image = images[i];
+
+		// Images no alive pass uses are never created
+		if (image.imported || image.firstPass < 0)
+			continue;
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = image.format;
+		imageInfo.extent.width = image.extent.width;
+		imageInfo.extent.height = image.extent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = image.usage | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(logicalDevice, &imageInfo, nullptr, &image.image.image) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create render graph image: " + image.name);
+
+		vkGetImageMemoryRequirements(logicalDevice, image.image.image, &image.memoryRequirements);
+
+		// The memory is owned by the memory slot
+		image.image.allocation = VK_NULL_HANDLE;
+
+		transientImages.push_back(i);
+	}
+
+	// Place the largest images first so smaller ones fill the slots they leave
+	std::stable_sort(transientImages.begin(), transientImages.end(), [this](RenderGraphImageId a, RenderGraphImageId b)
+		{
+			return images[a].memoryRequirements.size > images[b].memoryRequirements.size;
+		});
+
+	for (RenderGraphImageId id : transientImages)
+	{
+		VulkanRenderGraphImage& image = images[id];
+
+		for (u32 slotIndex = 0; slotIndex < memorySlots.size(); slotIndex++)
+		{
+			VulkanRenderGraphMemorySlot& slot = memorySlots[slotIndex];
+
+			if ((slot.memoryRequirements.memoryTypeBits & image.memoryRequirements.memoryTypeBits) == 0)
+				continue;
+
+			// The queues do not wait for each other between frames, memory used on one queue cannot be reused on the other
+			if (images[slot.images[0]].queueMask != image.queueMask)
+				continue;
+
+			bool overlap = false;
+			for (RenderGraphImageId other : slot.images)
+			{
+				if (image.firstPass <= images[other].lastPass && images[other].firstPass <= image.lastPass)
+				{
+					overlap = true;
+					break;
+				}
+			}
+
+			if (overlap)
+				continue;
+
+			slot.memoryRequirements.size = std::max(slot.memoryRequirements.size, image.memoryRequirements.size);
+			slot.memoryRequirements.alignment = std::max(slot.memoryRequirements.alignment, image.memoryRequirements.alignment);
+			slot.memoryRequirements.memoryTypeBits &= image.memoryRequirements.memoryTypeBits;
+			slot.images.push_back(id);
+
+			image.memorySlot = static_cast<i32>(slotIndex);
+			break;
+		}
+
+		// No slot is free for the whole lifetime of the image
+		if (image.memorySlot < 0)
+		{
+			VulkanRenderGraphMemorySlot slot{};
+			slot.memoryRequirements = image.memoryRequirements;
+			slot.allocation = VK_NULL_HANDLE;
+			slot.images.push_back(id);
+
+			memorySlots.push_back(slot);
+
+			image.memorySlot = static_cast<i32>(memorySlots.size() - 1);
+		}
+	}
+
+	// Allocate the slots and bind every image at the start of its slot
+	for (VulkanRenderGraphMemorySlot& slot : memorySlots)
+	{
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+		if (vmaAllocateMemory(vmaAllocator, &slot.memoryRequirements, &allocInfo, &slot.allocation, nullptr) != VK_SUCCESS)
+			throw std::runtime_error("Failed to allocate render graph memory");
+
+		for (RenderGraphImageId id : slot.images)
+		{
+			VulkanRenderGraphImage& image = images[id];
+
+			if (vmaBindImageMemory(vmaAllocator, slot.allocation, image.image.image) != VK_SUCCESS)
+				throw std::runtime_error("Failed to bind render graph image: " + image.name);
+
+			WillEngine::VulkanUtil::createImageView(logicalDevice, image.image.image, image.image.imageView, 1, image.format, image.aspect);
+		}
+	}
+}
+
+void VulkanRenderGraph::computeBarriers()
+{
+	// Everything that has happened to the memory of a slot, an image starting its lifetime has to wait for the images before it
+	// Kept per queue, a barrier only covers its own queue and the uses on the other queue are ordered by the semaphores
+	std::vector<VkPipelineStageFlags> slotStages[2] = { std::vector<VkPipelineStageFlags>(memorySlots.size(), 0),
+		std::vector<VkPipelineStageFlags>(memorySlots.size(), 0) };
+	std::vector<VkAccessFlags> slotWrites[2] = { std::vector<VkAccessFlags>(memorySlots.size(), 0),
+		std::vector<VkAccessFlags>(memorySlots.size(), 0) };
+
+	for (RenderGraphPassId passId : executionOrder)
+	{
+		const u32 queue = passes[passId].asyncCompute ? 1 : 0;
+
+		for (const VulkanRenderGraphAccess& access : passes[passId].accesses)
+		{
+			const VulkanRenderGraphImage& image = images[access.image];
+
+			if (image.memorySlot < 0)
+				continue;
+
+			slotStages[queue][image.memorySlot] |= access.stage;
+			if (access.write)
+				slotWrites[queue][image.memorySlot] |= access.access;
+		}
+	}
+
+	// The graph runs every frame, so the first use of an image in a frame depends on its last use in the previous frame
+	// The first run only finds the state every image is left in at the end of the frame
+	std::vector<RenderGraphImageState> states(images.size(), RenderGraphImageState{});
+
+	for (u32 run = 0; run < 2; run++)
+	{
+		const bool emit = run == 1;
+
+		// Releases are added to earlier passes, so every pass is cleared before any barrier is emitted
+		if (emit)
+		{
+			for (RenderGraphPassId passId : executionOrder)
+			{
+				VulkanRenderGraphPass& pass = passes[passId];
+
+				pass.srcStage = 0;
+				pass.dstStage = 0;
+				pass.srcAccess = 0;
+				pass.dstAccess = 0;
+				pass.imageBarriers.clear();
+				pass.imageBarrierImages.clear();
+
+				pass.releaseSrcStage = 0;
+				pass.releaseBarriers.clear();
+				pass.releaseBarrierImages.clear();
+			}
+		}
+
+		for (i32 order = 0; order < static_cast<i32>(executionOrder.size()); order++)
+		{
+			VulkanRenderGraphPass& pass = passes[executionOrder[order]];
+			const u32 queue = pass.asyncCompute ? 1 : 0;
+
+			for (const VulkanRenderGraphAccess& access : pass.accesses)
+			{
+				const VulkanRenderGraphImage& image = images[access.image];
+				RenderGraphImageState& state = states[access.image];
+
+				VkPipelineStageFlags srcStage = 0;
+				VkAccessFlags srcAccess = 0;
+				VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				bool needBarrier = false;
+
+				const bool otherQueue = state.valid && state.asyncCompute != pass.asyncCompute;
+
+				if (!image.imported && image.firstPass == order)
+				{
+					// The content of an aliased image is undefined when its lifetime starts
+					srcStage = slotStages[queue][image.memorySlot];
+					srcAccess = slotWrites[queue][image.memorySlot];
+					oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+					needBarrier = true;
+				}
+				else if (otherQueue)
+				{
+					// The semaphore between the batches already makes this pass wait for the last use on the other queue
+					const bool discard = access.write && access.layout == VK_IMAGE_LAYOUT_UNDEFINED;
+					const VkImageLayout newLayout = access.layout != VK_IMAGE_LAYOUT_UNDEFINED ? access.layout : state.layout;
+
+					if (emit && !discard && graphicsQueueFamily != computeQueueFamily)
+					{
+						// Exclusive images keep their content across families only if the old family releases them and the new one acquires them
+						const u32 srcFamily = state.asyncCompute ? computeQueueFamily : graphicsQueueFamily;
+						const u32 dstFamily = pass.asyncCompute ? computeQueueFamily : graphicsQueueFamily;
+
+						VkImageMemoryBarrier barrier{};
+						barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+						barrier.oldLayout = state.layout;
+						barrier.newLayout = newLayout;
+						barrier.srcQueueFamilyIndex = srcFamily;
+						barrier.dstQueueFamilyIndex = dstFamily;
+						barrier.image = VK_NULL_HANDLE;
+						barrier.subresourceRange = { image.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+
+						VulkanRenderGraphPass& releasePass = passes[executionOrder[state.lastPass]];
+
+						VkImageMemoryBarrier release = barrier;
+						release.srcAccessMask = state.write ? state.access : 0;
+						release.dstAccessMask = 0;
+
+						releasePass.releaseSrcStage |= state.stage;
+						releasePass.releaseBarriers.push_back(release);
+						releasePass.releaseBarrierImages.push_back(access.image);
+
+						VkImageMemoryBarrier acquire = barrier;
+						acquire.srcAccessMask = 0;
+						acquire.dstAccessMask = access.access;
+
+						pass.dstStage |= access.stage;
+						pass.imageBarriers.push_back(acquire);
+						pass.imageBarrierImages.push_back(access.image);
+					}
+					else
+					{
+						// Same family or the content is dropped, only the layout may have to change
+						oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+						needBarrier = access.layout != VK_IMAGE_LAYOUT_UNDEFINED && access.layout != oldLayout;
+					}
+				}
+				else if (state.valid)
+				{
+					const bool layoutChanged = access.layout != VK_IMAGE_LAYOUT_UNDEFINED && access.layout != state.layout;
+
+					srcStage = state.stage;
+					srcAccess = state.write ? state.access : 0;
+					oldLayout = state.layout;
+					// Reads after reads in the same layout do not need a barrier
+					needBarrier = layoutChanged || state.write || access.write;
+				}
+
+				if (emit && needBarrier)
+				{
+					pass.srcStage |= srcStage;
+					pass.dstStage |= access.stage;
+
+					if (access.layout != VK_IMAGE_LAYOUT_UNDEFINED && access.layout != oldLayout)
+					{
+						VkImageMemoryBarrier barrier{};
+						barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+						barrier.srcAccessMask = srcAccess;
+						barrier.dstAccessMask = access.access;
+						barrier.oldLayout = oldLayout;
+						barrier.newLayout = access.layout;
+						barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						// The handle is filled in when the pass is executed, imported images can be created after the graph is compiled
+						barrier.image = VK_NULL_HANDLE;
+						barrier.subresourceRange = { image.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+
+						pass.imageBarriers.push_back(barrier);
+						pass.imageBarrierImages.push_back(access.image);
+					}
+					else
+					{
+						pass.srcAccess |= srcAccess;
+						pass.dstAccess |= access.access;
+					}
+				}
+
+				// Update the state of the image after this pass
+				if (access.write || state.write || !state.valid || otherQueue)
+				{
+					state.stage = access.stage;
+					state.access = access.access;
+					state.write = access.write;
+				}
+				else
+				{
+					// Several passes reading the image, a later write has to wait for all of them
+					state.stage |= access.stage;
+					state.access |= access.access;
+				}
+
+				state.layout = access.finalLayout;
+				state.valid = true;
+				state.asyncCompute = pass.asyncCompute;
+				state.lastPass = order;
+			}
+		}
+	}
+}
+
+void VulkanRenderGraph::execute(VulkanFrame& frame, std::vector<VulkanRenderGraphBatch>& batches)
+{
+	assert(compiled);
+
+	for (RenderGraphPassId passId : executionOrder)
+	{
+		VulkanRenderGraphPass& pass = passes[passId];
+
+		if (pass.shouldExecute && !pass.shouldExecute())
+			continue;
+
+		// Compute passes use command buffers allocated from the compute family
+		VkCommandBuffer& commandBuffer = pass.asyncCompute ? frame.computeCommandBuffers.at(pass.commandBufferType) :
+			frame.commandBuffers.at(pass.commandBufferType);
+
+		// Begin command buffer
+		VkCommandBufferBeginInfo commandBeginInfo{};
+		commandBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		commandBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(commandBuffer, &commandBeginInfo) != VK_SUCCESS)
+			throw std::runtime_error("Failed to begin command buffer for pass: " + pass.name);
+
+		// Barriers with the passes before
+		if (pass.dstStage != 0)
+		{
+			for (u32 i = 0; i < pass.imageBarriers.size(); i++)
+			{
+				pass.imageBarriers[i].image = getImage(pass.imageBarrierImages[i]).image;
+			}
+
+			VkMemoryBarrier memoryBarrier{};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.srcAccessMask = pass.srcAccess;
+			memoryBarrier.dstAccessMask = pass.dstAccess;
+
+			const u32 memoryBarrierCount = (pass.srcAccess != 0 || pass.dstAccess != 0) ? 1 : 0;
+			const VkPipelineStageFlags srcStage = pass.srcStage != 0 ? pass.srcStage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+			vkCmdPipelineBarrier(commandBuffer, srcStage, pass.dstStage, 0, memoryBarrierCount, &memoryBarrier, 0, nullptr,
+				static_cast<u32>(pass.imageBarriers.size()), pass.imageBarriers.data());
+		}
+
+		pass.record(commandBuffer);
+
+		// Hand images over to the queue of the next pass using them
+		if (!pass.releaseBarriers.empty())
+		{
+			for (u32 i = 0; i < pass.releaseBarriers.size(); i++)
+			{
+				pass.releaseBarriers[i].image = getImage(pass.releaseBarrierImages[i]).image;
+			}
+
+			vkCmdPipelineBarrier(commandBuffer, pass.releaseSrcStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+				static_cast<u32>(pass.releaseBarriers.size()), pass.releaseBarriers.data());
+		}
+
+		// End command buffer
+		vkEndCommandBuffer(commandBuffer);
+
+		if (batches.empty() || batches.back().asyncCompute != pass.asyncCompute)
+			batches.push_back({ pass.asyncCompute, {} });
+
+		batches.back().commandBuffers.push_back(commandBuffer);
+	}
+}
+
+void VulkanRenderGraph::destroy(VkDevice& logicalDevice, VmaAllocator& vmaAllocator)
+{
+	for (VulkanRenderGraphImage& image : images)
+	{
+		if (image.imported || image.memorySlot < 0)
+			continue;
+
+		vkDestroyImageView(logicalDevice, image.image.imageView, nullptr);
+		vkDestroyImage(logicalDevice, image.image.image, nullptr);
+	}
+
+	for (VulkanRenderGraphMemorySlot& slot : memorySlots)
+	{
+		vmaFreeMemory(vmaAllocator, slot.allocation);
+	}
+
+	images.clear();
+	passes.clear();
+	executionOrder.clear();
+	memorySlots.clear();
+
+	compiled = false;
+}
+
+const VulkanAllocatedImage& VulkanRenderGraph::getImage(RenderGraphImageId image) const
+{
+	if (images[image].imported)
+		return *images[image].importedImage;
+
+	return images[image].image;
+}
+
+u32 VulkanRenderGraph::getNumCulledPasses() const
+{
+	return static_cast<u32>(passes.size() - executionOrder.size());
+}
+
+u64 VulkanRenderGraph::getTransientMemorySize() const
+{
+	u64 size = 0;
+
+	for (const VulkanRenderGraphMemorySlot& slot : memorySlots)
+	{
+		size += slot.memoryRequirements.size;
+	}
+
+	return size;
+}
+
+u64 VulkanRenderGraph::getUnaliasedMemorySize() const
+{
+	u64 size = 0;
+
+	for (const VulkanRenderGraphImage& image : images)
+	{
+		if (image.imported || image.memorySlot < 0)
+			continue;
+
+		size += image.memoryRequirements.size;
+	}
+
+	return size;
+}
@@ -16,6 +16,10 @@ VulkanWindow::VulkanWindow() :
     graphicsQueue(VK_NULL_HANDLE),
     computeQueue(VK_NULL_HANDLE),
     presentQueue(VK_NULL_HANDLE),
+    graphicsQueueFamily(0),
+    computeQueueFamily(0),
+    drawIndirectCount(false),
+    multiDrawIndirect(false),
     surface(VK_NULL_HANDLE),
     vulkanEngine(nullptr)
 {
@@ -215,52 +219,94 @@ void VulkanWindow::createLogicalDevice()
         throw std::runtime_error("GPU does not have required Present Queue Family");
 
     u32 queueFamilyIndicies = WillEngine::VulkanUtil::findQueueFamilies(physicalDevice, VK_QUEUE_GRAPHICS_BIT, VK_NULL_HANDLE).value();
-    u32 computeFamilyIndicies = WillEngine::VulkanUtil::findQueueFamilies(physicalDevice, VK_QUEUE_COMPUTE_BIT, VK_NULL_HANDLE).value();
     u32 presentFamilyIndicies = WillEngine::VulkanUtil::findQueueFamilies(physicalDevice, VK_QUEUE_GRAPHICS_BIT, surface).value();
 
-    f32 queuePriorities = 1.0f;
+    // Bloom runs on a compute queue next to the graphics queue, preferably from a family without graphics
+    // Otherwise use a second queue of the graphics family, if it has one
+    std::optional<u32> dedicatedComputeFamily = WillEngine::VulkanUtil::findDedicatedComputeQueueFamily(physicalDevice);
+    u32 computeFamilyIndicies = dedicatedComputeFamily.has_value() ? dedicatedComputeFamily.value() : queueFamilyIndicies;
+    u32 computeQueueIndex = dedicatedComputeFamily.has_value() ? 0 : 1;
+
+    u32 queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
+
+    // The queues are synchronised with a timeline semaphore, the GPU culled draws need a count buffer and the materials descriptor indexing
+    VkPhysicalDeviceVulkan12Features supportedVulkan12Features{};
+    supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+    VkPhysicalDeviceFeatures2 supportedFeatures{};
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures.pNext = &supportedVulkan12Features;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+
+    const bool hasComputeQueue = computeQueueIndex < queueFamilyProperties[computeFamilyIndicies].queueCount;
+    const bool asyncCompute = hasComputeQueue && supportedVulkan12Features.timelineSemaphore == VK_TRUE;
+
+    drawIndirectCount = supportedVulkan12Features.drawIndirectCount == VK_TRUE;
+    multiDrawIndirect = supportedFeatures.features.multiDrawIndirect == VK_TRUE;
+
+    // Material textures are indexed from one descriptor array that is written while it is bound
+    if (supportedVulkan12Features.descriptorIndexing != VK_TRUE ||
+        supportedVulkan12Features.runtimeDescriptorArray != VK_TRUE ||
+        supportedVulkan12Features.shaderSampledImageArrayNonUniformIndexing != VK_TRUE ||
+        supportedVulkan12Features.descriptorBindingPartiallyBound != VK_TRUE ||
+        supportedVulkan12Features.descriptorBindingSampledImageUpdateAfterBind != VK_TRUE ||
+        supportedVulkan12Features.descriptorBindingStorageBufferUpdateAfterBind != VK_TRUE ||
+        supportedVulkan12Features.descriptorBindingUpdateUnusedWhilePending != VK_TRUE)
+        throw std::runtime_error("GPU does not support descriptor indexing required for bindless textures");
+
+    const f32 queuePriorities[] = { 1.0f, 1.0f };
 
     // Device Features
     VkPhysicalDeviceFeatures basicFeatures{};
     basicFeatures.samplerAnisotropy = VK_TRUE;
     basicFeatures.geometryShader = VK_TRUE;
-
-    VkPhysicalDeviceImagelessFramebufferFeatures imagelessFramebuffer{};
-    imagelessFramebuffer.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGELESS_FRAMEBUFFER_FEATURES;
-    imagelessFramebuffer.imagelessFramebuffer = VK_TRUE;
+    // Indirect draws start at the batch's first visible object
+    basicFeatures.drawIndirectFirstInstance = VK_TRUE;
+    // Every cluster of a batch is drawn by one indirect call
+    basicFeatures.multiDrawIndirect = multiDrawIndirect ? VK_TRUE : VK_FALSE;
+
+    // The individual feature structs of promoted extensions can't be chained together with this one
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.imagelessFramebuffer = VK_TRUE;
+    vulkan12Features.timelineSemaphore = asyncCompute ? VK_TRUE : VK_FALSE;
+    vulkan12Features.drawIndirectCount = drawIndirectCount ? VK_TRUE : VK_FALSE;
+    vulkan12Features.descriptorIndexing = VK_TRUE;
+    vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+    vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+    vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
 
     VkPhysicalDeviceFeatures2 deviceFeatures{};
     deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
     deviceFeatures.features = basicFeatures;
-    deviceFeatures.pNext = &imagelessFramebuffer;
+    deviceFeatures.pNext = &vulkan12Features;
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 
-    std::vector<u32> uniqueQueueFaimiles;
-    if (queueFamilyIndicies == presentFamilyIndicies && queueFamilyIndicies == computeFamilyIndicies)
-    {
-        uniqueQueueFaimiles.push_back(queueFamilyIndicies);
-    }
-    else
-    {
-        uniqueQueueFaimiles.insert(uniqueQueueFaimiles.end(),
-            { queueFamilyIndicies, computeFamilyIndicies, presentFamilyIndicies });
-    }
+    std::set<u32> uniqueQueueFaimiles = { queueFamilyIndicies, presentFamilyIndicies };
+    if (asyncCompute)
+        uniqueQueueFaimiles.insert(computeFamilyIndicies);
 
     // Create queue infos based on the queue family
-    for (u32& queueFamily : uniqueQueueFaimiles)
+    for (u32 queueFamily : uniqueQueueFaimiles)
     {
         VkDeviceQueueCreateInfo queueInfo{};
         queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueInfo.queueCount = 1;
-        queueInfo.queueFamilyIndex = queueFamilyIndicies;
-        queueInfo.pQueuePriorities = &queuePriorities;
+        queueInfo.queueCount = (asyncCompute && queueFamily == computeFamilyIndicies) ? computeQueueIndex + 1 : 1;
+        queueInfo.queueFamilyIndex = queueFamily;
+        queueInfo.pQueuePriorities = queuePriorities;
         queueCreateInfos.push_back(queueInfo);
     }
 
     VkDeviceCreateInfo logicalDeviceInfo{};
     logicalDeviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    logicalDeviceInfo.queueCreateInfoCount = static_cast<u32>(uniqueQueueFaimiles.size());
+    logicalDeviceInfo.queueCreateInfoCount = static_cast<u32>(queueCreateInfos.size());
     logicalDeviceInfo.pQueueCreateInfos = queueCreateInfos.data();
     //logicalDeviceInfo.pEnabledFeatures = &deviceFeatures;
     logicalDeviceInfo.pNext = &deviceFeatures;
@@ -282,6 +328,13 @@ void VulkanWindow::createLogicalDevice()
 
     // Retrive the present queue for later use
     vkGetDeviceQueue(logicalDevice, presentFamilyIndicies, 0, &presentQueue);
+
+    // Retrive the compute queue for later use, bloom stays on the graphics queue without it
+    if (asyncCompute)
+        vkGetDeviceQueue(logicalDevice, computeFamilyIndicies, computeQueueIndex, &computeQueue);
+
+    graphicsQueueFamily = queueFamilyIndicies;
+    computeQueueFamily = computeFamilyIndicies;
 }
 
 void VulkanWindow::createSurface()
@@ -293,6 +346,9 @@ void VulkanWindow::createSurface()
 void VulkanWindow::initVulkanEngine(GameState* gameState, u32 numThreads)
 {
     vulkanEngine = new VulkanEngine(numThreads);
+    vulkanEngine->setComputeQueue(computeQueue, graphicsQueueFamily, computeQueueFamily);
+    vulkanEngine->drawIndirectCount = drawIndirectCount;
+    vulkanEngine->multiDrawIndirect = multiDrawIndirect;
     vulkanEngine->init(window, instance, logicalDevice, physicalDevice, surface, graphicsQueue, gameState);
 }
 
@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "Core/WorkerPool.h"
+
+WorkerPool::WorkerPool(u32 numThreads) :
+	threads(),
+	mutex(),
+	workCondition(),
+	doneCondition(),
+	task(nullptr),
+	numTasks(0),
+	numPendingTasks(0),
+	generation(0),
+	stopping(false)
+{
+	const u32 numWorkers = std::max(numThreads, 1u) - 1;
+
+	threads.reserve(numWorkers);
+
+	// Task 0 belongs to the calling thread
+	for (u32 i = 0; i < numWorkers; i++)
+	{
+		threads.emplace_back(&WorkerPool::workerLoop, this, i + 1);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	workCondition.notify_all();
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+void WorkerPool::run(u32 numTasks, const std::function<void(u32)>& task)
+{
+	numTasks = std::clamp(numTasks, 1u, getNumThreads());
+
+	if (numTasks > 1)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			this->task = &task;
+			this->numTasks = numTasks;
+			numPendingTasks = numTasks - 1;
+			generation++;
+		}
+
+		workCondition.notify_all();
+	}
+
+	task(0);
+
+	if (numTasks > 1)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		doneCondition.wait(lock, [this]() { return numPendingTasks == 0; });
+
+		this->task = nullptr;
+	}
+}
+
+void WorkerPool::workerLoop(u32 taskIndex)
+{
+	u32 lastGeneration = 0;
+
+	while (true)
+	{
+		const std::function<void(u32)>* currentTask = nullptr;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workCondition.wait(lock, [&]() { return stopping || generation != lastGeneration; });
+
+			if (stopping)
+				return;
+
+			lastGeneration = generation;
+
+			// Runs with fewer tasks leave the remaining workers asleep
+			if (taskIndex >= numTasks)
+				continue;
+
+			currentTask = task;
+		}
+
+		(*currentTask)(taskIndex);
+
+		bool lastTask = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			lastTask = --numPendingTasks == 0;
+		}
+
+		if (lastTask)
+			doneCondition.notify_one();
+	}
+}
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 std::tuple<bool, std::string> WillEngine::Utils::selectFile()
 {
+#ifdef _WIN32
 	OPENFILENAME ofn;
 
 	wchar_t szFile[256];
@@ -34,6 +35,10 @@ std::tuple<bool, std::string> WillEngine::Utils::selectFile()
 	{
 		return {false, ""};
 	}
+#else
+	// There is no native file dialog on other platforms
+	return {false, ""};
+#endif
 }
 
 std::vector<char> WillEngine::Utils::readSprivShader(const char* filename)
@@ -99,6 +99,8 @@ void SystemManager::initAnimation()
 {
     animationManager = new AnimationManager();
     animationManager->init(gameState.gameResources.animations);
+
+    gameState.gameSettings.enablePoseCache = true;
 }
 
 void SystemManager::initVulkanWindow()
@@ -110,7 +112,17 @@ void SystemManager::initVulkanWindow()
     inputManager = new InputManager();
     inputManager->init(vulkanWindow->window);
 
-    vulkanWindow->initVulkan(&gameState, 4);
+    gameState.gameSettings.gpuDrivenRendering = true;
+    gameState.gameSettings.enableFrustumCulling = true;
+    gameState.gameSettings.enableOcclusionCulling = true;
+    gameState.gameSettings.enableClusterCulling = true;
+    gameState.gameSettings.enableLods = true;
+    gameState.gameSettings.shadowLodBias = 2.0f;
+    gameState.gameSettings.forcedLod = -1;
+    gameState.gameSettings.showLodColors = false;
+
+    // One command buffer recording worker per hardware thread
+    vulkanWindow->initVulkan(&gameState, std::max(1u, std::thread::hardware_concurrency()));
 }
 
 void SystemManager::update()
@@ -268,8 +280,11 @@ void SystemManager::loadModel()
     {
         Material* material = it->second;
 
-        material->initDescriptorSet(vulkanWindow->logicalDevice, vulkanWindow->physicalDevice, vulkanWindow->vulkanEngine->vmaAllocator,
-            vulkanWindow->vulkanEngine->commandPool, vulkanWindow->vulkanEngine->descriptorPool, vulkanWindow->graphicsQueue);
+        material->initTextures(vulkanWindow->logicalDevice, vulkanWindow->physicalDevice, vulkanWindow->vulkanEngine->vmaAllocator,
+            vulkanWindow->vulkanEngine->commandPool, vulkanWindow->graphicsQueue);
+
+        // Write its textures to the bindless texture array
+        vulkanWindow->vulkanEngine->addMaterial(vulkanWindow->logicalDevice, material);
 
         // Add this material to the game state graphics resources
         gameState.graphicsResources.materials[material->id] = material;
@@ -278,7 +293,7 @@ void SystemManager::loadModel()
     for (Mesh* mesh : loadedMeshes)
     {
         mesh->uploadDataToPhysicalDevice(vulkanWindow->logicalDevice, vulkanWindow->physicalDevice, vulkanWindow->vulkanEngine->vmaAllocator, vulkanWindow->surface,
-            vulkanWindow->graphicsQueue);
+            vulkanWindow->graphicsQueue, vulkanWindow->vulkanEngine->geometryArenas[mesh->getGeometryType()]);
 
         // Add this mesh to the game state graphics resources
         gameState.graphicsResources.meshes[mesh->id] = mesh;
@@ -291,8 +306,9 @@ void SystemManager::loadModel()
 
     if (loadedSkeleton)
     {
-        loadedSkeleton->generateNecessityMap(entities[0]);
+        loadedSkeleton->generateHierarchy(entities[0]);
         gameState.gameResources.skeletons[loadedSkeleton->id] = loadedSkeleton;
+        gameState.gameResources.rootEntitySkeletons[entities[0]->id] = loadedSkeleton->id;
         vulkanWindow->vulkanEngine->skeletonToInitialise.push(loadedSkeleton);
     }
 
@@ -314,6 +330,38 @@ void SystemManager::loadModel()
         gameState.gameResources.entities[entities[i]->id] = entities[i];
     }
 
+    // Bake every animation of the skeleton so that crowds of it can be drawn without CPU skinning
+    // A skeleton without bones has nothing to bake
+    if (loadedSkeleton && loadedSkeleton->hasBones() && !loadedAnimations.empty() && gameState.gameSettings.bakeAnimations)
+    {
+        BakedAnimation* bakedAnimation = new BakedAnimation(loadedSkeleton);
+
+        for (Animation* animation : loadedAnimations)
+        {
+            bakedAnimation->addClip(loadedSkeleton, animation);
+        }
+
+        // Every skinned mesh of this skeleton is drawn for each instance
+        for (Entity* entity : entities)
+        {
+            if (!entity->HasComponent<MeshComponent>())
+                continue;
+
+            if (!entity->AnyParentHasComponent<SkeletalComponent>())
+                continue;
+
+            MeshComponent* meshComp = entity->GetComponent<MeshComponent>();
+
+            for (u32 i = 0; i < meshComp->getNumMesh(); i++)
+            {
+                bakedAnimation->addMesh(meshComp->meshIndicies[i], meshComp->materialIndicies[i]);
+            }
+        }
+
+        gameState.gameResources.bakedAnimations[loadedSkeleton->id] = bakedAnimation;
+        vulkanWindow->vulkanEngine->bakedAnimationToInitialise.push(bakedAnimation);
+    }
+
     // Add all the entities to the query to update transformation
     gameState.queryTasks.transformToUpdate.push(entities[0]);
 }
@@ -339,7 +387,8 @@ void SystemManager::processMesh()
         std::tie(loadedMeshes, loadedMaterials, loadedSkeleton, loadedAnimations) = WillEngine::Utils::readModel(defaultPreset.c_str());
 
         Mesh* mesh = loadedMeshes[0];
-        mesh->uploadDataToPhysicalDevice(vulkanWindow->logicalDevice, vulkanWindow->physicalDevice, vulkanWindow->vulkanEngine->vmaAllocator, vulkanWindow->surface, vulkanWindow->graphicsQueue);
+        mesh->uploadDataToPhysicalDevice(vulkanWindow->logicalDevice, vulkanWindow->physicalDevice, vulkanWindow->vulkanEngine->vmaAllocator, vulkanWindow->surface, vulkanWindow->graphicsQueue,
+            vulkanWindow->vulkanEngine->geometryArenas[mesh->getGeometryType()]);
         // Add this mesh to the graphics resources
         gameState.graphicsResources.meshes[mesh->id] = mesh;
 
@@ -352,8 +401,10 @@ void SystemManager::processMesh()
         Material* material = loadedMaterials.begin()->second;
         gameState.graphicsResources.materials[material->id] = material;
 
-        material->initDescriptorSet(vulkanWindow->logicalDevice, vulkanWindow->physicalDevice, vulkanWindow->vulkanEngine->vmaAllocator,
-            vulkanWindow->vulkanEngine->commandPool, vulkanWindow->vulkanEngine->descriptorPool, vulkanWindow->graphicsQueue);
+        material->initTextures(vulkanWindow->logicalDevice, vulkanWindow->physicalDevice, vulkanWindow->vulkanEngine->vmaAllocator,
+            vulkanWindow->vulkanEngine->commandPool, vulkanWindow->graphicsQueue);
+
+        vulkanWindow->vulkanEngine->addMaterial(vulkanWindow->logicalDevice, material);
 
         gameState.queryTasks.meshesToAdd.pop();
     }
@@ -361,69 +412,53 @@ void SystemManager::processMesh()
 
 void SystemManager::processTransformationCalculations()
 {
+    // Poses are only shared within a frame
+    gameState.poseCache.beginFrame();
+    PoseCache* poseCache = gameState.gameSettings.enablePoseCache ? &gameState.poseCache : nullptr;
+
     // Update Global Transformation
     while (!gameState.queryTasks.transformToUpdate.empty())
     {
         Entity* currentEntity = gameState.queryTasks.transformToUpdate.front();
         Entity* rootEntity = currentEntity->getRoot();
 
-        bool hasSkeleton = false;
-        u32 skeletonId = 0;
-        const std::unordered_map<std::string, bool>* necessityMap = nullptr;
+        // Find the skeleton driven by this root entity, its necessity mask is generated when the model is loaded
+        Skeleton* skeleton = nullptr;
 
-        // Check if this entity or its child is associated to any skeleton
-        // NOTE: This is a horrible way of doing it, but it will work for now.
-        for (auto& it : gameState.gameResources.skeletons)
-        {
-            Skeleton* skeleton = it.second;
+        auto skeletonIt = gameState.gameResources.rootEntitySkeletons.find(rootEntity->id);
+        if (skeletonIt != gameState.gameResources.rootEntitySkeletons.end())
+            skeleton = gameState.gameResources.skeletons.at(skeletonIt->second);
 
-            skeleton->resetNecessityMap();
-
-            for (auto& jt : gameState.gameResources.entities)
-            {
-                Entity* entity = jt.second;
-
-                // Check if they're from the same root entity
-                if (entity->getRoot()->id != rootEntity->id)
-                    continue;
-
-                SkeletalComponent* skeletalComponent = entity->AnyParentGetComponent<SkeletalComponent>();
-
-                if (skeletalComponent && skeleton->id == skeletalComponent->skeletalId)
-                    continue;
-
-                if (skeleton->hasBone(entity->name))
-                {
-                    hasSkeleton = true;
-                    skeletonId = it.first;
-                    
-                    skeleton->buildNecessityMap(entity);
-                }
-            }
-
-            necessityMap = &skeleton->getNecessityMap();
+        AnimationComponent* animationComp = nullptr;
+        Animation* animation = nullptr;
+        if (rootEntity->HasComponent<AnimationComponent>())
+        {
+            animationComp = rootEntity->GetComponent<AnimationComponent>();
+            animation = gameState.gameResources.animations[animationComp->getCurrentAnimationId()];
         }
 
-        // Update Global Transformation
-        TransformComponent* transformComponent = currentEntity->GetComponent<TransformComponent>();
-        if (rootEntity->HasComponent<AnimationComponent>())
+        if (skeleton)
         {
-            AnimationComponent* animationComp = rootEntity->GetComponent<AnimationComponent>();
-            Animation* animation = gameState.gameResources.animations[animationComp->getCurrentAnimationId()];
+            // Changes made outside of the animation (e.g. from the inspector) are read back into the pose buffer
+            skeleton->readLocalPose(currentEntity, currentEntity != rootEntity);
 
-            transformComponent->updateAllChildWorldTransformation(animation, animationComp, necessityMap);
+            // Evaluate the pose buffer and only write back to the entities that need it
+            skeleton->updatePose(animation, animationComp, poseCache);
+            skeleton->updateBoneUniform();
+            skeleton->syncEntities();
         }
         else
         {
-            transformComponent->updateAllChildWorldTransformation();
-        }
-
-        // Update Skeleton Bone Uniform if it is has a skeleton
-        if (hasSkeleton)
-        {
-            Skeleton* skeleton = gameState.gameResources.skeletons.at(skeletonId);
-
-            skeleton->updateBoneUniform(rootEntity);
+            // Update Global Transformation
+            TransformComponent* transformComponent = currentEntity->GetComponent<TransformComponent>();
+            if (animation)
+            {
+                transformComponent->updateAllChildWorldTransformation(animation, animationComp);
+            }
+            else
+            {
+                transformComponent->updateAllChildWorldTransformation();
+            }
         }
 
         // Remove the current entity from the queue
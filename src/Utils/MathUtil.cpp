@@ -70,4 +70,44 @@ void WillEngine::Utils::DecomposeMatrix(mat4 in, vec3& position, vec3& rotation,
 
 	position = translation;
 	scale = scaling;
+}
+
+void WillEngine::Utils::TransformAabb(const mat4& transformation, const vec3& aabbMin, const vec3& aabbMax, vec3& worldMin, vec3& worldMax)
+{
+	const vec3 centre = (aabbMin + aabbMax) * 0.5f;
+	const vec3 extent = (aabbMax - aabbMin) * 0.5f;
+
+	// The extent along each world axis is the sum of the absolute contributions of the box's axes
+	const mat3 absolute = mat3(glm::abs(vec3(transformation[0])), glm::abs(vec3(transformation[1])), glm::abs(vec3(transformation[2])));
+
+	const vec3 worldCentre = vec3(transformation * vec4(centre, 1));
+	const vec3 worldExtent = absolute * extent;
+
+	worldMin = worldCentre - worldExtent;
+	worldMax = worldCentre + worldExtent;
+}
+
+vec4 WillEngine::Utils::TransformBoundingSphere(const mat4& transformation, const vec4& boundingSphere)
+{
+	const vec3 centre = vec3(transformation * vec4(vec3(boundingSphere), 1));
+	const f32 scale = std::max(std::max(glm::length(vec3(transformation[0])), glm::length(vec3(transformation[1]))), glm::length(vec3(transformation[2])));
+
+	return vec4(centre, boundingSphere.w * scale);
+}
+
+vec2 WillEngine::Utils::EncodeOctahedral(const vec3& direction)
+{
+	const f32 length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+	if (length == 0)
+		return vec2(0);
+
+	const vec3 octahedron = direction / length;
+
+	if (octahedron.z >= 0)
+		return vec2(octahedron);
+
+	// The lower half is folded over the diagonals
+	const vec2 sign(octahedron.x >= 0 ? 1.0f : -1.0f, octahedron.y >= 0 ? 1.0f : -1.0f);
+
+	return (1.0f - glm::abs(vec2(octahedron.y, octahedron.x))) * sign;
 }
\ No newline at end of file
@@ -0,0 +1,456 @@
+#include "pch.h"
+#include "Utils/MeshOptimizer.h"
+
+#include <atomic>
+#include <numeric>
+
+// Forsyth's scoring uses a larger LRU cache than the simulated FIFO so vertices about to leave it still count
+static const u32 FORSYTH_CACHE_SIZE = 32;
+static const f32 FORSYTH_CACHE_DECAY_POWER = 1.5f;
+static const f32 FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+static const f32 FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+static const f32 FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+static const u32 NO_TRIANGLE = UINT32_MAX;
+
+static f32 forsythVertexScore(i32 cachePosition, u32 numLiveTriangles)
+{
+	// Vertices without triangles left are never picked
+	if (numLiveTriangles == 0)
+		return -1.0f;
+
+	f32 score = 0;
+	if (cachePosition >= 0)
+	{
+		// The vertices of the last triangle score the same, so the next triangle doesn't favour one of them
+		if (cachePosition < 3)
+			score = FORSYTH_LAST_TRIANGLE_SCORE;
+		else
+			score = std::pow(1.0f - static_cast<f32>(cachePosition - 3) / static_cast<f32>(FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+	}
+
+	// Vertices with few triangles left are finished first so they can leave the cache
+	score += FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<f32>(numLiveTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+
+	return score;
+}
+
+// Returns true if the vertex is not in the simulated FIFO cache and adds it
+static bool cacheMiss(std::vector<u32>& cacheTimestamps, u32& timestamp, u32 cacheSize, u32 vertex)
+{
+	if (timestamp - cacheTimestamps[vertex] <= cacheSize)
+		return false;
+
+	cacheTimestamps[vertex] = timestamp++;
+
+	return true;
+}
+
+void WillEngine::Utils::optimizeMesh(Mesh* mesh, bool overdraw, VertexCacheStatistics& before, VertexCacheStatistics& after)
+{
+	const u32 numVertices = static_cast<u32>(mesh->positions.size());
+
+	before = analyzeVertexCache(mesh->indicies, numVertices, VERTEX_CACHE_SIZE);
+	after = before;
+
+	// Only triangle lists can be reordered freely
+	if (mesh->primitive != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST || mesh->indicies.size() < 3)
+		return;
+
+	optimizeVertexCache(mesh->indicies, numVertices);
+
+	if (overdraw)
+		optimizeOverdraw(mesh->indicies, mesh->positions, OVERDRAW_THRESHOLD);
+
+	std::vector<u32> remap;
+	const u32 numUsedVertices = optimizeVertexFetch(mesh->indicies, numVertices, remap);
+	mesh->remapVertices(remap, numUsedVertices);
+
+	// Removed vertices may have been on the bounds
+	mesh->computeBounds();
+
+	after = analyzeVertexCache(mesh->indicies, numUsedVertices, VERTEX_CACHE_SIZE);
+}
+
+void WillEngine::Utils::optimizeMeshes(const std::vector<Mesh*>& meshes, bool overdraw, bool printStatistics)
+{
+	const u32 numMeshes = static_cast<u32>(meshes.size());
+
+	if (numMeshes == 0)
+		return;
+
+	std::vector<VertexCacheStatistics> before(numMeshes);
+	std::vector<VertexCacheStatistics> after(numMeshes);
+
+	// Meshes differ a lot in size, so every thread takes the next mesh once it is done
+	std::atomic<u32> nextMesh = 0;
+
+	auto optimize = [&]()
+		{
+			for (u32 i = nextMesh++; i < numMeshes; i = nextMesh++)
+			{
+				optimizeMesh(meshes[i], overdraw, before[i], after[i]);
+			}
+		};
+
+	const u32 numThreads = std::clamp(std::thread::hardware_concurrency(), 1u, numMeshes);
+
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads);
+	for (u32 i = 0; i < numThreads; i++)
+	{
+		threads.emplace_back(optimize);
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	if (!printStatistics)
+		return;
+
+	for (u32 i = 0; i < numMeshes; i++)
+	{
+		printf("Optimised mesh %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", meshes[i]->name.c_str(), before[i].acmr, after[i].acmr, before[i].atvr,
+			after[i].atvr);
+	}
+}
+
+WillEngine::Utils::VertexCacheStatistics WillEngine::Utils::analyzeVertexCache(const std::vector<u32>& indices, u32 numVertices, u32 cacheSize)
+{
+	VertexCacheStatistics statistics{};
+
+	const u32 numTriangles = static_cast<u32>(indices.size() / 3);
+
+	if (numTriangles == 0 || numVertices == 0)
+		return statistics;
+
+	std::vector<u32> cacheTimestamps(numVertices, 0);
+	u32 timestamp = cacheSize + 1;
+
+	std::vector<bool> referenced(numVertices, false);
+	u32 numReferenced = 0;
+	u32 misses = 0;
+
+	for (u32 index : indices)
+	{
+		if (cacheMiss(cacheTimestamps, timestamp, cacheSize, index))
+			misses++;
+
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			numReferenced++;
+		}
+	}
+
+	statistics.acmr = static_cast<f32>(misses) / static_cast<f32>(numTriangles);
+	statistics.atvr = static_cast<f32>(misses) / static_cast<f32>(numReferenced);
+
+	return statistics;
+}
+
+void WillEngine::Utils::optimizeVertexCache(std::vector<u32>& indices, u32 numVertices)
+{
+	const u32 numTriangles = static_cast<u32>(indices.size() / 3);
+
+	if (numTriangles == 0)
+		return;
+
+	// Triangles of every vertex, the live ones first
+	std::vector<u32> triangleOffsets(numVertices + 1, 0);
+	for (u32 index : indices)
+	{
+		triangleOffsets[index + 1]++;
+	}
+
+	std::vector<u32> numLiveTriangles(numVertices);
+	for (u32 i = 0; i < numVertices; i++)
+	{
+		numLiveTriangles[i] = triangleOffsets[i + 1];
+		triangleOffsets[i + 1] += triangleOffsets[i];
+	}
+
+	std::vector<u32> vertexTriangles(numTriangles * 3);
+	std::vector<u32> fillOffsets(triangleOffsets.begin(), triangleOffsets.end() - 1);
+	for (u32 i = 0; i < numTriangles * 3; i++)
+	{
+		vertexTriangles[fillOffsets[indices[i]]++] = i / 3;
+	}
+
+	std::vector<i32> cachePositions(numVertices, -1);
+	std::vector<f32> vertexScores(numVertices);
+	for (u32 i = 0; i < numVertices; i++)
+	{
+		vertexScores[i] = forsythVertexScore(-1, numLiveTriangles[i]);
+	}
+
+	std::vector<f32> triangleScores(numTriangles);
+	u32 bestTriangle = 0;
+	for (u32 i = 0; i < numTriangles; i++)
+	{
+		triangleScores[i] = vertexScores[indices[i * 3]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+
+		if (triangleScores[i] > triangleScores[bestTriangle])
+			bestTriangle = i;
+	}
+
+	std::vector<bool> emitted(numTriangles, false);
+	u32 nextTriangle = 0;
+
+	std::vector<u32> optimized;
+	optimized.reserve(numTriangles * 3);
+
+	// Most recently used vertex first, with room for the vertices of one more triangle before the oldest ones are dropped
+	std::vector<u32> cache;
+	std::vector<u32> newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	for (u32 n = 0; n < numTriangles; n++)
+	{
+		// No vertex in the cache has triangles left, continue with the next triangle in the original order
+		if (bestTriangle == NO_TRIANGLE)
+		{
+			while (emitted[nextTriangle])
+			{
+				nextTriangle++;
+			}
+
+			bestTriangle = nextTriangle;
+		}
+
+		emitted[bestTriangle] = true;
+
+		const u32 triangle[3] = { indices[bestTriangle * 3], indices[bestTriangle * 3 + 1], indices[bestTriangle * 3 + 2] };
+		optimized.insert(optimized.end(), triangle, triangle + 3);
+
+		newCache.clear();
+		for (u32 k = 0; k < 3; k++)
+		{
+			const u32 vertex = triangle[k];
+
+			// Degenerate triangles use a vertex more than once
+			if (std::find(newCache.begin(), newCache.end(), vertex) != newCache.end())
+				continue;
+
+			newCache.push_back(vertex);
+
+			// Swap the triangle behind the vertex's live triangles
+			u32* liveTriangles = &vertexTriangles[triangleOffsets[vertex]];
+			u32* emittedTriangle = std::find(liveTriangles, liveTriangles + numLiveTriangles[vertex], bestTriangle);
+			std::swap(*emittedTriangle, liveTriangles[numLiveTriangles[vertex] - 1]);
+			numLiveTriangles[vertex]--;
+		}
+
+		// Followed by the rest of the cache
+		const u32 numTriangleVertices = static_cast<u32>(newCache.size());
+		for (u32 vertex : cache)
+		{
+			if (std::find(newCache.begin(), newCache.begin() + numTriangleVertices, vertex) == newCache.begin() + numTriangleVertices)
+				newCache.push_back(vertex);
+		}
+
+		// Vertices pushed out of the cache lose their cache score
+		for (u32 i = 0; i < newCache.size(); i++)
+		{
+			cachePositions[newCache[i]] = i < FORSYTH_CACHE_SIZE ? static_cast<i32>(i) : -1;
+		}
+
+		// Only the vertices that moved in the cache change score, and with them their live triangles
+		for (u32 vertex : newCache)
+		{
+			const f32 score = forsythVertexScore(cachePositions[vertex], numLiveTriangles[vertex]);
+			const f32 difference = score - vertexScores[vertex];
+			vertexScores[vertex] = score;
+
+			const u32* liveTriangles = &vertexTriangles[triangleOffsets[vertex]];
+			for (u32 i = 0; i < numLiveTriangles[vertex]; i++)
+			{
+				triangleScores[liveTriangles[i]] += difference;
+			}
+		}
+
+		newCache.resize(std::min<u64>(newCache.size(), FORSYTH_CACHE_SIZE));
+		cache.swap(newCache);
+
+		// The next triangle is the best one using a vertex in the cache
+		bestTriangle = NO_TRIANGLE;
+		f32 bestScore = -1.0f;
+		for (u32 vertex : cache)
+		{
+			const u32* liveTriangles = &vertexTriangles[triangleOffsets[vertex]];
+			for (u32 i = 0; i < numLiveTriangles[vertex]; i++)
+			{
+				if (triangleScores[liveTriangles[i]] > bestScore)
+				{
+					bestScore = triangleScores[liveTriangles[i]];
+					bestTriangle = liveTriangles[i];
+				}
+			}
+		}
+	}
+
+	indices.swap(optimized);
+}
+
+void WillEngine::Utils::optimizeOverdraw(std::vector<u32>& indices, const std::vector<vec3>& positions, f32 threshold)
+{
+	const u32 numTriangles = static_cast<u32>(indices.size() / 3);
+	const u32 numVertices = static_cast<u32>(positions.size());
+
+	if (numTriangles == 0)
+		return;
+
+	std::vector<u32> cacheTimestamps(numVertices, 0);
+	u32 timestamp = VERTEX_CACHE_SIZE + 1;
+
+	auto triangleMisses = [&](u32 triangle)
+		{
+			u32 misses = 0;
+			for (u32 k = 0; k < 3; k++)
+			{
+				if (cacheMiss(cacheTimestamps, timestamp, VERTEX_CACHE_SIZE, indices[triangle * 3 + k]))
+					misses++;
+			}
+
+			return misses;
+		};
+
+	// Every vertex in the cache becomes too old, as if the previous cluster was drawn somewhere else
+	auto resetCache = [&]()
+		{
+			timestamp += VERTEX_CACHE_SIZE + 1;
+		};
+
+	// Hard boundaries where the cache optimisation started again and no vertex was reused, moving them costs nothing
+	std::vector<u32> hardClusters;
+	for (u32 i = 0; i < numTriangles; i++)
+	{
+		if (triangleMisses(i) == 3)
+			hardClusters.push_back(i);
+	}
+
+	if (hardClusters.empty() || hardClusters[0] != 0)
+		hardClusters.insert(hardClusters.begin(), 0);
+
+	hardClusters.push_back(numTriangles);
+
+	// Split a hard cluster where the part so far already reuses vertices about as well as the whole cluster
+	std::vector<u32> clusters;
+	for (u32 c = 0; c + 1 < hardClusters.size(); c++)
+	{
+		const u32 begin = hardClusters[c];
+		const u32 end = hardClusters[c + 1];
+
+		resetCache();
+
+		u32 clusterMisses = 0;
+		for (u32 i = begin; i < end; i++)
+		{
+			clusterMisses += triangleMisses(i);
+		}
+
+		const f32 clusterAcmr = static_cast<f32>(clusterMisses) / static_cast<f32>(end - begin);
+
+		resetCache();
+		clusters.push_back(begin);
+
+		u32 start = begin;
+		u32 misses = 0;
+		for (u32 i = begin; i < end; i++)
+		{
+			misses += triangleMisses(i);
+
+			if (i + 1 < end && static_cast<f32>(misses) <= threshold * clusterAcmr * static_cast<f32>(i + 1 - start))
+			{
+				clusters.push_back(i + 1);
+
+				resetCache();
+				start = i + 1;
+				misses = 0;
+			}
+		}
+	}
+
+	const u32 numClusters = static_cast<u32>(clusters.size());
+	clusters.push_back(numTriangles);
+
+	// Area weighted centre of the mesh
+	vec3 meshCentre(0);
+	f32 meshArea = 0;
+
+	std::vector<vec3> clusterCentres(numClusters, vec3(0));
+	std::vector<vec3> clusterNormals(numClusters, vec3(0));
+	for (u32 c = 0; c < numClusters; c++)
+	{
+		f32 clusterArea = 0;
+
+		for (u32 i = clusters[c]; i < clusters[c + 1]; i++)
+		{
+			const vec3& p0 = positions[indices[i * 3]];
+			const vec3& p1 = positions[indices[i * 3 + 1]];
+			const vec3& p2 = positions[indices[i * 3 + 2]];
+
+			// Twice the area in the length
+			const vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			const f32 area = glm::length(normal);
+			const vec3 centre = (p0 + p1 + p2) / 3.0f;
+
+			clusterCentres[c] += centre * area;
+			clusterNormals[c] += normal;
+			clusterArea += area;
+		}
+
+		meshCentre += clusterCentres[c];
+		meshArea += clusterArea;
+
+		if (clusterArea > 0)
+			clusterCentres[c] /= clusterArea;
+	}
+
+	if (meshArea > 0)
+		meshCentre /= meshArea;
+
+	// Clusters in front of the centre and facing away from it are likely to occlude the rest, so they are drawn first
+	std::vector<f32> sortKeys(numClusters, 0);
+	for (u32 c = 0; c < numClusters; c++)
+	{
+		const f32 normalLength = glm::length(clusterNormals[c]);
+		if (normalLength > 0)
+			sortKeys[c] = glm::dot(clusterCentres[c] - meshCentre, clusterNormals[c] / normalLength);
+	}
+
+	std::vector<u32> order(numClusters);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](u32 a, u32 b)
+		{
+			return sortKeys[a] > sortKeys[b];
+		});
+
+	std::vector<u32> sorted;
+	sorted.reserve(indices.size());
+	for (u32 c : order)
+	{
+		sorted.insert(sorted.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	}
+
+	indices.swap(sorted);
+}
+
+u32 WillEngine::Utils::optimizeVertexFetch(std::vector<u32>& indices, u32 numVertices, std::vector<u32>& remap)
+{
+	remap.assign(numVertices, Mesh::REMOVED_VERTEX);
+
+	u32 numUsedVertices = 0;
+	for (u32& index : indices)
+	{
+		if (remap[index] == Mesh::REMOVED_VERTEX)
+			remap[index] = numUsedVertices++;
+
+		index = remap[index];
+	}
+
+	return numUsedVertices;
+}
\ No newline at end of file
@@ -0,0 +1,440 @@
+#include "pch.h"
+#include "Utils/MeshSimplifier.h"
+
+#include "Core/SkinnedMesh.h"
+
+#include "Utils/MeshOptimizer.h"
+
+#include <atomic>
+#include <numeric>
+
+// Vertices without a bone form their own group
+static const u32 NO_GROUP = UINT32_MAX;
+
+// Sum of the squared distances to a set of planes, weighted by the area of the triangle each plane came from
+// Symmetric 4x4 matrix, only the upper triangle is stored
+struct Quadric
+{
+	f64 a00, a01, a02, a03;
+	f64 a11, a12, a13;
+	f64 a22, a23;
+	f64 a33;
+
+	// Total area of the planes, the error is divided by it to get a squared distance
+	f64 weight;
+};
+
+// Edge collapse of one vertex onto a neighbour
+struct Collapse
+{
+	u32 from;
+	u32 to;
+	f64 cost;
+};
+
+static void addPlane(Quadric& quadric, const vec3& normal, f64 distance, f64 weight)
+{
+	const f64 a = normal.x;
+	const f64 b = normal.y;
+	const f64 c = normal.z;
+
+	quadric.a00 += weight * a * a;
+	quadric.a01 += weight * a * b;
+	quadric.a02 += weight * a * c;
+	quadric.a03 += weight * a * distance;
+	quadric.a11 += weight * b * b;
+	quadric.a12 += weight * b * c;
+	quadric.a13 += weight * b * distance;
+	quadric.a22 += weight * c * c;
+	quadric.a23 += weight * c * distance;
+	quadric.a33 += weight * distance * distance;
+	quadric.weight += weight;
+}
+
+static void addQuadric(Quadric& quadric, const Quadric& other)
+{
+	quadric.a00 += other.a00;
+	quadric.a01 += other.a01;
+	quadric.a02 += other.a02;
+	quadric.a03 += other.a03;
+	quadric.a11 += other.a11;
+	quadric.a12 += other.a12;
+	quadric.a13 += other.a13;
+	quadric.a22 += other.a22;
+	quadric.a23 += other.a23;
+	quadric.a33 += other.a33;
+	quadric.weight += other.weight;
+}
+
+// Mean squared distance of the position to the planes
+static f64 quadricError(const Quadric& quadric, const vec3& position)
+{
+	const f64 x = position.x;
+	const f64 y = position.y;
+	const f64 z = position.z;
+
+	const f64 error = quadric.a00 * x * x + 2 * quadric.a01 * x * y + 2 * quadric.a02 * x * z + 2 * quadric.a03 * x
+		+ quadric.a11 * y * y + 2 * quadric.a12 * y * z + 2 * quadric.a13 * y
+		+ quadric.a22 * z * z + 2 * quadric.a23 * z
+		+ quadric.a33;
+
+	return quadric.weight > 0 ? std::abs(error) / quadric.weight : 0;
+}
+
+void WillEngine::Utils::generateLods(Mesh* mesh)
+{
+	mesh->lods.clear();
+
+	const u32 numIndices = static_cast<u32>(mesh->indicies.size());
+	const u32 numVertices = static_cast<u32>(mesh->positions.size());
+
+	mesh->lods.push_back(MeshLod{ 0, numIndices, 0, 0, 0.0f });
+
+	// Only triangle lists are simplified
+	if (mesh->primitive != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST || numIndices < 3)
+		return;
+
+	// Skinned vertices are grouped by the bone with the largest weight, so parts moved by different bones stay apart
+	std::vector<u32> groups(numVertices, 0);
+	if (mesh->getGeometryType() == VulkanGeometryType::Skinned)
+	{
+		const SkinnedMesh* skinnedMesh = static_cast<const SkinnedMesh*>(mesh);
+
+		for (u32 i = 0; i < numVertices && i < skinnedMesh->boneWeights.size(); i++)
+		{
+			const BoneWeight& boneWeight = skinnedMesh->boneWeights[i];
+
+			groups[i] = NO_GROUP;
+			f32 maxWeight = 0;
+			for (u32 j = 0; j < MAX_BONE_INFLUENCE; j++)
+			{
+				if (boneWeight.boneIds[j] >= 0 && boneWeight.weights[j] > maxWeight)
+				{
+					maxWeight = boneWeight.weights[j];
+					groups[i] = static_cast<u32>(boneWeight.boneIds[j]);
+				}
+			}
+		}
+	}
+
+	const std::vector<bool> locked = findLockedVertices(mesh->indicies, mesh->positions);
+
+	// Every level is simplified from the level before, so the errors add up
+	std::vector<u32> previous = mesh->indicies;
+	f32 error = 0;
+
+	for (u32 i = 1; i < MAX_MESH_LODS; i++)
+	{
+		const u32 targetIndexCount = static_cast<u32>(previous.size() / 3 * LOD_TRIANGLE_RATIO) * 3;
+
+		f32 levelError = 0;
+		std::vector<u32> simplified = simplifyMesh(previous, mesh->positions, groups, locked, targetIndexCount, levelError);
+
+		if (simplified.empty() || simplified.size() > previous.size() * (1.0f - LOD_MIN_REDUCTION))
+			break;
+
+		optimizeVertexCache(simplified, numVertices);
+
+		error += levelError;
+
+		mesh->lods.push_back(MeshLod{ static_cast<u32>(mesh->indicies.size()), static_cast<u32>(simplified.size()), 0, 0, error });
+		mesh->indicies.insert(mesh->indicies.end(), simplified.begin(), simplified.end());
+
+		previous.swap(simplified);
+	}
+
+	mesh->indiciesSize = static_cast<u32>(mesh->indicies.size());
+}
+
+void WillEngine::Utils::generateMeshLods(const std::vector<Mesh*>& meshes, bool printStatistics)
+{
+	const u32 numMeshes = static_cast<u32>(meshes.size());
+
+	if (numMeshes == 0)
+		return;
+
+	// Meshes differ a lot in size, so every thread takes the next mesh once it is done
+	std::atomic<u32> nextMesh = 0;
+
+	auto generate = [&]()
+		{
+			for (u32 i = nextMesh++; i < numMeshes; i = nextMesh++)
+			{
+				generateLods(meshes[i]);
+			}
+		};
+
+	const u32 numThreads = std::clamp(std::thread::hardware_concurrency(), 1u, numMeshes);
+
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads);
+	for (u32 i = 0; i < numThreads; i++)
+	{
+		threads.emplace_back(generate);
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	if (!printStatistics)
+		return;
+
+	for (const Mesh* mesh : meshes)
+	{
+		printf("Generated %u levels of detail for mesh %s, triangles:", static_cast<u32>(mesh->lods.size()), mesh->name.c_str());
+
+		for (const MeshLod& lod : mesh->lods)
+		{
+			printf(" %u", lod.numIndices / 3);
+		}
+
+		printf("\n");
+	}
+}
+
+std::vector<u32> WillEngine::Utils::simplifyMesh(const std::vector<u32>& indices, const std::vector<vec3>& positions, const std::vector<u32>& groups,
+	const std::vector<bool>& locked, u32 targetIndexCount, f32& error)
+{
+	const u32 numVertices = static_cast<u32>(positions.size());
+
+	std::vector<u32> result = indices;
+
+	// Planes of the triangles around every vertex
+	std::vector<Quadric> quadrics(numVertices, Quadric{});
+	for (u32 i = 0; i + 2 < result.size(); i += 3)
+	{
+		const vec3& a = positions[result[i]];
+		vec3 normal = glm::cross(positions[result[i + 1]] - a, positions[result[i + 2]] - a);
+		const f32 length = glm::length(normal);
+
+		if (length <= 0.0f)
+			continue;
+
+		normal /= length;
+		const f64 distance = -glm::dot(normal, a);
+
+		for (u32 j = 0; j < 3; j++)
+		{
+			addPlane(quadrics[result[i + j]], normal, distance, length * 0.5);
+		}
+	}
+
+	// Vertex every vertex has collapsed onto in the current pass
+	std::vector<u32> collapsedTo(numVertices);
+	std::iota(collapsedTo.begin(), collapsedTo.end(), 0);
+
+	std::vector<Collapse> collapses;
+	std::vector<u32> triangleOffsets;
+	std::vector<u32> vertexTriangles;
+	std::vector<bool> touched;
+
+	f64 maxCost = 0;
+
+	// Every pass collapses the cheapest edges that don't share a triangle with each other
+	while (result.size() > targetIndexCount)
+	{
+		const u32 numTriangles = static_cast<u32>(result.size() / 3);
+
+		collapses.clear();
+		for (u32 i = 0; i < result.size(); i += 3)
+		{
+			for (u32 j = 0; j < 3; j++)
+			{
+				const u32 a = result[i + j];
+				const u32 b = result[i + (j + 1) % 3];
+
+				Quadric quadric = quadrics[a];
+				addQuadric(quadric, quadrics[b]);
+
+				if (!locked[a] && groups[a] == groups[b])
+					collapses.push_back(Collapse{ a, b, quadricError(quadric, positions[b]) });
+
+				if (!locked[b] && groups[a] == groups[b])
+					collapses.push_back(Collapse{ b, a, quadricError(quadric, positions[a]) });
+			}
+		}
+
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+			{
+				return a.cost < b.cost;
+			});
+
+		// Triangles around every vertex
+		triangleOffsets.assign(numVertices + 1, 0);
+		for (u32 index : result)
+		{
+			triangleOffsets[index + 1]++;
+		}
+
+		std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+
+		vertexTriangles.resize(result.size());
+		std::vector<u32> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (u32 i = 0; i < result.size(); i++)
+		{
+			vertexTriangles[fill[result[i]]++] = i / 3;
+		}
+
+		touched.assign(numVertices, false);
+
+		const u32 trianglesToRemove = numTriangles - targetIndexCount / 3;
+		u32 removedTriangles = 0;
+		u32 appliedCollapses = 0;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (removedTriangles >= trianglesToRemove)
+				break;
+
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			// The collapse is rejected if a remaining triangle would turn over
+			bool flipped = false;
+			u32 collapsedTriangles = 0;
+			for (u32 i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1] && !flipped; i++)
+			{
+				const u32 triangle = vertexTriangles[i];
+				const u32* corners = &result[triangle * 3];
+
+				if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to)
+				{
+					collapsedTriangles++;
+					continue;
+				}
+
+				vec3 before[3];
+				vec3 after[3];
+				for (u32 j = 0; j < 3; j++)
+				{
+					before[j] = positions[corners[j]];
+					after[j] = positions[corners[j] == collapse.from ? collapse.to : corners[j]];
+				}
+
+				const vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				const vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+				// Degenerate triangles have no side to turn over to
+				if (normalBefore != vec3(0))
+					flipped = glm::dot(normalBefore, normalAfter) <= 0.0f;
+			}
+
+			if (flipped)
+				continue;
+
+			collapsedTo[collapse.from] = collapse.to;
+			addQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+			maxCost = std::max(maxCost, collapse.cost);
+
+			// The triangles around the vertex change, so none of their vertices collapse again in this pass
+			for (u32 i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1]; i++)
+			{
+				const u32 triangle = vertexTriangles[i];
+
+				for (u32 j = 0; j < 3; j++)
+				{
+					touched[result[triangle * 3 + j]] = true;
+				}
+			}
+
+			removedTriangles += collapsedTriangles;
+			appliedCollapses++;
+		}
+
+		if (appliedCollapses == 0)
+			break;
+
+		// Move the collapsed vertices and drop the triangles that have lost an edge
+		u32 numIndices = 0;
+		for (u32 i = 0; i < result.size(); i += 3)
+		{
+			const u32 a = collapsedTo[result[i]];
+			const u32 b = collapsedTo[result[i + 1]];
+			const u32 c = collapsedTo[result[i + 2]];
+
+			if (a == b || b == c || a == c)
+				continue;
+
+			result[numIndices++] = a;
+			result[numIndices++] = b;
+			result[numIndices++] = c;
+		}
+		result.resize(numIndices);
+	}
+
+	error = static_cast<f32>(std::sqrt(maxCost));
+
+	return result;
+}
+
+std::vector<bool> WillEngine::Utils::findLockedVertices(const std::vector<u32>& indices, const std::vector<vec3>& positions)
+{
+	const u32 numVertices = static_cast<u32>(positions.size());
+
+	std::vector<bool> locked(numVertices, false);
+
+	// Vertices sorted by position, so the ones with the same position are next to each other
+	std::vector<u32> order(numVertices);
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](u32 a, u32 b)
+		{
+			const vec3& pa = positions[a];
+			const vec3& pb = positions[b];
+
+			return std::tie(pa.x, pa.y, pa.z) < std::tie(pb.x, pb.y, pb.z);
+		});
+
+	// The first vertex with the same position stands for all of them
+	std::vector<u32> positionIds(numVertices);
+	for (u32 i = 0; i < numVertices; i++)
+	{
+		const bool samePosition = i > 0 && positions[order[i]] == positions[order[i - 1]];
+
+		positionIds[order[i]] = samePosition ? positionIds[order[i - 1]] : order[i];
+
+		if (samePosition)
+		{
+			locked[order[i]] = true;
+			locked[order[i - 1]] = true;
+		}
+	}
+
+	// Directed edges between positions, an edge of a closed manifold surface has exactly one opposite edge
+	std::unordered_map<u64, u32> edgeCounts;
+	auto edgeKey = [](u32 a, u32 b)
+		{
+			return (static_cast<u64>(a) << 32) | b;
+		};
+
+	for (u32 i = 0; i + 2 < indices.size(); i += 3)
+	{
+		for (u32 j = 0; j < 3; j++)
+		{
+			edgeCounts[edgeKey(positionIds[indices[i + j]], positionIds[indices[i + (j + 1) % 3]])]++;
+		}
+	}
+
+	for (u32 i = 0; i + 2 < indices.size(); i += 3)
+	{
+		for (u32 j = 0; j < 3; j++)
+		{
+			const u32 a = indices[i + j];
+			const u32 b = indices[i + (j + 1) % 3];
+
+			auto opposite = edgeCounts.find(edgeKey(positionIds[b], positionIds[a]));
+
+			if (edgeCounts[edgeKey(positionIds[a], positionIds[b])] != 1 || opposite == edgeCounts.end() || opposite->second != 1)
+			{
+				locked[a] = true;
+				locked[b] = true;
+			}
+		}
+	}
+
+	return locked;
+}
\ No newline at end of file
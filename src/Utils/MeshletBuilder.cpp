@@ -0,0 +1,170 @@
+#include "pch.h"
+#include "Utils/MeshletBuilder.h"
+
+void WillEngine::Utils::buildMeshlets(Mesh* mesh)
+{
+	mesh->meshlets.clear();
+
+	// The whole mesh is one level if no levels were generated
+	if (mesh->lods.empty())
+	{
+		buildMeshlets(mesh, 0, static_cast<u32>(mesh->indicies.size()));
+
+		return;
+	}
+
+	for (MeshLod& lod : mesh->lods)
+	{
+		lod.firstMeshlet = static_cast<u32>(mesh->meshlets.size());
+		buildMeshlets(mesh, lod.firstIndex, lod.numIndices);
+		lod.numMeshlets = static_cast<u32>(mesh->meshlets.size()) - lod.firstMeshlet;
+	}
+}
+
+void WillEngine::Utils::buildMeshlets(Mesh* mesh, u32 firstIndex, u32 numIndices)
+{
+	if (numIndices == 0)
+		return;
+
+	// Other topologies are drawn whole, as one meshlet that is never back-face culled
+	if (mesh->primitive != VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST || numIndices < 3)
+	{
+		Meshlet meshlet{};
+		meshlet.firstIndex = firstIndex;
+		meshlet.numIndices = numIndices;
+		meshlet.numVertices = static_cast<u32>(mesh->positions.size());
+		meshlet.boundingSphere = mesh->boundingSphere;
+		meshlet.coneAxis = vec3(0, 0, 1);
+		meshlet.coneCutoff = MESHLET_NO_CONE;
+		mesh->meshlets.push_back(meshlet);
+
+		return;
+	}
+
+	// Meshlet a vertex was last counted in, so shared vertices are only counted once per meshlet
+	std::vector<u32> vertexMeshlet(mesh->positions.size(), UINT32_MAX);
+
+	Meshlet meshlet{};
+	meshlet.firstIndex = firstIndex;
+
+	const u32 lastIndex = firstIndex + numIndices;
+
+	for (u32 i = firstIndex; i + 2 < lastIndex; i += 3)
+	{
+		const u32 meshletIndex = static_cast<u32>(mesh->meshlets.size());
+
+		u32 newVertices = 0;
+		for (u32 j = 0; j < 3; j++)
+		{
+			if (vertexMeshlet[mesh->indicies[i + j]] != meshletIndex)
+				newVertices++;
+		}
+
+		const bool full = meshlet.numVertices + newVertices > MAX_MESHLET_VERTICES || meshlet.numIndices / 3 + 1 > MAX_MESHLET_TRIANGLES;
+
+		if (full)
+		{
+			computeMeshletBounds(meshlet, mesh->indicies, mesh->positions);
+			mesh->meshlets.push_back(meshlet);
+
+			meshlet = Meshlet{};
+			meshlet.firstIndex = i;
+		}
+
+		// The triangle starts the next meshlet if this one was full
+		const u32 currentMeshlet = static_cast<u32>(mesh->meshlets.size());
+		for (u32 j = 0; j < 3; j++)
+		{
+			const u32 vertex = mesh->indicies[i + j];
+
+			if (vertexMeshlet[vertex] != currentMeshlet)
+			{
+				vertexMeshlet[vertex] = currentMeshlet;
+				meshlet.numVertices++;
+			}
+		}
+
+		meshlet.numIndices += 3;
+	}
+
+	computeMeshletBounds(meshlet, mesh->indicies, mesh->positions);
+	mesh->meshlets.push_back(meshlet);
+}
+
+void WillEngine::Utils::computeMeshletBounds(Meshlet& meshlet, const std::vector<u32>& indices, const std::vector<vec3>& positions)
+{
+	const u32 firstIndex = meshlet.firstIndex;
+	const u32 lastIndex = meshlet.firstIndex + meshlet.numIndices;
+
+	// Bounding sphere around the centre of the bounding box, the same as the mesh's
+	vec3 aabbMin = positions[indices[firstIndex]];
+	vec3 aabbMax = aabbMin;
+	for (u32 i = firstIndex; i < lastIndex; i++)
+	{
+		aabbMin = glm::min(aabbMin, positions[indices[i]]);
+		aabbMax = glm::max(aabbMax, positions[indices[i]]);
+	}
+
+	const vec3 centre = (aabbMin + aabbMax) * 0.5f;
+
+	f32 radiusSquared = 0;
+	for (u32 i = firstIndex; i < lastIndex; i++)
+	{
+		const vec3 offset = positions[indices[i]] - centre;
+		radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+	}
+
+	meshlet.boundingSphere = vec4(centre, std::sqrt(radiusSquared));
+
+	meshlet.coneApex = centre;
+	meshlet.coneAxis = vec3(0, 0, 1);
+	meshlet.coneCutoff = MESHLET_NO_CONE;
+
+	// Normal cone, the axis is the average of the triangle normals
+	// First corner and unit normal of every triangle
+	std::vector<std::pair<vec3, vec3>> triangles;
+	triangles.reserve(meshlet.numIndices / 3);
+
+	vec3 normalSum(0);
+	for (u32 i = firstIndex; i + 2 < lastIndex; i += 3)
+	{
+		const vec3& a = positions[indices[i]];
+		const vec3 normal = glm::cross(positions[indices[i + 1]] - a, positions[indices[i + 2]] - a);
+		const f32 length = glm::length(normal);
+
+		// Degenerate triangles are never drawn, so they don't widen the cone
+		if (length <= 0.0f)
+			continue;
+
+		triangles.emplace_back(a, normal / length);
+		normalSum += normal / length;
+	}
+
+	const f32 sumLength = glm::length(normalSum);
+
+	if (triangles.empty() || sumLength <= 0.0f)
+		return;
+
+	const vec3 axis = normalSum / sumLength;
+
+	f32 minDot = 1.0f;
+	for (const auto& [corner, normal] : triangles)
+	{
+		minDot = std::min(minDot, glm::dot(normal, axis));
+	}
+
+	if (minDot <= MESHLET_MIN_CONE_DOT)
+		return;
+
+	// Move the apex back along the axis until it is behind the plane of every triangle
+	f32 maxDistance = 0;
+	for (const auto& [corner, normal] : triangles)
+	{
+		maxDistance = std::max(maxDistance, glm::dot(centre - corner, normal) / glm::dot(axis, normal));
+	}
+
+	meshlet.coneApex = centre - axis * maxDistance;
+	meshlet.coneAxis = axis;
+	// A view direction within the cutoff of the axis sees the back of every triangle
+	meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
\ No newline at end of file
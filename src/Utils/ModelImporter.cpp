@@ -8,6 +8,9 @@
 
 #include "Utils/Image.h"
 #include "Utils/MathUtil.h"
+#include "Utils/MeshOptimizer.h"
+#include "Utils/MeshletBuilder.h"
+#include "Utils/MeshSimplifier.h"
 
 #include <assimp/cimport.h>
 
@@ -55,6 +58,18 @@ std::tuple<std::vector<Mesh*>, std::map<u32, Material*>, Skeleton*, std::vector<
 
 	std::vector<Mesh*> meshes = extractMesh(scene);
 
+	// Triangle and vertex order for the vertex cache and vertex fetch
+	optimizeMeshes(meshes, OPTIMIZE_OVERDRAW, PRINT_MESH_STATISTICS);
+
+	// Coarser levels of detail sharing the optimised vertices
+	generateMeshLods(meshes, PRINT_MESH_STATISTICS);
+
+	// Clusters of the triangles of every level, culled on the GPU
+	for (u32 i = 0; i < meshes.size(); i++)
+	{
+		buildMeshlets(meshes[i]);
+	}
+
 	// Reassign material id to our own generated unique id
 	for (u32 i = 0; i < meshes.size(); i++)
 	{
@@ -250,18 +265,20 @@ Mesh* WillEngine::Utils::extractMeshWithoutBones(const aiMesh* currentAiMesh)
 	const aiVector3D* pVertex = currentAiMesh->mVertices;
 	const aiVector3D* pNormal = currentAiMesh->mNormals;
 	const aiVector3D* pTangent = currentAiMesh->mTangents;
+	const aiVector3D* pBitangent = currentAiMesh->mBitangents;
 	const aiVector3D* pUV = hasTexture ? currentAiMesh->mTextureCoords[0] : &zero3D;
 
 	for (u64 j = 0; j < currentAiMesh->mNumVertices; j++)
 	{
 		mesh->positions.emplace_back(pVertex->x, pVertex->y, pVertex->z);
 		mesh->normals.emplace_back(pNormal->x, pNormal->y, pNormal->z);
-		mesh->tangents.emplace_back(pTangent->x, pTangent->y, pTangent->z);
+		mesh->tangents.push_back(tangentWithSign(*pNormal, *pTangent, *pBitangent));
 		mesh->uvs.emplace_back(pUV->x, pUV->y);
 
 		pVertex++;
 		pNormal++;
 		pTangent++;
+		pBitangent++;
 
 		if (hasTexture)
 			pUV++;
@@ -285,6 +302,9 @@ Mesh* WillEngine::Utils::extractMeshWithoutBones(const aiMesh* currentAiMesh)
 
 	mesh->materialIndex = currentAiMesh->mMaterialIndex;
 
+	// The positions are freed once uploaded, the bounds are kept for culling
+	mesh->computeBounds();
+
 	return mesh;
 }
 
@@ -309,18 +329,20 @@ Mesh* WillEngine::Utils::extractMeshWithBones(const aiMesh* currentAiMesh)
 	const aiVector3D* pVertex = currentAiMesh->mVertices;
 	const aiVector3D* pNormal = currentAiMesh->mNormals;
 	const aiVector3D* pTangent = currentAiMesh->mTangents;
+	const aiVector3D* pBitangent = currentAiMesh->mBitangents;
 	const aiVector3D* pUV = hasTexture ? currentAiMesh->mTextureCoords[0] : &zero3D;
 
 	for (u64 j = 0; j < currentAiMesh->mNumVertices; j++)
 	{
 		mesh->positions.emplace_back(pVertex->x, pVertex->y, pVertex->z);
 		mesh->normals.emplace_back(pNormal->x, pNormal->y, pNormal->z);
-		mesh->tangents.emplace_back(pTangent->x, pTangent->y, pTangent->z);
+		mesh->tangents.push_back(tangentWithSign(*pNormal, *pTangent, *pBitangent));
 		mesh->uvs.emplace_back(pUV->x, pUV->y);
 
 		pVertex++;
 		pNormal++;
 		pTangent++;
+		pBitangent++;
 
 		if (hasTexture)
 			pUV++;
@@ -344,6 +366,9 @@ Mesh* WillEngine::Utils::extractMeshWithBones(const aiMesh* currentAiMesh)
 
 	mesh->materialIndex = currentAiMesh->mMaterialIndex;
 
+	// Bounds of the bind pose
+	mesh->computeBounds();
+
 	// =====================================================
 
 	extractVerticesBoneWeight(mesh, currentAiMesh);
@@ -353,6 +378,18 @@ Mesh* WillEngine::Utils::extractMeshWithBones(const aiMesh* currentAiMesh)
 	return (Mesh*) mesh;
 }
 
+vec4 WillEngine::Utils::tangentWithSign(const aiVector3D& normal, const aiVector3D& tangent, const aiVector3D& bitangent)
+{
+	const vec3 n(normal.x, normal.y, normal.z);
+	const vec3 t(tangent.x, tangent.y, tangent.z);
+	const vec3 b(bitangent.x, bitangent.y, bitangent.z);
+
+	// Negative when the uvs are mirrored
+	const f32 sign = glm::dot(glm::cross(t, n), b) < 0 ? -1.0f : 1.0f;
+
+	return vec4(t, sign);
+}
+
 void WillEngine::Utils::extractNodes(const char* filename, const aiScene* scene, std::vector<Mesh*> extractedMesh, std::map<u32, Material*> extractedMaterial,
 	Skeleton* extractedSkeleton, std::vector<Entity*>* entities)
 {
@@ -29,6 +29,25 @@ std::optional<u32> WillEngine::VulkanUtil::findQueueFamilies(VkPhysicalDevice& p
     return {};
 }
 
+std::optional<u32> WillEngine::VulkanUtil::findDedicatedComputeQueueFamily(VkPhysicalDevice& physicalDevice)
+{
+    u32 queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
+
+    for (u32 i = 0; i < queueFamilyProperties.size(); i++)
+    {
+        const VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+
+        if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+            return i;
+    }
+
+    return {};
+}
+
 void WillEngine::VulkanUtil::querySupportedSurfaceFormat(VkPhysicalDevice& device,
     VkSurfaceKHR& surface,
     VkSurfaceCapabilitiesKHR& capabilities,
@@ -423,6 +442,25 @@ void WillEngine::VulkanUtil::createImageView(VkDevice& logicalDevice, VkImage& i
         throw std::runtime_error("Failed to create image view");
 }
 
+void WillEngine::VulkanUtil::createMipImageView(VkDevice& logicalDevice, VkImage& image, VkImageView& imageView, u32 baseMipLevel, u32 mipLevels,
+    VkFormat format, VkImageAspectFlags aspectMask)
+{
+    VkImageViewCreateInfo imageViewInfo{};
+    imageViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    imageViewInfo.image = image;
+    imageViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    imageViewInfo.format = format;
+    imageViewInfo.components = VkComponentMapping{};
+    imageViewInfo.subresourceRange.aspectMask = aspectMask;
+    imageViewInfo.subresourceRange.baseMipLevel = baseMipLevel;
+    imageViewInfo.subresourceRange.levelCount = mipLevels;
+    imageViewInfo.subresourceRange.baseArrayLayer = 0;
+    imageViewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(logicalDevice, &imageViewInfo, nullptr, &imageView) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create image view");
+}
+
 void WillEngine::VulkanUtil::createDepthImageView(VkDevice& logicalDevice, VkImage& image, VkImageView& imageView, u32 layerCount,
     VkFormat format, VkImageAspectFlags aspectMask)
 {
@@ -573,6 +611,21 @@ VkCommandPool WillEngine::VulkanUtil::createCommandPool(VkDevice& logicalDevice,
     return std::move(commandPool);
 }
 
+VkCommandPool WillEngine::VulkanUtil::createCommandPool(VkDevice& logicalDevice, u32 queueFamilyIndex)
+{
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+
+    if (vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create command pool");
+
+    return commandPool;
+}
+
 VkCommandBuffer WillEngine::VulkanUtil::createCommandBuffer(VkDevice& logicalDevice, VkCommandPool& commandPool)
 {
     VkCommandBufferAllocateInfo allocateInfo{};
@@ -620,6 +673,17 @@ VkFence WillEngine::VulkanUtil::createFence(VkDevice& logicalDevice, bool signal
     return std::move(fence);
 }
 
+void WillEngine::VulkanUtil::memoryBarrier(VkCommandBuffer& commandBuffer, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask,
+    VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+{
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccessMask;
+    barrier.dstAccessMask = dstAccessMask;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
 void WillEngine::VulkanUtil::bufferBarrier(VkCommandBuffer& commandBuffer, VkBuffer& buffer, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask,
     VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage, VkDeviceSize size, VkDeviceSize offset, u32 srcFamilyIndex, u32 dstFamilyIndex)
 {
@@ -745,6 +809,30 @@ void WillEngine::VulkanUtil::initDepthSkeletonShaderModule(VkDevice& logicalDevi
     fragShader = WillEngine::VulkanUtil::createShaderModule(logicalDevice, fragShaderCode);
 }
 
+void WillEngine::VulkanUtil::initBakedSkeletalShaderModule(VkDevice& logicalDevice, VkShaderModule& vertShader, VkShaderModule& fragShader)
+{
+    const char* vertShaderPath = "././shaders/bone_pass/baked.vert.spv";
+    const char* fragShaderPath = "././shaders/geometry_pass/deferred.frag.spv";
+
+    auto vertShaderCode = WillEngine::Utils::readSprivShader(vertShaderPath);
+    auto fragShaderCode = WillEngine::Utils::readSprivShader(fragShaderPath);
+
+    vertShader = WillEngine::VulkanUtil::createShaderModule(logicalDevice, vertShaderCode);
+    fragShader = WillEngine::VulkanUtil::createShaderModule(logicalDevice, fragShaderCode);
+}
+
+void WillEngine::VulkanUtil::initDepthBakedSkeletonShaderModule(VkDevice& logicalDevice, VkShaderModule& vertShader, VkShaderModule& fragShader)
+{
+    const char* vertShaderPath = "././shaders/bone_pass/bakedDepth.vert.spv";
+    const char* fragShaderPath = "././shaders/bone_pass/depth.frag.spv";
+
+    auto vertShaderCode = WillEngine::Utils::readSprivShader(vertShaderPath);
+    auto fragShaderCode = WillEngine::Utils::readSprivShader(fragShaderPath);
+
+    vertShader = WillEngine::VulkanUtil::createShaderModule(logicalDevice, vertShaderCode);
+    fragShader = WillEngine::VulkanUtil::createShaderModule(logicalDevice, fragShaderCode);
+}
+
 void WillEngine::VulkanUtil::initFilterBrightShaderModule(VkDevice& logicalDevice, VkShaderModule& compShader)
 {
     //const char* shaderPath = "././shaders/post_processing/bloomDownscale.comp.spv";
@@ -791,6 +879,63 @@ void WillEngine::VulkanUtil::initBlendColorShaderModule(VkDevice& logicalDevice,
     compShader = WillEngine::VulkanUtil::createShaderModule(logicalDevice, shaderCode);
 }
 
+void WillEngine::VulkanUtil::initCullShaderModule(VkDevice& logicalDevice, VkShaderModule& compShader)
+{
+    const char* shaderPath = "././shaders/culling/cull.comp.spv";
+
+    auto shaderCode = WillEngine::Utils::readSprivShader(shaderPath);
+
+    compShader = WillEngine::VulkanUtil::createShaderModule(logicalDevice, shaderCode);
+}
+
+void WillEngine::VulkanUtil::initHiZShaderModule(VkDevice& logicalDevice, VkShaderModule& compShader)
+{
+    const char* shaderPath = "././shaders/culling/hiz.comp.spv";
+
+    auto shaderCode = WillEngine::Utils::readSprivShader(shaderPath);
+
+    compShader = WillEngine::VulkanUtil::createShaderModule(logicalDevice, shaderCode);
+}
+
+void WillEngine::VulkanUtil::initDepthIndirectShaderModule(VkDevice& logicalDevice, VkShaderModule& vertShader, VkShaderModule& fragShader)
+{
+    const char* vertShaderPath = "././shaders/depth_pre_pass/indirect.vert.spv";
+    const char* fragShaderPath = "././shaders/depth_pre_pass/shader.frag.spv";
+
+    auto vertShaderCode = WillEngine::Utils::readSprivShader(vertShaderPath);
+    auto fragShaderCode = WillEngine::Utils::readSprivShader(fragShaderPath);
+
+    vertShader = WillEngine::VulkanUtil::createShaderModule(logicalDevice, vertShaderCode);
+    fragShader = WillEngine::VulkanUtil::createShaderModule(logicalDevice, fragShaderCode);
+}
+
+void WillEngine::VulkanUtil::initGeometryIndirectShaderModule(VkDevice& logicalDevice, VkShaderModule& vertShader, VkShaderModule& fragShader)
+{
+    const char* vertShaderPath = "././shaders/geometry_pass/indirect.vert.spv";
+    const char* fragShaderPath = "././shaders/geometry_pass/deferred.frag.spv";
+
+    auto vertShaderCode = WillEngine::Utils::readSprivShader(vertShaderPath);
+    auto fragShaderCode = WillEngine::Utils::readSprivShader(fragShaderPath);
+
+    vertShader = WillEngine::VulkanUtil::createShaderModule(logicalDevice, vertShaderCode);
+    fragShader = WillEngine::VulkanUtil::createShaderModule(logicalDevice, fragShaderCode);
+}
+
+void WillEngine::VulkanUtil::initShadowIndirectShaderModule(VkDevice& logicalDevice, VkShaderModule& vertShader, VkShaderModule& geomShader, VkShaderModule& fragShader)
+{
+    const char* vertShaderPath = "././shaders/shadow_pass/point_light/indirect.vert.spv";
+    const char* geomShaderPath = "././shaders/shadow_pass/point_light/shadow.geom.spv";
+    const char* fragShaderPath = "././shaders/shadow_pass/point_light/shadow.frag.spv";
+
+    auto vertShaderCode = WillEngine::Utils::readSprivShader(vertShaderPath);
+    auto geomShaderCode = WillEngine::Utils::readSprivShader(geomShaderPath);
+    auto fragShaderCode = WillEngine::Utils::readSprivShader(fragShaderPath);
+
+    vertShader = WillEngine::VulkanUtil::createShaderModule(logicalDevice, vertShaderCode);
+    geomShader = WillEngine::VulkanUtil::createShaderModule(logicalDevice, geomShaderCode);
+    fragShader = WillEngine::VulkanUtil::createShaderModule(logicalDevice, fragShaderCode);
+}
+
 void WillEngine::VulkanUtil::createDescriptorSetLayout(VkDevice& logicalDevice, VkDescriptorSetLayout& descriptorSetLayout,
     VkDescriptorType descriptorType, VkShaderStageFlags shaderStage, u32 binding, u32 descriptorCount)
 {
@@ -809,6 +954,28 @@ void WillEngine::VulkanUtil::createDescriptorSetLayout(VkDevice& logicalDevice,
         throw std::runtime_error("Failed to create descriptor set layout");
 }
 
+void WillEngine::VulkanUtil::createDescriptorSetLayoutBindings(VkDevice& logicalDevice, VkDescriptorSetLayout& descriptorSetLayout,
+    VkDescriptorType descriptorType, VkShaderStageFlags shaderStage, u32 bindingCount)
+{
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings(bindingCount);
+    for (u32 i = 0; i < bindingCount; i++)
+    {
+        layoutBindings[i] = {};
+        layoutBindings[i].binding = i;
+        layoutBindings[i].descriptorType = descriptorType;
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].stageFlags = shaderStage;
+    }
+
+    VkDescriptorSetLayoutCreateInfo descriptorInfo{};
+    descriptorInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptorInfo.bindingCount = bindingCount;
+    descriptorInfo.pBindings = layoutBindings.data();
+
+    if (vkCreateDescriptorSetLayout(logicalDevice, &descriptorInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create descriptor set layout");
+}
+
 void WillEngine::VulkanUtil::allocDescriptorSet(VkDevice& logicalDevice, VkDescriptorPool& descriptorPool, VkDescriptorSetLayout& descriptorSetInfo,
     VkDescriptorSet& descriptorSet)
 {
@@ -822,7 +989,8 @@ void WillEngine::VulkanUtil::allocDescriptorSet(VkDevice& logicalDevice, VkDescr
         throw std::runtime_error("Failed to allocate Descriptor Sets");
 }
 
-void WillEngine::VulkanUtil::writeDescriptorSetBuffer(VkDevice& logicalDevice, VkDescriptorSet& descriptorSet, VkBuffer& descriptorBuffer, u32 binding)
+void WillEngine::VulkanUtil::writeDescriptorSetBuffer(VkDevice& logicalDevice, VkDescriptorSet& descriptorSet, VkBuffer& descriptorBuffer, u32 binding,
+    VkDescriptorType descriptorType)
 {
     VkDescriptorBufferInfo bufferInfo{};
     bufferInfo.buffer = descriptorBuffer;
@@ -833,7 +1001,7 @@ void WillEngine::VulkanUtil::writeDescriptorSetBuffer(VkDevice& logicalDevice, V
     writeSet.dstSet = descriptorSet;
     writeSet.dstBinding = binding;
     writeSet.descriptorCount = 1;
-    writeSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    writeSet.descriptorType = descriptorType;
     writeSet.pBufferInfo = &bufferInfo;
 
     vkUpdateDescriptorSets(logicalDevice, 1, &writeSet, 0, nullptr);
@@ -867,6 +1035,125 @@ void WillEngine::VulkanUtil::writeDescriptorSetImage(VkDevice& logicalDevice, Vk
     vkUpdateDescriptorSets(logicalDevice, 1, &writeSet, 0, nullptr);
 }
 
+VulkanVertexInput WillEngine::VulkanUtil::createVertexInput(VulkanGeometryType geometryType, bool compressed, bool positionOnly, bool bakedAnimation)
+{
+    VulkanVertexInput vertexInput{};
+    vertexInput.compressed = compressed ? VK_TRUE : VK_FALSE;
+
+    auto addBinding = [&vertexInput](u32 stride, VkVertexInputRate inputRate)
+    {
+        VkVertexInputBindingDescription binding{};
+        binding.binding = static_cast<u32>(vertexInput.bindings.size());
+        binding.stride = stride;
+        binding.inputRate = inputRate;
+
+        vertexInput.bindings.push_back(binding);
+    };
+
+    auto addAttribute = [&vertexInput](u32 location, u32 binding, VkFormat format, u32 offset)
+    {
+        VkVertexInputAttributeDescription attribute{};
+        attribute.location = location;
+        attribute.binding = binding;
+        attribute.format = format;
+        attribute.offset = offset;
+
+        vertexInput.attributes.push_back(attribute);
+    };
+
+    // Locations are the same for every layout, 0 position, 1 normal, 2 tangent, 3 uv, 4 bone ids, 5 weights
+    if (compressed)
+    {
+        // Positions stay in their own stream so the depth and shadow passes only fetch them
+        addBinding(sizeof(u64), VK_VERTEX_INPUT_RATE_VERTEX);
+        addAttribute(0, 0, VK_FORMAT_R16G16B16A16_UNORM, 0);
+
+        // Normal, tangent and uv interleaved
+        addBinding(sizeof(VulkanCompressedAttributes), VK_VERTEX_INPUT_RATE_VERTEX);
+        if (!positionOnly)
+        {
+            addAttribute(1, 1, VK_FORMAT_R16G16_SNORM, offsetof(VulkanCompressedAttributes, normal));
+            addAttribute(2, 1, VK_FORMAT_R8G8B8A8_SNORM, offsetof(VulkanCompressedAttributes, tangent));
+            addAttribute(3, 1, VK_FORMAT_R16G16_SFLOAT, offsetof(VulkanCompressedAttributes, uv));
+        }
+
+        // Bone ids and weights interleaved
+        if (geometryType == VulkanGeometryType::Skinned)
+        {
+            addBinding(sizeof(VulkanCompressedSkin), VK_VERTEX_INPUT_RATE_VERTEX);
+            addAttribute(4, 2, VK_FORMAT_R8G8B8A8_UINT, offsetof(VulkanCompressedSkin, boneIds));
+            addAttribute(5, 2, VK_FORMAT_R16G16B16A16_UNORM, offsetof(VulkanCompressedSkin, weights));
+        }
+    }
+    else
+    {
+        addBinding(sizeof(vec3), VK_VERTEX_INPUT_RATE_VERTEX);
+        addAttribute(0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0);
+
+        addBinding(sizeof(vec3), VK_VERTEX_INPUT_RATE_VERTEX);
+        addBinding(sizeof(vec4), VK_VERTEX_INPUT_RATE_VERTEX);
+        addBinding(sizeof(vec2), VK_VERTEX_INPUT_RATE_VERTEX);
+        if (!positionOnly)
+        {
+            addAttribute(1, 1, VK_FORMAT_R32G32B32_SFLOAT, 0);
+            addAttribute(2, 2, VK_FORMAT_R32G32B32A32_SFLOAT, 0);
+            addAttribute(3, 3, VK_FORMAT_R32G32_SFLOAT, 0);
+        }
+
+        if (geometryType == VulkanGeometryType::Skinned)
+        {
+            addBinding(sizeof(uvec4), VK_VERTEX_INPUT_RATE_VERTEX);
+            addAttribute(4, 4, VK_FORMAT_R32G32B32A32_UINT, 0);
+
+            addBinding(sizeof(vec4), VK_VERTEX_INPUT_RATE_VERTEX);
+            addAttribute(5, 5, VK_FORMAT_R32G32B32A32_SFLOAT, 0);
+        }
+    }
+
+    vertexInput.numStreams = static_cast<u32>(vertexInput.bindings.size());
+
+    // Streams without an attribute are bound with the arena but not described to the pipeline
+    if (positionOnly)
+    {
+        std::vector<VkVertexInputBindingDescription> usedBindings;
+        for (const VkVertexInputBindingDescription& binding : vertexInput.bindings)
+        {
+            auto used = std::find_if(vertexInput.attributes.begin(), vertexInput.attributes.end(),
+                [&binding](const VkVertexInputAttributeDescription& attribute) { return attribute.binding == binding.binding; });
+
+            if (used != vertexInput.attributes.end())
+                usedBindings.push_back(binding);
+        }
+
+        vertexInput.bindings = usedBindings;
+    }
+
+    // The baked animation instance buffer is bound after the streams
+    if (bakedAnimation)
+    {
+        const u32 instanceBinding = vertexInput.numStreams;
+
+        VkVertexInputBindingDescription binding{};
+        binding.binding = instanceBinding;
+        binding.stride = sizeof(BakedAnimationInstance);
+        binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        vertexInput.bindings.push_back(binding);
+
+        // Model transform, one location per column
+        for (u32 i = 0; i < 4; i++)
+        {
+            addAttribute(6 + i, instanceBinding, VK_FORMAT_R32G32B32A32_SFLOAT,
+                static_cast<u32>(offsetof(BakedAnimationInstance, modelTransform) + sizeof(vec4) * i));
+        }
+        // First matrix and number of frames
+        addAttribute(10, instanceBinding, VK_FORMAT_R32G32_UINT, offsetof(BakedAnimationInstance, firstMatrix));
+        // Frame rate and time offset
+        addAttribute(11, instanceBinding, VK_FORMAT_R32G32_SFLOAT, offsetof(BakedAnimationInstance, frameRate));
+    }
+
+    return vertexInput;
+}
+
 void WillEngine::VulkanUtil::createPipelineLayout(VkDevice& logicalDevice, VkPipelineLayout& pipelineLayout, u32 size,
     VkDescriptorSetLayout* descriptorSetLayout, u32 pushConstantCount, VkPushConstantRange* pushConstant)
 {
@@ -1033,7 +1320,7 @@ void WillEngine::VulkanUtil::createPipeline(VkDevice& logicalDevice, VkPipeline&
 }
 
 void WillEngine::VulkanUtil::createSkeletalPipeline(VkDevice& logicalDevice, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout, VkRenderPass& renderpass,
-    VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent)
+    VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent, const VulkanVertexInput& vertexInput)
 {
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -1047,75 +1334,29 @@ void WillEngine::VulkanUtil::createSkeletalPipeline(VkDevice& logicalDevice, VkP
     fragShaderStageInfo.module = fragShader;
     fragShaderStageInfo.pName = "main";
 
+    // The vertex shader decodes the normal and tangent if the vertices are compressed
+    VkSpecializationMapEntry specializationEntry{};
+    specializationEntry.constantID = 0;
+    specializationEntry.offset = 0;
+    specializationEntry.size = sizeof(VkBool32);
+
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationEntry;
+    specializationInfo.dataSize = sizeof(VkBool32);
+    specializationInfo.pData = &vertexInput.compressed;
+
+    vertShaderStageInfo.pSpecializationInfo = &specializationInfo;
+
     VkPipelineShaderStageCreateInfo stages[] = { vertShaderStageInfo , fragShaderStageInfo };
 
     // Shader code inputs
-    // Position
-    VkVertexInputBindingDescription vertexInputs[6]{};
-    vertexInputs[0].binding = 0;
-    vertexInputs[0].stride = sizeof(vec3);
-    vertexInputs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // Normal
-    vertexInputs[1].binding = 1;
-    vertexInputs[1].stride = sizeof(vec3);
-    vertexInputs[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // Tangent
-    vertexInputs[2].binding = 2;
-    vertexInputs[2].stride = sizeof(vec3);
-    vertexInputs[2].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // UV
-    vertexInputs[3].binding = 3;
-    vertexInputs[3].stride = sizeof(vec2);
-    vertexInputs[3].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // Bone IDs
-    vertexInputs[4].binding = 4;
-    vertexInputs[4].stride = sizeof(ivec4);
-    vertexInputs[4].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // Weights
-    vertexInputs[5].binding = 5;
-    vertexInputs[5].stride = sizeof(vec4);
-    vertexInputs[5].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-    VkVertexInputAttributeDescription vertexAttrib[6]{};
-    // Position
-    vertexAttrib[0].location = 0;
-    vertexAttrib[0].binding = 0;
-    vertexAttrib[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttrib[0].offset = 0;
-    // Normal
-    vertexAttrib[1].location = 1;
-    vertexAttrib[1].binding = 1;
-    vertexAttrib[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttrib[1].offset = 0;
-    // Tangent
-    vertexAttrib[2].location = 2;
-    vertexAttrib[2].binding = 2;
-    vertexAttrib[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttrib[2].offset = 0;
-    // UV
-    vertexAttrib[3].location = 3;
-    vertexAttrib[3].binding = 3;
-    vertexAttrib[3].format = VK_FORMAT_R32G32_SFLOAT;
-    vertexAttrib[3].offset = 0;
-    // Bone IDs
-    vertexAttrib[4].location = 4;
-    vertexAttrib[4].binding = 4;
-    //vertexAttrib[4].format = VK_FORMAT_R8G8B8A8_SINT;
-    vertexAttrib[4].format = VK_FORMAT_R32G32B32A32_SINT;
-    vertexAttrib[4].offset = 0;
-    // Weights
-    vertexAttrib[5].location = 5;
-    vertexAttrib[5].binding = 5;
-    vertexAttrib[5].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-    vertexAttrib[5].offset = 0;
-
-    // Input Info
     VkPipelineVertexInputStateCreateInfo inputInfo{};
     inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    inputInfo.vertexBindingDescriptionCount = sizeof(vertexInputs) / sizeof(vertexInputs[0]);
-    inputInfo.pVertexBindingDescriptions = vertexInputs;
-    inputInfo.vertexAttributeDescriptionCount = sizeof(vertexAttrib) / sizeof(vertexAttrib[0]);
-    inputInfo.pVertexAttributeDescriptions = vertexAttrib;
+    inputInfo.vertexBindingDescriptionCount = static_cast<u32>(vertexInput.bindings.size());
+    inputInfo.pVertexBindingDescriptions = vertexInput.bindings.data();
+    inputInfo.vertexAttributeDescriptionCount = static_cast<u32>(vertexInput.attributes.size());
+    inputInfo.pVertexAttributeDescriptions = vertexInput.attributes.data();
 
     // Input assembly
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -1161,8 +1402,8 @@ void WillEngine::VulkanUtil::createSkeletalPipeline(VkDevice& logicalDevice, VkP
     multisampleInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
     multisampleInfo.sampleShadingEnable = VK_FALSE;
 
-    VkPipelineColorBlendAttachmentState colorBlend[Material::BRDF_TEXTURE_SIZE]{};
-    for (u32 i = 0; i < Material::BRDF_TEXTURE_SIZE; i++)
+    VkPipelineColorBlendAttachmentState colorBlend[VulkanFramebuffer::ATTACHMENT_SIZE]{};
+    for (u32 i = 0; i < VulkanFramebuffer::ATTACHMENT_SIZE; i++)
     {
         colorBlend[i].blendEnable = VK_FALSE;
         colorBlend[i].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
@@ -1215,7 +1456,7 @@ void WillEngine::VulkanUtil::createSkeletalPipeline(VkDevice& logicalDevice, VkP
 }
 
 void WillEngine::VulkanUtil::createGeometryPipeline(VkDevice& logicalDevice, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout, VkRenderPass& renderpass,
-    VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent)
+    VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent, const VulkanVertexInput& vertexInput)
 {
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -1229,56 +1470,29 @@ void WillEngine::VulkanUtil::createGeometryPipeline(VkDevice& logicalDevice, VkP
     fragShaderStageInfo.module = fragShader;
     fragShaderStageInfo.pName = "main";
 
-    VkPipelineShaderStageCreateInfo stages[] = { vertShaderStageInfo , fragShaderStageInfo };
+    // The vertex shader decodes the normal and tangent if the vertices are compressed
+    VkSpecializationMapEntry specializationEntry{};
+    specializationEntry.constantID = 0;
+    specializationEntry.offset = 0;
+    specializationEntry.size = sizeof(VkBool32);
 
-    // Shader code inputs
-    // Position
-    VkVertexInputBindingDescription vertexInputs[4]{};
-    vertexInputs[0].binding = 0;
-    vertexInputs[0].stride = sizeof(vec3);
-    vertexInputs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // Normal
-    vertexInputs[1].binding = 1;
-    vertexInputs[1].stride = sizeof(vec3);
-    vertexInputs[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // Tangent
-    vertexInputs[2].binding = 2;
-    vertexInputs[2].stride = sizeof(vec3);
-    vertexInputs[2].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // UV
-    vertexInputs[3].binding = 3;
-    vertexInputs[3].stride = sizeof(vec2);
-    vertexInputs[3].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationEntry;
+    specializationInfo.dataSize = sizeof(VkBool32);
+    specializationInfo.pData = &vertexInput.compressed;
 
-    VkVertexInputAttributeDescription vertexAttrib[4]{};
-    // Position
-    vertexAttrib[0].location = 0;
-    vertexAttrib[0].binding = 0;
-    vertexAttrib[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttrib[0].offset = 0;
-    // Normal
-    vertexAttrib[1].location = 1;
-    vertexAttrib[1].binding = 1;
-    vertexAttrib[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttrib[1].offset = 0;
-    // Tangent
-    vertexAttrib[2].location = 2;
-    vertexAttrib[2].binding = 2;
-    vertexAttrib[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttrib[2].offset = 0;
-    // UV
-    vertexAttrib[3].location = 3;
-    vertexAttrib[3].binding = 3;
-    vertexAttrib[3].format = VK_FORMAT_R32G32_SFLOAT;
-    vertexAttrib[3].offset = 0;
+    vertShaderStageInfo.pSpecializationInfo = &specializationInfo;
 
-    // Input Info
+    VkPipelineShaderStageCreateInfo stages[] = { vertShaderStageInfo , fragShaderStageInfo };
+
+    // Shader code inputs
     VkPipelineVertexInputStateCreateInfo inputInfo{};
     inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    inputInfo.vertexBindingDescriptionCount = sizeof(vertexInputs) / sizeof(vertexInputs[0]);
-    inputInfo.pVertexBindingDescriptions = vertexInputs;
-    inputInfo.vertexAttributeDescriptionCount = sizeof(vertexAttrib) / sizeof(vertexAttrib[0]);
-    inputInfo.pVertexAttributeDescriptions = vertexAttrib;
+    inputInfo.vertexBindingDescriptionCount = static_cast<u32>(vertexInput.bindings.size());
+    inputInfo.pVertexBindingDescriptions = vertexInput.bindings.data();
+    inputInfo.vertexAttributeDescriptionCount = static_cast<u32>(vertexInput.attributes.size());
+    inputInfo.pVertexAttributeDescriptions = vertexInput.attributes.data();
 
     // Input assembly
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -1324,8 +1538,8 @@ void WillEngine::VulkanUtil::createGeometryPipeline(VkDevice& logicalDevice, VkP
     multisampleInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
     multisampleInfo.sampleShadingEnable = VK_FALSE;
 
-    VkPipelineColorBlendAttachmentState colorBlend[Material::BRDF_TEXTURE_SIZE]{};
-    for (u32 i = 0; i < Material::BRDF_TEXTURE_SIZE; i++)
+    VkPipelineColorBlendAttachmentState colorBlend[VulkanFramebuffer::ATTACHMENT_SIZE]{};
+    for (u32 i = 0; i < VulkanFramebuffer::ATTACHMENT_SIZE; i++)
     {
         colorBlend[i].blendEnable = VK_FALSE;
         colorBlend[i].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
@@ -1496,7 +1710,7 @@ void WillEngine::VulkanUtil::createShadingPipeline(VkDevice& logicalDevice, VkPi
 }
 
 void WillEngine::VulkanUtil::createShadowPipeline(VkDevice& logicalDevice, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout, VkRenderPass& renderpass,
-    VkShaderModule& vertShader, VkShaderModule& geomShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, u32 width, u32 height)
+    VkShaderModule& vertShader, VkShaderModule& geomShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, u32 width, u32 height, const VulkanVertexInput& vertexInput)
 {
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -1519,53 +1733,12 @@ void WillEngine::VulkanUtil::createShadowPipeline(VkDevice& logicalDevice, VkPip
     VkPipelineShaderStageCreateInfo stages[] = { vertShaderStageInfo, geomShaderStageInfo, fragShaderStageInfo };
 
     // Shader code inputs
-    // Position
-    VkVertexInputBindingDescription vertexInputs[4]{};
-    vertexInputs[0].binding = 0;
-    vertexInputs[0].stride = sizeof(vec3);
-    vertexInputs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // Normal
-    vertexInputs[1].binding = 1;
-    vertexInputs[1].stride = sizeof(vec3);
-    vertexInputs[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // Tangent
-    vertexInputs[2].binding = 2;
-    vertexInputs[2].stride = sizeof(vec3);
-    vertexInputs[2].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // UV
-    vertexInputs[3].binding = 3;
-    vertexInputs[3].stride = sizeof(vec2);
-    vertexInputs[3].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-    VkVertexInputAttributeDescription vertexAttrib[4]{};
-    // Position
-    vertexAttrib[0].location = 0;
-    vertexAttrib[0].binding = 0;
-    vertexAttrib[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttrib[0].offset = 0;
-    // Normal
-    vertexAttrib[1].location = 1;
-    vertexAttrib[1].binding = 1;
-    vertexAttrib[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttrib[1].offset = 0;
-    // Tangent
-    vertexAttrib[2].location = 2;
-    vertexAttrib[2].binding = 2;
-    vertexAttrib[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttrib[2].offset = 0;
-    // UV
-    vertexAttrib[3].location = 3;
-    vertexAttrib[3].binding = 3;
-    vertexAttrib[3].format = VK_FORMAT_R32G32_SFLOAT;
-    vertexAttrib[3].offset = 0;
-
-    // Input Info
     VkPipelineVertexInputStateCreateInfo inputInfo{};
     inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    inputInfo.vertexBindingDescriptionCount = sizeof(vertexInputs) / sizeof(vertexInputs[0]);
-    inputInfo.pVertexBindingDescriptions = vertexInputs;
-    inputInfo.vertexAttributeDescriptionCount = sizeof(vertexAttrib) / sizeof(vertexAttrib[0]);
-    inputInfo.pVertexAttributeDescriptions = vertexAttrib;
+    inputInfo.vertexBindingDescriptionCount = static_cast<u32>(vertexInput.bindings.size());
+    inputInfo.pVertexBindingDescriptions = vertexInput.bindings.data();
+    inputInfo.vertexAttributeDescriptionCount = static_cast<u32>(vertexInput.attributes.size());
+    inputInfo.pVertexAttributeDescriptions = vertexInput.attributes.data();
 
     // Input assembly
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -1643,7 +1816,7 @@ void WillEngine::VulkanUtil::createShadowPipeline(VkDevice& logicalDevice, VkPip
 }
 
 void WillEngine::VulkanUtil::createDepthPipeline(VkDevice& logicalDevice, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout, VkRenderPass& renderpass,
-    VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent)
+    VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent, const VulkanVertexInput& vertexInput)
 {
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -1660,53 +1833,12 @@ void WillEngine::VulkanUtil::createDepthPipeline(VkDevice& logicalDevice, VkPipe
     VkPipelineShaderStageCreateInfo stages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
     // Shader code inputs
-    // Position
-    VkVertexInputBindingDescription vertexInputs[4]{};
-    vertexInputs[0].binding = 0;
-    vertexInputs[0].stride = sizeof(vec3);
-    vertexInputs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // Normal
-    vertexInputs[1].binding = 1;
-    vertexInputs[1].stride = sizeof(vec3);
-    vertexInputs[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // Tangent
-    vertexInputs[2].binding = 2;
-    vertexInputs[2].stride = sizeof(vec3);
-    vertexInputs[2].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // UV
-    vertexInputs[3].binding = 3;
-    vertexInputs[3].stride = sizeof(vec2);
-    vertexInputs[3].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-    VkVertexInputAttributeDescription vertexAttrib[4]{};
-    // Position
-    vertexAttrib[0].location = 0;
-    vertexAttrib[0].binding = 0;
-    vertexAttrib[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttrib[0].offset = 0;
-    // Normal
-    vertexAttrib[1].location = 1;
-    vertexAttrib[1].binding = 1;
-    vertexAttrib[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttrib[1].offset = 0;
-    // Tangent
-    vertexAttrib[2].location = 2;
-    vertexAttrib[2].binding = 2;
-    vertexAttrib[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttrib[2].offset = 0;
-    // UV
-    vertexAttrib[3].location = 3;
-    vertexAttrib[3].binding = 3;
-    vertexAttrib[3].format = VK_FORMAT_R32G32_SFLOAT;
-    vertexAttrib[3].offset = 0;
-
-    // Input Info
     VkPipelineVertexInputStateCreateInfo inputInfo{};
     inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    inputInfo.vertexBindingDescriptionCount = sizeof(vertexInputs) / sizeof(vertexInputs[0]);
-    inputInfo.pVertexBindingDescriptions = vertexInputs;
-    inputInfo.vertexAttributeDescriptionCount = sizeof(vertexAttrib) / sizeof(vertexAttrib[0]);
-    inputInfo.pVertexAttributeDescriptions = vertexAttrib;
+    inputInfo.vertexBindingDescriptionCount = static_cast<u32>(vertexInput.bindings.size());
+    inputInfo.pVertexBindingDescriptions = vertexInput.bindings.data();
+    inputInfo.vertexAttributeDescriptionCount = static_cast<u32>(vertexInput.attributes.size());
+    inputInfo.pVertexAttributeDescriptions = vertexInput.attributes.data();
 
     // Input assembly
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -1791,7 +1923,7 @@ void WillEngine::VulkanUtil::createDepthPipeline(VkDevice& logicalDevice, VkPipe
 }
 
 void WillEngine::VulkanUtil::createDepthSkeletalPipeline(VkDevice& logicalDevice, VkPipeline& pipeline, VkPipelineLayout& pipelineLayout, VkRenderPass& renderpass,
-    VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent)
+    VkShaderModule& vertShader, VkShaderModule& fragShader, VkPrimitiveTopology primitive, VkExtent2D extent, const VulkanVertexInput& vertexInput)
 {
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -1808,72 +1940,12 @@ void WillEngine::VulkanUtil::createDepthSkeletalPipeline(VkDevice& logicalDevice
     VkPipelineShaderStageCreateInfo stages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
     // Shader code inputs
-    // Position
-    VkVertexInputBindingDescription vertexInputs[6]{};
-    vertexInputs[0].binding = 0;
-    vertexInputs[0].stride = sizeof(vec3);
-    vertexInputs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // Normal
-    vertexInputs[1].binding = 1;
-    vertexInputs[1].stride = sizeof(vec3);
-    vertexInputs[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // Tangent
-    vertexInputs[2].binding = 2;
-    vertexInputs[2].stride = sizeof(vec3);
-    vertexInputs[2].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // UV
-    vertexInputs[3].binding = 3;
-    vertexInputs[3].stride = sizeof(vec2);
-    vertexInputs[3].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // Bone IDs
-    vertexInputs[4].binding = 4;
-    vertexInputs[4].stride = sizeof(ivec4);
-    vertexInputs[4].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    // Weights
-    vertexInputs[5].binding = 5;
-    vertexInputs[5].stride = sizeof(vec4);
-    vertexInputs[5].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-    VkVertexInputAttributeDescription vertexAttrib[6]{};
-    // Position
-    vertexAttrib[0].location = 0;
-    vertexAttrib[0].binding = 0;
-    vertexAttrib[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttrib[0].offset = 0;
-    // Normal
-    vertexAttrib[1].location = 1;
-    vertexAttrib[1].binding = 1;
-    vertexAttrib[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttrib[1].offset = 0;
-    // Tangent
-    vertexAttrib[2].location = 2;
-    vertexAttrib[2].binding = 2;
-    vertexAttrib[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexAttrib[2].offset = 0;
-    // UV
-    vertexAttrib[3].location = 3;
-    vertexAttrib[3].binding = 3;
-    vertexAttrib[3].format = VK_FORMAT_R32G32_SFLOAT;
-    vertexAttrib[3].offset = 0;
-    // Bone IDs
-    vertexAttrib[4].location = 4;
-    vertexAttrib[4].binding = 4;
-    //vertexAttri[4].format = VK_FORMAT_R8G8B8A8_SINT;
-    vertexAttrib[4].format = VK_FORMAT_R32G32B32A32_SINT;
-    vertexAttrib[4].offset = 0;
-    // Weights
-    vertexAttrib[5].location = 5;
-    vertexAttrib[5].binding = 5;
-    vertexAttrib[5].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-    vertexAttrib[5].offset = 0;
-
-    // Input Info
     VkPipelineVertexInputStateCreateInfo inputInfo{};
     inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    inputInfo.vertexBindingDescriptionCount = sizeof(vertexInputs) / sizeof(vertexInputs[0]);
-    inputInfo.pVertexBindingDescriptions = vertexInputs;
-    inputInfo.vertexAttributeDescriptionCount = sizeof(vertexAttrib) / sizeof(vertexAttrib[0]);
-    inputInfo.pVertexAttributeDescriptions = vertexAttrib;
+    inputInfo.vertexBindingDescriptionCount = static_cast<u32>(vertexInput.bindings.size());
+    inputInfo.pVertexBindingDescriptions = vertexInput.bindings.data();
+    inputInfo.vertexAttributeDescriptionCount = static_cast<u32>(vertexInput.attributes.size());
+    inputInfo.pVertexAttributeDescriptions = vertexInput.attributes.data();
 
     // Input assembly
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -0,0 +1,491 @@
+#include "pch.h"
+
+#include "Core/Mesh.h"
+#include "Core/Skeleton.h"
+#include "Core/BakedAnimation.h"
+#include "Core/Meshlet.h"
+#include "Core/RangeAllocator.h"
+#include "Core/DrawSorter.h"
+
+#include "Core/ECS/TransformComponent.h"
+
+#include "Utils/MeshOptimizer.h"
+#include "Utils/MeshletBuilder.h"
+#include "Utils/MeshSimplifier.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <numeric>
+#include <random>
+#include <unordered_set>
+
+// Headless behaviour checks
+// Runs the engine utilities on generated data and checks the results, without creating a window or a Vulkan device
+//
+// Usage: BehaviourTests
+// Prints every failed check and returns 1 if any failed
+
+static u32 numChecks = 0;
+static u32 numFailures = 0;
+
+static void check(bool condition, const char* name)
+{
+	numChecks++;
+
+	if (condition)
+		return;
+
+	numFailures++;
+	printf("FAILED: %s\n", name);
+}
+
+// Flat grid of quads in the xz plane, split into two triangles each
+static Mesh* createGrid(u32 size)
+{
+	Mesh* mesh = new Mesh();
+
+	for (u32 z = 0; z <= size; z++)
+	{
+		for (u32 x = 0; x <= size; x++)
+		{
+			mesh->positions.push_back(vec3(x, 0, z));
+		}
+	}
+
+	const u32 rowSize = size + 1;
+	for (u32 z = 0; z < size; z++)
+	{
+		for (u32 x = 0; x < size; x++)
+		{
+			const u32 corner = z * rowSize + x;
+
+			mesh->indicies.insert(mesh->indicies.end(), { corner, corner + rowSize, corner + 1 });
+			mesh->indicies.insert(mesh->indicies.end(), { corner + 1, corner + rowSize, corner + rowSize + 1 });
+		}
+	}
+
+	mesh->indiciesSize = static_cast<u32>(mesh->indicies.size());
+	mesh->computeBounds();
+
+	return mesh;
+}
+
+// Put the triangles in a random order, the worst case for the vertex cache and the meshlet vertex limit
+static void shuffleTriangles(std::vector<u32>& indices, u32 seed)
+{
+	const u32 numTriangles = static_cast<u32>(indices.size() / 3);
+
+	std::vector<u32> triangles(numTriangles);
+	std::iota(triangles.begin(), triangles.end(), 0);
+	std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+
+	std::vector<u32> shuffled;
+	shuffled.reserve(indices.size());
+	for (u32 triangle : triangles)
+	{
+		shuffled.insert(shuffled.end(), indices.begin() + triangle * 3, indices.begin() + triangle * 3 + 3);
+	}
+
+	indices.swap(shuffled);
+}
+
+static void checkMeshlets(Mesh* mesh)
+{
+	WillEngine::Utils::buildMeshlets(mesh);
+
+	check(!mesh->meshlets.empty(), "meshlets: a triangle list builds meshlets");
+
+	bool withinVertexLimit = true;
+	bool withinTriangleLimit = true;
+	bool vertexCountMatches = true;
+	bool contiguous = true;
+
+	u32 nextIndex = 0;
+	std::unordered_set<u32> vertices;
+
+	for (const Meshlet& meshlet : mesh->meshlets)
+	{
+		vertices.clear();
+		vertices.insert(mesh->indicies.begin() + meshlet.firstIndex, mesh->indicies.begin() + meshlet.firstIndex + meshlet.numIndices);
+
+		withinVertexLimit &= meshlet.numVertices <= WillEngine::Utils::MAX_MESHLET_VERTICES;
+		withinTriangleLimit &= meshlet.numIndices % 3 == 0 && meshlet.numIndices / 3 <= WillEngine::Utils::MAX_MESHLET_TRIANGLES;
+		vertexCountMatches &= vertices.size() == meshlet.numVertices;
+		contiguous &= meshlet.firstIndex == nextIndex;
+
+		nextIndex = meshlet.firstIndex + meshlet.numIndices;
+	}
+
+	check(withinVertexLimit, "meshlets: at most 64 vertices per meshlet");
+	check(withinTriangleLimit, "meshlets: at most 124 triangles per meshlet");
+	check(vertexCountMatches, "meshlets: vertex count matches the unique indices");
+	check(contiguous && nextIndex == mesh->indicies.size(), "meshlets: every triangle is in exactly one meshlet");
+}
+
+static void testMeshlets()
+{
+	// In cache order the triangle limit ends the meshlets
+	Mesh* orderedGrid = createGrid(64);
+	checkMeshlets(orderedGrid);
+	delete orderedGrid;
+
+	// In random order nearly every triangle brings new vertices, so the vertex limit ends them
+	Mesh* shuffledGrid = createGrid(64);
+	shuffleTriangles(shuffledGrid->indicies, 1);
+	checkMeshlets(shuffledGrid);
+	delete shuffledGrid;
+}
+
+static void testSimplifier()
+{
+	// Closed torus with a UV seam, the first ring of vertices is duplicated at the end with exactly the same positions
+	const u32 numRings = 48;
+	const u32 numSides = 24;
+	const f32 majorRadius = 2.0f;
+	const f32 minorRadius = 0.5f;
+
+	std::vector<vec3> positions;
+	for (u32 ring = 0; ring <= numRings; ring++)
+	{
+		for (u32 side = 0; side < numSides; side++)
+		{
+			if (ring == numRings)
+			{
+				positions.push_back(positions[side]);
+				continue;
+			}
+
+			const f32 u = glm::two_pi<f32>() * ring / numRings;
+			const f32 v = glm::two_pi<f32>() * side / numSides;
+			const f32 radius = majorRadius + minorRadius * cos(v);
+
+			positions.push_back(vec3(radius * cos(u), minorRadius * sin(v), radius * sin(u)));
+		}
+	}
+
+	std::vector<u32> indices;
+	for (u32 ring = 0; ring < numRings; ring++)
+	{
+		for (u32 side = 0; side < numSides; side++)
+		{
+			const u32 a = ring * numSides + side;
+			const u32 b = ring * numSides + (side + 1) % numSides;
+			const u32 c = a + numSides;
+			const u32 d = b + numSides;
+
+			indices.insert(indices.end(), { a, c, b });
+			indices.insert(indices.end(), { b, c, d });
+		}
+	}
+
+	const std::vector<bool> locked = WillEngine::Utils::findLockedVertices(indices, positions);
+
+	// The torus has no border, so only the seam is locked
+	bool seamLocked = true;
+	bool restUnlocked = true;
+	for (u32 i = 0; i < positions.size(); i++)
+	{
+		const u32 ring = i / numSides;
+
+		if (ring == 0 || ring == numRings)
+			seamLocked &= locked[i];
+		else
+			restUnlocked &= !locked[i];
+	}
+
+	check(seamLocked, "simplifier: seam vertices are locked");
+	check(restUnlocked, "simplifier: vertices away from the seam are not locked");
+
+	const std::vector<u32> groups(positions.size(), 0);
+	const u32 targetIndexCount = static_cast<u32>(indices.size() / 3 * WillEngine::Utils::LOD_TRIANGLE_RATIO) * 3;
+
+	f32 error = 0;
+	const std::vector<u32> simplified = WillEngine::Utils::simplifyMesh(indices, positions, groups, locked, targetIndexCount, error);
+
+	check(!simplified.empty() && simplified.size() % 3 == 0, "simplifier: the result is a triangle list");
+	check(simplified.size() <= indices.size() * (1.0f - WillEngine::Utils::LOD_MIN_REDUCTION), "simplifier: triangles are removed");
+
+	// Locked vertices never collapse, so the seam keeps every vertex on both sides
+	std::vector<bool> used(positions.size(), false);
+	for (u32 index : simplified)
+	{
+		used[index] = true;
+	}
+
+	bool seamKept = true;
+	for (u32 i = 0; i < positions.size(); i++)
+	{
+		if (locked[i])
+			seamKept &= used[i];
+	}
+
+	check(seamKept, "simplifier: every seam vertex is still used");
+}
+
+static void testVertexCache()
+{
+	Mesh* mesh = createGrid(64);
+	shuffleTriangles(mesh->indicies, 2);
+
+	const u32 numIndices = static_cast<u32>(mesh->indicies.size());
+
+	WillEngine::Utils::VertexCacheStatistics before;
+	WillEngine::Utils::VertexCacheStatistics after;
+	WillEngine::Utils::optimizeMesh(mesh, false, before, after);
+
+	printf("ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", before.acmr, after.acmr, before.atvr, after.atvr);
+
+	check(mesh->indicies.size() == numIndices, "vertex cache: no triangle is lost");
+	check(after.acmr < before.acmr, "vertex cache: ACMR goes down");
+	// A shuffled grid misses about every vertex of a triangle, a cache ordered one about one vertex per triangle or less
+	check(after.acmr < 1.0f, "vertex cache: ACMR below 1 on a regular grid");
+
+	// The statistics reported must be the ones of the final index buffer
+	const WillEngine::Utils::VertexCacheStatistics measured = WillEngine::Utils::analyzeVertexCache(mesh->indicies,
+		static_cast<u32>(mesh->positions.size()), WillEngine::Utils::VERTEX_CACHE_SIZE);
+	check(measured.acmr == after.acmr, "vertex cache: reported ACMR matches the index buffer");
+
+	delete mesh;
+}
+
+static void testRangeAllocator()
+{
+	RangeAllocator allocator;
+	allocator.reset(30);
+
+	u32 first = 0;
+	u32 second = 0;
+	u32 third = 0;
+	check(allocator.allocate(10, first) && allocator.allocate(10, second) && allocator.allocate(10, third), "range allocator: allocations fit");
+	check(allocator.getAllocated() == 30 && allocator.getLargestFreeRange() == 0, "range allocator: full after allocating the capacity");
+
+	u32 overflow = 0;
+	check(!allocator.allocate(1, overflow), "range allocator: allocation fails when full");
+
+	// Free the middle range first so the outer ones each merge with it
+	allocator.free(second, 10);
+	check(allocator.getLargestFreeRange() == 10, "range allocator: freed range is reusable");
+
+	allocator.free(first, 10);
+	check(allocator.getLargestFreeRange() == 20, "range allocator: neighbouring free ranges merge");
+
+	allocator.free(third, 10);
+	check(allocator.getLargestFreeRange() == 30 && allocator.getAllocated() == 0, "range allocator: everything merges back into one range");
+	check(allocator.getFragmentation() == 0.0f, "range allocator: no fragmentation once merged");
+
+	// Growing a full allocator keeps the allocations and adds one free range at the end
+	allocator.reset(10);
+	check(allocator.allocate(10, first), "range allocator: allocation fits before growing");
+
+	allocator.grow(20);
+	check(allocator.getCapacity() == 20 && allocator.getAllocated() == 10, "range allocator: growing keeps the allocations");
+	check(allocator.getLargestFreeRange() == 10, "range allocator: growing adds the new space");
+
+	allocator.free(first, 10);
+	check(allocator.getLargestFreeRange() == 20 && allocator.getAllocated() == 0, "range allocator: grown space merges with freed ranges");
+
+	// Free space at the end merges with the grown space
+	allocator.reset(20);
+	check(allocator.allocate(10, first), "range allocator: allocation fits before growing a partly free allocator");
+
+	allocator.grow(40);
+	check(allocator.getLargestFreeRange() == 30 && allocator.getFragmentation() == 0.0f, "range allocator: grown space merges with the free end");
+}
+
+static void checkSortOrder(const std::vector<u64>& keys, u32 maxThreads, const char* name)
+{
+	DrawSorter sorter;
+	sorter.sort(keys, maxThreads);
+
+	const std::vector<u32>& order = sorter.getOrder();
+
+	bool permutation = order.size() == keys.size();
+	bool sorted = true;
+	bool stable = true;
+
+	std::vector<bool> seen(keys.size(), false);
+	for (u32 i = 0; i < order.size() && permutation; i++)
+	{
+		permutation &= order[i] < keys.size() && !seen[order[i]];
+		if (!permutation)
+			break;
+
+		seen[order[i]] = true;
+
+		if (i == 0)
+			continue;
+
+		const u64 previousKey = keys[order[i - 1]];
+		const u64 key = keys[order[i]];
+
+		sorted &= previousKey <= key;
+		// Packets with equal keys keep the order they were gathered in
+		stable &= previousKey != key || order[i - 1] < order[i];
+	}
+
+	printf("%s: %u keys on up to %u threads\n", name, static_cast<u32>(keys.size()), maxThreads);
+
+	check(permutation, "draw sorter: the order holds every packet once");
+	check(sorted, "draw sorter: keys are in ascending order");
+	check(stable, "draw sorter: equal keys keep their order");
+}
+
+static void testDrawSorter()
+{
+	std::mt19937_64 random(3);
+
+	// Few distinct keys spread over every byte, so every pass moves keys and there are many equal ones
+	std::vector<u64> keys(50000);
+	for (u64& key : keys)
+	{
+		key = (random() % 64) * 0x0101010101010101ull;
+	}
+
+	checkSortOrder(keys, 1, "draw sorter");
+	checkSortOrder(keys, 8, "draw sorter");
+
+	// Keys that only differ in the low bytes skip the passes of the common bytes
+	for (u64& key : keys)
+	{
+		key = 0xABCD000000000000ull | (random() & 0xFFFF);
+	}
+
+	checkSortOrder(keys, 8, "draw sorter common bytes");
+
+	checkSortOrder({}, 8, "draw sorter empty");
+	checkSortOrder({ 42 }, 8, "draw sorter single");
+}
+
+static Entity* createNode(Entity* parent, const char* name, const vec3& position, std::vector<Entity*>& entities)
+{
+	Entity* entity = parent ? new Entity(parent, name) : new Entity(name);
+
+	if (parent)
+		parent->addChild(entity);
+
+	entity->addComponent(new TransformComponent(entity, position, vec3(0), vec3(1)));
+	entities.push_back(entity);
+
+	return entity;
+}
+
+// Keys half way between the ticks, so sampling at a tick never lands exactly on a key
+static void addKeys(Animation* animation, const char* nodeName, f32 phase)
+{
+	AnimationNode& node = animation->animationNodes.emplace(nodeName, AnimationNode(nodeName)).first->second;
+
+	for (u32 i = 0; i < static_cast<u32>(animation->getNumTicks()); i++)
+	{
+		const f64 time = i + 0.5;
+
+		node.addPosition(vec3(0.0f, 0.5f, 0.1f * i), time);
+		node.addRotation(glm::angleAxis(phase + 0.3f * i, glm::normalize(vec3(1, 1, 0))), time);
+		node.addScale(vec3(1.0f + 0.05f * i), time);
+	}
+}
+
+// Largest difference between the baked bone matrices and the ones updatePose gives at the same frames
+static f32 getBakedError(Skeleton* skeleton, const Animation* animation, PoseCache* poseCache)
+{
+	// One baked frame per tick
+	const f32 frameRate = static_cast<f32>(animation->getTicksPerSecond());
+
+	u32 numFrames = 0;
+	const std::vector<mat4> baked = BakedAnimation::bake(skeleton, animation, frameRate, numFrames);
+
+	const u32 numBones = skeleton->getNumBones();
+
+	AnimationComponent animationComp;
+
+	f32 maxError = 0.0f;
+
+	for (u32 frame = 0; frame < numFrames; frame++)
+	{
+		// Anywhere in the tick of the frame gives the same pose
+		animationComp.setTime((frame + 0.5) / animation->getTicksPerSecond());
+
+		if (poseCache)
+			poseCache->beginFrame();
+
+		skeleton->updatePose(animation, &animationComp, poseCache);
+		skeleton->updateBoneUniform();
+
+		for (u32 bone = 0; bone < numBones; bone++)
+		{
+			const mat4& expected = baked[static_cast<u64>(frame) * numBones + bone];
+			const mat4& sampled = skeleton->boneUniform.boneMatrices[bone];
+
+			for (u32 column = 0; column < 4; column++)
+			{
+				const vec4 difference = glm::abs(expected[column] - sampled[column]);
+				maxError = std::max(maxError, std::max(std::max(difference.x, difference.y), std::max(difference.z, difference.w)));
+			}
+		}
+	}
+
+	return maxError;
+}
+
+static void testBakedAnimation()
+{
+	const f32 tolerance = 1e-4f;
+
+	// A placed root with a chain of three bones
+	std::vector<Entity*> entities;
+	Entity* rootEntity = createNode(nullptr, "Model", vec3(2.0f, 0.0f, 1.0f), entities);
+	Entity* hipEntity = createNode(rootEntity, "Hip", vec3(0.0f, 1.0f, 0.0f), entities);
+	Entity* spineEntity = createNode(hipEntity, "Spine", vec3(0.0f, 0.5f, 0.0f), entities);
+	createNode(spineEntity, "Head", vec3(0.0f, 0.4f, 0.0f), entities);
+
+	Skeleton* skeleton = new Skeleton();
+
+	BoneInfo::beginCreation();
+	for (const char* boneName : { "Hip", "Spine", "Head" })
+	{
+		BoneInfo bone{};
+		bone.setName(boneName);
+		skeleton->addBone(bone);
+	}
+	BoneInfo::endCreation();
+
+	skeleton->generateHierarchy(rootEntity);
+
+	// The second clip leaves the spine to its bind pose
+	Animation* walk = new Animation("Walk", 8, 24);
+	addKeys(walk, "Hip", 0.0f);
+	addKeys(walk, "Spine", 1.0f);
+
+	Animation* wave = new Animation("Wave", 6, 24);
+	addKeys(wave, "Hip", 2.0f);
+
+	PoseCache poseCache;
+
+	check(getBakedError(skeleton, walk, nullptr) < tolerance, "baked animation: baked frames match updatePose");
+	check(getBakedError(skeleton, walk, &poseCache) < tolerance, "baked animation: baked frames match the cached pose");
+	// Played right after the first clip, the spine must not keep the first clip's pose
+	check(getBakedError(skeleton, wave, nullptr) < tolerance, "baked animation: nodes the new clip doesn't animate are reset");
+
+	delete wave;
+	delete walk;
+	delete skeleton;
+
+	for (Entity* entity : entities)
+	{
+		delete entity->GetComponent<TransformComponent>();
+		delete entity;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	testMeshlets();
+	testSimplifier();
+	testVertexCache();
+	testRangeAllocator();
+	testDrawSorter();
+	testBakedAnimation();
+
+	printf("%u of %u checks passed\n", numChecks - numFailures, numChecks);
+
+	return numFailures == 0 ? 0 : 1;
+}